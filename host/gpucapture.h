@@ -0,0 +1,45 @@
+/*
+ * GP0 packet capture for the host build
+ *
+ * host/gpuio.c implements the hardware layer of gpu.h by walking each linked
+ * list passed to sendLinkedList() the way the GPU DMA channel would, and
+ * decoding every GP0 command in it. Per frame it counts list entries,
+ * non-empty packets, command words and primitives, and estimates the GPU
+ * fill cost from the area each primitive covers inside the drawing area:
+ *
+ *   cycles = setup + pixels * (1 + textured + semi-transparent)
+ *
+ * with a fixed setup cost per primitive. It's a rough model of the GPU,
+ * good for comparing two versions of a draw path against each other rather
+ * than for absolute timings. Polygon areas are exact, the part outside the
+ * drawing area is estimated from their bounding boxes.
+ *
+ * bench.c prints the totals at the end of each scenario, after its own
+ * results line:
+ *
+ *   HOST name=<name> frames=<n> entries=<avg>/<max> packets=<avg>/<max>
+ *        words=<avg>/<max> prims=<avg>/<max> pixels=<avg>/<max>
+ *        gpu=<avg>/<max> load=<percent> upload=<halfwords> errors=<n>
+ *
+ * gpu is the estimated cycles per frame and load the average as a share of
+ * a 60 Hz frame, errors counts malformed packets. Setting LANDER_GP0_DUMP to
+ * a path also writes every frame's command stream there as it's sent: a
+ * uint32_t word count, then the GP0 words in drawing order without the list
+ * tags, all little endian.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Clear the totals at the start of a scenario */
+void resetGPUCapture(void);
+
+/* Print the totals since the last reset */
+void printGPUCapture(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,433 @@
+/*
+ * GPU hardware layer for the host build, capturing instead of drawing
+ *
+ * Stands in for src/gpuio.c, see gpucapture.h for what gets measured.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "gpu.h"
+#include "gpucapture.h"
+#include "ps1/gpucmd.h"
+
+/* Rough GPU cycles spent setting up each kind of primitive */
+#define POLYGON_SETUP_CYCLES 16
+#define RECT_SETUP_CYCLES     8
+#define LINE_SETUP_CYCLES     8
+
+/* GPU clock cycles in a 60 Hz frame */
+#define GPU_CYCLES_PER_FRAME (53693175 / 60)
+
+/* Guards against a corrupted list sending the walk round in circles */
+#define MAX_LIST_ENTRIES (1 << 20)
+
+#define END_OF_LIST 0xffffff
+
+typedef struct {
+	uint64_t sum;
+	uint32_t max;
+} Counter;
+
+typedef struct {
+	uint32_t entries, packets, words, prims, pixels, cycles;
+} FrameCapture;
+
+typedef struct {
+	int      frames;
+	Counter  entries, packets, words, prims, pixels, cycles;
+	uint64_t uploadHalfwords;
+	uint32_t errors;
+} CaptureTotals;
+
+/* Drawing environment, kept across frames as the GPU does */
+static int areaLeft = 0, areaTop = 0, areaRight = 1023, areaBottom = 511;
+static int offsetX  = 0, offsetY = 0;
+
+static CaptureTotals totals;
+
+static FILE     *dumpFile    = NULL;
+static bool     dumpChecked  = false;
+static uint32_t *dumpWords    = NULL;
+static size_t   dumpLength   = 0, dumpCapacity = 0;
+
+static void addCounter(Counter *counter, uint32_t value) {
+	counter->sum += value;
+
+	if (value > counter->max)
+		counter->max = value;
+}
+
+static inline int getX(uint32_t xy) {
+	return (int16_t) (xy & 0xffff);
+}
+
+static inline int getY(uint32_t xy) {
+	return (int16_t) (xy >> 16);
+}
+
+static int64_t clipSpan(int start, int end, int min, int max) {
+	if (start < min)
+		start = min;
+	if (end > (max + 1))
+		end = max + 1;
+
+	return (end > start) ? (end - start) : 0;
+}
+
+/* Pixels of a width x height box at (x, y) inside the drawing area */
+static int64_t clipBox(int x, int y, int width, int height) {
+	return clipSpan(x, x + width, areaLeft, areaRight)
+		* clipSpan(y, y + height, areaTop, areaBottom);
+}
+
+/* Area of a triangle or quad, scaled by how much of its bounding box is
+ * inside the drawing area */
+static uint32_t getPolygonPixels(const int *x, const int *y, int numVertices) {
+	int64_t area = 0;
+
+	for (int i = 0; i < (numVertices - 2); i++) {
+		int64_t cross = (int64_t) (x[i + 1] - x[i]) * (y[i + 2] - y[i])
+			- (int64_t) (x[i + 2] - x[i]) * (y[i + 1] - y[i]);
+
+		area += (cross < 0) ? -cross : cross;
+	}
+
+	area /= 2;
+
+	int left = x[0], right = x[0], top = y[0], bottom = y[0];
+
+	for (int i = 1; i < numVertices; i++) {
+		if (x[i] < left)   left   = x[i];
+		if (x[i] > right)  right  = x[i];
+		if (y[i] < top)    top    = y[i];
+		if (y[i] > bottom) bottom = y[i];
+	}
+
+	int64_t box = (int64_t) (right - left + 1) * (bottom - top + 1);
+
+	return (uint32_t) ((area * clipBox(left, top, right - left + 1, bottom - top + 1)) / box);
+}
+
+static void addPrimitive(
+	FrameCapture *frame,
+	uint32_t     pixels,
+	int          setup,
+	bool         textured,
+	bool         semiTrans
+) {
+	frame->prims++;
+	frame->pixels += pixels;
+	frame->cycles += setup + pixels * (1 + textured + semiTrans);
+}
+
+static int decodePolygon(FrameCapture *frame, const uint32_t *words, int length) {
+	uint32_t cmd         = words[0];
+	bool     gouraud     = (cmd >> 28) & 1;
+	bool     quad        = (cmd >> 27) & 1;
+	bool     textured    = (cmd >> 26) & 1;
+	bool     semiTrans   = (cmd >> 25) & 1;
+	int      numVertices = quad ? 4 : 3;
+
+	int x[4], y[4], i = 1;
+
+	for (int v = 0; v < numVertices; v++) {
+		if (v && gouraud)
+			i++;
+		if (i >= length)
+			return -1;
+
+		x[v] = getX(words[i]) + offsetX;
+		y[v] = getY(words[i]) + offsetY;
+		i   += textured ? 2 : 1;
+	}
+
+	if (i > length)
+		return -1;
+
+	addPrimitive(
+		frame, getPolygonPixels(x, y, numVertices), POLYGON_SETUP_CYCLES,
+		textured, semiTrans
+	);
+	return i;
+}
+
+static int decodeRectangle(FrameCapture *frame, const uint32_t *words, int length) {
+	static const int fixedSizes[] = { 0, 1, 8, 16 };
+
+	uint32_t cmd       = words[0];
+	int      size      = (cmd >> 27) & 3;
+	bool     textured  = (cmd >> 26) & 1;
+	bool     semiTrans = (cmd >> 25) & 1;
+	int      count     = 2 + textured + !size;
+
+	if (count > length)
+		return -1;
+
+	int width  = fixedSizes[size];
+	int height = fixedSizes[size];
+
+	if (!size) {
+		width  = getX(words[count - 1]) & 0x3ff;
+		height = getY(words[count - 1]) & 0x1ff;
+	}
+
+	int x = getX(words[1]) + offsetX;
+	int y = getY(words[1]) + offsetY;
+
+	addPrimitive(
+		frame, (uint32_t) clipBox(x, y, width, height), RECT_SETUP_CYCLES,
+		textured, semiTrans
+	);
+	return count;
+}
+
+static int decodeLine(FrameCapture *frame, const uint32_t *words, int length) {
+	uint32_t cmd       = words[0];
+	bool     gouraud   = (cmd >> 28) & 1;
+	bool     polyline  = (cmd >> 27) & 1;
+	bool     semiTrans = (cmd >> 25) & 1;
+
+	int i = 1, lastX = 0, lastY = 0;
+
+	for (int v = 0;; v++) {
+		if (v && gouraud)
+			i++;
+		if (i >= length)
+			return -1;
+
+		// Polylines end with a 0x5xxx5xxx word in place of a vertex
+		if (polyline && (v >= 2) && ((words[i] & 0xf000f000) == 0x50005000))
+			return i + 1;
+
+		int x = getX(words[i]), y = getY(words[i]);
+		i++;
+
+		if (v) {
+			int dx = abs(x - lastX), dy = abs(y - lastY);
+
+			addPrimitive(frame, ((dx > dy) ? dx : dy) + 1, LINE_SETUP_CYCLES, false, semiTrans);
+		}
+
+		lastX = x;
+		lastY = y;
+
+		if (!polyline && (v == 1))
+			return i;
+	}
+}
+
+/* Decode one GP0 command, returning its length in words or -1 if the packet
+ * ends partway through it */
+static int decodeCommand(FrameCapture *frame, const uint32_t *words, int length) {
+	uint32_t cmd = words[0] >> 24;
+
+	switch (cmd >> 5) {
+		case 1:
+			return decodePolygon(frame, words, length);
+
+		case 2:
+			return decodeLine(frame, words, length);
+
+		case 3:
+			return decodeRectangle(frame, words, length);
+
+		case 4:  // VRAM to VRAM copy
+			return (length >= 4) ? 4 : -1;
+
+		case 5: {  // CPU to VRAM copy, data follows inline
+			if (length < 3)
+				return -1;
+
+			int count = 3 + ((getX(words[2]) * getY(words[2]) + 1) / 2);
+			return (count <= length) ? count : -1;
+		}
+
+		case 6:  // VRAM to CPU copy
+			return (length >= 3) ? 3 : -1;
+	}
+
+	switch (cmd) {
+		case 0x02:  // Fill, ignores the drawing area and offset
+			if (length < 3)
+				return -1;
+
+			addPrimitive(
+				frame,
+				(getX(words[2]) & 0x3ff) * (getY(words[2]) & 0x1ff),
+				RECT_SETUP_CYCLES,
+				false,
+				false
+			);
+			return 3;
+
+		case 0xe3:
+			areaLeft = words[0] & 0x3ff;
+			areaTop  = (words[0] >> 10) & 0x3ff;
+			return 1;
+
+		case 0xe4:
+			areaRight  = words[0] & 0x3ff;
+			areaBottom = (words[0] >> 10) & 0x3ff;
+			return 1;
+
+		case 0xe5:
+			// Signed 11-bit offsets
+			offsetX = ((int32_t) (words[0] << 21)) >> 21;
+			offsetY = ((int32_t) (words[0] << 10)) >> 21;
+			return 1;
+
+		default:  // NOP, cache flush and the other environment commands
+			return 1;
+	}
+}
+
+static void appendDump(const uint32_t *words, int length) {
+	if ((dumpLength + length) > dumpCapacity) {
+		dumpCapacity = (dumpLength + length) * 2;
+		dumpWords    = realloc(dumpWords, dumpCapacity * sizeof(uint32_t));
+
+		if (!dumpWords) {
+			fputs("GP0 dump: out of memory\n", stderr);
+			exit(1);
+		}
+	}
+
+	for (int i = 0; i < length; i++)
+		dumpWords[dumpLength++] = words[i];
+}
+
+static void writeDump(void) {
+	uint32_t header = (uint32_t) dumpLength;
+
+	fwrite(&header, sizeof(header), 1, dumpFile);
+	fwrite(dumpWords, sizeof(uint32_t), dumpLength, dumpFile);
+	dumpLength = 0;
+}
+
+void setupGPU(GP1VideoMode mode, int width, int height) {}
+
+void waitForGP0Ready(void) {}
+
+void waitForDMADone(void) {}
+
+void sendLinkedList(const void *data) {
+	// List entries only hold the low 24 bits of each address, so every buffer
+	// a packet can live in must be mapped below 16 MB (see host/CMakeLists.txt)
+	if ((uintptr_t) data > END_OF_LIST) {
+		fputs("GP0 capture: packet buffers above 16 MB, build without PIE\n", stderr);
+		exit(1);
+	}
+
+	if (!dumpChecked) {
+		const char *path = getenv("LANDER_GP0_DUMP");
+		dumpChecked      = true;
+
+		if (path && !(dumpFile = fopen(path, "wb")))
+			perror(path);
+	}
+
+	FrameCapture   frame = { 0 };
+	const uint32_t *ptr  = data;
+
+	for (;;) {
+		uint32_t tag    = *ptr;
+		int      length = tag >> 24;
+
+		if (++frame.entries > MAX_LIST_ENTRIES) {
+			fputs("GP0 capture: list doesn't terminate\n", stderr);
+			exit(1);
+		}
+
+		if (length) {
+			frame.packets++;
+			frame.words += length;
+
+			for (int i = 1; i <= length;) {
+				int count = decodeCommand(&frame, &ptr[i], length - i + 1);
+
+				if (count < 0) {
+					totals.errors++;
+					break;
+				}
+
+				i += count;
+			}
+
+			if (dumpFile)
+				appendDump(&ptr[1], length);
+		}
+
+		uint32_t next = tag & END_OF_LIST;
+
+		if (next == END_OF_LIST)
+			break;
+
+		ptr = (const uint32_t *) (uintptr_t) next;
+	}
+
+	if (dumpFile)
+		writeDump();
+
+	totals.frames++;
+	addCounter(&totals.entries, frame.entries);
+	addCounter(&totals.packets, frame.packets);
+	addCounter(&totals.words,   frame.words);
+	addCounter(&totals.prims,   frame.prims);
+	addCounter(&totals.pixels,  frame.pixels);
+	addCounter(&totals.cycles,  frame.cycles);
+}
+
+void sendVRAMData(
+	const void *data,
+	int        x,
+	int        y,
+	int        width,
+	int        height
+) {
+	totals.uploadHalfwords += width * height;
+}
+
+void clearOrderingTable(uint32_t *table, int numEntries) {
+	// Same result as the OTC channel, see clearLayer() in gpu.c
+	table[0] = gp0_endTag(0);
+
+	for (int i = 1; i < numEntries; i++)
+		table[i] = gp0_tag(0, &table[i - 1]);
+}
+
+void showFramebuffer(int x, int y) {}
+
+void resetGPUCapture(void) {
+	CaptureTotals empty = { 0 };
+	totals              = empty;
+}
+
+static inline unsigned long getAverage(const Counter *counter, int frames) {
+	return (unsigned long) (counter->sum / (frames ? frames : 1));
+}
+
+void printGPUCapture(const char *name) {
+	int frames = totals.frames;
+
+	unsigned long cycles = getAverage(&totals.cycles, frames);
+
+	printf(
+		"HOST name=%s frames=%d entries=%lu/%lu packets=%lu/%lu words=%lu/%lu "
+		"prims=%lu/%lu pixels=%lu/%lu gpu=%lu/%lu load=%lu%% upload=%lu "
+		"errors=%lu\n",
+		name,
+		frames,
+		getAverage(&totals.entries, frames), (unsigned long) totals.entries.max,
+		getAverage(&totals.packets, frames), (unsigned long) totals.packets.max,
+		getAverage(&totals.words,   frames), (unsigned long) totals.words.max,
+		getAverage(&totals.prims,   frames), (unsigned long) totals.prims.max,
+		getAverage(&totals.pixels,  frames), (unsigned long) totals.pixels.max,
+		cycles,                              (unsigned long) totals.cycles.max,
+		(cycles * 100) / GPU_CYCLES_PER_FRAME,
+		(unsigned long) totals.uploadHalfwords,
+		(unsigned long) totals.errors
+	);
+}
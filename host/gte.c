@@ -0,0 +1,345 @@
+/*
+ * Software GTE for the host build
+ *
+ * Register reads and writes follow the hardware's packing and sign extension
+ * rules, and the modelled commands follow the formulas documented for the
+ * real GTE. The flag register isn't updated, and perspective division is
+ * exact rather than going through the UNR table, which can move projected
+ * coordinates by a pixel at most.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ps1/gte.h"
+
+static uint32_t dataRegs[32], controlRegs[32];
+
+static inline int64_t clamp(int64_t value, int64_t min, int64_t max) {
+	if (value < min)
+		return min;
+	if (value > max)
+		return max;
+
+	return value;
+}
+
+/* Register accessors */
+
+static inline int16_t getLow(uint32_t value) {
+	return (int16_t) value;
+}
+
+static inline int16_t getHigh(uint32_t value) {
+	return (int16_t) (value >> 16);
+}
+
+/* Entry i (0-8, row major) of the matrix starting at control register base */
+static inline int getMatrixEntry(int base, int i) {
+	uint32_t value = controlRegs[base + i / 2];
+
+	return (i & 1) ? getHigh(value) : getLow(value);
+}
+
+static void getVector(int index, int32_t *output) {
+	if (index == 3) {
+		output[0] = getLow(dataRegs[GTE_IR1]);
+		output[1] = getLow(dataRegs[GTE_IR2]);
+		output[2] = getLow(dataRegs[GTE_IR3]);
+		return;
+	}
+
+	output[0] = getLow (dataRegs[GTE_VXY0 + index * 2]);
+	output[1] = getHigh(dataRegs[GTE_VXY0 + index * 2]);
+	output[2] = getLow (dataRegs[GTE_VZ0  + index * 2]);
+}
+
+static void setMAC(const int64_t *mac, int shift, bool lm) {
+	for (int i = 0; i < 3; i++) {
+		int32_t value = (int32_t) (mac[i] >> shift);
+
+		dataRegs[GTE_MAC1 + i] = value;
+		dataRegs[GTE_IR1  + i] = (uint16_t) clamp(value, lm ? 0 : -0x8000, 0x7fff);
+	}
+}
+
+/* Push a value into a FIFO of count registers starting at base */
+static void pushFIFO(int base, int count, uint32_t value) {
+	for (int i = 0; i < (count - 1); i++)
+		dataRegs[base + i] = dataRegs[base + i + 1];
+
+	dataRegs[base + count - 1] = value;
+}
+
+/* MAC = (translation << 12) + matrix * vector, the IR registers saturated */
+static void multiplyVector(
+	int           matrix,
+	const int32_t *vector,
+	const int32_t *translation,
+	int           shift,
+	bool          lm
+) {
+	int64_t mac[3];
+
+	for (int i = 0; i < 3; i++) {
+		mac[i] = (int64_t) translation[i] * 0x1000
+			+ (int64_t) getMatrixEntry(matrix, i * 3 + 0) * vector[0]
+			+ (int64_t) getMatrixEntry(matrix, i * 3 + 1) * vector[1]
+			+ (int64_t) getMatrixEntry(matrix, i * 3 + 2) * vector[2];
+	}
+
+	setMAC(mac, shift, lm);
+}
+
+static void getControlVector(int base, int32_t *output) {
+	output[0] = (int32_t) controlRegs[base + 0];
+	output[1] = (int32_t) controlRegs[base + 1];
+	output[2] = (int32_t) controlRegs[base + 2];
+}
+
+/* Commands */
+
+static void rtp(int index, int shift, bool lm) {
+	int32_t vector[3], translation[3];
+
+	getVector(index, vector);
+	getControlVector(GTE_TRX, translation);
+	multiplyVector(GTE_RT11RT12, vector, translation, shift, lm);
+
+	int32_t mac3 = (int32_t) dataRegs[GTE_MAC3];
+	int32_t sz   = (int32_t) clamp(mac3 >> (12 - shift), 0, 0xffff);
+
+	pushFIFO(GTE_SZ0, 4, sz);
+
+	uint32_t h = controlRegs[GTE_H] & 0xffff;
+	int64_t  n = 0x1ffff;
+
+	if (h < (uint32_t) (sz * 2))
+		n = clamp(((int64_t) h * 0x20000 / sz + 1) / 2, 0, 0x1ffff);
+
+	int64_t ir1 = getLow(dataRegs[GTE_IR1]);
+	int64_t ir2 = getLow(dataRegs[GTE_IR2]);
+	int64_t sx  = (n * ir1 + (int32_t) controlRegs[GTE_OFX]) >> 16;
+	int64_t sy  = (n * ir2 + (int32_t) controlRegs[GTE_OFY]) >> 16;
+
+	pushFIFO(
+		GTE_SXY0,
+		3,
+		_gte_pack((int) clamp(sx, -0x400, 0x3ff), (int) clamp(sy, -0x400, 0x3ff))
+	);
+
+	int64_t mac0 = n * getLow(controlRegs[GTE_DQA]) + (int32_t) controlRegs[GTE_DQB];
+
+	dataRegs[GTE_MAC0] = (int32_t) mac0;
+	dataRegs[GTE_IR0]  = (uint16_t) clamp(mac0 >> 12, 0, 0x1000);
+}
+
+static void nclip(void) {
+	int32_t x0 = getLow(dataRegs[GTE_SXY0]), y0 = getHigh(dataRegs[GTE_SXY0]);
+	int32_t x1 = getLow(dataRegs[GTE_SXY1]), y1 = getHigh(dataRegs[GTE_SXY1]);
+	int32_t x2 = getLow(dataRegs[GTE_SXY2]), y2 = getHigh(dataRegs[GTE_SXY2]);
+
+	dataRegs[GTE_MAC0] = (x0 * y1) + (x1 * y2) + (x2 * y0)
+		- (x0 * y2) - (x1 * y0) - (x2 * y1);
+}
+
+static void avsz(int first, int scale) {
+	int64_t sum = 0;
+
+	for (int i = first; i < 4; i++)
+		sum += dataRegs[GTE_SZ0 + i] & 0xffff;
+
+	int64_t mac0 = sum * scale;
+
+	dataRegs[GTE_MAC0] = (int32_t) mac0;
+	dataRegs[GTE_OTZ]  = (uint16_t) clamp(mac0 >> 12, 0, 0xffff);
+}
+
+static void mvmva(uint32_t cmd, int shift, bool lm) {
+	static const int matrices[] = { GTE_RT11RT12, GTE_L11L12, GTE_LR1LR2 };
+
+	int mx = (cmd >> 17) & 3;
+	int v  = (cmd >> 15) & 3;
+	int cv = (cmd >> 13) & 3;
+
+	if ((mx == 3) || (cv == GTE_CV_FC >> 13)) {
+		fprintf(stderr, "GTE: MVMVA hardware quirk (mx=%d, cv=%d) not modelled\n", mx, cv);
+		abort();
+	}
+
+	int32_t vector[3], translation[3] = { 0, 0, 0 };
+
+	getVector(v, vector);
+
+	if (cv == (GTE_CV_TR >> 13))
+		getControlVector(GTE_TRX, translation);
+	else if (cv == (GTE_CV_BK >> 13))
+		getControlVector(GTE_RBK, translation);
+
+	multiplyVector(matrices[mx], vector, translation, shift, lm);
+}
+
+/* Normal color with color: light the normal, add the ambient color and
+ * modulate by RGBC, pushing the result into the color FIFO */
+static void ncc(int index, int shift, bool lm) {
+	int32_t normal[3], light[3], background[3];
+
+	getVector(index, normal);
+	multiplyVector(GTE_L11L12, normal, (const int32_t[]) { 0, 0, 0 }, shift, lm);
+
+	getVector(3, light);
+	getControlVector(GTE_RBK, background);
+	multiplyVector(GTE_LR1LR2, light, background, shift, lm);
+
+	uint32_t rgbc = dataRegs[GTE_RGBC];
+	int64_t  mac[3];
+
+	for (int i = 0; i < 3; i++) {
+		int channel = (rgbc >> (i * 8)) & 0xff;
+
+		mac[i] = ((int64_t) channel * getLow(dataRegs[GTE_IR1 + i])) << 4;
+	}
+
+	setMAC(mac, shift, lm);
+
+	uint32_t color = rgbc & 0xff000000;
+
+	for (int i = 0; i < 3; i++) {
+		int32_t value = (int32_t) dataRegs[GTE_MAC1 + i] >> 4;
+
+		color |= (uint32_t) clamp(value, 0, 0xff) << (i * 8);
+	}
+
+	pushFIFO(GTE_RGB0, 3, color);
+}
+
+void gte_command(uint32_t cmd) {
+	int  shift = (cmd & GTE_SF) ? 12 : 0;
+	bool lm    = (cmd & GTE_LM) != 0;
+
+	switch (cmd & 0x3f) {
+		case GTE_CMD_RTPS:
+			rtp(0, shift, lm);
+			break;
+
+		case GTE_CMD_RTPT:
+			rtp(0, shift, lm);
+			rtp(1, shift, lm);
+			rtp(2, shift, lm);
+			break;
+
+		case GTE_CMD_NCLIP:
+			nclip();
+			break;
+
+		case GTE_CMD_AVSZ3:
+			avsz(1, getLow(controlRegs[GTE_ZSF3]));
+			break;
+
+		case GTE_CMD_AVSZ4:
+			avsz(0, getLow(controlRegs[GTE_ZSF4]));
+			break;
+
+		case GTE_CMD_MVMVA:
+			mvmva(cmd, shift, lm);
+			break;
+
+		case GTE_CMD_NCCS:
+			ncc(0, shift, lm);
+			break;
+
+		case GTE_CMD_NCCT:
+			ncc(0, shift, lm);
+			ncc(1, shift, lm);
+			ncc(2, shift, lm);
+			break;
+
+		default:
+			fprintf(stderr, "GTE: command 0x%02x not modelled\n", cmd & 0x3f);
+			abort();
+	}
+}
+
+void gte_setControlReg(GTEControlRegister reg, uint32_t value) {
+	controlRegs[reg & 31] = value;
+}
+
+uint32_t gte_getControlReg(GTEControlRegister reg) {
+	uint32_t value = controlRegs[reg & 31];
+
+	// The last entry of each matrix and H read back sign extended
+	switch (reg) {
+		case GTE_RT33:
+		case GTE_L33:
+		case GTE_LB3:
+		case GTE_H:
+		case GTE_DQA:
+		case GTE_ZSF3:
+		case GTE_ZSF4:
+			return (uint32_t) (int32_t) getLow(value);
+
+		default:
+			return value;
+	}
+}
+
+void gte_setDataReg(GTEDataRegister reg, uint32_t value) {
+	switch (reg) {
+		case GTE_SXYP:
+			pushFIFO(GTE_SXY0, 3, value);
+			break;
+
+		case GTE_IRGB:
+			dataRegs[GTE_IR1] = ((value >>  0) & 0x1f) << 7;
+			dataRegs[GTE_IR2] = ((value >>  5) & 0x1f) << 7;
+			dataRegs[GTE_IR3] = ((value >> 10) & 0x1f) << 7;
+			break;
+
+		default:
+			dataRegs[reg & 31] = value;
+			break;
+	}
+}
+
+uint32_t gte_getDataReg(GTEDataRegister reg) {
+	uint32_t value = dataRegs[reg & 31];
+
+	switch (reg) {
+		// Halfword registers, signed or not
+		case GTE_VZ0:
+		case GTE_VZ1:
+		case GTE_VZ2:
+		case GTE_IR0:
+		case GTE_IR1:
+		case GTE_IR2:
+		case GTE_IR3:
+			return (uint32_t) (int32_t) getLow(value);
+
+		case GTE_OTZ:
+		case GTE_SZ0:
+		case GTE_SZ1:
+		case GTE_SZ2:
+		case GTE_SZ3:
+			return value & 0xffff;
+
+		case GTE_SXYP:
+			return dataRegs[GTE_SXY2];
+
+		case GTE_IRGB:
+		case GTE_ORGB: {
+			uint32_t color = 0;
+
+			for (int i = 0; i < 3; i++) {
+				int32_t channel = getLow(dataRegs[GTE_IR1 + i]) >> 7;
+
+				color |= (uint32_t) clamp(channel, 0, 0x1f) << (i * 5);
+			}
+
+			return color;
+		}
+
+		default:
+			return value;
+	}
+}
@@ -0,0 +1,16 @@
+/*
+ * Declarations the PS1 build gets from the SDK's runtime, force included
+ * into every source of the host build
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void initSerialIO(int baud);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,30 @@
+/*
+ * Host stand-in for the SDK's ps1/cop0.h
+ *
+ * The system control coprocessor is only used to turn on the GTE, which the
+ * host's software GTE doesn't need, so the registers are plain variables.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+	COP0_STATUS = 12,
+	COP0_CAUSE  = 13
+} COP0Register;
+
+typedef enum {
+	COP0_STATUS_IEc = 1 <<  0,
+	COP0_STATUS_CU2 = 1 << 30
+} COP0StatusFlag;
+
+extern uint32_t hostCOP0Registers[32];
+
+static inline uint32_t cop0_getReg(COP0Register reg) {
+	return hostCOP0Registers[reg];
+}
+
+static inline void cop0_setReg(COP0Register reg, uint32_t value) {
+	hostCOP0Registers[reg] = value;
+}
@@ -0,0 +1,196 @@
+/*
+ * Host stand-in for the SDK's ps1/gte.h, backed by a software GTE
+ *
+ * Same types, register names and command flags as the SDK header, but every
+ * register access is a function call into host/gte.c, which models the GTE
+ * in integer arithmetic following the documented formulas (flag register
+ * and the exact UNR division table aside). That's close enough to the
+ * hardware for culling, depth sorting and packet counts to come out the
+ * same as on the console.
+ *
+ * gte_command() takes the command word at runtime here, only the commands
+ * the renderer uses are modelled and anything else aborts.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+	int16_t x, y, z, _padding;
+} GTEVector16;
+
+typedef struct {
+	int32_t x, y, z;
+} GTEVector32;
+
+typedef struct {
+	int16_t values[3][3];
+	int16_t _padding;
+} GTEMatrix;
+
+typedef enum {
+	GTE_VXY0 =  0, GTE_VZ0  =  1, GTE_VXY1 =  2, GTE_VZ1  =  3,
+	GTE_VXY2 =  4, GTE_VZ2  =  5, GTE_RGBC =  6, GTE_OTZ  =  7,
+	GTE_IR0  =  8, GTE_IR1  =  9, GTE_IR2  = 10, GTE_IR3  = 11,
+	GTE_SXY0 = 12, GTE_SXY1 = 13, GTE_SXY2 = 14, GTE_SXYP = 15,
+	GTE_SZ0  = 16, GTE_SZ1  = 17, GTE_SZ2  = 18, GTE_SZ3  = 19,
+	GTE_RGB0 = 20, GTE_RGB1 = 21, GTE_RGB2 = 22, GTE_RES1 = 23,
+	GTE_MAC0 = 24, GTE_MAC1 = 25, GTE_MAC2 = 26, GTE_MAC3 = 27,
+	GTE_IRGB = 28, GTE_ORGB = 29, GTE_LZCS = 30, GTE_LZCR = 31
+} GTEDataRegister;
+
+typedef enum {
+	GTE_RT11RT12 =  0, GTE_RT13RT21 =  1, GTE_RT22RT23 =  2, GTE_RT31RT32 =  3,
+	GTE_RT33     =  4, GTE_TRX      =  5, GTE_TRY      =  6, GTE_TRZ      =  7,
+	GTE_L11L12   =  8, GTE_L13L21   =  9, GTE_L22L23   = 10, GTE_L31L32   = 11,
+	GTE_L33      = 12, GTE_RBK      = 13, GTE_GBK      = 14, GTE_BBK      = 15,
+	GTE_LR1LR2   = 16, GTE_LR3LG1   = 17, GTE_LG2LG3   = 18, GTE_LB1LB2   = 19,
+	GTE_LB3      = 20, GTE_RFC      = 21, GTE_GFC      = 22, GTE_BFC      = 23,
+	GTE_OFX      = 24, GTE_OFY      = 25, GTE_H        = 26, GTE_DQA      = 27,
+	GTE_DQB      = 28, GTE_ZSF3     = 29, GTE_ZSF4     = 30, GTE_FLAG     = 31
+} GTEControlRegister;
+
+typedef enum {
+	GTE_CMD_RTPS  = 0x01,
+	GTE_CMD_NCLIP = 0x06,
+	GTE_CMD_OP    = 0x0c,
+	GTE_CMD_DPCS  = 0x10,
+	GTE_CMD_INTPL = 0x11,
+	GTE_CMD_MVMVA = 0x12,
+	GTE_CMD_NCDS  = 0x13,
+	GTE_CMD_CDP   = 0x14,
+	GTE_CMD_NCDT  = 0x16,
+	GTE_CMD_NCCS  = 0x1b,
+	GTE_CMD_CC    = 0x1c,
+	GTE_CMD_NCS   = 0x1e,
+	GTE_CMD_NCT   = 0x20,
+	GTE_CMD_SQR   = 0x28,
+	GTE_CMD_DCPL  = 0x29,
+	GTE_CMD_DPCT  = 0x2a,
+	GTE_CMD_AVSZ3 = 0x2d,
+	GTE_CMD_AVSZ4 = 0x2e,
+	GTE_CMD_RTPT  = 0x30,
+	GTE_CMD_GPF   = 0x3d,
+	GTE_CMD_GPL   = 0x3e,
+	GTE_CMD_NCCT  = 0x3f
+} GTECommand;
+
+typedef enum {
+	GTE_LM      = 1 << 10, /* Clamp IR1-IR3 to 0 rather than -0x8000 */
+	GTE_CV_TR   = 0 << 13, /* MVMVA translation vector */
+	GTE_CV_BK   = 1 << 13,
+	GTE_CV_FC   = 2 << 13,
+	GTE_CV_NONE = 3 << 13,
+	GTE_V_V0    = 0 << 15, /* MVMVA multiplied vector */
+	GTE_V_V1    = 1 << 15,
+	GTE_V_V2    = 2 << 15,
+	GTE_V_IR    = 3 << 15,
+	GTE_MX_RT   = 0 << 17, /* MVMVA matrix */
+	GTE_MX_LLM  = 1 << 17,
+	GTE_MX_LCM  = 2 << 17,
+	GTE_SF      = 1 << 19  /* Shift results right by 12 bits */
+} GTECommandFlag;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void     gte_command(uint32_t cmd);
+void     gte_setControlReg(GTEControlRegister reg, uint32_t value);
+uint32_t gte_getControlReg(GTEControlRegister reg);
+void     gte_setDataReg(GTEDataRegister reg, uint32_t value);
+uint32_t gte_getDataReg(GTEDataRegister reg);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Equivalents of LWC2 and SWC2, offset being in bytes from ptr */
+static inline void gte_loadDataReg(GTEDataRegister reg, int offset, const void *ptr) {
+	gte_setDataReg(reg, *((const uint32_t *) ((const uint8_t *) ptr + offset)));
+}
+
+static inline void gte_storeDataReg(GTEDataRegister reg, int offset, void *ptr) {
+	*((uint32_t *) ((uint8_t *) ptr + offset)) = gte_getDataReg(reg);
+}
+
+static inline uint32_t _gte_pack(int low, int high) {
+	return ((uint32_t) low & 0xffff) | ((uint32_t) high << 16);
+}
+
+static inline void gte_setV0(int x, int y, int z) {
+	gte_setDataReg(GTE_VXY0, _gte_pack(x, y));
+	gte_setDataReg(GTE_VZ0,  z);
+}
+
+static inline void gte_setV1(int x, int y, int z) {
+	gte_setDataReg(GTE_VXY1, _gte_pack(x, y));
+	gte_setDataReg(GTE_VZ1,  z);
+}
+
+static inline void gte_setV2(int x, int y, int z) {
+	gte_setDataReg(GTE_VXY2, _gte_pack(x, y));
+	gte_setDataReg(GTE_VZ2,  z);
+}
+
+static inline void gte_loadV0(const GTEVector16 *input) {
+	gte_setV0(input->x, input->y, input->z);
+}
+
+static inline void gte_loadV1(const GTEVector16 *input) {
+	gte_setV1(input->x, input->y, input->z);
+}
+
+static inline void gte_loadV2(const GTEVector16 *input) {
+	gte_setV2(input->x, input->y, input->z);
+}
+
+/* Load three vectors given as the columns of a matrix, row by row */
+static inline void gte_setColumnVectors(
+	int v11, int v12, int v13,
+	int v21, int v22, int v23,
+	int v31, int v32, int v33
+) {
+	gte_setV0(v11, v21, v31);
+	gte_setV1(v12, v22, v32);
+	gte_setV2(v13, v23, v33);
+}
+
+/* The three matrices are packed into five control registers each, two
+ * entries per register in row major order */
+static inline void _gte_loadMatrix(int base, const GTEMatrix *input) {
+	const int16_t *v = &(input->values)[0][0];
+
+	gte_setControlReg((GTEControlRegister) (base + 0), _gte_pack(v[0], v[1]));
+	gte_setControlReg((GTEControlRegister) (base + 1), _gte_pack(v[2], v[3]));
+	gte_setControlReg((GTEControlRegister) (base + 2), _gte_pack(v[4], v[5]));
+	gte_setControlReg((GTEControlRegister) (base + 3), _gte_pack(v[6], v[7]));
+	gte_setControlReg((GTEControlRegister) (base + 4), v[8]);
+}
+
+static inline void _gte_storeMatrix(int base, GTEMatrix *output) {
+	int16_t *v = &(output->values)[0][0];
+
+	for (int i = 0; i < 9; i++) {
+		uint32_t value = gte_getControlReg((GTEControlRegister) (base + i / 2));
+
+		v[i] = (int16_t) ((i & 1) ? (value >> 16) : value);
+	}
+}
+
+static inline void gte_loadRotationMatrix(const GTEMatrix *input) {
+	_gte_loadMatrix(GTE_RT11RT12, input);
+}
+
+static inline void gte_storeRotationMatrix(GTEMatrix *output) {
+	_gte_storeMatrix(GTE_RT11RT12, output);
+}
+
+static inline void gte_loadLightMatrix(const GTEMatrix *input) {
+	_gte_loadMatrix(GTE_L11L12, input);
+}
+
+static inline void gte_loadLightColorMatrix(const GTEMatrix *input) {
+	_gte_loadMatrix(GTE_LR1LR2, input);
+}
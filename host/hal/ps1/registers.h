@@ -0,0 +1,87 @@
+/*
+ * Host stand-in for the SDK's ps1/registers.h
+ *
+ * Only what the shared sources built by the host project reference. Every
+ * register maps onto a plain array covering the I/O area, so writes are
+ * simply kept and reads return the last value written (0 at startup, which
+ * reads as an NTSC console with the GPU idle). Nothing here has side effects:
+ * the parts of the program that need to observe GPU and DMA traffic go
+ * through host/gpuio.c instead.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define F_CPU 33868800
+
+#define IO_BASE 0x1f801000
+#define IO_SIZE 0x2000
+
+extern uint8_t hostIOPorts[IO_SIZE];
+
+#define _MMIO8(addr)  (*((volatile uint8_t  *) &hostIOPorts[(addr) - IO_BASE]))
+#define _MMIO16(addr) (*((volatile uint16_t *) &hostIOPorts[(addr) - IO_BASE]))
+#define _MMIO32(addr) (*((volatile uint32_t *) &hostIOPorts[(addr) - IO_BASE]))
+
+/* GPU */
+
+#define GPU_GP0 _MMIO32(IO_BASE | 0x810)
+#define GPU_GP1 _MMIO32(IO_BASE | 0x814)
+
+typedef enum {
+	GP1_STAT_FB_MODE_BITMASK = 1 << 20,
+	GP1_STAT_FB_MODE_NTSC    = 0 << 20,
+	GP1_STAT_FB_MODE_PAL     = 1 << 20,
+	GP1_STAT_CMD_READY       = 1 << 26
+} GP1StatusFlag;
+
+/* DMA */
+
+typedef enum {
+	DMA_MDEC_IN  = 0,
+	DMA_MDEC_OUT = 1,
+	DMA_GPU      = 2,
+	DMA_CDROM    = 3,
+	DMA_SPU      = 4,
+	DMA_PIO      = 5,
+	DMA_OTC      = 6
+} DMAChannel;
+
+#define DMA_MADR(n) _MMIO32((IO_BASE | 0x080) + (16 * (n)))
+#define DMA_BCR(n)  _MMIO32((IO_BASE | 0x084) + (16 * (n)))
+#define DMA_CHCR(n) _MMIO32((IO_BASE | 0x088) + (16 * (n)))
+
+#define DMA_DPCR _MMIO32(IO_BASE | 0x0f0)
+#define DMA_DICR _MMIO32(IO_BASE | 0x0f4)
+
+#define DMA_DPCR_CH_ENABLE(n) (1 << (((n) * 4) + 3))
+
+/* Interrupts */
+
+typedef enum {
+	IRQ_VSYNC  =  0,
+	IRQ_GPU    =  1,
+	IRQ_CDROM  =  2,
+	IRQ_DMA    =  3,
+	IRQ_TIMER0 =  4,
+	IRQ_TIMER1 =  5,
+	IRQ_TIMER2 =  6,
+	IRQ_SIO0   =  7,
+	IRQ_SIO1   =  8,
+	IRQ_SPU    =  9,
+	IRQ_GUN    = 10
+} IRQChannel;
+
+#define IRQ_STAT _MMIO16(IO_BASE | 0x070)
+#define IRQ_MASK _MMIO16(IO_BASE | 0x074)
+
+/* Timers */
+
+typedef enum {
+	TIMER_CTRL_PRESCALE = 1 << 9
+} TimerControlFlag;
+
+#define TIMER_VALUE(n)  _MMIO16((IO_BASE | 0x100) + (16 * (n)))
+#define TIMER_CTRL(n)   _MMIO16((IO_BASE | 0x104) + (16 * (n)))
+#define TIMER_RELOAD(n) _MMIO16((IO_BASE | 0x108) + (16 * (n)))
@@ -0,0 +1,86 @@
+/*
+ * Interrupt event layer for the host build
+ *
+ * Stands in for src/irq.c. Nothing ever has to be waited for on the host, so
+ * waitForFrame() simply moves time forward: the vblank count jumps to the
+ * frame asked for and the hblank counter (timer 1) by as many scanlines, so
+ * code timing itself against either still sees a console running at full
+ * speed. DMA transfers complete as soon as they're started.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "irq.h"
+#include "ps1/registers.h"
+
+static uint32_t vsyncCount    = 0;
+static int      linesPerFrame = IRQ_LINES_PER_FRAME_NTSC;
+static int      vsyncRate     = IRQ_VSYNC_RATE_NTSC;
+
+static IRQCallback idleCallback  = NULL;
+static IRQCallback vsyncCallback = NULL;
+static DMACallback dmaCallbacks[IRQ_NUM_DMA_CHANNELS];
+
+void initIRQ(bool isPAL) {
+	linesPerFrame = isPAL ? IRQ_LINES_PER_FRAME_PAL : IRQ_LINES_PER_FRAME_NTSC;
+	vsyncRate     = isPAL ? IRQ_VSYNC_RATE_PAL : IRQ_VSYNC_RATE_NTSC;
+	vsyncCount    = 0;
+
+	for (int i = 0; i < IRQ_NUM_DMA_CHANNELS; i++)
+		dmaCallbacks[i] = NULL;
+}
+
+void handleDMAFlags(uint32_t channels) {
+	for (int i = 0; i < IRQ_NUM_DMA_CHANNELS; i++) {
+		if ((channels & (1 << i)) && dmaCallbacks[i])
+			dmaCallbacks[i]((DMAChannel) i);
+	}
+}
+
+void handleVSync(void) {
+	vsyncCount++;
+	TIMER_VALUE(1) += linesPerFrame;
+
+	if (vsyncCallback)
+		vsyncCallback();
+}
+
+void serviceIRQs(void) {}
+
+uint32_t getVSyncCount(void) {
+	return vsyncCount;
+}
+
+int getVSyncRate(void) {
+	return vsyncRate;
+}
+
+void waitForFrame(uint32_t frame) {
+	while ((int32_t) (vsyncCount - frame) < 0) {
+		handleVSync();
+
+		if (idleCallback)
+			idleCallback();
+	}
+}
+
+void waitForDMA(DMAChannel channel) {}
+
+void setIdleCallback(IRQCallback callback) {
+	idleCallback = callback;
+}
+
+void setVSyncCallback(IRQCallback callback) {
+	vsyncCallback = callback;
+}
+
+void setDMACallback(DMAChannel channel, DMACallback callback) {
+	dmaCallbacks[channel] = callback;
+}
+
+bool testDMAComplete(DMAChannel channel) {
+	return true;
+}
+
+void setIRQCallback(IRQChannel channel, IRQCallback callback) {}
@@ -0,0 +1,129 @@
+/*
+ * Hardware the host build leaves out
+ *
+ * Sound, CD-ROM, BIOS and controller entry points the renderer calls, doing
+ * nothing: benchmarks feed their input from bench.c, and none of these
+ * affect what gets drawn. Also holds the memory behind the host's register
+ * and scratchpad stand-ins.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "archive.h"
+#include "bios.h"
+#include "cdda.h"
+#include "cdread.h"
+#include "cdrom.h"
+#include "controller.h"
+#include "scratchpad.h"
+#include "sound.h"
+#include "spu.h"
+#include "spustream.h"
+#include "ps1/cop0.h"
+#include "ps1/registers.h"
+
+uint8_t  hostIOPorts[IO_SIZE];
+uint32_t hostCOP0Registers[32];
+
+/* Aligned like the real scratchpad so its words can be accessed directly */
+uint8_t hostScratchpad[SCRATCHPAD_SIZE] __attribute__((aligned(8)));
+
+static ControllerState noController;
+
+void initSerialIO(int baud) {}
+
+void biosInit(void) {}
+
+void setupSPU(void) {}
+
+void spuUnmute(void) {}
+
+size_t getSPURAMFree(void) {
+	return 0;
+}
+
+void updateSPUVoices(void) {}
+
+int getActiveVoices(void) {
+	return 0;
+}
+
+void initSoundBank(SoundBank *bank) {
+	bank->numSounds = 0;
+}
+
+int loadSound(
+	SoundBank  *bank,
+	const void *data,
+	size_t     size,
+	int        sampleRate,
+	int        priority
+) {
+	return -1;
+}
+
+int playSound(const SoundBank *bank, int sound, int volume) {
+	return -1;
+}
+
+bool startSPUStreamFromMemory(
+	const void *data,
+	size_t     size,
+	int        sampleRate,
+	int        volume,
+	bool       loop
+) {
+	return false;
+}
+
+void stopSPUStream(void) {}
+
+bool isSPUStreamPlaying(void) {
+	return false;
+}
+
+void updateSPUStream(void) {}
+
+void initCDROM(void) {}
+
+void updateCDROM(void) {}
+
+void initCDRead(void) {}
+
+void updateCDRead(void) {}
+
+bool openArchive(
+	Archive        *archive,
+	const char     *path,
+	CDReadCallback callback,
+	void           *arg
+) {
+	return false;
+}
+
+const ArchiveEntry *findAsset(const Archive *archive, const char *name) {
+	return NULL;
+}
+
+bool loadAsset(
+	const Archive      *archive,
+	const ArchiveEntry *entry,
+	void               *buffer,
+	CDReadCallback     callback,
+	void               *arg
+) {
+	return false;
+}
+
+void initCDDA(void) {}
+
+void updateCDDA(void) {}
+
+void initControllers(void) {}
+
+void updateControllers(void) {}
+
+const ControllerState *getControllerState(int index) {
+	return &noController;
+}
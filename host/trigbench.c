@@ -0,0 +1,98 @@
+/*
+ * Host-side comparison of the sine lookup table against the polynomial
+ *
+ * Prints the error of each isin() variant against a double precision
+ * reference over every input angle, plus a rough throughput figure. Timings
+ * are for the host CPU only; on the R3000 the gap is wider, as the polynomial
+ * needs several multiplies and the table needs none (isinFast) or one.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "trig.h"
+#include "sineTable.h"
+
+#define ONE         4096
+#define BENCH_LOOPS 2000
+
+typedef int (*SineFunction)(int x);
+
+typedef struct {
+	const char   *name;
+	SineFunction func;
+	int          shift;
+} SineVariant;
+
+static const SineVariant variants[] = {
+	{ "isinFast",  isinFast,  ISIN_SHIFT  },
+	{ "isin",      isin,      ISIN_SHIFT  },
+	{ "isinPoly",  isinPoly,  ISIN_SHIFT  },
+	{ "isin2",     isin2,     ISIN2_SHIFT },
+	{ "isin2Poly", isin2Poly, ISIN2_SHIFT }
+};
+
+#define NUM_VARIANTS (int) (sizeof(variants) / sizeof(variants[0]))
+
+/* Keeps the benchmark loops from being optimized out */
+static volatile int sink;
+
+static void measureAccuracy(const SineVariant *variant) {
+	int    range    = 4 << variant->shift;
+	double maxError = 0.0, sumError = 0.0, sumSquare = 0.0;
+
+	// Go over one full turn in both directions to cover negative angles.
+	for (int x = -range; x < range; x++) {
+		double angle = (x * M_PI) / (2 << variant->shift);
+		double error = fabs(variant->func(x) - sin(angle) * ONE);
+
+		if (error > maxError)
+			maxError = error;
+
+		sumError  += error;
+		sumSquare += error * error;
+	}
+
+	printf(
+		"%-10s max=%7.3f avg=%7.3f rms=%7.3f",
+		variant->name,
+		maxError,
+		sumError / (2 * range),
+		sqrt(sumSquare / (2 * range))
+	);
+}
+
+static void measureThroughput(const SineVariant *variant) {
+	int mask = (4 << variant->shift) - 1;
+	int acc  = 0;
+
+	clock_t start = clock();
+
+	for (int loop = 0; loop < BENCH_LOOPS; loop++) {
+		// Step by an odd stride so consecutive inputs don't share entries.
+		for (int i = 0, x = loop; i < 4096; i++, x += 1237)
+			acc += variant->func(x & mask);
+	}
+
+	clock_t end = clock();
+	sink        = acc;
+
+	double ns = ((double) (end - start) / CLOCKS_PER_SEC) * 1e9;
+	printf("  %6.2f ns/call\n", ns / (BENCH_LOOPS * 4096.0));
+}
+
+int main(void) {
+	printf(
+		"Sine table: %d entries per quadrant (%d bytes), errors in 4.12 LSBs\n",
+		1 << SINE_TABLE_BITS,
+		(int) sizeof(sineTable)
+	);
+
+	for (int i = 0; i < NUM_VARIANTS; i++) {
+		measureAccuracy(&variants[i]);
+		measureThroughput(&variants[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * Packed asset archive for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "archive.h"
+#include "cdread.h"
+#include "iso9660.h"
+
+static inline const ArchiveEntry *getEntries(const Archive *archive) {
+	return (const ArchiveEntry *) &archive->toc[2];
+}
+
+static void finishOpen(Archive *archive, bool success) {
+	if (!success)
+		archive->numEntries = 0;
+	if (archive->openCallback)
+		archive->openCallback(success, archive->openArg);
+}
+
+static void onTOCRead(bool success, void *arg) {
+	Archive *archive = (Archive *) arg;
+
+	if (!success) {
+		finishOpen(archive, false);
+		return;
+	}
+
+	uint32_t version    = archive->toc[1] & 0xffff;
+	uint32_t numEntries = archive->toc[1] >> 16;
+
+	if (
+		(archive->toc[0] != ARCHIVE_MAGIC) ||
+		(version != ARCHIVE_VERSION) ||
+		(numEntries > ARCHIVE_MAX_ENTRIES)
+	) {
+		finishOpen(archive, false);
+		return;
+	}
+
+	archive->numEntries = numEntries;
+	finishOpen(archive, true);
+}
+
+static void onArchiveFound(const CDFile *file, void *arg) {
+	Archive *archive = (Archive *) arg;
+
+	if (!file) {
+		finishOpen(archive, false);
+		return;
+	}
+
+	archive->lba = file->lba;
+
+	if (!readCDSectors(file->lba, 1, archive->toc, onTOCRead, archive))
+		finishOpen(archive, false);
+}
+
+uint32_t hashAssetName(const char *name) {
+	uint32_t hash = 0x811c9dc5;
+
+	for (; *name; name++) {
+		char c = *name;
+
+		if ((c >= 'a') && (c <= 'z'))
+			c -= 'a' - 'A';
+
+		hash = (hash ^ (uint8_t) c) * 0x01000193;
+	}
+
+	return hash;
+}
+
+bool openArchive(
+	Archive        *archive,
+	const char     *path,
+	CDReadCallback callback,
+	void           *arg
+) {
+	archive->numEntries   = 0;
+	archive->openCallback = callback;
+	archive->openArg      = arg;
+
+	return findCDFile(path, onArchiveFound, archive);
+}
+
+const ArchiveEntry *findAsset(const Archive *archive, const char *name) {
+	uint32_t           hash  = hashAssetName(name);
+	const ArchiveEntry *entry = getEntries(archive);
+
+	for (int i = archive->numEntries; i; i--, entry++) {
+		if (entry->nameHash == hash)
+			return entry;
+	}
+
+	return NULL;
+}
+
+bool loadAsset(
+	const Archive      *archive,
+	const ArchiveEntry *entry,
+	void               *buffer,
+	CDReadCallback     callback,
+	void               *arg
+) {
+	uint32_t lba = archive->lba + (entry->offsetType & 0xffffff);
+
+	return readCDSectors(lba, getAssetSectors(entry), buffer, callback, arg);
+}
+
+bool streamAsset(
+	const Archive      *archive,
+	const ArchiveEntry *entry,
+	CDSectorCallback   onSector,
+	CDReadCallback     onDone,
+	void               *arg
+) {
+	uint32_t lba = archive->lba + (entry->offsetType & 0xffffff);
+
+	return streamCDSectors(lba, getAssetSectors(entry), onSector, onDone, arg);
+}
@@ -0,0 +1,101 @@
+/*
+ * Packed asset archive for PS1 bare-metal
+ *
+ * tools/packArchive.py packs the assets listed in assets/archive.json into a
+ * single file on the disc, each blob starting on its own sector. The first
+ * sector is a table of contents giving every asset's sector offset, size and
+ * type, so once it has been read any asset is a single seek away, without
+ * walking the ISO9660 directory again. Assets meant to be loaded together are
+ * packed next to each other to keep the number of seeks down.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cdread.h"
+
+#define ARCHIVE_MAGIC       0x4b41504c /* "LPAK" */
+#define ARCHIVE_VERSION     1
+#define ARCHIVE_MAX_ENTRIES ((CD_SECTOR_SIZE - 8) / sizeof(ArchiveEntry))
+
+/* Must match ASSET_TYPES in tools/packArchive.py */
+typedef enum {
+	ASSET_TYPE_RAW     = 0,
+	ASSET_TYPE_MODEL   = 1,
+	ASSET_TYPE_TEXTURE = 2,
+	ASSET_TYPE_PALETTE = 3,
+	ASSET_TYPE_SOUND   = 4
+} ArchiveAssetType;
+
+/* Table of contents entry, as stored on disc */
+typedef struct {
+	uint32_t nameHash;
+	uint32_t offsetType; /* type << 24 | sector offset from the archive start */
+	uint32_t size;       /* Bytes */
+} ArchiveEntry;
+
+typedef struct {
+	uint32_t       lba;
+	uint16_t       numEntries;
+	CDReadCallback openCallback;
+	void           *openArg;
+
+	/* Table of contents sector, read in place: 8-byte header, then entries */
+	uint32_t       toc[CD_SECTOR_SIZE / 4];
+} Archive;
+
+static inline ArchiveAssetType getAssetType(const ArchiveEntry *entry) {
+	return (ArchiveAssetType) (entry->offsetType >> 24);
+}
+
+/* Sectors an asset occupies, and so the buffer size loadAsset() needs */
+static inline int getAssetSectors(const ArchiveEntry *entry) {
+	return (entry->size + CD_SECTOR_SIZE - 1) / CD_SECTOR_SIZE;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FNV-1a hash of an asset name, ignoring case */
+uint32_t hashAssetName(const char *name);
+
+/*
+ * Find the archive file on disc and read its table of contents. The callback
+ * runs from the CD-ROM interrupt. Returns false if the reader is busy.
+ */
+bool openArchive(
+	Archive        *archive,
+	const char     *path,
+	CDReadCallback callback,
+	void           *arg
+);
+
+/* Look an asset up by name, returns NULL if it isn't in the archive */
+const ArchiveEntry *findAsset(const Archive *archive, const char *name);
+
+/*
+ * Read a whole asset into buffer, which must be word aligned and hold
+ * getAssetSectors() sectors. Returns false if the reader is busy.
+ */
+bool loadAsset(
+	const Archive      *archive,
+	const ArchiveEntry *entry,
+	void               *buffer,
+	CDReadCallback     callback,
+	void               *arg
+);
+
+/* Stream an asset sector by sector, see streamCDSectors() */
+bool streamAsset(
+	const Archive      *archive,
+	const ArchiveEntry *entry,
+	CDSectorCallback   onSector,
+	CDReadCallback     onDone,
+	void               *arg
+);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,172 @@
+/*
+ * Benchmark scenarios for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "bench.h"
+#include "controller.h"
+#include "irq.h"
+#include "ps1/registers.h"
+
+#ifdef LANDER_HOST
+#include "gpucapture.h"
+#endif
+
+#define STICK_CENTER 0x80
+
+/* Nothing pressed, the lander and shapes just drift */
+static const BenchInput idleScript[] = {
+	{ 1, 0, STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER },
+	{ 0 }
+};
+
+/* Turn the lander on all three axes, in both directions */
+static const BenchInput rotateScript[] = {
+	{ 60, PAD_RIGHT,         STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER },
+	{ 60, PAD_DOWN,          STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER },
+	{ 60, PAD_R1,            STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER },
+	{ 60, PAD_LEFT | PAD_UP, STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER },
+	{ 60, 0,                 0xff,         0x00,         0x00,         STICK_CENTER },
+	{ 0 }
+};
+
+/* Move the lander out through every level of detail and back, spinning */
+static const BenchInput zoomScript[] = {
+	{ 60, PAD_L2 | PAD_RIGHT, STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER },
+	{ 60, PAD_R2 | PAD_UP,    STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER },
+	{ 0 }
+};
+
+/* Change every HUD line every frame: sticks flip end to end and buttons
+ * alternate, X retriggering the sound effect */
+static const BenchInput hudScript[] = {
+	{ 1, PAD_X | PAD_UP | PAD_L1 | PAD_L2,                0x00, 0xff, 0x00, 0xff },
+	{ 1, PAD_SQUARE | PAD_DOWN | PAD_R1,                  0xff, 0x00, 0xff, 0x00 },
+	{ 1, PAD_TRIANGLE | PAD_LEFT | PAD_R2,                0x10, 0xf0, 0xf0, 0x10 },
+	{ 1, PAD_X | PAD_SQUARE | PAD_RIGHT | PAD_L1 | PAD_R1, 0xf0, 0x10, 0x10, 0xf0 },
+	{ 0 }
+};
+
+static const BenchScenario scenarios[] = {
+	{ .name = "idle",   .numFrames = 300, .numShapes = 0,  .script = idleScript   },
+	{ .name = "rotate", .numFrames = 600, .numShapes = 6,  .script = rotateScript },
+	{ .name = "crowd",  .numFrames = 600, .numShapes = BENCH_MAX_SHAPES, .script = zoomScript },
+	{ .name = "hud",    .numFrames = 600, .numShapes = 6,  .script = hudScript    }
+};
+
+#define NUM_SCENARIOS (sizeof(scenarios) / sizeof(scenarios[0]))
+
+static uint16_t frameStartTimer, frameStartLine;
+
+const BenchScenario *getBenchScenario(int index) {
+	if ((index < 0) || (index >= (int) NUM_SCENARIOS))
+		return NULL;
+
+	return &scenarios[index];
+}
+
+const BenchInput *getBenchInput(const BenchScenario *scenario, int frame) {
+	int length = 0;
+
+	for (const BenchInput *step = scenario->script; step->frames; step++)
+		length += step->frames;
+
+	frame %= length;
+
+	const BenchInput *step = scenario->script;
+
+	for (; frame >= step->frames; step++)
+		frame -= step->frames;
+
+	return step;
+}
+
+void beginBenchScenario(BenchResults *results) {
+	results->cyclesSum  = 0;
+	results->cyclesMax  = 0;
+	results->wordsSum   = 0;
+	results->wordsMax   = 0;
+	results->dmaWaitSum = 0;
+	results->dmaWaitMax = 0;
+	results->frames     = 0;
+	results->dropped    = 0;
+	results->overflows  = 0;
+
+#ifdef LANDER_HOST
+	resetGPUCapture();
+#endif
+}
+
+void beginBenchFrame(void) {
+	frameStartLine  = getHblankCounter();
+	frameStartTimer = TIMER_VALUE(2);
+}
+
+void endBenchFrame(BenchResults *results) {
+	uint32_t cycles = getElapsedTimer2Ticks(frameStartTimer, frameStartLine) * 8;
+
+	results->cyclesSum += cycles;
+	if (cycles > results->cyclesMax)
+		results->cyclesMax = cycles;
+}
+
+void recordBenchFrame(
+	BenchResults *results,
+	int          wordsUsed,
+	int          dmaWait,
+	int          packetsDropped,
+	int          vblanks
+) {
+	results->wordsSum   += wordsUsed;
+	results->dmaWaitSum += dmaWait;
+
+	if ((uint32_t) wordsUsed > results->wordsMax)
+		results->wordsMax = wordsUsed;
+	if ((uint32_t) dmaWait > results->dmaWaitMax)
+		results->dmaWaitMax = dmaWait;
+
+	if (packetsDropped)
+		results->overflows++;
+	if (vblanks > 1)
+		results->dropped += vblanks - 1;
+
+	results->frames++;
+}
+
+void printBenchResults(const BenchScenario *scenario, const BenchResults *results) {
+	int frames = results->frames ? results->frames : 1;
+
+#ifdef LANDER_HOST
+	// Timers, DMA and vblanks are stubbed on the host, so only the packet
+	// arena usage is real. The GPU side is on the HOST line below.
+	printf(
+		"BENCH name=%s frames=%d cycles=n/a words=%lu/%lu "
+		"dmawait=n/a dropped=n/a overflow=%d\n",
+		scenario->name,
+		results->frames,
+		(unsigned long) (results->wordsSum / frames),
+		(unsigned long) results->wordsMax,
+		results->overflows
+	);
+
+	printGPUCapture(scenario->name);
+#else
+	printf(
+		"BENCH name=%s frames=%d cycles=%lu/%lu words=%lu/%lu "
+		"dmawait=%lu/%lu dropped=%d overflow=%d\n",
+		scenario->name,
+		results->frames,
+		(unsigned long) (results->cyclesSum / frames),
+		(unsigned long) results->cyclesMax,
+		(unsigned long) (results->wordsSum / frames),
+		(unsigned long) results->wordsMax,
+		(unsigned long) (results->dmaWaitSum / frames),
+		(unsigned long) results->dmaWaitMax,
+		results->dropped,
+		results->overflows
+	);
+#endif
+}
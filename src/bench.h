@@ -0,0 +1,88 @@
+/*
+ * Benchmark scenarios for PS1 bare-metal
+ *
+ * The lander-bench build runs each scenario for a fixed number of frames from
+ * the same random seed, with the controller replaced by a scripted list of
+ * inputs, so every run draws exactly the same frames. At the end of each
+ * scenario one line of key=value results is printed over serial:
+ *
+ *   BENCH name=<name> frames=<n> cycles=<avg>/<max> words=<avg>/<max>
+ *         dmawait=<avg>/<max> dropped=<n> overflow=<n>
+ *
+ * cycles is CPU time from the start of a frame to its presentFrame() call,
+ * in system clock cycles. words is the packet arena usage, dmawait the
+ * scanlines presentFrame() spent waiting for the previous list's DMA, and
+ * dropped the frames that missed their vblank. "BENCH END" follows the last
+ * scenario. The host build (see host/) prints n/a for cycles, dmawait and
+ * dropped, which it has no real timers for.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Seed the starfield and shapes are reset from at the start of each scenario */
+#define BENCH_SEED 12345
+
+/* Most shapes any scenario draws, main.c sizes its shape arrays to this */
+#define BENCH_MAX_SHAPES 24
+
+/* Stars filling the whole starfield */
+#define BENCH_NUM_STARS 2048
+
+/* Controller state held for a number of frames */
+typedef struct {
+	uint16_t frames;
+	uint16_t buttons;
+	uint8_t  leftX, leftY, rightX, rightY;
+} BenchInput;
+
+typedef struct {
+	const char       *name;
+	int              numFrames, numShapes;
+	const BenchInput *script;  /* Played in a loop, ends with frames = 0 */
+} BenchScenario;
+
+typedef struct {
+	uint32_t cyclesSum, cyclesMax;
+	uint32_t wordsSum, wordsMax;
+	uint32_t dmaWaitSum, dmaWaitMax;
+	int      frames, dropped, overflows;
+} BenchResults;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returns NULL past the last scenario */
+const BenchScenario *getBenchScenario(int index);
+
+/* Scripted input for a frame of the scenario */
+const BenchInput *getBenchInput(const BenchScenario *scenario, int frame);
+
+/* Clear the results. Cycle counts come from timer 2, which initIRQ() sets up
+ * and nothing here reprograms, as the profiler reads it too. */
+void beginBenchScenario(BenchResults *results);
+
+/* Mark the start of a frame's CPU work */
+void beginBenchFrame(void);
+
+/* Close a frame's CPU time right before presentFrame() */
+void endBenchFrame(BenchResults *results);
+
+/* Account for the last presented frame's packet words, DMA wait, dropped
+ * packets and missed vblanks */
+void recordBenchFrame(
+	BenchResults *results,
+	int          wordsUsed,
+	int          dmaWait,
+	int          packetsDropped,
+	int          vblanks
+);
+
+void printBenchResults(const BenchScenario *scenario, const BenchResults *results);
+
+#ifdef __cplusplus
+}
+#endif
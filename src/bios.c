@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "bios.h"
+#include "irq.h"
 #include "ps1/registers.h"
 
 /* BIOS syscall wrappers - these call through the BIOS jump tables */
@@ -52,10 +53,6 @@ static inline void syscall_flushCache(void) {
 	((void (*)(void))0xa0)();
 }
 
-/* Event constants from psyqo */
-#define EVENT_DMA         0xf0000011
-#define EVENT_MODE_CALLBACK 0x1000
-
 /* DMA IRQ handler - called by BIOS when DMA completes */
 /* This matches psyqo's dmaIRQ() in kernel.cpp exactly */
 static void dmaIRQ(void) {
@@ -82,13 +79,22 @@ static void dmaIRQ(void) {
 	ack <<= 24;
 	dicr |= ack;
 	DMA_DICR = dicr;
+
+	/* Latch completion flags and run per-channel callbacks */
+	handleDMAFlags(dirqs & 0x7f);
 }
 
-void biosInit(void) {
-	/* DISABLED - these BIOS syscalls crash pcsx_rearmed HLE */
-	printf("BIOS: Skipped (HLE incompatible)\n");
+/* VSync handler - called by BIOS on root counter 3 (vblank) interrupts */
+static void vsyncIRQ(void) {
+	handleVSync();
+}
 
-#if 0
+void biosInit(void) {
+#ifndef ENABLE_BIOS_EVENTS
+	/* DISABLED by default - these BIOS syscalls crash pcsx_rearmed HLE. The
+	 * event layer in irq.c falls back to polling the latched flags instead. */
+	printf("BIOS: Skipped (HLE incompatible), polling IRQ flags\n");
+#else
 	/* Flush instruction cache first */
 	syscall_flushCache();
 
@@ -102,8 +108,12 @@ void biosInit(void) {
 	uint32_t event = syscall_openEvent(EVENT_DMA, 0x1000, EVENT_MODE_CALLBACK, dmaIRQ);
 	syscall_enableEvent(event);
 
-	/* Enable DMA interrupts in hardware */
-	IRQ_MASK |= (1 << IRQ_DMA);
+	/* VSync event drives the vblank counter in irq.c */
+	event = syscall_openEvent(EVENT_VBLANK, EVENT_SPEC_INT, EVENT_MODE_CALLBACK, vsyncIRQ);
+	syscall_enableEvent(event);
+
+	/* Enable DMA and VSync interrupts in hardware */
+	IRQ_MASK |= (1 << IRQ_DMA) | (1 << IRQ_VSYNC);
 
 	/* Enable master DMA IRQ in DICR */
 	uint32_t dicr = DMA_DICR;
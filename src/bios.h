@@ -13,11 +13,15 @@ extern "C" {
 
 /* Event class IDs */
 #define EVENT_DMA       0xf0000011
+#define EVENT_VBLANK    0xf2000003
+
+/* Event specs */
+#define EVENT_SPEC_INT  0x0002
 
 /* Event modes */
 #define EVENT_MODE_CALLBACK  0x1000
 
-/* Initialize BIOS event system for HLE compatibility */
+/* Initialize BIOS event system for HLE compatibility (needs ENABLE_BIOS_EVENTS) */
 void biosInit(void);
 
 /* Open a BIOS event */
@@ -1,127 +1,144 @@
 /*
  * CD-DA Audio Playback for PS1 bare-metal
- * Simplified to match psyqo's approach exactly
+ * Simplified to match psyqo's approach, with every command going through
+ * the asynchronous queue in cdrom.c
  */
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include "cdda.h"
+#include "cdread.h"
+#include "cdrom.h"
 #include "ps1/registers.h"
 
-/* CD-ROM commands (matching psyqo's CDL enum) */
-#define CDL_SETLOC   0x02
-#define CDL_PLAY     0x03
-#define CDL_STOP     0x08
-#define CDL_PAUSE    0x09
-#define CDL_INIT     0x0A
-#define CDL_DEMUTE   0x0C
-#define CDL_SETMODE  0x0E
-#define CDL_GETTD    0x14
-#define CDL_SEEKP    0x16
-
-/* Track position storage */
+/* Track position storage (BCD minute/second, 0:0 = not fetched yet) */
 static uint8_t trackMinute[100];
 static uint8_t trackSecond[100];
 static int numTracks = 0;
 static int currentTrack = 0;
+static int pendingTrack = 0;  /* Track to start once the TOC is known */
+static int deferredTrack = 0; /* Track to start once a data read is done */
 static bool cddaInitialized = false;
 static bool isPlaying = false;
+static volatile bool trackEnded = false;  /* Set by the end of track event */
 
-/* Simple delay */
-static void delay(int count) {
-	for (volatile int i = 0; i < count; i++)
-		__asm__ volatile("");
+static void startTrack(int track);
+
+/* Set CD audio volume (matches psyqo's setVolume) */
+static void setCDVolume(uint8_t leftToLeft, uint8_t rightToRight) {
+	/* SPU CD audio input volume */
+	SPU_AVOLL = 0x7FFF;
+	SPU_AVOLR = 0x7FFF;
+
+	/* CD-ROM mixer: Bank 2 */
+	CDROM_ADDRESS = 2;
+	CDROM_ATV0 = leftToLeft;   /* Left CD -> Left SPU */
+	CDROM_ATV1 = 0;            /* Left CD -> Right SPU (no crossfeed) */
+
+	/* CD-ROM mixer: Bank 3 */
+	CDROM_ADDRESS = 3;
+	CDROM_ATV2 = rightToRight; /* Right CD -> Right SPU */
+	CDROM_ATV3 = 0;            /* Right CD -> Left SPU (no crossfeed) */
+	CDROM_ADPCTL = 0x20;       /* Apply volume settings */
 }
 
-/* Wait for CD-ROM ready */
-static void waitReady(void) {
-	while (CDROM_HSTS & CDROM_HSTS_BUSYSTS)
-		__asm__ volatile("");
+/* GETTD response: status, then the track's minute and second in BCD */
+static void onTrackPosition(const CDROMResponse *response, void *arg) {
+	int track = (intptr_t) arg;
+
+	if ((response->irq != CDROM_IRQ_ACKNOWLEDGE) || (response->length < 3)) {
+		printf("CDDA: Can't locate track %d\n", track);
+		return;
+	}
+
+	trackMinute[track] = response->data[1];
+	trackSecond[track] = response->data[2];
+	printf("CDDA: Track %d at %02X:%02X:00\n",
+		track, trackMinute[track], trackSecond[track]);
+
+	if (track == currentTrack)
+		startTrack(track);
 }
 
-/* Wait for interrupt and read response */
-static int waitResponse(uint8_t *response, int maxLen) {
-	/* Wait for interrupt */
-	CDROM_ADDRESS = 1;
-	while (!(CDROM_HINTSTS & CDROM_HINT_INT_BITMASK))
-		__asm__ volatile("");
-
-	int intType = CDROM_HINTSTS & CDROM_HINT_INT_BITMASK;
-
-	/* Read response bytes */
-	int count = 0;
-	while ((CDROM_HSTS & CDROM_HSTS_RSLRRDY) && count < maxLen) {
-		if (response) response[count] = CDROM_RESULT;
-		else (void)CDROM_RESULT;
-		count++;
+/* GETTD track 0 returns the total number of tracks */
+static void onTrackCount(const CDROMResponse *response, void *arg) {
+	if ((response->irq != CDROM_IRQ_ACKNOWLEDGE) || (response->length < 3)) {
+		printf("CDDA: No TOC, is there a disc?\n");
+		return;
 	}
 
-	/* Drain remaining */
-	while (CDROM_HSTS & CDROM_HSTS_RSLRRDY)
-		(void)CDROM_RESULT;
+	numTracks = fromBCD(response->data[2]);
+	printf("CDDA: %d tracks on disc\n", numTracks);
+
+	if (numTracks < 2) {
+		printf("CDDA: No audio tracks\n");
+		return;
+	}
 
-	/* Acknowledge interrupt */
-	CDROM_HCLRCTL = CDROM_HCLRCTL_CLRINT_BITMASK;
-	delay(1000);
+	cddaInitialized = true;
 
-	return intType;
+	if (pendingTrack)
+		playCDDATrack(pendingTrack);
 }
 
-/* Send command with no params */
-static void sendCommand(uint8_t cmd) {
-	waitReady();
-	CDROM_ADDRESS = 0;
-	CDROM_COMMAND = cmd;
-	delay(1000);
+/* With auto pause the drive stops at the end of the track and raises a data
+ * end interrupt, which arrives here as an event */
+static void onCDDAEvent(const CDROMResponse *response, void *arg) {
+	if (isPlaying && (response->irq == CDROM_IRQ_DATA_END))
+		trackEnded = true;
 }
 
-/* Send command with params */
-static void sendCommandParams(uint8_t cmd, const uint8_t *params, int numParams) {
-	waitReady();
-	CDROM_ADDRESS = 0;
-	for (int i = 0; i < numParams; i++) {
-		CDROM_PARAMETER = params[i];
+static void onPlaying(const CDROMResponse *response, void *arg) {
+	int track = (intptr_t) arg;
+
+	if (response->irq != CDROM_IRQ_ACKNOWLEDGE) {
+		printf("CDDA: Track %d failed to start\n", track);
+		return;
 	}
-	CDROM_COMMAND = cmd;
-	delay(1000);
-}
 
-/* BCD conversion */
-static uint8_t toBCD(int val) {
-	return ((val / 10) << 4) | (val % 10);
+	isPlaying  = (track == currentTrack);
+	trackEnded = false;
+	printf("CDDA: Playing track %d\n", track);
 }
 
-static int fromBCD(uint8_t bcd) {
-	return ((bcd >> 4) * 10) + (bcd & 0x0F);
-}
+/* Queue everything needed to start a track whose position is known. A data
+ * read in progress owns the drive's mode and the event callback, so the
+ * track waits for it to finish. */
+static void startTrack(int track) {
+	uint8_t params[3];
 
-/* Set CD audio volume (matches psyqo's setVolume) */
-static void setCDVolume(uint8_t leftToLeft, uint8_t rightToRight) {
-	/* SPU CD audio input volume */
-	SPU_AVOLL = 0x7FFF;
-	SPU_AVOLR = 0x7FFF;
+	if (isCDReadBusy()) {
+		deferredTrack = track;
+		return;
+	}
 
-	/* CD-ROM mixer: Bank 2 */
-	CDROM_ADDRESS = 2;
-	CDROM_ATV0 = leftToLeft;   /* Left CD -> Left SPU */
-	CDROM_ATV1 = 0;            /* Left CD -> Right SPU (no crossfeed) */
+	deferredTrack = 0;
 
-	/* CD-ROM mixer: Bank 3 */
-	CDROM_ADDRESS = 3;
-	CDROM_ATV2 = rightToRight; /* Right CD -> Right SPU */
-	CDROM_ATV3 = 0;            /* Right CD -> Left SPU (no crossfeed) */
-	CDROM_ADPCTL = 0x20;       /* Apply volume settings */
+	/* SETMODE: CD-DA audio output enabled, pause at the end of the track
+	 * instead of running on into the next one */
+	params[0] = CDROM_MODE_CDDA | CDROM_MODE_AUTO_PAUSE;
+	issueCDROMCommand(CDROM_CMD_SETMODE, params, 1, NULL, NULL);
+
+	/* SETLOC: Set position to track start (BCD format) */
+	params[0] = trackMinute[track];
+	params[1] = trackSecond[track];
+	params[2] = 0x00;  /* Frame 0 */
+	issueCDROMCommand(CDROM_CMD_SETLOC, params, 3, NULL, NULL);
+
+	/* SEEKP completes in the background, PLAY is only sent once it has */
+	issueCDROMCommand(CDROM_CMD_SEEKP, NULL, 0, NULL, NULL);
+	issueCDROMCommand(
+		CDROM_CMD_PLAY, NULL, 0, onPlaying, (void *) (intptr_t) track
+	);
 }
 
 void initCDDA(void) {
-	uint8_t response[8];
-
 	printf("CDDA: Initializing...\n");
 
 	/* Enable SPU with CD audio input */
 	SPU_CTRL = SPU_CTRL_ENABLE | SPU_CTRL_DAC_ENABLE | SPU_CTRL_I2SA_ENABLE;
-	delay(5000);
 
 	/* Set master volume */
 	SPU_MVOLL = 0x3FFF;
@@ -131,55 +148,25 @@ void initCDDA(void) {
 	setCDVolume(0x80, 0x80);
 	printf("CDDA: Volume set\n");
 
-	/* Clear pending interrupts */
-	CDROM_ADDRESS = 1;
-	CDROM_HCLRCTL = CDROM_HCLRCTL_CLRINT_BITMASK | CDROM_HCLRCTL_CLRPRM;
-	delay(5000);
-
-	/* Initialize CD-ROM */
-	printf("CDDA: Sending INIT...\n");
-	sendCommand(CDL_INIT);
-	waitResponse(response, 8);
-	delay(50000);
-	waitResponse(response, 8);  /* Init sends two responses */
-	printf("CDDA: CD-ROM ready\n");
+	/* Registered once, data reads take it over while they run and give it
+	 * back when they finish */
+	setCDROMEventCallback(onCDDAEvent, NULL);
 
-	/* Get track count (GETTD track 0 returns total tracks) */
+	/* The drive was reset by initCDROM(), these run after its INIT. Track 2
+	 * (the first audio track) starts as soon as the TOC has been read. */
 	uint8_t param = 0;
-	sendCommandParams(CDL_GETTD, &param, 1);
-	waitResponse(response, 8);
-	numTracks = fromBCD(response[2]);
-	printf("CDDA: %d tracks on disc\n", numTracks);
+	issueCDROMCommand(CDROM_CMD_GETTD, &param, 1, onTrackCount, NULL);
+	issueCDROMCommand(CDROM_CMD_DEMUTE, NULL, 0, NULL, NULL);
 
-	if (numTracks < 2) {
-		printf("CDDA: No audio tracks\n");
-		return;
-	}
-
-	/* Get position of track 2 (first audio track) */
-	param = toBCD(2);
-	sendCommandParams(CDL_GETTD, &param, 1);
-	waitResponse(response, 8);
-	trackMinute[2] = response[1];  /* Already BCD */
-	trackSecond[2] = response[2];
-	printf("CDDA: Track 2 at %02X:%02X:00\n", trackMinute[2], trackSecond[2]);
-
-	/* Demute CD audio */
-	sendCommand(CDL_DEMUTE);
-	waitResponse(response, 8);
-	printf("CDDA: Demuted\n");
-
-	cddaInitialized = true;
-
-	/* Start playing track 2 */
-	playCDDATrack(2);
+	pendingTrack = 2;
 }
 
 void playCDDATrack(int track) {
-	uint8_t response[8];
-	uint8_t params[3];
-
-	if (!cddaInitialized) return;
+	/* Still reading the TOC, start the track once it's done */
+	if (!cddaInitialized) {
+		pendingTrack = track;
+		return;
+	}
 	if (track < 2 || track > numTracks) {
 		printf("CDDA: Invalid track %d\n", track);
 		return;
@@ -187,59 +174,36 @@ void playCDDATrack(int track) {
 
 	printf("CDDA: Playing track %d...\n", track);
 
+	currentTrack = track;
+	pendingTrack = 0;
+	isPlaying    = false;
+
 	/* Get track position if not already cached */
 	if (trackMinute[track] == 0 && trackSecond[track] == 0) {
 		uint8_t param = toBCD(track);
-		sendCommandParams(CDL_GETTD, &param, 1);
-		waitResponse(response, 8);
-		trackMinute[track] = response[1];
-		trackSecond[track] = response[2];
+		issueCDROMCommand(
+			CDROM_CMD_GETTD, &param, 1, onTrackPosition, (void *) (intptr_t) track
+		);
+	} else {
+		startTrack(track);
 	}
-
-	/* SETMODE: 0x01 = CD-DA audio output enabled */
-	params[0] = 0x01;
-	sendCommandParams(CDL_SETMODE, params, 1);
-	waitResponse(response, 8);
-
-	/* SETLOC: Set position to track start (BCD format) */
-	params[0] = trackMinute[track];
-	params[1] = trackSecond[track];
-	params[2] = 0x00;  /* Frame 0 */
-	sendCommandParams(CDL_SETLOC, params, 3);
-	waitResponse(response, 8);
-
-	/* SEEKP: Seek to audio position */
-	sendCommand(CDL_SEEKP);
-	waitResponse(response, 8);  /* Acknowledge */
-	waitResponse(response, 8);  /* Complete */
-	printf("CDDA: Seek complete\n");
-
-	/* PLAY: Start playback */
-	sendCommand(CDL_PLAY);
-	waitResponse(response, 8);
-
-	currentTrack = track;
-	isPlaying = true;
-	printf("CDDA: Playing!\n");
 }
 
 void stopCDDA(void) {
-	uint8_t response[8];
 	if (!cddaInitialized) return;
 
-	sendCommand(CDL_STOP);
-	waitResponse(response, 8);
-	isPlaying = false;
+	issueCDROMCommand(CDROM_CMD_STOP, NULL, 0, NULL, NULL);
+	currentTrack = 0;
+	isPlaying    = false;
 	printf("CDDA: Stopped\n");
 }
 
 void pauseCDDA(void) {
-	uint8_t response[8];
 	if (!cddaInitialized) return;
 
-	sendCommand(CDL_PAUSE);
-	waitResponse(response, 8);
-	isPlaying = false;
+	issueCDROMCommand(CDROM_CMD_PAUSE, NULL, 0, NULL, NULL);
+	currentTrack = 0;
+	isPlaying    = false;
 	printf("CDDA: Paused\n");
 }
 
@@ -248,6 +212,33 @@ bool isCDDAPlaying(void) {
 }
 
 void updateCDDA(void) {
-	/* Simple implementation - no looping for now */
-	/* In a real game, you'd check for track end and restart */
+	/* Don't send PLAY in the middle of a data read, start or loop the track
+	 * once it's done */
+	if (isCDReadBusy())
+		return;
+
+	/* Unless it was stopped meanwhile */
+	if (deferredTrack) {
+		int track = deferredTrack;
+
+		deferredTrack = 0;
+		if (track == currentTrack)
+			startTrack(track);
+	}
+
+	if (!trackEnded)
+		return;
+
+	trackEnded = false;
+
+	/* PLAY with a track number seeks straight to its start, skipping the
+	 * SETLOC/SEEKP round trips of the first start. The mode is unchanged. */
+	if (isPlaying) {
+		uint8_t param = toBCD(currentTrack);
+
+		isPlaying = false;
+		issueCDROMCommand(
+			CDROM_CMD_PLAY, &param, 1, onPlaying, (void *) (intptr_t) currentTrack
+		);
+	}
 }
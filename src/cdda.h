@@ -24,7 +24,7 @@ void pauseCDDA(void);
 /* Check if CD-DA is currently playing */
 bool isCDDAPlaying(void);
 
-/* Call periodically to handle looping */
+/* Call once per frame, restarts the track when it reaches its end */
 void updateCDDA(void);
 
 #endif /* CDDA_H */
@@ -0,0 +1,327 @@
+/*
+ * CD-ROM data sector reader for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cdread.h"
+#include "cdrom.h"
+#include "irq.h"
+#include "ps1/registers.h"
+
+#define SECTOR_WORDS (CD_SECTOR_SIZE / 4)
+
+/* Sectors are read as 2340 bytes so the drive hands over the header (BCD
+ * M:S:F and mode) and Mode 2 subheader ahead of the 2048 bytes of data */
+#define HEADER_WORDS 3
+
+typedef enum {
+	CD_READ_IDLE,
+	CD_READ_STARTING, /* SETLOC and READ_N queued, data ignored until acked */
+	CD_READ_RUNNING,  /* Sectors arriving */
+	CD_READ_STALLED,  /* Stream buffer full, drive paused */
+	CD_READ_DRAINING  /* Every sector received, stream buffer not yet empty */
+} CDReadState;
+
+static volatile CDReadState state = CD_READ_IDLE;
+
+static uint32_t startLBA;
+static int      numSectors, receivedSectors, deliveredSectors;
+static int      retries;
+static bool     singleSpeed;
+static uint32_t lastSectorFrame;
+
+/* Caller buffer of a direct read, NULL for streams */
+static uint32_t *destination;
+
+static CDSectorCallback sectorCallback;
+static CDReadCallback   doneCallback;
+static void             *callbackArg;
+
+/* Event callback the read took over (CD-DA's end of track handler, ...),
+ * given back once it finishes */
+static CDROMCallback savedEventCallback;
+static void          *savedEventArg;
+
+static uint32_t streamBuffer[CD_READ_BUFFERED_SECTORS][SECTOR_WORDS];
+static uint8_t  bufferHead = 0, bufferLength = 0;
+
+static void onReadStarted(const CDROMResponse *response, void *arg);
+
+/* Copy the next words of the sector buffer into memory */
+static void transferWords(uint32_t *target, int words) {
+	DMA_MADR(DMA_CDROM) = (uint32_t) target;
+	DMA_BCR (DMA_CDROM) = words;
+	DMA_CHCR(DMA_CDROM) = 0
+		| DMA_CHCR_READ
+		| DMA_CHCR_MODE_BURST
+		| DMA_CHCR_ENABLE
+		| DMA_CHCR_TRIGGER;
+
+	// This runs from the CD-ROM interrupt, so spin here rather than in
+	// waitForDMA(), which would service interrupts again. A sector takes
+	// well under a millisecond to transfer.
+	while (DMA_CHCR(DMA_CDROM) & DMA_CHCR_ENABLE)
+		__asm__ volatile("");
+}
+
+/* Start reading the sector the drive just reported and return the logical
+ * sector number from its header */
+static uint32_t openSector(void) {
+	uint32_t header[HEADER_WORDS];
+
+	CDROM_ADDRESS = 0;
+	CDROM_HCHPCTL = CDROM_HCHPCTL_BFRD;
+
+	while (!(CDROM_HSTS & CDROM_HSTS_DRQSTS))
+		__asm__ volatile("");
+
+	transferWords(header, HEADER_WORDS);
+	return msfToLBA((const uint8_t *) header);
+}
+
+static void closeSector(void) {
+	CDROM_HCHPCTL = 0;
+}
+
+/* Seek to the next sector still missing and start reading */
+static void startRead(void) {
+	uint8_t msf[3];
+
+	state           = CD_READ_STARTING;
+	lastSectorFrame = getVSyncCount();
+
+	lbaToMSF(startLBA + receivedSectors, msf);
+	issueCDROMCommand(CDROM_CMD_SETLOC, msf, 3, NULL, NULL);
+	issueCDROMCommand(CDROM_CMD_READ_N, NULL, 0, onReadStarted, NULL);
+}
+
+static void finishRead(bool success) {
+	// The callback may start another read straight away
+	CDReadCallback callback = doneCallback;
+	void           *arg     = callbackArg;
+
+	state = CD_READ_IDLE;
+	setCDROMEventCallback(savedEventCallback, savedEventArg);
+
+	if (callback)
+		callback(success, arg);
+}
+
+static void retryRead(void) {
+	if (++retries > CD_READ_MAX_RETRIES) {
+		issueCDROMCommand(CDROM_CMD_PAUSE, NULL, 0, NULL, NULL);
+		finishRead(false);
+		return;
+	}
+
+	issueCDROMCommand(CDROM_CMD_PAUSE, NULL, 0, NULL, NULL);
+	startRead();
+}
+
+/* Seek back to a sector that went by before it could be fetched. That isn't
+ * a drive error, so it doesn't count as a retry; rather the rest of the read
+ * runs at single speed, giving the main loop twice as long per sector. */
+static void recoverOverrun(void) {
+	issueCDROMCommand(CDROM_CMD_PAUSE, NULL, 0, NULL, NULL);
+
+	if (!singleSpeed) {
+		uint8_t mode = CDROM_MODE_SIZE_2340;
+
+		singleSpeed = true;
+		issueCDROMCommand(CDROM_CMD_SETMODE, &mode, 1, NULL, NULL);
+	}
+
+	startRead();
+}
+
+static void onReadStarted(const CDROMResponse *response, void *arg) {
+	if (state != CD_READ_STARTING)
+		return;
+
+	if (response->irq != CDROM_IRQ_ACKNOWLEDGE) {
+		retryRead();
+		return;
+	}
+
+	state           = CD_READ_RUNNING;
+	lastSectorFrame = getVSyncCount();
+}
+
+static void onSectorReady(void) {
+	uint32_t *target;
+
+	if (destination) {
+		target = &destination[receivedSectors * SECTOR_WORDS];
+	} else {
+		if (bufferLength >= CD_READ_BUFFERED_SECTORS) {
+			// Leave this sector in the drive, it's read again once
+			// updateCDRead() has made room for it.
+			issueCDROMCommand(CDROM_CMD_PAUSE, NULL, 0, NULL, NULL);
+			state = CD_READ_STALLED;
+			return;
+		}
+
+		target = streamBuffer[
+			(bufferHead + bufferLength) % CD_READ_BUFFERED_SECTORS
+		];
+	}
+
+	// Interrupts are only polled, so by the time this runs the drive may
+	// have moved on and replaced the sector it reported. Skip any sector
+	// seen before and seek back if the one expected went by.
+	uint32_t lba      = openSector();
+	uint32_t expected = startLBA + receivedSectors;
+
+	if (lba != expected) {
+		closeSector();
+
+		if (lba > expected)
+			recoverOverrun();
+		return;
+	}
+
+	transferWords(target, SECTOR_WORDS);
+	closeSector();
+
+	if (!destination)
+		bufferLength++;
+
+	receivedSectors++;
+	retries         = 0;
+	lastSectorFrame = getVSyncCount();
+
+	if (receivedSectors < numSectors)
+		return;
+
+	issueCDROMCommand(CDROM_CMD_PAUSE, NULL, 0, NULL, NULL);
+
+	if (destination)
+		finishRead(true);
+	else
+		state = CD_READ_DRAINING;
+}
+
+static void onReadEvent(const CDROMResponse *response, void *arg) {
+	if (state != CD_READ_RUNNING)
+		return;
+
+	switch (response->irq) {
+		case CDROM_IRQ_DATA_READY:
+			onSectorReady();
+			break;
+
+		case CDROM_IRQ_DATA_END:
+			// Ran off the end of the data track, retrying won't help
+			finishRead(false);
+			break;
+
+		case CDROM_IRQ_ERROR:
+			retryRead();
+			break;
+	}
+}
+
+static bool beginRead(
+	uint32_t         lba,
+	int              count,
+	uint32_t         *buffer,
+	CDSectorCallback onSector,
+	CDReadCallback   onDone,
+	void             *arg
+) {
+	if ((state != CD_READ_IDLE) || (count <= 0))
+		return false;
+
+	startLBA         = lba;
+	numSectors       = count;
+	receivedSectors  = 0;
+	deliveredSectors = 0;
+	retries          = 0;
+	singleSpeed      = false;
+	destination      = buffer;
+	sectorCallback   = onSector;
+	doneCallback     = onDone;
+	callbackArg      = arg;
+	bufferHead       = 0;
+	bufferLength     = 0;
+
+	savedEventCallback = getCDROMEventCallback(&savedEventArg);
+	setCDROMEventCallback(onReadEvent, NULL);
+
+	uint8_t mode = CDROM_MODE_SPEED_2X | CDROM_MODE_SIZE_2340;
+	issueCDROMCommand(CDROM_CMD_SETMODE, &mode, 1, NULL, NULL);
+
+	startRead();
+	return true;
+}
+
+void initCDRead(void) {
+	state        = CD_READ_IDLE;
+	bufferHead   = 0;
+	bufferLength = 0;
+
+	DMA_DPCR |= DMA_DPCR_CH_ENABLE(DMA_CDROM);
+}
+
+bool readCDSectors(
+	uint32_t       lba,
+	int            count,
+	void           *buffer,
+	CDReadCallback callback,
+	void           *arg
+) {
+	if (!buffer)
+		return false;
+
+	return beginRead(lba, count, (uint32_t *) buffer, NULL, callback, arg);
+}
+
+bool streamCDSectors(
+	uint32_t         lba,
+	int              count,
+	CDSectorCallback onSector,
+	CDReadCallback   onDone,
+	void             *arg
+) {
+	if (!onSector)
+		return false;
+
+	return beginRead(lba, count, NULL, onSector, onDone, arg);
+}
+
+bool isCDReadBusy(void) {
+	return state != CD_READ_IDLE;
+}
+
+void updateCDRead(void) {
+	// The slot being handed out stays counted in bufferLength until the
+	// callback returns, so sectors arriving meanwhile can't overwrite it.
+	while (bufferLength) {
+		sectorCallback(streamBuffer[bufferHead], deliveredSectors, callbackArg);
+
+		bufferHead = (bufferHead + 1) % CD_READ_BUFFERED_SECTORS;
+		bufferLength--;
+		deliveredSectors++;
+	}
+
+	switch (state) {
+		case CD_READ_STALLED:
+			startRead();
+			break;
+
+		case CD_READ_DRAINING:
+			if (deliveredSectors >= numSectors)
+				finishRead(true);
+			break;
+
+		case CD_READ_RUNNING:
+			if ((getVSyncCount() - lastSectorFrame) > CD_READ_TIMEOUT_FRAMES)
+				retryRead();
+			break;
+
+		default:
+			break;
+	}
+}
@@ -0,0 +1,85 @@
+/*
+ * CD-ROM data sector reader for PS1 bare-metal
+ *
+ * Reads 2048-byte Mode 2 Form 1 sectors with READ_N, moving each one out of
+ * the drive's buffer with DMA3 as soon as its data ready interrupt arrives.
+ * Sectors go either straight into a caller buffer or, for streams too large
+ * to hold at once, through a small internal double buffer that updateCDRead()
+ * drains from the main loop. When the double buffer fills up the drive is
+ * paused and resumed once there is space, so a slow consumer costs time but
+ * never loses sectors. Each sector's header is checked against the position
+ * expected next: repeats are dropped, and if one was missed because the
+ * interrupt was serviced late the read restarts from it at single speed,
+ * without counting against CD_READ_MAX_RETRIES. That limit is kept for
+ * drive errors and stalls, after which reads retry from the failed sector.
+ *
+ * The drive has a single head, so reading data stops any CD-DA or XA
+ * playback in progress. A read takes over the CD-ROM event callback while it
+ * runs and puts the previous one back when it finishes.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CD_SECTOR_SIZE 2048
+
+/* Sectors held by a stream while waiting for updateCDRead() */
+#define CD_READ_BUFFERED_SECTORS 2
+
+/* Attempts at restarting a read after a drive error or a stall */
+#define CD_READ_MAX_RETRIES 3
+
+/* Frames to wait for the next sector before treating the read as stalled */
+#define CD_READ_TIMEOUT_FRAMES 60
+
+/* Called once a read has finished or given up */
+typedef void (*CDReadCallback)(bool success, void *arg);
+
+/* Called for each sector of a stream, in order, from updateCDRead() */
+typedef void (*CDSectorCallback)(const uint32_t *data, int index, void *arg);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Enable DMA3 and reset the reader. Needs initCDROM() to have been called. */
+void initCDRead(void);
+
+/*
+ * Read count sectors starting at lba into buffer, which must be word aligned
+ * and hold count * CD_SECTOR_SIZE bytes. The callback runs from the CD-ROM
+ * interrupt. Returns false if another read is in progress.
+ */
+bool readCDSectors(
+	uint32_t       lba,
+	int            count,
+	void           *buffer,
+	CDReadCallback callback,
+	void           *arg
+);
+
+/*
+ * Read count sectors starting at lba, handing each one to onSector from
+ * updateCDRead(). The sector data is only valid during the callback. Returns
+ * false if another read is in progress.
+ */
+bool streamCDSectors(
+	uint32_t         lba,
+	int              count,
+	CDSectorCallback onSector,
+	CDReadCallback   onDone,
+	void             *arg
+);
+
+/* Returns whether a read is in progress */
+bool isCDReadBusy(void);
+
+/* Deliver buffered stream sectors, resume stalled reads and check for
+ * timeouts. Call every frame after updateCDROM(). */
+void updateCDRead(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,344 @@
+/*
+ * Asynchronous CD-ROM command queue for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cdrom.h"
+#include "irq.h"
+#include "ps1/registers.h"
+
+/* Interrupts the controller is allowed to raise */
+#define CDROM_HINT_ENABLE_ALL 0x1f
+
+typedef enum {
+	CDROM_STATE_IDLE,         /* Nothing in flight */
+	CDROM_STATE_WAIT_ACK,     /* Command sent, waiting for INT3 */
+	CDROM_STATE_WAIT_COMPLETE /* Acknowledged, waiting for INT2 */
+} CDROMState;
+
+typedef struct {
+	CDROMCallback callback;
+	void          *arg;
+	uint8_t       cmd;
+	uint8_t       numParams;
+	uint8_t       params[CDROM_MAX_PARAMS];
+} CDROMRequest;
+
+static CDROMRequest queue[CDROM_QUEUE_SIZE];
+static uint8_t      queueHead = 0, queueLength = 0;
+
+static volatile CDROMState state = CDROM_STATE_IDLE;
+static uint32_t            sentFrame;
+
+/* Set from the acknowledge of a READ_N/READ_S until something stops the
+ * read, so errors it raises aren't taken for a command's answer */
+static bool reading = false;
+
+/* Set when a command times out, so nothing is sent until the next
+ * updateCDROM() and a late answer to it can't be taken for the next one's */
+static bool holdOff = false;
+
+static CDROMCallback eventCallback    = NULL;
+static void          *eventCallbackArg = NULL;
+
+/* Mode set by the last SETMODE queued, so callers can skip redundant ones */
+static uint8_t currentMode = 0;
+
+/* Commands that send a second, "complete" response after the acknowledge */
+static bool hasSecondResponse(uint8_t cmd) {
+	switch (cmd) {
+		case CDROM_CMD_STOP:
+		case CDROM_CMD_PAUSE:
+		case CDROM_CMD_INIT:
+		case CDROM_CMD_SEEKL:
+		case CDROM_CMD_SEEKP:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/* Track whether the drive is reading data from the commands it acknowledges */
+static void updateReadState(uint8_t cmd) {
+	switch (cmd) {
+		case CDROM_CMD_READ_N:
+		case CDROM_CMD_READ_S:
+			reading = true;
+			break;
+
+		case CDROM_CMD_SETLOC:
+		case CDROM_CMD_SETMODE:
+		case CDROM_CMD_SETFILTER:
+		case CDROM_CMD_GETSTAT:
+		case CDROM_CMD_GETLOCP:
+		case CDROM_CMD_MUTE:
+		case CDROM_CMD_DEMUTE:
+			break;
+
+		default:
+			reading = false;
+			break;
+	}
+}
+
+/* Pop the command in flight and return its callback and argument. Must be
+ * called with interrupts masked. */
+static CDROMCallback popRequest(void **arg) {
+	// The callback may queue more commands into the slot being freed, so
+	// take what's needed out of it first.
+	CDROMCallback callback = queue[queueHead].callback;
+	*arg                   = queue[queueHead].arg;
+
+	queueHead = (queueHead + 1) % CDROM_QUEUE_SIZE;
+	queueLength--;
+	state = CDROM_STATE_IDLE;
+
+	return callback;
+}
+
+/* Pop the command in flight and hand it its response */
+static void completeRequest(const CDROMResponse *response) {
+	void *arg;
+
+	uint32_t      status   = enterCriticalSection();
+	CDROMCallback callback = popRequest(&arg);
+	exitCriticalSection(status);
+
+	if (callback)
+		callback(response, arg);
+}
+
+/* Send the next queued command if the drive can take it */
+static void sendNextCommand(void) {
+	uint32_t status = enterCriticalSection();
+
+	if (
+		(state != CDROM_STATE_IDLE) || !queueLength || holdOff ||
+		(CDROM_HSTS & CDROM_HSTS_BUSYSTS)
+	) {
+		exitCriticalSection(status);
+		return;
+	}
+
+	const CDROMRequest *request = &queue[queueHead];
+
+	CDROM_ADDRESS = 0;
+
+	for (int i = 0; i < request->numParams; i++)
+		CDROM_PARAMETER = request->params[i];
+
+	CDROM_COMMAND = request->cmd;
+
+	state     = CDROM_STATE_WAIT_ACK;
+	sentFrame = getVSyncCount();
+	exitCriticalSection(status);
+}
+
+static void cdromIRQHandler(void) {
+	CDROMResponse response;
+
+	CDROM_ADDRESS = 1;
+	response.irq    = CDROM_HINTSTS & CDROM_HINT_INT_BITMASK;
+	response.length = 0;
+
+	while (CDROM_HSTS & CDROM_HSTS_RSLRRDY) {
+		uint8_t value = CDROM_RESULT;
+
+		if (response.length < CDROM_MAX_RESPONSE)
+			response.data[response.length++] = value;
+	}
+
+	CDROM_HCLRCTL = CDROM_HCLRCTL_CLRINT_BITMASK;
+
+	switch (response.irq) {
+		case CDROM_IRQ_ACKNOWLEDGE:
+			// A stray acknowledge, most likely from a command that already
+			// timed out. It was cleared above, nothing else to do.
+			if (state != CDROM_STATE_WAIT_ACK)
+				break;
+
+			updateReadState(queue[queueHead].cmd);
+
+			if (hasSecondResponse(queue[queueHead].cmd)) {
+				state     = CDROM_STATE_WAIT_COMPLETE;
+				sentFrame = getVSyncCount();
+			} else {
+				completeRequest(&response);
+			}
+			break;
+
+		case CDROM_IRQ_COMPLETE:
+			if (state == CDROM_STATE_WAIT_COMPLETE)
+				completeRequest(&response);
+			break;
+
+		case CDROM_IRQ_ERROR:
+			// Errors fail the command in flight, unless a read is running:
+			// then they're reported as an event for cdread.c to retry, and a
+			// command they actually answered falls back on the short
+			// acknowledge timeout. The
+			// drive stops reading after an error, so the next one goes to
+			// the command again.
+			if ((state != CDROM_STATE_IDLE) && !reading) {
+				completeRequest(&response);
+				break;
+			}
+
+			reading = false;
+			// Fall through
+
+		default:
+			if (eventCallback)
+				eventCallback(&response, eventCallbackArg);
+			break;
+	}
+
+	sendNextCommand();
+}
+
+void initCDROM(void) {
+	queueHead   = 0;
+	queueLength = 0;
+	state       = CDROM_STATE_IDLE;
+	currentMode = 0;
+	reading     = false;
+	holdOff     = false;
+
+	// Drop anything left over from the BIOS, then let the controller raise
+	// every interrupt type.
+	CDROM_ADDRESS   = 1;
+	CDROM_HCLRCTL   = CDROM_HCLRCTL_CLRINT_BITMASK | CDROM_HCLRCTL_CLRPRM;
+	CDROM_HINTMSK_W = CDROM_HINT_ENABLE_ALL;
+
+	IRQ_STAT = ~(1 << IRQ_CDROM);
+	setIRQCallback(IRQ_CDROM, cdromIRQHandler);
+
+	issueCDROMCommand(CDROM_CMD_INIT, NULL, 0, NULL, NULL);
+}
+
+bool issueCDROMCommand(
+	CDROMCommand  cmd,
+	const uint8_t *params,
+	int           numParams,
+	CDROMCallback callback,
+	void          *arg
+) {
+	if (numParams > CDROM_MAX_PARAMS)
+		return false;
+
+	// Commands may be issued from callbacks the BIOS DMA event runs
+	// (an SPU upload finishing, ...), so don't let one land halfway through
+	// an insertion
+	uint32_t status = enterCriticalSection();
+
+	if (queueLength >= CDROM_QUEUE_SIZE) {
+		exitCriticalSection(status);
+		return false;
+	}
+
+	CDROMRequest *request = &queue[(queueHead + queueLength) % CDROM_QUEUE_SIZE];
+
+	request->callback  = callback;
+	request->arg       = arg;
+	request->cmd       = cmd;
+	request->numParams = numParams;
+
+	for (int i = 0; i < numParams; i++)
+		request->params[i] = params[i];
+
+	if ((cmd == CDROM_CMD_SETMODE) && numParams)
+		currentMode = params[0];
+	else if (cmd == CDROM_CMD_INIT)
+		currentMode = 0;
+
+	queueLength++;
+	sendNextCommand();
+	exitCriticalSection(status);
+
+	return true;
+}
+
+void setCDROMEventCallback(CDROMCallback callback, void *arg) {
+	eventCallback    = callback;
+	eventCallbackArg = arg;
+}
+
+CDROMCallback getCDROMEventCallback(void **arg) {
+	*arg = eventCallbackArg;
+	return eventCallback;
+}
+
+uint8_t getCDROMMode(void) {
+	return currentMode;
+}
+
+bool isCDROMIdle(void) {
+	return !queueLength;
+}
+
+int getCDROMQueueLength(void) {
+	return queueLength;
+}
+
+void updateCDROM(void) {
+	serviceIRQs();
+
+	// Any late answer to a command that timed out last time has been dropped
+	// by now
+	holdOff = false;
+
+	// A drive with no disc, or an emulator without CD support, may never
+	// answer. Fail the command so the rest of the queue isn't stuck behind
+	// it, checking and popping it in one go so an answer arriving meanwhile
+	// can't complete it twice.
+	CDROMCallback callback = NULL;
+	void          *arg     = NULL;
+	bool          timedOut = false;
+
+	uint32_t status = enterCriticalSection();
+
+	// An error answering the command may have been taken for an event
+	// while a read was running, so don't wait long for the acknowledge
+	uint32_t timeout = (state == CDROM_STATE_WAIT_ACK)
+		? CDROM_ACK_TIMEOUT_FRAMES
+		: CDROM_TIMEOUT_FRAMES;
+
+	if (
+		(state != CDROM_STATE_IDLE) &&
+		((getVSyncCount() - sentFrame) > timeout)
+	) {
+		callback = popRequest(&arg);
+		timedOut = true;
+		holdOff  = true;
+		reading  = false;
+	}
+
+	exitCriticalSection(status);
+
+	if (timedOut && callback) {
+		CDROMResponse response = { .irq = CDROM_IRQ_NONE, .length = 0 };
+
+		callback(&response, arg);
+	}
+
+	sendNextCommand();
+}
+
+void lbaToMSF(uint32_t lba, uint8_t *msf) {
+	// Logical sector 0 is at 00:02:00, after the lead-in
+	lba += 150;
+
+	msf[0] = toBCD(lba / (75 * 60));
+	msf[1] = toBCD((lba / 75) % 60);
+	msf[2] = toBCD(lba % 75);
+}
+
+uint32_t msfToLBA(const uint8_t *msf) {
+	uint32_t sectors =
+		(fromBCD(msf[0]) * 60 + fromBCD(msf[1])) * 75 + fromBCD(msf[2]);
+
+	return (sectors >= 150) ? (sectors - 150) : 0;
+}
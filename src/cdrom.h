@@ -0,0 +1,125 @@
+/*
+ * Asynchronous CD-ROM command queue for PS1 bare-metal
+ *
+ * Commands are queued with a completion callback and sent one at a time as
+ * the drive becomes free. Responses are collected from the CD-ROM interrupt,
+ * which irq.c services from every wait primitive, so seeks and drive resets
+ * run in the background instead of stalling the frame loop. Commands that
+ * finish with a second response (INIT, SEEKP, PAUSE, ...) only complete once
+ * it arrives; data and end of track interrupts that arrive while streaming,
+ * and errors raised while a read is running, go to the event callback.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CDROM_MAX_PARAMS    4
+#define CDROM_MAX_RESPONSE 16
+#define CDROM_QUEUE_SIZE   16
+
+/* Frames to wait for a command's acknowledge, which normally arrives within
+ * milliseconds, and then for its completion (seeks, spin up) before giving up
+ * on it */
+#define CDROM_ACK_TIMEOUT_FRAMES 10
+#define CDROM_TIMEOUT_FRAMES     300
+
+typedef enum {
+	CDROM_CMD_GETSTAT   = 0x01,
+	CDROM_CMD_SETLOC    = 0x02,
+	CDROM_CMD_PLAY      = 0x03,
+	CDROM_CMD_READ_N    = 0x06,
+	CDROM_CMD_STOP      = 0x08,
+	CDROM_CMD_PAUSE     = 0x09,
+	CDROM_CMD_INIT      = 0x0a,
+	CDROM_CMD_MUTE      = 0x0b,
+	CDROM_CMD_DEMUTE    = 0x0c,
+	CDROM_CMD_SETFILTER = 0x0d,
+	CDROM_CMD_SETMODE   = 0x0e,
+	CDROM_CMD_GETLOCP   = 0x11,
+	CDROM_CMD_GETTN     = 0x13,
+	CDROM_CMD_GETTD     = 0x14,
+	CDROM_CMD_SEEKL     = 0x15,
+	CDROM_CMD_SEEKP     = 0x16,
+	CDROM_CMD_READ_S    = 0x1b
+} CDROMCommand;
+
+/* SETMODE flags */
+#define CDROM_MODE_CDDA       0x01
+#define CDROM_MODE_AUTO_PAUSE 0x02
+#define CDROM_MODE_REPORT     0x04
+#define CDROM_MODE_XA_FILTER  0x08
+#define CDROM_MODE_SIZE_2340  0x20
+#define CDROM_MODE_XA_ADPCM   0x40
+#define CDROM_MODE_SPEED_2X   0x80
+
+/* Response of a finished command, or an unsolicited event */
+typedef struct {
+	uint8_t irq;     /* CDROM_IRQ_*, CDROM_IRQ_NONE if the command timed out */
+	uint8_t length;
+	uint8_t data[CDROM_MAX_RESPONSE];
+} CDROMResponse;
+
+typedef void (*CDROMCallback)(const CDROMResponse *response, void *arg);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reset the controller's interrupt state, hook the CD-ROM interrupt and queue
+ * an INIT. Needs initIRQ() to have been called.
+ */
+void initCDROM(void);
+
+/*
+ * Queue a command. The callback, if any, gets the final response (the second
+ * one for commands that have two). Returns false if the queue is full.
+ */
+bool issueCDROMCommand(
+	CDROMCommand  cmd,
+	const uint8_t *params,
+	int           numParams,
+	CDROMCallback callback,
+	void          *arg
+);
+
+/* Callback for data ready, data end and error interrupts that don't belong to
+ * a command in flight, read errors included */
+void setCDROMEventCallback(CDROMCallback callback, void *arg);
+
+/* Current event callback and its argument, so a temporary user can put it
+ * back afterwards */
+CDROMCallback getCDROMEventCallback(void **arg);
+
+/* Mode of the last SETMODE queued (0 after INIT) */
+uint8_t getCDROMMode(void);
+
+/* Returns whether every queued command has completed */
+bool isCDROMIdle(void);
+
+/* Commands queued or in flight */
+int getCDROMQueueLength(void);
+
+/* Send any command the drive wasn't ready for yet and check for timeouts.
+ * Cheap enough to call every frame. */
+void updateCDROM(void);
+
+/* BCD helpers for MSF positions and track numbers */
+static inline uint8_t toBCD(int value) {
+	return ((value / 10) << 4) | (value % 10);
+}
+static inline int fromBCD(uint8_t value) {
+	return ((value >> 4) * 10) + (value & 15);
+}
+
+/* Convert a logical sector number to a BCD minute/second/frame position */
+void lbaToMSF(uint32_t lba, uint8_t *msf);
+
+/* Convert a BCD minute/second/frame position back to a logical sector */
+uint32_t msfToLBA(const uint8_t *msf);
+
+#ifdef __cplusplus
+}
+#endif
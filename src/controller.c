@@ -0,0 +1,273 @@
+/*
+ * Controller driver for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "controller.h"
+#include "irq.h"
+#include "ps1/registers.h"
+
+/* Scanlines (about 64 us each) to hold DTR before the first byte, and to wait
+ * for an acknowledge before giving up on the port */
+#define CONTROLLER_SELECT_LINES  2
+#define CONTROLLER_ACK_LINES     8
+
+/* Address byte, poll command, and the tap byte asking a multitap for all four
+ * slots (4 * 8 bytes after the ID and 0x5a). A multitap hands each slot's
+ * 8-byte block on to the pad in it, so the block has to start with the poll
+ * command too. The pads' replies come back in the next round's blocks. */
+#define CONTROLLER_ADDRESS  0x01
+#define CONTROLLER_CMD_POLL 0x42
+#define CONTROLLER_TAP_ALL  0x01
+#define CONTROLLER_MAX_RESPONSE (3 + CONTROLLER_SLOTS_PER_PORT * 8)
+
+#define CONTROLLER_ID_NONE     0xff
+#define CONTROLLER_ID_MULTITAP 0x80
+
+typedef enum {
+	CONTROLLER_STATE_IDLE,     /* Waiting for the next vblank */
+	CONTROLLER_STATE_SELECT,   /* DTR asserted, waiting to send byte 0 */
+	CONTROLLER_STATE_EXCHANGE  /* Byte sent, waiting for its IRQ */
+} ControllerBusState;
+
+static ControllerState pads[2][CONTROLLER_MAX_PADS];
+static volatile uint8_t frontBuffer = 0;
+static volatile uint32_t rounds = 0;
+
+static volatile bool       roundRequested = false;
+static ControllerBusState  state          = CONTROLLER_STATE_IDLE;
+static int                 currentPort;
+static uint16_t            stateLine;
+
+static uint8_t response[CONTROLLER_MAX_RESPONSE];
+static int     byteIndex, responseLength;
+
+static void clearState(ControllerState *pad) {
+	pad->buttons   = 0;
+	pad->leftX     = 0x80;
+	pad->leftY     = 0x80;
+	pad->rightX    = 0x80;
+	pad->rightY    = 0x80;
+	pad->isAnalog  = false;
+	pad->connected = false;
+}
+
+/*
+ * Parse one pad's reply, laid out the same whether it came straight from the
+ * port or out of a multitap slot: ID, 0x5a, buttons (2 bytes), then the right
+ * and left sticks if analog.
+ */
+static void parsePad(ControllerState *pad, const uint8_t *data) {
+	clearState(pad);
+
+	uint8_t id = data[0];
+
+	if ((id == CONTROLLER_ID_NONE) || !id)
+		return;
+
+	int type = id >> 4;
+
+	pad->connected = true;
+	pad->buttons   = (data[2] | (data[3] << 8)) ^ 0xffff;
+
+	// Type 0x7 = DualShock, 0x5 = analog joystick
+	if ((type == 0x7) || (type == 0x5)) {
+		pad->isAnalog = true;
+		pad->rightX   = data[4];
+		pad->rightY   = data[5];
+		pad->leftX    = data[6];
+		pad->leftY    = data[7];
+	}
+}
+
+static void sendByte(void) {
+	uint8_t value = 0x00;
+
+	if (byteIndex == 0)
+		value = CONTROLLER_ADDRESS;
+	else if (byteIndex == 1)
+		value = CONTROLLER_CMD_POLL;
+	else if (byteIndex == 2)
+		value = CONTROLLER_TAP_ALL;
+	else if (
+		(response[1] == CONTROLLER_ID_MULTITAP) &&
+		!((byteIndex - 3) % 8)
+	)
+		value = CONTROLLER_CMD_POLL;
+
+	// Pads don't acknowledge the last byte, its arrival in the RX FIFO raises
+	// the IRQ instead
+	if (byteIndex == (responseLength - 1))
+		SIO_CTRL(0) |= SIO_CTRL_RX_IRQ_ENABLE;
+
+	stateLine   = getHblankCounter();
+	state       = CONTROLLER_STATE_EXCHANGE;
+	SIO_DATA(0) = value;
+}
+
+static void selectPort(int port) {
+	currentPort = port;
+
+	if (port)
+		SIO_CTRL(0) |= SIO_CTRL_CS_PORT_2;
+	else
+		SIO_CTRL(0) &= ~SIO_CTRL_CS_PORT_2;
+
+	SIO_CTRL(0) |= SIO_CTRL_DTR | SIO_CTRL_ACKNOWLEDGE;
+
+	stateLine = getHblankCounter();
+	state     = CONTROLLER_STATE_SELECT;
+}
+
+/* Release the port, store what it returned and move on to the next one */
+static void finishPort(bool complete) {
+	SIO_CTRL(0) &= ~(SIO_CTRL_DTR | SIO_CTRL_RX_IRQ_ENABLE);
+
+	ControllerState *slots = &pads[frontBuffer ^ 1][currentPort * CONTROLLER_SLOTS_PER_PORT];
+
+	for (int i = 0; i < CONTROLLER_SLOTS_PER_PORT; i++)
+		clearState(&slots[i]);
+
+	if (complete) {
+		if (response[1] == CONTROLLER_ID_MULTITAP) {
+			for (int i = 0; i < CONTROLLER_SLOTS_PER_PORT; i++)
+				parsePad(&slots[i], &response[3 + i * 8]);
+		} else {
+			parsePad(&slots[0], &response[1]);
+		}
+	}
+
+	if ((currentPort + 1) < CONTROLLER_NUM_PORTS) {
+		selectPort(currentPort + 1);
+		return;
+	}
+
+	frontBuffer ^= 1;
+	rounds++;
+	state = CONTROLLER_STATE_IDLE;
+}
+
+static void sio0IRQHandler(void) {
+	SIO_CTRL(0) |= SIO_CTRL_ACKNOWLEDGE;
+
+	// The IRQ line stays up until acknowledged above, so it may latch again
+	// once after the byte has already been handled
+	if ((state != CONTROLLER_STATE_EXCHANGE) || !(SIO_STAT(0) & SIO_STAT_RX_NOT_EMPTY))
+		return;
+
+	response[byteIndex] = SIO_DATA(0);
+
+	// The ID byte gives the length of the rest, in halfwords after the 0x5a
+	// (0 for a multitap, which always sends four full slots)
+	if (byteIndex == 1) {
+		uint8_t id = response[1];
+
+		if (id == CONTROLLER_ID_NONE) {
+			finishPort(false);
+			return;
+		}
+
+		int halfwords  = (id & 0x0f) ? (id & 0x0f) : 16;
+		responseLength = 3 + halfwords * 2;
+
+		if (responseLength > CONTROLLER_MAX_RESPONSE)
+			responseLength = CONTROLLER_MAX_RESPONSE;
+	}
+
+	if (++byteIndex >= responseLength)
+		finishPort(true);
+	else
+		sendByte();
+}
+
+static void requestRound(void) {
+	roundRequested = true;
+}
+
+void initControllers(void) {
+	SIO_CTRL(0) = SIO_CTRL_RESET;
+	SIO_MODE(0) = SIO_MODE_BAUD_DIV1 | SIO_MODE_DATA_8;
+	SIO_BAUD(0) = F_CPU / 250000;
+	SIO_CTRL(0) = SIO_CTRL_TX_ENABLE | SIO_CTRL_RX_ENABLE | SIO_CTRL_DSR_IRQ_ENABLE;
+
+	for (int i = 0; i < CONTROLLER_MAX_PADS; i++) {
+		clearState(&pads[0][i]);
+		clearState(&pads[1][i]);
+	}
+
+	frontBuffer    = 0;
+	rounds         = 0;
+	roundRequested = false;
+	state          = CONTROLLER_STATE_IDLE;
+
+	IRQ_STAT = ~(1 << IRQ_SIO0);
+	setIRQCallback(IRQ_SIO0, sio0IRQHandler);
+	setVSyncCallback(requestRound);
+	setIdleCallback(updateControllers);
+}
+
+/* Start the first byte once the select delay is over, or give up on a port
+ * that didn't acknowledge in time */
+static void checkExchange(void) {
+	uint16_t elapsed = getHblankCounter() - stateLine;
+
+	switch (state) {
+		case CONTROLLER_STATE_SELECT:
+			if (elapsed < CONTROLLER_SELECT_LINES)
+				break;
+
+			// Drop anything left in the FIFO, then start with the address byte.
+			// The real length is only known once the ID arrives.
+			while (SIO_STAT(0) & SIO_STAT_RX_NOT_EMPTY)
+				SIO_DATA(0);
+
+			for (int i = 0; i < CONTROLLER_MAX_RESPONSE; i++)
+				response[i] = CONTROLLER_ID_NONE;
+
+			byteIndex      = 0;
+			responseLength = CONTROLLER_MAX_RESPONSE;
+			sendByte();
+			break;
+
+		case CONTROLLER_STATE_EXCHANGE:
+			// Nothing connected, or it stopped answering partway through
+			if (elapsed >= CONTROLLER_ACK_LINES)
+				finishPort(false);
+			break;
+
+		default:
+			break;
+	}
+}
+
+void updateControllers(void) {
+	// Pick up the vblank requesting a round, as nothing else may have
+	// serviced it if the frame didn't have to wait
+	serviceIRQs();
+
+	if ((state != CONTROLLER_STATE_IDLE) || !roundRequested)
+		return;
+
+	roundRequested = false;
+	selectPort(0);
+
+	// Run the whole round in one burst rather than a step per call, so it
+	// doesn't stretch over several frames when the main loop is the only
+	// caller. Each byte is acknowledged within a few dozen microseconds and
+	// every wait is bounded by the select delay or the acknowledge timeout,
+	// so a round takes around a millisecond, a few with multitaps.
+	while (state != CONTROLLER_STATE_IDLE) {
+		serviceIRQs();
+		checkExchange();
+	}
+}
+
+const ControllerState *getControllerState(int index) {
+	return &pads[frontBuffer][index];
+}
+
+uint32_t getControllerRound(void) {
+	return rounds;
+}
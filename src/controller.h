@@ -0,0 +1,80 @@
+/*
+ * Controller driver for PS1 bare-metal
+ *
+ * Both ports are polled once per frame. A vblank callback requests a new
+ * round, which the next updateControllers() call, from the idle callback
+ * wait primitives run or from the main loop, runs in one short burst: the
+ * SIO0 interrupt (acknowledge from the pad, or a received byte for the last
+ * one) steps a byte-level state machine through the exchange, with the
+ * select delay before the first byte and a timeout for a missing
+ * acknowledge bounding every wait. An empty port costs a few hblanks.
+ *
+ * Every poll asks a multitap for all four of its slots, which plain pads
+ * ignore, so up to CONTROLLER_MAX_PADS pads are read in one exchange per
+ * port. Pad index is port * CONTROLLER_SLOTS_PER_PORT + slot, slot 0 being the
+ * pad itself when no multitap is present. Results are double buffered and
+ * published once a round has covered both ports.
+ *
+ * Button bits are as they appear in the poll response, inverted so that
+ * pressed buttons read as set.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CONTROLLER_NUM_PORTS      2
+#define CONTROLLER_SLOTS_PER_PORT 4
+#define CONTROLLER_MAX_PADS       (CONTROLLER_NUM_PORTS * CONTROLLER_SLOTS_PER_PORT)
+
+#define PAD_SELECT   (1 << 0)
+#define PAD_L3       (1 << 1)
+#define PAD_R3       (1 << 2)
+#define PAD_START    (1 << 3)
+#define PAD_UP       (1 << 4)
+#define PAD_RIGHT    (1 << 5)
+#define PAD_DOWN     (1 << 6)
+#define PAD_LEFT     (1 << 7)
+#define PAD_L2       (1 << 8)
+#define PAD_R2       (1 << 9)
+#define PAD_L1       (1 << 10)
+#define PAD_R1       (1 << 11)
+#define PAD_TRIANGLE (1 << 12)
+#define PAD_CIRCLE   (1 << 13)
+#define PAD_X        (1 << 14)
+#define PAD_SQUARE   (1 << 15)
+
+/* Controller state structure with analog support */
+typedef struct {
+	uint16_t buttons;    /* Digital buttons (active high after inversion) */
+	uint8_t  leftX;      /* Left stick X (0x00=left, 0x80=center, 0xFF=right) */
+	uint8_t  leftY;      /* Left stick Y (0x00=up, 0x80=center, 0xFF=down) */
+	uint8_t  rightX;     /* Right stick X */
+	uint8_t  rightY;     /* Right stick Y */
+	bool     isAnalog;   /* True if analog controller detected */
+	bool     connected;  /* False if nothing answered in this slot */
+} ControllerState;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Reset SIO0, then hook the vblank, SIO0 and idle callbacks */
+void initControllers(void);
+
+/* Run a round if one was requested since the last. Runs as the idle callback
+ * and should also be called once per frame, so that polling carries on when
+ * the frame never has to wait. */
+void updateControllers(void);
+
+/* State of a pad as of the last completed round. Unconnected slots read as
+ * nothing pressed with centered sticks. */
+const ControllerState *getControllerState(int index);
+
+/* Number of completed rounds, to tell whether the state is new */
+uint32_t getControllerRound(void);
+
+#ifdef __cplusplus
+}
+#endif
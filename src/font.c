@@ -14,6 +14,7 @@
  * PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "font.h"
 #include "gpu.h"
@@ -117,6 +118,56 @@ static const SpriteInfo fontSprites[] = {
 	{ .x = 90, .y = 45, .width = 6, .height = 9 }  // Invalid character
 };
 
+/* Advance the pen over one character, returning the sprite to draw at the
+ * position before the advance or NULL for whitespace */
+static const SpriteInfo *layoutChar(char ch, int x, int *currentX, int *currentY) {
+	// Check if the character is "special" and shall be handled without
+	// drawing any sprite, or if it's invalid and should be rendered as a box
+	// with a question mark (character code 127).
+	switch (ch) {
+		case '\t':
+			*currentX += FONT_TAB_WIDTH - 1;
+			*currentX -= *currentX % FONT_TAB_WIDTH;
+			return 0;
+
+		case '\n':
+			*currentX  = x;
+			*currentY += FONT_LINE_HEIGHT;
+			return 0;
+
+		case ' ':
+			*currentX += FONT_SPACE_WIDTH;
+			return 0;
+
+		case '\x80' ... '\xff':
+			ch = '\x7f';
+			break;
+	}
+
+	// If the character was not a tab, newline or space, fetch its respective
+	// entry from the sprite coordinate table.
+	const SpriteInfo *sprite = &fontSprites[ch - FONT_FIRST_TABLE_CHAR];
+
+	*currentX += sprite->width;
+	return sprite;
+}
+
+/* Fill in one glyph's rectangle command, summing the UV coordinates of the
+ * spritesheet in VRAM to those of the sprite itself within the sheet. Blending
+ * makes sure any semitransparent pixels in the font get rendered correctly. */
+static inline void writeGlyph(
+	uint32_t          *ptr,
+	const TextureInfo *font,
+	const SpriteInfo  *sprite,
+	int               x,
+	int               y
+) {
+	ptr[0] = gp0_rectangle(true, true, true);
+	ptr[1] = gp0_xy(x, y);
+	ptr[2] = gp0_uv(font->u + sprite->x, font->v + sprite->y, font->clut);
+	ptr[3] = gp0_xy(sprite->width, sprite->height);
+}
+
 void printString(
 	DMAChain          *chain,
 	const TextureInfo *font,
@@ -131,52 +182,104 @@ void printString(
 	// Start by sending a texpage command to tell the GPU to use the font's
 	// spritesheet. Note that the texpage command before a drawing command can
 	// be omitted when reusing the same texture, so sending it here just once is
-	// enough. zIndex 0 = draw in front of everything.
-	ptr    = allocatePacket(chain, 0, 1);
+	// enough. The HUD layer is drawn in front of everything.
+	ptr    = allocatePacket(chain, OT_LAYER_HUD, 0, 1);
 	ptr[0] = gp0_texpage(font->page, false, false);
 
 	// Iterate over every character in the string.
 	for (; *str; str++) {
-		char ch = *str;
-
-		// Check if the character is "special" and shall be handled without
-		// drawing any sprite, or if it's invalid and should be rendered as a
-		// box with a question mark (character code 127).
-		switch (ch) {
-			case '\t':
-				currentX += FONT_TAB_WIDTH - 1;
-				currentX -= currentX % FONT_TAB_WIDTH;
-				continue;
-
-			case '\n':
-				currentX  = x;
-				currentY += FONT_LINE_HEIGHT;
-				continue;
-
-			case ' ':
-				currentX += FONT_SPACE_WIDTH;
-				continue;
-
-			case '\x80' ... '\xff':
-				ch = '\x7f';
-				break;
+		int glyphX = currentX, glyphY = currentY;
+
+		const SpriteInfo *sprite = layoutChar(*str, x, &currentX, &currentY);
+		if (!sprite)
+			continue;
+
+		ptr = allocatePacket(chain, OT_LAYER_HUD, 0, 4);
+		writeGlyph(ptr, font, sprite, glyphX, glyphY);
+	}
+}
+
+void initTextLine(TextLine *line, int x, int y) {
+	initRetainedBlock(&line->block, line->data, TEXT_LINE_BUFFER_SIZE);
+
+	line->text[0] = 0;
+	line->x       = x;
+	line->y       = y;
+}
+
+/* Lay out the string and pack the texpage and its glyphs, several per packet,
+ * into the line's block */
+static void buildTextLine(TextLine *line, const TextureInfo *font) {
+	int16_t          glyphX[TEXT_LINE_MAX_LENGTH];
+	int16_t          glyphY[TEXT_LINE_MAX_LENGTH];
+	const SpriteInfo *sprites[TEXT_LINE_MAX_LENGTH];
+
+	int currentX = line->x, currentY = line->y;
+	int count    = 0;
+
+	for (const char *str = line->text; *str; str++) {
+		int x = currentX, y = currentY;
+
+		const SpriteInfo *sprite = layoutChar(*str, line->x, &currentX, &currentY);
+		if (!sprite)
+			continue;
+
+		glyphX [count] = x;
+		glyphY [count] = y;
+		sprites[count] = sprite;
+		count++;
+	}
+
+	initRetainedBlock(&line->block, line->data, TEXT_LINE_BUFFER_SIZE);
+
+	// The texpage goes in the first packet, so the block doesn't depend on
+	// whatever texture page the GPU was left with.
+	int glyphsInPacket = TEXT_GLYPHS_PER_PACKET - 1;
+	int i              = 0;
+
+	do {
+		if (glyphsInPacket > (count - i))
+			glyphsInPacket = count - i;
+
+		bool     first  = (i == 0);
+		int      length = glyphsInPacket * 4 + (first ? 1 : 0);
+		uint32_t *ptr   = allocateRetainedPacket(&line->block, length);
+
+		if (first)
+			*(ptr++) = gp0_texpage(font->page, false, false);
+
+		for (int j = glyphsInPacket; j > 0; j--, i++, ptr += 4)
+			writeGlyph(ptr, font, sprites[i], glyphX[i], glyphY[i]);
+
+		glyphsInPacket = TEXT_GLYPHS_PER_PACKET;
+	} while (i < count);
+}
+
+bool printTextLine(
+	DMAChain          *chain,
+	TextLine          *line,
+	const TextureInfo *font,
+	const char        *str
+) {
+	// Compare against the cached string and update it in a single pass
+	bool changed = false;
+	int  i       = 0;
+
+	for (; (i < TEXT_LINE_MAX_LENGTH) && str[i]; i++) {
+		if (line->text[i] != str[i]) {
+			line->text[i] = str[i];
+			changed       = true;
 		}
+	}
 
-		// If the character was not a tab, newline or space, fetch its
-		// respective entry from the sprite coordinate table.
-		const SpriteInfo *sprite = &fontSprites[ch - FONT_FIRST_TABLE_CHAR];
-
-		// Draw the character, summing the UV coordinates of the spritesheet in
-		// VRAM to those of the sprite itself within the sheet. Enable blending
-		// to make sure any semitransparent pixels in the font get rendered
-		// correctly. zIndex 0 = draw in front of everything.
-		ptr    = allocatePacket(chain, 0, 4);
-		ptr[0] = gp0_rectangle(true, true, true);
-		ptr[1] = gp0_xy(currentX, currentY);
-		ptr[2] = gp0_uv(font->u + sprite->x, font->v + sprite->y, font->clut);
-		ptr[3] = gp0_xy(sprite->width, sprite->height);
-
-		// Move onto the next character.
-		currentX += sprite->width;
+	if (line->text[i]) {
+		line->text[i] = 0;
+		changed       = true;
 	}
+
+	if (changed)
+		buildTextLine(line, font);
+
+	linkRetainedBlock(chain, &line->block, OT_LAYER_HUD, 0);
+	return changed;
 }
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "gpu.h"
 
@@ -24,10 +25,35 @@
 #define FONT_TAB_WIDTH        32
 #define FONT_LINE_HEIGHT      10
 
+/* Longest string a TextLine can cache, longer strings are cut short */
+#define TEXT_LINE_MAX_LENGTH 40
+
+/* Glyphs packed into each packet of a TextLine, keeping packets within
+ * CHAIN_MAX_PACKET_LENGTH */
+#define TEXT_GLYPHS_PER_PACKET (CHAIN_MAX_PACKET_LENGTH / 4)
+
+/* Texpage, four words per glyph and one tag per packet */
+#define TEXT_LINE_BUFFER_SIZE ( \
+	1 + TEXT_LINE_MAX_LENGTH * 4 + \
+	(TEXT_LINE_MAX_LENGTH / TEXT_GLYPHS_PER_PACKET) + 1 )
+
 typedef struct {
 	uint8_t x, y, width, height;
 } SpriteInfo;
 
+/*
+ * A string laid out once into a retained block of glyph packets. The block
+ * is only rebuilt when the string passed to printTextLine() differs from the
+ * cached one, otherwise it is just relinked. As with any retained block,
+ * double buffered code needs one TextLine per DMAChain.
+ */
+typedef struct {
+	RetainedBlock block;
+	uint32_t      data[TEXT_LINE_BUFFER_SIZE];
+	char          text[TEXT_LINE_MAX_LENGTH + 1];
+	int16_t       x, y;
+} TextLine;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +66,17 @@ void printString(
 	const char        *str
 );
 
+void initTextLine(TextLine *line, int x, int y);
+
+/* Link a line's glyphs into the HUD layer, rebuilding them first if the
+ * string changed. Returns true if the line was rebuilt. */
+bool printTextLine(
+	DMAChain          *chain,
+	TextLine          *line,
+	const TextureInfo *font,
+	const char        *str
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,29 @@
+/*
+ * Lightweight text formatting for PS1 bare-metal
+ *
+ * Append helpers for building HUD strings without going through printf().
+ * Each one writes at the given position, null terminates the result and
+ * returns a pointer to the terminator so calls can be chained.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Copy a string */
+char *appendString(char *out, const char *str);
+
+/* Signed decimal, right-aligned with spaces to at least width characters
+ * like printf()'s "%*d" */
+char *appendInt(char *out, int value, int width);
+
+/* Unsigned hexadecimal with the given number of digits, zero padded */
+char *appendHex(char *out, uint32_t value, int digits);
+
+#ifdef __cplusplus
+}
+#endif
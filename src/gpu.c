@@ -6,183 +6,291 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include "gpu.h"
+#include "irq.h"
+#include "profiler.h"
+#include "vram.h"
 #include "ps1/gpucmd.h"
-#include "ps1/registers.h"
-
-void setupGPU(GP1VideoMode mode, int width, int height) {
-	int x = 0x760;
-	int y = (mode == GP1_MODE_PAL) ? 0xa3 : 0x88;
-
-	GP1HorizontalRes horizontalRes = GP1_HRES_320;
-	GP1VerticalRes   verticalRes   = GP1_VRES_256;
-
-	int offsetX = (width  * gp1_clockMultiplierH(horizontalRes)) / 2;
-	int offsetY = (height / gp1_clockDividerV(verticalRes))      / 2;
-
-	GPU_GP1 = gp1_resetGPU();
-	GPU_GP1 = gp1_fbRangeH(x - offsetX, x + offsetX);
-	GPU_GP1 = gp1_fbRangeV(y - offsetY, y + offsetY);
-	GPU_GP1 = gp1_fbMode(
-		horizontalRes,
-		verticalRes,
-		mode,
-		false,
-		GP1_COLOR_16BPP
-	);
+
+/* Vblank count at the last waitForVSync() return */
+static uint32_t lastVSync = 0;
+
+void waitForVSync(void) {
+	// Like polling the latched IRQ_STAT bit, return immediately if a vblank
+	// already happened since the previous call.
+	waitForFrame(lastVSync + 1);
+	lastVSync = getVSyncCount();
 }
 
-void waitForGP0Ready(void) {
-	while (!(GPU_GP1 & GP1_STAT_CMD_READY))
-		__asm__ volatile("");
+/* Layers up to this many entries are cleared by the CPU, as setting up an OTC
+ * transfer and waiting for it costs more than writing a few words */
+#define OT_CPU_CLEAR_THRESHOLD 16
+
+#define OT_BACKGROUND_OFFSET 0
+#define OT_FAR_OFFSET        (OT_BACKGROUND_OFFSET + OT_BACKGROUND_SIZE + 1)
+#define OT_WORLD_OFFSET      (OT_FAR_OFFSET        + OT_FAR_SIZE        + 1)
+#define OT_HUD_OFFSET        (OT_WORLD_OFFSET      + OT_WORLD_SIZE      + 1)
+
+/* The GTE's ZSF3/ZSF4 are set up so that OTZ is the average screen Z. The
+ * background and HUD have a single slot, the far layer holds background
+ * shapes and the world layer sorts the main model, both at 2 units per
+ * slot. */
+const OTLayerConfig otLayers[NUM_OT_LAYERS] = {
+	{
+		.offset  = OT_BACKGROUND_OFFSET,
+		.size    = OT_BACKGROUND_SIZE,
+		.zNear   = 0,
+		.zShift  = 0,
+		.reserve = 0
+	}, {
+		.offset  = OT_FAR_OFFSET,
+		.size    = OT_FAR_SIZE,
+		.zNear   = 256,
+		.zShift  = 1,
+		.reserve = 4
+	}, {
+		.offset  = OT_WORLD_OFFSET,
+		.size    = OT_WORLD_SIZE,
+		.zNear   = OT_WORLD_Z_NEAR,
+		.zShift  = OT_WORLD_Z_SHIFT,
+		.reserve = 1
+	}, {
+		.offset  = OT_HUD_OFFSET,
+		.size    = OT_HUD_SIZE,
+		.zNear   = 0,
+		.zShift  = 0,
+		.reserve = 0
+	}
+};
+
+/* Dropped packets are written here instead of into the arena */
+static uint32_t discardPacket[CHAIN_MAX_PACKET_LENGTH + 1];
+
+_Static_assert(
+	(OT_HUD_OFFSET + OT_HUD_SIZE + 1) == ORDERING_TABLE_SIZE,
+	"Ordering table layers don't add up to ORDERING_TABLE_SIZE"
+);
+
+static void clearLayer(DMAChain *chain, OTLayer layer) {
+	const OTLayerConfig *config = &otLayers[layer];
+
+	uint32_t *table      = &(chain->orderingTable)[config->offset];
+	int      numEntries  = config->size + 1;
+	chain->usedLayers   |= 1 << layer;
+
+	if (numEntries > OT_CPU_CLEAR_THRESHOLD) {
+		clearOrderingTable(table, numEntries);
+		return;
+	}
+
+	// Same layout the OTC channel produces: each entry links to the one below
+	// it and the bottom entry terminates the list.
+	table[0] = gp0_endTag(0);
+
+	for (int i = 1; i < numEntries; i++)
+		table[i] = gp0_tag(0, &table[i - 1]);
 }
 
-void waitForDMADone(void) {
-	while (DMA_CHCR(DMA_GPU) & DMA_CHCR_ENABLE)
-		__asm__ volatile("");
+/* Get the ordering table entry for a slot, clearing the layer if needed */
+static inline uint32_t *getLayerEntry(DMAChain *chain, OTLayer layer, int zIndex) {
+	const OTLayerConfig *config = &otLayers[layer];
+
+	assert((zIndex >= 0) && (zIndex < config->size));
+
+	if (!(chain->usedLayers & (1 << layer)))
+		clearLayer(chain, layer);
+
+	return &(chain->orderingTable)[config->offset + 1 + zIndex];
 }
 
-void waitForVSync(void) {
-	while (!(IRQ_STAT & (1 << IRQ_VSYNC)))
-		__asm__ volatile("");
+/* Chain every used layer's link entry to the top of the next used layer and
+ * return the first entry to send */
+static uint32_t *linkLayers(DMAChain *chain) {
+	uint32_t *first = 0, *link = 0;
+
+	// Something has to be sent even if nothing was drawn.
+	if (!chain->usedLayers)
+		clearLayer(chain, OT_LAYER_BACKGROUND);
+
+	for (int i = 0; i < NUM_OT_LAYERS; i++) {
+		if (!(chain->usedLayers & (1 << i)))
+			continue;
 
-	IRQ_STAT = ~(1 << IRQ_VSYNC);
+		const OTLayerConfig *config = &otLayers[i];
+		uint32_t            *table  = &(chain->orderingTable)[config->offset];
+		uint32_t            *top    = &table[config->size];
+
+		if (link)
+			*link = gp0_tag(0, top);
+		else
+			first = top;
+
+		link = table;
+	}
+
+	*link = gp0_endTag(0);
+	return first;
 }
 
-void sendLinkedList(const void *data) {
-	waitForDMADone();
-	assert(!((uint32_t) data % 4));
+void initChain(DMAChain *chain, uint32_t *buffer, int length) {
+	chain->data = buffer;
+	chain->end  = &buffer[length];
 
-	DMA_MADR(DMA_GPU) = (uint32_t) data;
-	DMA_CHCR(DMA_GPU) = 0
-		| DMA_CHCR_WRITE
-		| DMA_CHCR_MODE_LIST
-		| DMA_CHCR_ENABLE;
+	// Each layer may only fill the arena up to its limit, leaving the rest for
+	// the layers with a smaller reserve.
+	for (int i = 0; i < NUM_OT_LAYERS; i++)
+		chain->layerLimit[i] = &buffer[length - (length * otLayers[i].reserve) / 16];
+
+	beginChain(chain);
+}
+
+void beginChain(DMAChain *chain) {
+	chain->nextPacket     = chain->data;
+	chain->packetsDropped = 0;
+	chain->usedLayers     = 0;
 }
 
-void sendVRAMData(
-	const void *data,
-	int        x,
-	int        y,
-	int        width,
-	int        height
+uint32_t *allocatePacket(
+	DMAChain *chain,
+	OTLayer  layer,
+	int      zIndex,
+	int      numCommands
 ) {
-	waitForDMADone();
-	assert(!((uint32_t) data % 4));
+	// Checked in release builds too: a longer packet overflows discardPacket
+	// once the layer is full, and there's nowhere safe to hand it instead
+	if (numCommands > CHAIN_MAX_PACKET_LENGTH) {
+		printf("GPU: %d word packet over CHAIN_MAX_PACKET_LENGTH\n", numCommands);
 
-	size_t length = (width * height) / 2;
-	size_t chunkSize, numChunks;
+		for (;;)
+			__asm__ volatile("");
+	}
 
-	if (length < DMA_MAX_CHUNK_SIZE) {
-		chunkSize = length;
-		numChunks = 1;
-	} else {
-		chunkSize = DMA_MAX_CHUNK_SIZE;
-		numChunks = length / DMA_MAX_CHUNK_SIZE;
+	uint32_t *ptr  = chain->nextPacket;
+	uint32_t *next = &ptr[numCommands + 1];
 
-		assert(!(length % DMA_MAX_CHUNK_SIZE));
+	if (next > chain->layerLimit[layer]) {
+		chain->packetsDropped++;
+		return &discardPacket[1];
 	}
 
-	waitForGP0Ready();
-	GPU_GP0 = gp0_vramWrite();
-	GPU_GP0 = gp0_xy(x, y);
-	GPU_GP0 = gp0_xy(width, height);
-
-	DMA_MADR(DMA_GPU) = (uint32_t) data;
-	DMA_BCR (DMA_GPU) = chunkSize | (numChunks << 16);
-	DMA_CHCR(DMA_GPU) = 0
-		| DMA_CHCR_WRITE
-		| DMA_CHCR_MODE_SLICE
-		| DMA_CHCR_ENABLE;
+	chain->nextPacket = next;
+
+	uint32_t *entry = getLayerEntry(chain, layer, zIndex);
+
+	*ptr   = gp0_tag(numCommands, (void *) *entry);
+	*entry = gp0_tag(0, ptr);
+
+	return &ptr[1];
 }
 
-void clearOrderingTable(uint32_t *table, int numEntries) {
-	DMA_MADR(DMA_OTC) = (uint32_t) &table[numEntries - 1];
-	DMA_BCR (DMA_OTC) = numEntries;
-	DMA_CHCR(DMA_OTC) = 0
-		| DMA_CHCR_READ
-		| DMA_CHCR_REVERSE
-		| DMA_CHCR_MODE_BURST
-		| DMA_CHCR_ENABLE
-		| DMA_CHCR_TRIGGER;
-
-	while (DMA_CHCR(DMA_OTC) & DMA_CHCR_ENABLE)
-		__asm__ volatile("");
+void initRetainedBlock(RetainedBlock *block, uint32_t *buffer, int length) {
+	block->data       = buffer;
+	block->end        = &buffer[length];
+	block->nextPacket = buffer;
+	block->head       = 0;
+	block->tail       = 0;
+	block->tailLength = 0;
 }
 
-uint32_t *allocatePacket(DMAChain *chain, int zIndex, int numCommands) {
-	uint32_t *ptr      = chain->nextPacket;
-	chain->nextPacket += numCommands + 1;
+uint32_t *allocateRetainedPacket(RetainedBlock *block, int numCommands) {
+	uint32_t *ptr      = block->nextPacket;
+	block->nextPacket += numCommands + 1;
 
-	assert((zIndex >= 0) && (zIndex < ORDERING_TABLE_SIZE));
+	assert(block->nextPacket <= block->end);
 
-	*ptr = gp0_tag(numCommands, (void *) chain->orderingTable[zIndex]);
-	chain->orderingTable[zIndex] = gp0_tag(0, ptr);
+	// Packets in a block are drawn in allocation order, so each new packet is
+	// appended after the current tail rather than prepended to a slot.
+	if (block->tail)
+		*(block->tail) = gp0_tag(block->tailLength, ptr);
+	else
+		block->head = ptr;
 
-	assert(chain->nextPacket < &(chain->data)[CHAIN_BUFFER_SIZE]);
+	block->tail       = ptr;
+	block->tailLength = numCommands;
+	*ptr              = gp0_tag(numCommands, 0);
 
 	return &ptr[1];
 }
 
-void uploadTexture(
-	TextureInfo *info,
-	const void  *data,
-	int         x,
-	int         y,
-	int         width,
-	int         height
+void linkRetainedBlock(
+	DMAChain      *chain,
+	RetainedBlock *block,
+	OTLayer       layer,
+	int           zIndex
 ) {
-	assert((width <= 256) && (height <= 256));
+	if (!block->head)
+		return;
 
-	sendVRAMData(data, x, y, width, height);
-	waitForDMADone();
+	uint32_t *entry = getLayerEntry(chain, layer, zIndex);
 
-	info->page   = gp0_page(
-		x /  64,
-		y / 256,
-		GP0_BLEND_SEMITRANS,
-		GP0_COLOR_16BPP
-	);
-	info->clut   = 0;
-	info->u      = (uint8_t)  (x %  64);
-	info->v      = (uint8_t)  (y % 256);
-	info->width  = (uint16_t) width;
-	info->height = (uint16_t) height;
+	*(block->tail) = gp0_tag(block->tailLength, (void *) *entry);
+	*entry         = gp0_tag(0, block->head);
 }
 
-void uploadIndexedTexture(
-	TextureInfo   *info,
-	const void    *image,
-	const void    *palette,
-	int           imageX,
-	int           imageY,
-	int           paletteX,
-	int           paletteY,
-	int           width,
-	int           height,
-	GP0ColorDepth colorDepth
+void initPresenter(FramePresenter *presenter) {
+	presenter->pending           = false;
+	presenter->pendingX          = 0;
+	presenter->pendingY          = 0;
+	presenter->frameCount        = 0;
+	presenter->timings.dmaWait   = 0;
+	presenter->timings.drawWait  = 0;
+	presenter->timings.vsyncWait = 0;
+
+	presenter->chainStats.capacity       = 0;
+	presenter->chainStats.wordsUsed      = 0;
+	presenter->chainStats.highWater      = 0;
+	presenter->chainStats.packetsDropped = 0;
+}
+
+void presentFrame(
+	FramePresenter *presenter,
+	DMAChain       *chain,
+	int            bufferX,
+	int            bufferY
 ) {
-	assert((width <= 256) && (height <= 256));
+	uint16_t start = getHblankCounter();
+
+	// Wait for the previously submitted list to be fully fetched by the DMA
+	// controller, then for the GPU to finish drawing its last primitives. Once
+	// both are done the previous chain can be reused and its framebuffer shown.
+	PROFILE_BEGIN(PROFILE_GPU_WAIT);
+	waitForDMADone();
+	uint16_t dmaDone = getHblankCounter();
 
-	int numColors    = (colorDepth == GP0_COLOR_8BPP) ? 256 : 16;
-	int widthDivider = (colorDepth == GP0_COLOR_8BPP) ?   2 :  4;
+	waitForGP0Ready();
+	uint16_t drawDone = getHblankCounter();
+	PROFILE_END(PROFILE_GPU_WAIT);
 
-	assert(!(paletteX % 16) && ((paletteX + numColors) <= 1024));
+	PROFILE_BEGIN(PROFILE_VSYNC_WAIT);
+	waitForVSync();
+	uint16_t vsyncDone = getHblankCounter();
+	PROFILE_END(PROFILE_VSYNC_WAIT);
 
-	sendVRAMData(image, imageX, imageY, width / widthDivider, height);
-	waitForDMADone();
-	sendVRAMData(palette, paletteX, paletteY, numColors, 1);
-	waitForDMADone();
+	if (presenter->pending)
+		showFramebuffer(presenter->pendingX, presenter->pendingY);
+
+	// The GPU is idle and the new frame is on screen, so this is the one
+	// point where queued texture uploads can't corrupt anything being drawn
+	serviceVRAMUploads();
+	sendLinkedList(linkLayers(chain));
+
+	ChainStats *stats = &presenter->chainStats;
+	int        used   = chain->nextPacket - chain->data;
+
+	stats->capacity       = chain->end - chain->data;
+	stats->wordsUsed      = used;
+	stats->packetsDropped = chain->packetsDropped;
+
+	if (used > stats->highWater)
+		stats->highWater = used;
+
+	presenter->pending    = true;
+	presenter->pendingX   = bufferX;
+	presenter->pendingY   = bufferY;
+	presenter->frameCount++;
 
-	info->page   = gp0_page(
-		imageX /  64,
-		imageY / 256,
-		GP0_BLEND_SEMITRANS,
-		colorDepth
-	);
-	info->clut   = gp0_clut(paletteX / 16, paletteY);
-	info->u      = (uint8_t)  ((imageX %  64) * widthDivider);
-	info->v      = (uint8_t)   (imageY % 256);
-	info->width  = (uint16_t) width;
-	info->height = (uint16_t) height;
+	presenter->timings.dmaWait   = dmaDone   - start;
+	presenter->timings.drawWait  = drawDone  - dmaDone;
+	presenter->timings.vsyncWait = vsyncDone - drawDone;
 }
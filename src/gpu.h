@@ -5,19 +5,119 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "ps1/gpucmd.h"
 
 #define DMA_MAX_CHUNK_SIZE    16
 #define CHAIN_BUFFER_SIZE   8192
-#define ORDERING_TABLE_SIZE 1024
+
+/* Longest packet allocatePacket() accepts, excluding the tag. Asking for more
+ * halts with a message, NDEBUG builds included. */
+#define CHAIN_MAX_PACKET_LENGTH 16
+
+/*
+ * Ordering table layers, in drawing order. Each layer is its own small
+ * ordering table with a depth range and sort resolution suited to what goes
+ * in it, and the layers are chained together when the frame is submitted.
+ * Within a layer higher slots are drawn first, as with a flat table.
+ */
+typedef enum {
+	OT_LAYER_BACKGROUND = 0,
+	OT_LAYER_FAR        = 1,
+	OT_LAYER_WORLD      = 2,
+	OT_LAYER_HUD        = 3
+} OTLayer;
+
+#define NUM_OT_LAYERS 4
+
+/* Sort slots per layer */
+#define OT_BACKGROUND_SIZE   1
+#define OT_FAR_SIZE        256
+#define OT_WORLD_SIZE      336
+#define OT_HUD_SIZE          1
+
+/* The world layer starts right at the camera, so the lander's near faces still
+ * sort at its closest zoom, and ends just past its furthest faces at the far
+ * end of the zoom range (440 plus 224 units of bounding sphere and offset).
+ * Two OTZ units per slot is still twice as fine as the old flat table. */
+#define OT_WORLD_Z_NEAR  0
+#define OT_WORLD_Z_SHIFT 1
+#define OT_WORLD_Z_FAR   (OT_WORLD_Z_NEAR + (OT_WORLD_SIZE << OT_WORLD_Z_SHIFT))
+
+/* Every layer has one extra entry below its slots to link to the next one */
+#define ORDERING_TABLE_SIZE ( \
+	OT_BACKGROUND_SIZE + OT_FAR_SIZE + OT_WORLD_SIZE + OT_HUD_SIZE + \
+	NUM_OT_LAYERS )
 
 typedef struct {
-	uint32_t data[CHAIN_BUFFER_SIZE];
-	uint32_t orderingTable[ORDERING_TABLE_SIZE];
+	uint16_t offset;  /* Index of the layer's link entry in orderingTable */
+	uint16_t size;    /* Number of sort slots */
+	uint16_t zNear;   /* OTZ value that maps to slot 0 */
+	uint8_t  zShift;  /* Each slot covers (1 << zShift) OTZ units */
+	uint8_t  reserve; /* Sixteenths of the packet arena this layer can't use */
+} OTLayerConfig;
+
+/*
+ * Packet arena and layered ordering table for one frame. When the arena runs
+ * low, packets for low priority layers are dropped first (they are written to
+ * a scratch buffer that never gets linked) so that the rest of the frame, and
+ * the HUD in particular, still fits.
+ */
+typedef struct {
+	uint32_t *data, *end;
 	uint32_t *nextPacket;
+	uint32_t *layerLimit[NUM_OT_LAYERS];
+	uint32_t orderingTable[ORDERING_TABLE_SIZE];
+	uint16_t packetsDropped;
+	uint8_t  usedLayers; /* Bitmask of layers cleared and used this frame */
 } DMAChain;
 
+/* Packet arena usage of the last submitted frame, in words */
+typedef struct {
+	uint16_t capacity;
+	uint16_t wordsUsed;
+	uint16_t highWater;      /* Most words used by any frame so far */
+	uint16_t packetsDropped;
+} ChainStats;
+
+/*
+ * A block of packets built once and linked into an ordering table slot every
+ * frame by rewriting the last packet's tag, so only fields that change need
+ * to be patched in place. A block must not be relinked or patched while a
+ * chain it was linked into is still being drawn, so double buffered code
+ * needs one block per DMAChain.
+ */
+typedef struct {
+	uint32_t *data, *end;
+	uint32_t *nextPacket;
+	uint32_t *head, *tail;
+	int      tailLength;
+} RetainedBlock;
+
+/*
+ * Time spent blocked in each stage of presentFrame(), in hblank units. Needs
+ * initIRQ() to have started the hblank timer.
+ */
+typedef struct {
+	uint16_t dmaWait;   /* Previous list still being fetched by DMA */
+	uint16_t drawWait;  /* GPU still rasterizing the previous list */
+	uint16_t vsyncWait; /* Waiting for vblank to flip the display */
+} FrameTimings;
+
+/*
+ * Pipelined frame presenter. presentFrame() only blocks on the list that was
+ * submitted one call earlier, so the CPU can build frame N+1 in the other
+ * DMAChain while the GPU is still drawing frame N.
+ */
+typedef struct {
+	bool         pending;
+	int          pendingX, pendingY;
+	uint32_t     frameCount;
+	FrameTimings timings;
+	ChainStats   chainStats;
+} FramePresenter;
+
 typedef struct {
 	uint8_t  u, v;
 	uint16_t width, height;
@@ -28,10 +128,34 @@ typedef struct {
 extern "C" {
 #endif
 
+extern const OTLayerConfig otLayers[NUM_OT_LAYERS];
+
+/*
+ * Map a GTE OTZ value to a slot in the given layer. Depths nearer than the
+ * layer's range go in the front slot, depths past it return -1 so the caller
+ * can cull the primitive.
+ */
+static inline int getLayerSlot(OTLayer layer, int otz) {
+	const OTLayerConfig *config = &otLayers[layer];
+
+	int slot = (otz - config->zNear) >> config->zShift;
+
+	if (slot < 0)
+		return 0;
+	if (slot >= config->size)
+		return -1;
+
+	return slot;
+}
+
+/*
+ * Hardware layer, the only functions here that access the GPU and DMA
+ * registers. They live in gpuio.c so the host build can swap in a version
+ * that captures packets instead (see host/gpuio.c).
+ */
 void setupGPU(GP1VideoMode mode, int width, int height);
 void waitForGP0Ready(void);
 void waitForDMADone(void);
-void waitForVSync(void);
 
 void sendLinkedList(const void *data);
 void sendVRAMData(
@@ -42,27 +166,40 @@ void sendVRAMData(
 	int        height
 );
 void clearOrderingTable(uint32_t *table, int numEntries);
-uint32_t *allocatePacket(DMAChain *chain, int zIndex, int numCommands);
-
-void uploadTexture(
-	TextureInfo *info,
-	const void  *data,
-	int         x,
-	int         y,
-	int         width,
-	int         height
+
+/* Display the framebuffer at the given VRAM position */
+void showFramebuffer(int x, int y);
+
+void waitForVSync(void);
+
+/* Set up a chain to allocate packets from the given buffer */
+void initChain(DMAChain *chain, uint32_t *buffer, int length);
+
+/* Start building a new frame in the chain. Layers are cleared lazily the
+ * first time something is added to them, so unused layers cost nothing */
+void beginChain(DMAChain *chain);
+uint32_t *allocatePacket(
+	DMAChain *chain,
+	OTLayer  layer,
+	int      zIndex,
+	int      numCommands
 );
-void uploadIndexedTexture(
-	TextureInfo   *info,
-	const void    *image,
-	const void    *palette,
-	int           imageX,
-	int           imageY,
-	int           paletteX,
-	int           paletteY,
-	int           width,
-	int           height,
-	GP0ColorDepth colorDepth
+
+void initRetainedBlock(RetainedBlock *block, uint32_t *buffer, int length);
+uint32_t *allocateRetainedPacket(RetainedBlock *block, int numCommands);
+void linkRetainedBlock(
+	DMAChain      *chain,
+	RetainedBlock *block,
+	OTLayer       layer,
+	int           zIndex
+);
+
+void initPresenter(FramePresenter *presenter);
+void presentFrame(
+	FramePresenter *presenter,
+	DMAChain       *chain,
+	int            bufferX,
+	int            bufferY
 );
 
 #ifdef __cplusplus
@@ -0,0 +1,109 @@
+/*
+ * GPU hardware layer for PS1 bare-metal
+ *
+ * Everything in gpu.h that touches the GPU and DMA registers directly. The
+ * host build (see host/) links its own version of this file instead, which
+ * records the lists and uploads sent to it rather than drawing them.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "gpu.h"
+#include "irq.h"
+#include "ps1/gpucmd.h"
+#include "ps1/registers.h"
+
+void setupGPU(GP1VideoMode mode, int width, int height) {
+	int x = 0x760;
+	int y = (mode == GP1_MODE_PAL) ? 0xa3 : 0x88;
+
+	GP1HorizontalRes horizontalRes = GP1_HRES_320;
+	GP1VerticalRes   verticalRes   = GP1_VRES_256;
+
+	int offsetX = (width  * gp1_clockMultiplierH(horizontalRes)) / 2;
+	int offsetY = (height / gp1_clockDividerV(verticalRes))      / 2;
+
+	GPU_GP1 = gp1_resetGPU();
+	GPU_GP1 = gp1_fbRangeH(x - offsetX, x + offsetX);
+	GPU_GP1 = gp1_fbRangeV(y - offsetY, y + offsetY);
+	GPU_GP1 = gp1_fbMode(
+		horizontalRes,
+		verticalRes,
+		mode,
+		false,
+		GP1_COLOR_16BPP
+	);
+}
+
+void waitForGP0Ready(void) {
+	while (!(GPU_GP1 & GP1_STAT_CMD_READY))
+		__asm__ volatile("");
+}
+
+void waitForDMADone(void) {
+	waitForDMA(DMA_GPU);
+}
+
+void sendLinkedList(const void *data) {
+	waitForDMADone();
+	assert(!((uint32_t) data % 4));
+
+	DMA_MADR(DMA_GPU) = (uint32_t) data;
+	DMA_CHCR(DMA_GPU) = 0
+		| DMA_CHCR_WRITE
+		| DMA_CHCR_MODE_LIST
+		| DMA_CHCR_ENABLE;
+}
+
+void sendVRAMData(
+	const void *data,
+	int        x,
+	int        y,
+	int        width,
+	int        height
+) {
+	waitForDMADone();
+	assert(!((uint32_t) data % 4));
+
+	// Odd sized areas end with a padding halfword the GPU discards. Any
+	// length can be sent by picking the largest chunk size that divides it,
+	// so the queued uploads in vram.c can split images at arbitrary rows.
+	size_t length    = (width * height + 1) / 2;
+	size_t chunkSize = DMA_MAX_CHUNK_SIZE;
+
+	while (length % chunkSize)
+		chunkSize /= 2;
+
+	size_t numChunks = length / chunkSize;
+
+	waitForGP0Ready();
+	GPU_GP0 = gp0_vramWrite();
+	GPU_GP0 = gp0_xy(x, y);
+	GPU_GP0 = gp0_xy(width, height);
+
+	DMA_MADR(DMA_GPU) = (uint32_t) data;
+	DMA_BCR (DMA_GPU) = chunkSize | (numChunks << 16);
+	DMA_CHCR(DMA_GPU) = 0
+		| DMA_CHCR_WRITE
+		| DMA_CHCR_MODE_SLICE
+		| DMA_CHCR_ENABLE;
+}
+
+void clearOrderingTable(uint32_t *table, int numEntries) {
+	DMA_MADR(DMA_OTC) = (uint32_t) &table[numEntries - 1];
+	DMA_BCR (DMA_OTC) = numEntries;
+	DMA_CHCR(DMA_OTC) = 0
+		| DMA_CHCR_READ
+		| DMA_CHCR_REVERSE
+		| DMA_CHCR_MODE_BURST
+		| DMA_CHCR_ENABLE
+		| DMA_CHCR_TRIGGER;
+
+	while (DMA_CHCR(DMA_OTC) & DMA_CHCR_ENABLE)
+		__asm__ volatile("");
+}
+
+void showFramebuffer(int x, int y) {
+	GPU_GP1 = gp1_fbOffset(x, y);
+}
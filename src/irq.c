@@ -0,0 +1,188 @@
+/*
+ * Interrupt event layer for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "irq.h"
+#include "ps1/registers.h"
+
+/* DICR layout: per-channel enables in bits 16-22, flags in bits 24-30 */
+#define DICR_CH_ENABLE_SHIFT 16
+#define DICR_IRQ_ENABLE      (1 << 23)
+#define DICR_FLAG_SHIFT      24
+#define DICR_WRITE_MASK      0x00ff7fff
+
+#define DMA_WATCHED_CHANNELS ( \
+	(1 << DMA_GPU) | (1 << DMA_CDROM) | (1 << DMA_SPU) | (1 << DMA_OTC) )
+
+static volatile uint32_t vsyncCount    = 0;
+static volatile uint32_t dmaDoneFlags  = 0;
+static uint16_t          lastVSyncLine = 0;
+static int               linesPerFrame = IRQ_LINES_PER_FRAME_NTSC;
+static int               vsyncRate     = IRQ_VSYNC_RATE_NTSC;
+
+static IRQCallback idleCallback  = NULL;
+static IRQCallback vsyncCallback = NULL;
+static DMACallback dmaCallbacks[IRQ_NUM_DMA_CHANNELS];
+static IRQCallback irqCallbacks[IRQ_NUM_CHANNELS];
+static uint16_t    irqCallbackMask = 0;
+
+void initIRQ(bool isPAL) {
+	// Timer 1 counts hblanks; it is used both to time waits and to work out
+	// how many vblanks went by if serviceIRQs() was not called for a while.
+	TIMER_CTRL(1) = TIMER_CTRL_EXT_CLOCK;
+
+	// Timer 2 counts at the system clock / 8 for getElapsedTimer2Ticks(). It's
+	// only set up here, as the profiler and benchmark read it at the same time
+	// and reprogramming it would reset the count under one of them.
+	TIMER_CTRL(2) = TIMER_CTRL_PRESCALE;
+
+	linesPerFrame = isPAL ? IRQ_LINES_PER_FRAME_PAL : IRQ_LINES_PER_FRAME_NTSC;
+	vsyncRate     = isPAL ? IRQ_VSYNC_RATE_PAL : IRQ_VSYNC_RATE_NTSC;
+	lastVSyncLine = getHblankCounter();
+	vsyncCount    = 0;
+	dmaDoneFlags  = 0;
+
+	for (int i = 0; i < IRQ_NUM_DMA_CHANNELS; i++)
+		dmaCallbacks[i] = NULL;
+	for (int i = 0; i < IRQ_NUM_CHANNELS; i++)
+		irqCallbacks[i] = NULL;
+
+	irqCallbackMask = 0;
+
+	// Enable completion flags for the channels we care about. The flags latch
+	// in DICR whether or not the CPU takes the interrupt, so polling works
+	// even with the BIOS event handlers disabled.
+	uint32_t dicr = DMA_DICR & DICR_WRITE_MASK;
+	dicr         |= DMA_WATCHED_CHANNELS << DICR_CH_ENABLE_SHIFT;
+	dicr         |= DICR_IRQ_ENABLE;
+	DMA_DICR      = dicr | (0x7f << DICR_FLAG_SHIFT);
+
+	IRQ_STAT = ~((1 << IRQ_VSYNC) | (1 << IRQ_DMA));
+}
+
+void handleDMAFlags(uint32_t channels) {
+	dmaDoneFlags |= channels;
+
+	for (int i = 0; i < IRQ_NUM_DMA_CHANNELS; i++) {
+		if ((channels & (1 << i)) && dmaCallbacks[i])
+			dmaCallbacks[i]((DMAChannel) i);
+	}
+}
+
+void handleVSync(void) {
+	uint16_t line    = getHblankCounter();
+	int      elapsed = (uint16_t) (line - lastVSyncLine);
+	int      frames  = elapsed / linesPerFrame;
+
+	// Count whole frames only and carry the remainder over, so that a late
+	// poll doesn't count an extra vblank. A vblank seen less than a frame
+	// after the last one resyncs the reference to it instead.
+	if (frames < 1) {
+		frames        = 1;
+		lastVSyncLine = line;
+	} else {
+		lastVSyncLine += frames * linesPerFrame;
+	}
+
+	vsyncCount += frames;
+
+	if (vsyncCallback)
+		vsyncCallback();
+}
+
+/* With BIOS events the DMA and VSync event handlers in bios.c own DMA
+ * completion and vblank counting. Polling the flags as well could see one
+ * they're about to acknowledge and run its callback or count the frame a
+ * second time, or interrupt the handler's own update halfway through. */
+#ifdef ENABLE_BIOS_EVENTS
+#define IRQ_POLLED_MASK 0
+#else
+#define IRQ_POLLED_MASK ((1 << IRQ_VSYNC) | (1 << IRQ_DMA))
+#endif
+
+void serviceIRQs(void) {
+#ifndef ENABLE_BIOS_EVENTS
+	uint32_t dicr     = DMA_DICR;
+	uint32_t channels = (dicr >> DICR_FLAG_SHIFT) & DMA_WATCHED_CHANNELS;
+
+	if (channels) {
+		// Writing 1 to a flag bit clears it, so only the flags we are about
+		// to handle get acknowledged.
+		DMA_DICR = (dicr & DICR_WRITE_MASK) | (channels << DICR_FLAG_SHIFT);
+		handleDMAFlags(channels);
+	}
+#endif
+
+	uint16_t stat = IRQ_STAT & (IRQ_POLLED_MASK | irqCallbackMask);
+	if (!stat)
+		return;
+
+	IRQ_STAT = ~stat;
+
+	if (stat & (1 << IRQ_VSYNC))
+		handleVSync();
+
+	for (int i = 0; i < IRQ_NUM_CHANNELS; i++) {
+		if ((stat & irqCallbackMask) & (1 << i))
+			irqCallbacks[i]();
+	}
+}
+
+uint32_t getVSyncCount(void) {
+	return vsyncCount;
+}
+
+int getVSyncRate(void) {
+	return vsyncRate;
+}
+
+static void idle(void) {
+	serviceIRQs();
+
+	if (idleCallback)
+		idleCallback();
+}
+
+void waitForFrame(uint32_t frame) {
+	while ((int32_t) (vsyncCount - frame) < 0)
+		idle();
+}
+
+void waitForDMA(DMAChannel channel) {
+	while (DMA_CHCR(channel) & DMA_CHCR_ENABLE)
+		idle();
+}
+
+void setIdleCallback(IRQCallback callback) {
+	idleCallback = callback;
+}
+
+void setVSyncCallback(IRQCallback callback) {
+	vsyncCallback = callback;
+}
+
+void setDMACallback(DMAChannel channel, DMACallback callback) {
+	dmaCallbacks[channel] = callback;
+}
+
+bool testDMAComplete(DMAChannel channel) {
+	serviceIRQs();
+
+	uint32_t mask = 1 << channel;
+	bool     done = (dmaDoneFlags & mask) != 0;
+
+	dmaDoneFlags &= ~mask;
+	return done;
+}
+
+void setIRQCallback(IRQChannel channel, IRQCallback callback) {
+	irqCallbacks[channel] = callback;
+
+	if (callback)
+		irqCallbackMask |=  (1 << channel);
+	else
+		irqCallbackMask &= ~(1 << channel);
+}
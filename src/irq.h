@@ -0,0 +1,123 @@
+/*
+ * Interrupt event layer for PS1 bare-metal
+ *
+ * Tracks vblanks and DMA completion from the latched IRQ_STAT/DICR flags and
+ * dispatches callbacks. Events are serviced either from the BIOS DMA/VSync
+ * event callbacks (when biosInit() registers them) or by serviceIRQs(), which
+ * every wait primitive calls while it spins so the same code works under the
+ * HLE BIOS in EmulatorJS.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ps1/cop0.h"
+#include "ps1/registers.h"
+
+/* Scanlines per frame, used to catch up on vblanks missed between polls */
+#define IRQ_LINES_PER_FRAME_NTSC 263
+#define IRQ_LINES_PER_FRAME_PAL  314
+
+/* Vblanks per second */
+#define IRQ_VSYNC_RATE_NTSC 60
+#define IRQ_VSYNC_RATE_PAL  50
+
+/* Timer 2 ticks (sysclock / 8) per scanline, 33868800 / 8 / 15734 rounded
+ * so it's close enough on PAL too */
+#define IRQ_TIMER2_TICKS_PER_LINE 270
+
+#define IRQ_NUM_DMA_CHANNELS 7
+#define IRQ_NUM_CHANNELS     11
+
+typedef void (*IRQCallback)(void);
+typedef void (*DMACallback)(DMAChannel channel);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Set up the hblank timer (1) and the sysclock / 8 timer (2), and enable DMA
+ * completion flags for GPU/OTC/SPU */
+void initIRQ(bool isPAL);
+
+/* Acknowledge pending events, update counters and run callbacks. DMA
+ * completion and vblanks are left to the BIOS event handlers with
+ * ENABLE_BIOS_EVENTS. */
+void serviceIRQs(void);
+
+/* Called by the BIOS DMA event handler with the DICR flags it acknowledged */
+void handleDMAFlags(uint32_t channels);
+
+/* Called by the BIOS VSync event handler */
+void handleVSync(void);
+
+/* Number of vblanks since initIRQ() */
+uint32_t getVSyncCount(void);
+
+/* Vblanks per second, 50 or 60 depending on the video mode */
+int getVSyncRate(void);
+
+/* Raw hblank counter (timer 1), wraps every 65536 scanlines */
+static inline uint16_t getHblankCounter(void) {
+	return TIMER_VALUE(1);
+}
+
+/*
+ * Timer 2 ticks since the given timer 2 and hblank counter values were read,
+ * with timer 2 counting at sysclock / 8. The timer only holds the elapsed
+ * time modulo 65536 ticks; the hblank count is coarse but doesn't wrap within
+ * a frame, so it tells how many wraps the low 16 bits are missing.
+ */
+static inline uint32_t getElapsedTimer2Ticks(uint16_t timer, uint16_t line) {
+	uint16_t now   = TIMER_VALUE(2);
+	uint16_t lines = getHblankCounter() - line;
+
+	uint32_t ticks    = (uint16_t) (now - timer);
+	uint32_t estimate = lines * IRQ_TIMER2_TICKS_PER_LINE;
+
+	while ((ticks + 32768) < estimate)
+		ticks += 65536;
+
+	return ticks;
+}
+
+/* Mask interrupts while updating state the BIOS event handlers also touch.
+ * Returns the previous COP0 status to hand to exitCriticalSection(), so
+ * sections can nest and are harmless when called from a handler. */
+static inline uint32_t enterCriticalSection(void) {
+	uint32_t status = cop0_getReg(COP0_STATUS);
+
+	cop0_setReg(COP0_STATUS, status & ~COP0_STATUS_IEc);
+	return status;
+}
+static inline void exitCriticalSection(uint32_t status) {
+	if (status & COP0_STATUS_IEc)
+		cop0_setReg(COP0_STATUS, cop0_getReg(COP0_STATUS) | COP0_STATUS_IEc);
+}
+
+/* Block until getVSyncCount() reaches frame, running the idle callback */
+void waitForFrame(uint32_t frame);
+
+/* Block until a DMA channel is no longer busy, running the idle callback */
+void waitForDMA(DMAChannel channel);
+
+/* Work to run while a wait primitive is blocked (audio, input, ...) */
+void setIdleCallback(IRQCallback callback);
+
+/* Called at every vblank, from the BIOS event handler when registered, so it
+ * should only latch work for the idle callback or the main loop to pick up */
+void setVSyncCallback(IRQCallback callback);
+
+/* Per-channel DMA completion callback, or NULL to only latch the flag */
+void setDMACallback(DMAChannel channel, DMACallback callback);
+
+/* Returns whether a transfer completed on the channel since the last call */
+bool testDMAComplete(DMAChannel channel);
+
+/* Callback for a raw IRQ_STAT source (CD-ROM, SIO0, SPU, ...) */
+void setIRQCallback(IRQChannel channel, IRQCallback callback);
+
+#ifdef __cplusplus
+}
+#endif
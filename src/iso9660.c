@@ -0,0 +1,204 @@
+/*
+ * ISO9660 file lookup for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cdread.h"
+#include "iso9660.h"
+
+/* Offsets into the primary volume descriptor */
+#define PVD_TYPE        0
+#define PVD_IDENTIFIER  1
+#define PVD_ROOT_RECORD 156
+
+/* Offsets into a directory record */
+#define RECORD_LENGTH      0
+#define RECORD_LBA         2  /* Little endian copy, big endian follows */
+#define RECORD_SIZE        10
+#define RECORD_FLAGS       25
+#define RECORD_NAME_LENGTH 32
+#define RECORD_NAME        33
+
+#define RECORD_FLAG_DIRECTORY 0x02
+
+static uint32_t sectorBuffer[CD_SECTOR_SIZE / 4];
+
+static uint32_t rootLBA = 0, rootSize = 0;
+
+static const char     *searchPath;
+static CDFileCallback searchCallback;
+static void           *searchArg;
+
+static uint32_t dirLBA;
+static int      dirSectorsLeft;
+
+static void enterDirectory(uint32_t lba, uint32_t size);
+
+static uint32_t read32(const uint8_t *data) {
+	return data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
+}
+
+static bool isSeparator(char c) {
+	return (c == '\\') || (c == '/');
+}
+
+static char toUpper(char c) {
+	return ((c >= 'a') && (c <= 'z')) ? (c - 'a' + 'A') : c;
+}
+
+static void finishSearch(const CDFile *file) {
+	searchCallback(file, searchArg);
+}
+
+/* Compare a record's name, up to its version suffix, with the current path
+ * component */
+static bool matchName(const uint8_t *name, int length) {
+	for (int i = 0; i < length; i++) {
+		if (name[i] == ';') {
+			length = i;
+			break;
+		}
+	}
+
+	// Names without an extension may be stored with a trailing dot
+	if (length && (name[length - 1] == '.'))
+		length--;
+
+	const char *component = searchPath;
+
+	for (int i = 0; i < length; i++) {
+		char c = component[i];
+
+		if (!c || isSeparator(c) || (c == ';'))
+			return false;
+		if (toUpper(c) != name[i])
+			return false;
+	}
+
+	char end = component[length];
+	return !end || isSeparator(end) || (end == ';');
+}
+
+/* Step searchPath past the current component, returns false if it was the
+ * last one */
+static bool nextComponent(void) {
+	while (*searchPath && !isSeparator(*searchPath))
+		searchPath++;
+	while (isSeparator(*searchPath))
+		searchPath++;
+
+	return *searchPath != 0;
+}
+
+static void readNextDirectorySector(void);
+
+static void onDirectorySectorRead(bool success, void *arg) {
+	if (!success) {
+		finishSearch(NULL);
+		return;
+	}
+
+	const uint8_t *sector = (const uint8_t *) sectorBuffer;
+
+	for (int offset = 0; offset < (CD_SECTOR_SIZE - RECORD_NAME);) {
+		const uint8_t *record = &sector[offset];
+		int           length  = record[RECORD_LENGTH];
+
+		// Records never cross sectors, the rest of this one is padding
+		if (!length)
+			break;
+
+		int nameLength = record[RECORD_NAME_LENGTH];
+
+		if (
+			((offset + RECORD_NAME + nameLength) <= CD_SECTOR_SIZE) &&
+			matchName(&record[RECORD_NAME], nameLength)
+		) {
+			CDFile file = {
+				.lba  = read32(&record[RECORD_LBA]),
+				.size = read32(&record[RECORD_SIZE])
+			};
+			bool isDirectory = (record[RECORD_FLAGS] & RECORD_FLAG_DIRECTORY) != 0;
+
+			if (!nextComponent())
+				finishSearch(isDirectory ? NULL : &file);
+			else if (isDirectory)
+				enterDirectory(file.lba, file.size);
+			else
+				finishSearch(NULL);
+
+			return;
+		}
+
+		offset += length;
+	}
+
+	readNextDirectorySector();
+}
+
+static void readNextDirectorySector(void) {
+	if (!dirSectorsLeft) {
+		finishSearch(NULL);
+		return;
+	}
+
+	dirSectorsLeft--;
+
+	if (!readCDSectors(dirLBA++, 1, sectorBuffer, onDirectorySectorRead, NULL))
+		finishSearch(NULL);
+}
+
+static void enterDirectory(uint32_t lba, uint32_t size) {
+	dirLBA         = lba;
+	dirSectorsLeft = (size + CD_SECTOR_SIZE - 1) / CD_SECTOR_SIZE;
+
+	readNextDirectorySector();
+}
+
+static void onVolumeDescriptorRead(bool success, void *arg) {
+	static const char identifier[] = "CD001";
+
+	const uint8_t *pvd = (const uint8_t *) sectorBuffer;
+
+	if (!success || (pvd[PVD_TYPE] != 1)) {
+		finishSearch(NULL);
+		return;
+	}
+
+	for (int i = 0; i < 5; i++) {
+		if (pvd[PVD_IDENTIFIER + i] != identifier[i]) {
+			finishSearch(NULL);
+			return;
+		}
+	}
+
+	const uint8_t *root = &pvd[PVD_ROOT_RECORD];
+
+	rootLBA  = read32(&root[RECORD_LBA]);
+	rootSize = read32(&root[RECORD_SIZE]);
+
+	enterDirectory(rootLBA, rootSize);
+}
+
+bool findCDFile(const char *path, CDFileCallback callback, void *arg) {
+	if (!callback || isCDReadBusy())
+		return false;
+
+	searchCallback = callback;
+	searchArg      = arg;
+	searchPath     = path;
+
+	while (isSeparator(*searchPath))
+		searchPath++;
+
+	if (rootLBA) {
+		enterDirectory(rootLBA, rootSize);
+		return true;
+	}
+
+	return readCDSectors(
+		ISO_PVD_LBA, 1, sectorBuffer, onVolumeDescriptorRead, NULL
+	);
+}
@@ -0,0 +1,39 @@
+/*
+ * ISO9660 file lookup for PS1 bare-metal
+ *
+ * Finds a file's first sector and size by walking the directory records of
+ * the data track, one sector at a time through the CD-ROM sector reader. The
+ * root directory's location is read from the primary volume descriptor on
+ * the first lookup and remembered afterwards.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Sector of the primary volume descriptor */
+#define ISO_PVD_LBA 16
+
+typedef struct {
+	uint32_t lba;
+	uint32_t size; /* Bytes */
+} CDFile;
+
+/* Gets the file found, or NULL if it doesn't exist or the disc can't be read */
+typedef void (*CDFileCallback)(const CDFile *file, void *arg);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Look up a path such as "\\MUSIC.XA;1" or "DATA/LEVEL1.BIN". Names are
+ * matched case-insensitively and version suffixes are optional. The callback
+ * runs from the CD-ROM interrupt. Returns false if the reader is busy.
+ */
+bool findCDFile(const char *path, CDFileCallback callback, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
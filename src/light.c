@@ -0,0 +1,71 @@
+/*
+ * GTE lighting for PS1 bare-metal
+ */
+
+#include <stdint.h>
+#include "light.h"
+#include "ps1/gte.h"
+
+/* Rows are light directions, columns of the color matrix are light colors */
+static GTEMatrix viewLights;
+static GTEMatrix lightColors;
+
+void initLighting(void) {
+	for (int i = 0; i < NUM_LIGHTS; i++)
+		setLight(i, 0, 0, 0, 0, 0, 0);
+
+	// Warm key light from the upper left in front of the camera, and a dim
+	// blue fill from the lower right behind the object
+	setLight(0, -1858, -2683, -2477, 3072, 2944, 2688);
+	setLight(1,  2867,  1229,  2662,  512,  640, 1024);
+	setAmbientLight(1024, 960, 1152);
+}
+
+void setLight(int index, int x, int y, int z, int r, int g, int b) {
+	viewLights.values[index][0] = x;
+	viewLights.values[index][1] = y;
+	viewLights.values[index][2] = z;
+
+	lightColors.values[0][index] = r;
+	lightColors.values[1][index] = g;
+	lightColors.values[2][index] = b;
+
+	gte_loadLightColorMatrix(&lightColors);
+}
+
+void setAmbientLight(int r, int g, int b) {
+	gte_setControlReg(GTE_RBK, r);
+	gte_setControlReg(GTE_GBK, g);
+	gte_setControlReg(GTE_BBK, b);
+}
+
+void setLightRotation(const GTEMatrix *rotation) {
+	// A normal n in model space faces the light l at l . (R * n), which is
+	// (l * R) . n, so the model space light matrix is viewLights * R. Let the
+	// GTE multiply it out a column of R at a time.
+	const int16_t (*r)[3] = rotation->values;
+	GTEMatrix     lights;
+
+	gte_loadLightMatrix(&viewLights);
+
+	gte_setV0(r[0][0], r[1][0], r[2][0]);
+	gte_setV1(r[0][1], r[1][1], r[2][1]);
+	gte_setV2(r[0][2], r[1][2], r[2][2]);
+
+	gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_LLM | GTE_V_V0 | GTE_CV_NONE);
+	lights.values[0][0] = gte_getDataReg(GTE_IR1);
+	lights.values[1][0] = gte_getDataReg(GTE_IR2);
+	lights.values[2][0] = gte_getDataReg(GTE_IR3);
+
+	gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_LLM | GTE_V_V1 | GTE_CV_NONE);
+	lights.values[0][1] = gte_getDataReg(GTE_IR1);
+	lights.values[1][1] = gte_getDataReg(GTE_IR2);
+	lights.values[2][1] = gte_getDataReg(GTE_IR3);
+
+	gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_LLM | GTE_V_V2 | GTE_CV_NONE);
+	lights.values[0][2] = gte_getDataReg(GTE_IR1);
+	lights.values[1][2] = gte_getDataReg(GTE_IR2);
+	lights.values[2][2] = gte_getDataReg(GTE_IR3);
+
+	gte_loadLightMatrix(&lights);
+}
@@ -0,0 +1,40 @@
+/*
+ * GTE lighting for PS1 bare-metal
+ *
+ * Up to three directional lights plus an ambient color, evaluated by the GTE's
+ * normal color commands (NCCS/NCCT). Light directions are kept in view space;
+ * as normals are stored in model space, setLightRotation() moves the lights
+ * into each object's space before it is drawn, so lit meshes cost the CPU
+ * nothing per vertex.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "ps1/gte.h"
+
+#define NUM_LIGHTS 3
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Set up the default key and fill lights and the ambient color */
+void initLighting(void);
+
+/*
+ * Set a light's direction (a 4.12 unit vector in view space pointing towards
+ * the light) and its color (4.12, 4096 = full intensity). A black light is
+ * off. Takes effect at the next setLightRotation().
+ */
+void setLight(int index, int x, int y, int z, int r, int g, int b);
+
+/* Color added to every lit surface, 4.12 like the light colors */
+void setAmbientLight(int r, int g, int b);
+
+/* Load the light matrix for an object drawn with the given rotation */
+void setLightRotation(const GTEMatrix *rotation);
+
+#ifdef __cplusplus
+}
+#endif
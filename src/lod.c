@@ -0,0 +1,92 @@
+/*
+ * Bounding sphere culling and level of detail selection for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lod.h"
+#include "model.h"
+#include "ps1/gte.h"
+#include "trig.h"
+
+void initViewFrustum(
+	ViewFrustum *frustum,
+	int         h,
+	int         halfWidth,
+	int         halfHeight,
+	int         zNear,
+	int         zFar
+) {
+	// The side planes go through the eye and the screen edges, so their
+	// normals are (h, -halfWidth) and (h, -halfHeight) in the XZ and YZ
+	// planes, normalized here once rather than per test.
+	int sideLength = isqrt(h * h + halfWidth  * halfWidth);
+	int topLength  = isqrt(h * h + halfHeight * halfHeight);
+
+	frustum->sideX = (h         << 12) / sideLength;
+	frustum->sideZ = (halfWidth << 12) / sideLength;
+	frustum->topY  = (h          << 12) / topLength;
+	frustum->topZ  = (halfHeight << 12) / topLength;
+	frustum->zNear = zNear;
+	frustum->zFar  = zFar;
+	frustum->h     = h;
+}
+
+bool projectBoundingSphere(
+	const ViewFrustum    *frustum,
+	const BoundingSphere *sphere,
+	SphereProjection     *result
+) {
+	GTEVector16 center = { sphere->x, sphere->y, sphere->z, 0 };
+
+	// RTPS leaves the view space center in IR1-3 (saturated, which is fine
+	// as anything that far out is rejected anyway) and its projection in
+	// SXY2.
+	gte_loadV0(&center);
+	gte_command(GTE_CMD_RTPS | GTE_SF);
+
+	int x = (int16_t) gte_getDataReg(GTE_IR1);
+	int y = (int16_t) gte_getDataReg(GTE_IR2);
+	int z = (int16_t) gte_getDataReg(GTE_IR3);
+	int r = sphere->radius;
+
+	if (((z + r) < frustum->zNear) || ((z - r) > frustum->zFar))
+		return false;
+
+	int absX = (x < 0) ? -x : x;
+	int absY = (y < 0) ? -y : y;
+
+	// Signed distances from the nearest side and top/bottom planes, positive
+	// outside the frustum
+	if (((absX * frustum->sideX - z * frustum->sideZ) >> 12) > r)
+		return false;
+	if (((absY * frustum->topY  - z * frustum->topZ)  >> 12) > r)
+		return false;
+
+	uint32_t sxy = gte_getDataReg(GTE_SXY2);
+
+	result->x  = x;
+	result->y  = y;
+	result->z  = z;
+	result->sx = (int16_t) (sxy & 0xffff);
+	result->sy = (int16_t) (sxy >> 16);
+
+	if (z > 0) {
+		uint32_t radius = (r * frustum->h) / z;
+
+		result->radius = (radius > 0xffff) ? 0xffff : radius;
+	} else {
+		result->radius = 0xffff;
+	}
+
+	return true;
+}
+
+int selectLOD(const MeshLOD *lod, int radius) {
+	for (int i = 0; i < lod->numLevels; i++) {
+		if (radius >= lod->minRadius[i])
+			return i;
+	}
+
+	return LOD_SPRITE;
+}
@@ -0,0 +1,85 @@
+/*
+ * Bounding sphere culling and level of detail selection for PS1 bare-metal
+ *
+ * An object's bounding sphere is projected with a single RTPS before any of
+ * its vertices are touched. Spheres entirely outside the view frustum are
+ * rejected, and the on-screen radius of the others picks which of the
+ * object's meshes to draw. Objects too small to show any detail collapse to
+ * a single sprite.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "model.h"
+
+#define MESH_MAX_LODS 4
+
+/* selectLOD() results besides a level index */
+#define LOD_SPRITE -1
+#define LOD_CULLED -2
+
+/* View frustum of the GTE's projection, as plane normals in 4.12 fixed-point */
+typedef struct {
+	int16_t sideX, sideZ;  /* Left and right planes, mirrored on X */
+	int16_t topY,  topZ;   /* Top and bottom planes, mirrored on Y */
+	int16_t zNear, zFar;
+	int16_t h;             /* Projection plane distance */
+} ViewFrustum;
+
+/* Bounding sphere moved into view space by the GTE's current transform */
+typedef struct {
+	int16_t  x, y, z;      /* View space center, saturated */
+	int16_t  sx, sy;       /* Screen space center */
+	uint16_t radius;       /* On-screen radius in pixels, saturated */
+} SphereProjection;
+
+/*
+ * Levels of detail of one object, most detailed first. Each level is drawn
+ * while the object's on-screen radius is at least its minRadius, below the
+ * last one the object becomes a sprite. The bounding sphere of the first
+ * level is used for all of them.
+ */
+typedef struct {
+	const Model *levels[MESH_MAX_LODS];
+	uint8_t     minRadius[MESH_MAX_LODS];
+	uint8_t     numLevels;
+	uint8_t     spriteR, spriteG, spriteB; /* Textured meshes only */
+} MeshLOD;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Set up a frustum matching a GTE projection with the given H and screen
+ * half-size. Objects entirely closer than zNear or further than zFar are
+ * rejected too.
+ */
+void initViewFrustum(
+	ViewFrustum *frustum,
+	int         h,
+	int         halfWidth,
+	int         halfHeight,
+	int         zNear,
+	int         zFar
+);
+
+/*
+ * Project a model space bounding sphere using the GTE's current rotation
+ * matrix and translation vector. Returns false if the sphere is entirely
+ * outside the frustum.
+ */
+bool projectBoundingSphere(
+	const ViewFrustum    *frustum,
+	const BoundingSphere *sphere,
+	SphereProjection     *result
+);
+
+/* Pick the level to draw at the given on-screen radius, or LOD_SPRITE */
+int selectLOD(const MeshLOD *lod, int radius);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,127 @@
+/*
+ * LZ4 block decompressor for PS1 bare-metal
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lz4.h"
+
+#define MIN_MATCH 4
+
+/* Lets GCC emit LWL/LWR and SWL/SWR for word accesses at any alignment */
+typedef struct {
+	uint32_t value;
+} __attribute__((packed)) Unaligned32;
+
+static inline uint32_t readHeader(const uint8_t *data, int offset) {
+	return 0
+		| (data[offset + 0] <<  0)
+		| (data[offset + 1] <<  8)
+		| (data[offset + 2] << 16)
+		| (data[offset + 3] << 24);
+}
+
+/* Extended length: a run of 255s ended by any other value, all added up */
+static inline size_t readLength(const uint8_t **src, size_t length) {
+	const uint8_t *ptr = *src;
+	uint8_t       value;
+
+	do {
+		value   = *(ptr++);
+		length += value;
+	} while (value == 255);
+
+	*src = ptr;
+	return length;
+}
+
+/* Source and destination must not overlap within 4 bytes of each other */
+static inline void copyWords(uint8_t *dst, const uint8_t *src, size_t length) {
+	for (; length >= 4; length -= 4, dst += 4, src += 4)
+		((Unaligned32 *) dst)->value = ((const Unaligned32 *) src)->value;
+
+	for (; length; length--)
+		*(dst++) = *(src++);
+}
+
+bool isLZ4Data(const void *data) {
+	return readHeader((const uint8_t *) data, 0) == LZ4_MAGIC;
+}
+
+size_t getLZ4Size(const void *data) {
+	return readHeader((const uint8_t *) data, 4);
+}
+
+void decompressLZ4(void *output, const void *data) {
+	LZ4Stream stream;
+
+	initLZ4Stream(&stream, output, data);
+	decodeLZ4Stream(&stream, getLZ4Size(data));
+}
+
+void initLZ4Stream(LZ4Stream *stream, void *output, const void *data) {
+	assert(isLZ4Data(data));
+
+	stream->src   = (const uint8_t *) data + LZ4_HEADER_SIZE;
+	stream->start = (uint8_t *) output;
+	stream->dst   = stream->start;
+	stream->end   = stream->start + getLZ4Size(data);
+}
+
+size_t decodeLZ4Stream(LZ4Stream *stream, size_t length) {
+	const uint8_t *src    = stream->src;
+	uint8_t       *dst    = stream->dst;
+	uint8_t       *end    = stream->end;
+	uint8_t       *target = stream->start + length;
+
+	if (target > end)
+		target = end;
+
+	// Each sequence is a token (literal and match lengths, 4 bits each), the
+	// literals, then a 16-bit match offset. The block always ends with a
+	// sequence of literals only.
+	while (dst < target) {
+		uint8_t token = *(src++);
+		size_t  count = token >> 4;
+
+		if (count == 15)
+			count = readLength(&src, count);
+
+		copyWords(dst, src, count);
+		src += count;
+		dst += count;
+
+		if (dst >= end)
+			break;
+
+		size_t         offset = src[0] | (src[1] << 8);
+		const uint8_t *match  = dst - offset;
+		src += 2;
+
+		assert(offset && (match >= stream->start));
+
+		count = token & 15;
+
+		if (count == 15)
+			count = readLength(&src, count);
+
+		count += MIN_MATCH;
+
+		// Offsets under 4 repeat a short pattern, each byte read having just
+		// been written, so they can't be moved a word at a time
+		if (offset >= 4) {
+			copyWords(dst, match, count);
+			dst += count;
+		} else {
+			for (; count; count--)
+				*(dst++) = *(match++);
+		}
+	}
+
+	stream->src = src;
+	stream->dst = dst;
+
+	return dst - stream->start;
+}
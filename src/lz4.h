@@ -0,0 +1,62 @@
+/*
+ * LZ4 block decompressor for PS1 bare-metal
+ *
+ * Decodes assets packed by tools/compressAsset.py: an 8 byte header ("LZ4B"
+ * and the decompressed size) followed by a standard LZ4 block. LZ4 only
+ * needs byte loads, adds and copies, no bit reader or tables, so it decodes
+ * at a good fraction of memcpy speed on the R3000 with nothing but the
+ * output buffer as working memory.
+ *
+ * Copies move a word at a time through unaligned loads and stores (LWL/LWR
+ * and SWL/SWR pairs) whenever source and destination are at least 4 bytes
+ * apart, overlapping short-offset matches fall back to bytes.
+ *
+ * A stream can also be decoded in steps, each one stopping at the first
+ * sequence boundary past a given amount of output. That's enough to hand
+ * finished parts of the output to DMA while the rest is still decoding, see
+ * uploadCompressedVRAMImage().
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LZ4_MAGIC       0x42345a4c  /* "LZ4B" read as little endian */
+#define LZ4_HEADER_SIZE 8
+
+typedef struct {
+	const uint8_t *src;
+	uint8_t       *start, *dst, *end;
+} LZ4Stream;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Check for the compressAsset.py header */
+bool isLZ4Data(const void *data);
+
+/* Decompressed size in bytes */
+size_t getLZ4Size(const void *data);
+
+/* Decompress all of data into output, which must hold getLZ4Size() bytes */
+void decompressLZ4(void *output, const void *data);
+
+void initLZ4Stream(LZ4Stream *stream, void *output, const void *data);
+
+/*
+ * Decode until at least length bytes of output (counted from the start) are
+ * done, or the whole block is. Returns the number of bytes decoded so far,
+ * which may be a little over length.
+ */
+size_t decodeLZ4Stream(LZ4Stream *stream, size_t length);
+
+static inline bool isLZ4StreamDone(const LZ4Stream *stream) {
+	return stream->dst >= stream->end;
+}
+
+#ifdef __cplusplus
+}
+#endif
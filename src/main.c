@@ -8,58 +8,173 @@
 #include <stdio.h>
 #include "gpu.h"
 #include "spu.h"
+#include "sound.h"
+#include "spustream.h"
+#include "archive.h"
 #include "cdda.h"
+#include "cdrom.h"
+#include "cdread.h"
+#include "controller.h"
+#include "bench.h"
 #include "bios.h"
+#include "irq.h"
+#include "light.h"
+#include "lz4.h"
 #include "model.h"
+#include "particles.h"
+#include "mesh.h"
+#include "scratchpad.h"
+#include "shapes.h"
 #include "font.h"
+#include "format.h"
+#include "profiler.h"
+#include "timestep.h"
+#include "vram.h"
+#include "atlas.h"
 #include "ps1/cop0.h"
 #include "ps1/gpucmd.h"
 #include "ps1/gte.h"
 #include "ps1/registers.h"
-#include "trig.h"
+#include "matrix.h"
 
-/* Texture data embedded by CMake */
-extern const uint8_t textureData[];
+#ifdef COMPRESS_ASSETS
+#include "assetSizes.h"
+#endif
+
+/* Ship texture and font image packed into one atlas by CMake (see atlas.h) */
+extern const uint8_t atlasData[];
 
 /* Model data embedded by CMake */
 extern const uint8_t modelData[];
 extern const uint32_t modelData_size;
 
-/* Font data embedded by CMake */
-extern const uint8_t fontTexture[];
+/* Same model with every quad split into triangles, for the quad benchmark */
+extern const uint8_t modelDataTris[];
+extern const uint32_t modelDataTris_size;
+
+/* Decimated levels of detail of the model */
+extern const uint8_t modelDataLod1[];
+extern const uint32_t modelDataLod1_size;
+extern const uint8_t modelDataLod2[];
+extern const uint32_t modelDataLod2_size;
+
+/* Font palette embedded by CMake */
 extern const uint8_t fontPalette[];
 
-/* Music data embedded by CMake (SPU-ADPCM format) */
-extern const uint8_t musicData[];
-extern const uint32_t musicData_size;
+/* Longer SPU-ADPCM loop, streamed through SPU RAM instead of uploaded */
+extern const uint8_t streamData[];
+extern const uint32_t streamData_size;
+
+#ifdef COMPRESS_ASSETS
+/*
+ * Decompressed assets: the atlas while it's being sent to VRAM, then the
+ * models, which are parsed in place and stay here. The atlas is given back
+ * before the models are unpacked, so the arena only has to fit the larger of
+ * the two.
+ */
+#define ATLAS_STAGING_SIZE (ATLAS_MAIN_WIDTH * ATLAS_MAIN_HEIGHT * 2)
+#define ASSET_MODELS_SIZE  ( \
+	MODEL_DATA_SIZE + MODEL_DATA_TRIS_SIZE + \
+	MODEL_DATA_LOD1_SIZE + MODEL_DATA_LOD2_SIZE )
+#define ASSET_ARENA_SIZE   ((ATLAS_STAGING_SIZE > ASSET_MODELS_SIZE) \
+	? ATLAS_STAGING_SIZE \
+	: ASSET_MODELS_SIZE)
+
+static uint32_t assetArena[ASSET_ARENA_SIZE / 4];
+static size_t   assetArenaUsed = 0;
+
+static void *allocateAsset(size_t size) {
+	size = (size + 3) & ~3;
+
+	if ((assetArenaUsed + size) > ASSET_ARENA_SIZE)
+		return NULL;
+
+	void *ptr = (uint8_t *) assetArena + assetArenaUsed;
+	assetArenaUsed += size;
+
+	return ptr;
+}
+#endif
+
+/* Get an embedded asset, decompressing it first if CMake packed it (see
+ * lz4.h). Returns NULL if there's no room left for it. */
+static const void *unpackAsset(const void *data, uint32_t *size) {
+#ifdef COMPRESS_ASSETS
+	if (isLZ4Data(data)) {
+		size_t length = getLZ4Size(data);
+		void   *ptr   = allocateAsset(length);
+
+		if (ptr) {
+			decompressLZ4(ptr, data);
+			*size = length;
+		}
+
+		return ptr;
+	}
+#endif
+
+	return data;
+}
 
+/* Assets read from ASSETS.PAK on the disc rather than embedded (see
+ * assets/archive.json) */
+#define ARCHIVE_PATH "\\ASSETS.PAK;1"
 
-/* Font dimensions */
-#define FONT_WIDTH        96
-#define FONT_HEIGHT       56
-#define FONT_COLOR_DEPTH  GP0_COLOR_4BPP
+/* Sectors set aside for the bite sound effect, it's uploaded to SPU RAM from
+ * here */
+#define SOUND_BUFFER_SECTORS 4
+
+static Archive  archive;
+static uint32_t soundBuffer[SOUND_BUFFER_SECTORS * CD_SECTOR_SIZE / 4];
+
+/* 0 while a boot time archive read is in progress, then 1 or -1 */
+static volatile int archiveReadStatus;
+
+static void onArchiveRead(bool success, void *arg) {
+	archiveReadStatus = success ? 1 : -1;
+}
+
+/* Run the CD-ROM queue until the archive read in progress has finished. Only
+ * used at boot, before the main loop takes over updating the drive. */
+static bool waitForArchiveRead(void) {
+	while (!archiveReadStatus) {
+		waitForFrame(getVSyncCount() + 1);
+		updateCDROM();
+		updateCDRead();
+	}
+
+	return archiveReadStatus > 0;
+}
+
+/* Open the archive and read an asset out of it into buffer, which holds
+ * maxSectors sectors. Returns the asset's size, or 0 if it couldn't be read. */
+static uint32_t loadArchiveAsset(const char *name, void *buffer, int maxSectors) {
+	if (!archive.numEntries) {
+		archiveReadStatus = 0;
+
+		if (!openArchive(&archive, ARCHIVE_PATH, onArchiveRead, NULL))
+			return 0;
+		if (!waitForArchiveRead())
+			return 0;
+	}
+
+	const ArchiveEntry *entry = findAsset(&archive, name);
 
-/* Controller button definitions (directly from response bytes) */
-#define PAD_SELECT   (1 << 0)
-#define PAD_L3       (1 << 1)
-#define PAD_R3       (1 << 2)
-#define PAD_START    (1 << 3)
-#define PAD_UP       (1 << 4)
-#define PAD_RIGHT    (1 << 5)
-#define PAD_DOWN     (1 << 6)
-#define PAD_LEFT     (1 << 7)
-#define PAD_L2       (1 << 8)
-#define PAD_R2       (1 << 9)
-#define PAD_L1       (1 << 10)
-#define PAD_R1       (1 << 11)
-#define PAD_TRIANGLE (1 << 12)
-#define PAD_CIRCLE   (1 << 13)
-#define PAD_X        (1 << 14)
-#define PAD_SQUARE   (1 << 15)
-
-/* Texture dimensions */
-#define TEXTURE_WIDTH  64
-#define TEXTURE_HEIGHT 64
+	if (!entry || (getAssetSectors(entry) > maxSectors))
+		return 0;
+
+	archiveReadStatus = 0;
+
+	if (!loadAsset(&archive, entry, buffer, onArchiveRead, NULL))
+		return 0;
+	if (!waitForArchiveRead())
+		return 0;
+
+	return entry->size;
+}
+
+
+#define FONT_COLOR_DEPTH  GP0_COLOR_4BPP
 
 /* GTE uses 20.12 fixed-point format */
 #define ONE (1 << 12)
@@ -72,37 +187,105 @@ extern const uint32_t musicData_size;
 #define CENTERX (SCREEN_WIDTH  / 2)
 #define CENTERY (SCREEN_HEIGHT / 2)
 
-/* Starfield configuration - scrolling right to left */
-#define NUM_STARS 80
-
-/* Star structure - 2D scrolling with parallax layers */
-typedef struct {
-	int16_t x, y;
-	uint8_t brightness;
-	uint8_t speed;
-	uint8_t size;
-} Star;
-
-/* 3D Shape types */
-#define SHAPE_CUBE     0
-#define SHAPE_PYRAMID  1
-#define SHAPE_SPHERE   2  /* Low-poly octahedron */
+/* Starfield configuration - scrolling right to left, see particles.h. The
+ * benchmark build fills the whole starfield and has room for more shapes. */
+#ifdef LANDER_BENCH
+#define NUM_STARS BENCH_NUM_STARS
+#else
+#define NUM_STARS 1536
+#endif
+
+/* Exhaust particles spawned per tick while TRIANGLE is held, how long they
+ * last and how fast they leave the nozzle */
+#define EXHAUST_PER_TICK  6
+#define EXHAUST_LIFE     40
+#define EXHAUST_SPEED     4
+#define EXHAUST_SPREAD    1
+
+#ifdef LANDER_BENCH
+#define NUM_SHAPES BENCH_MAX_SHAPES
+#else
 #define NUM_SHAPES 6
+#endif
 
-/* 3D Shape structure */
+/* 3D Shape structure. The instance holds the state as of the last tick, it's
+ * copied to shapeInstances[] to be interpolated and drawn. */
 typedef struct {
-	int16_t x, y, z;
-	int16_t rotX, rotY, rotZ;
-	int16_t rotSpeedX, rotSpeedY, rotSpeedZ;
-	int16_t moveSpeed;
-	uint8_t type;
-	uint8_t r, g, b;  /* Base color */
+	MeshInstance instance;
+	Quaternion   orientation;
+	Quaternion   spin;  /* Rotation applied every frame */
+	int16_t      moveSpeed;
+	uint8_t      type;  /* Index into shapeLODs[] and shapeTriLODs[] */
 } Shape3D;
 
-/* Global starfield and shapes */
-static Star stars[NUM_STARS];
+/* Per-frame temporaries placed in the scratchpad */
+#define HUD_TEXT_SIZE 128
+
+SCRATCHPAD_STATIC_ASSERT(HUD_TEXT_SIZE, "HUD text buffer");
+
+/* HUD text lines, each laid out once and only rebuilt when its text changes.
+ * The retained glyph blocks are double buffered along with the chains. */
+enum {
+	HUD_MODE,
+	HUD_DPAD,
+	HUD_BUTTONS,
+	HUD_SHOULDERS,
+	HUD_LOD,
+	HUD_PACKETS,
+	HUD_SCRATCHPAD,
+	HUD_MESH,
+	HUD_WAIT,
+	HUD_LEFT_STICK,
+	HUD_RIGHT_STICK,
+	NUM_HUD_LINES
+};
+
+static const int16_t hudLineY[NUM_HUD_LINES] = {
+	8, 20, 32, 44,
+	SCREEN_HEIGHT - 90,
+	SCREEN_HEIGHT - 78,
+	SCREEN_HEIGHT - 66,
+	SCREEN_HEIGHT - 54,
+	SCREEN_HEIGHT - 42,
+	SCREEN_HEIGHT - 30,
+	SCREEN_HEIGHT - 18
+};
+
+static TextLine hudLines[2][NUM_HUD_LINES];
+
+/* Global starfield, exhaust and shapes */
+static Starfield      starfield;
+static ParticleSystem exhaust;
 static Shape3D shapes[NUM_SHAPES];
 
+/* Shape instances as drawn this frame, moved on from the last tick by the
+ * interpolation factor and switched to triangles with SELECT */
+static MeshInstance shapeInstances[NUM_SHAPES];
+static int          numActiveShapes = NUM_SHAPES;
+
+/* Lander orientation, rebuilt only when the player rotates it */
+static RotationCache landerRotation;
+
+/* L2/R2 move the lander between these distances to show its levels of
+ * detail. At the far end the whole model has to stay within the world
+ * layer, which is checked against its bounding sphere at boot. */
+#define LANDER_MIN_DISTANCE 200
+#define LANDER_MAX_DISTANCE 440
+#define LANDER_ZOOM_SPEED     4
+
+/* On-screen radii in pixels at which the lander switches to a lower level of
+ * detail, and finally to a sprite */
+#define LANDER_LOD0_RADIUS 80
+#define LANDER_LOD1_RADIUS 64
+#define LANDER_LOD2_RADIUS  8
+
+/* Objects are rejected by their bounding spheres outside this depth range,
+ * the far end is where the far ordering table layer stops */
+#define VIEW_Z_NEAR  32
+#define VIEW_Z_FAR  768
+
+static ViewFrustum viewFrustum;
+
 /* Simple pseudo-random number generator */
 static uint32_t randSeed = 12345;
 static uint32_t fastRand(void) {
@@ -110,26 +293,6 @@ static uint32_t fastRand(void) {
 	return (randSeed >> 16) & 0x7FFF;
 }
 
-/* Initialize a single star at right edge */
-static void resetStar(Star *star, bool randomX) {
-	star->x = randomX ? (int16_t)(fastRand() % SCREEN_WIDTH) : SCREEN_WIDTH + (fastRand() % 20);
-	star->y = (int16_t)(fastRand() % SCREEN_HEIGHT);
-	int layer = fastRand() % 3;
-	if (layer == 0) {
-		star->brightness = 60 + (fastRand() % 40);
-		star->speed = 1;
-		star->size = 1;
-	} else if (layer == 1) {
-		star->brightness = 120 + (fastRand() % 60);
-		star->speed = 2;
-		star->size = 1;
-	} else {
-		star->brightness = 200 + (fastRand() % 55);
-		star->speed = 3 + (fastRand() % 2);
-		star->size = 2;
-	}
-}
-
 /* Calculate screen X position from world coordinates */
 /* screenX = (worldX * focalLength) / worldZ + CENTERX */
 /* focalLength = SCREEN_WIDTH/2 = 160 */
@@ -140,87 +303,151 @@ static int getScreenX(int worldX, int worldZ) {
 
 /* Initialize a 3D shape - spawns off-screen to the right */
 static void resetShape(Shape3D *shape, bool randomX) {
-	shape->z = 350 + (fastRand() % 250);  /* Set Z first since X depends on it */
-	shape->y = (int16_t)((fastRand() % 180) - 90);
+	MeshInstance *inst = &shape->instance;
+
+	inst->z = 350 + (fastRand() % 350);  /* Set Z first since X depends on it */
+	inst->y = (int16_t)((fastRand() % 180) - 90);
 	if (randomX) {
 		/* Initial spawn: random position across screen */
-		shape->x = (int16_t)((fastRand() % 600) - 150);
+		inst->x = (int16_t)((fastRand() % 600) - 150);
 	} else {
 		/* Respawn: start off-screen right. Need worldX > worldZ to be off right edge */
 		/* Add some margin so shape is fully off-screen */
-		shape->x = shape->z + 50 + (fastRand() % 100);
+		inst->x = inst->z + 50 + (fastRand() % 100);
 	}
-	shape->rotX = fastRand() % 4096;
-	shape->rotY = fastRand() % 4096;
-	shape->rotZ = fastRand() % 4096;
-	shape->rotSpeedX = (fastRand() % 40) - 20;
-	shape->rotSpeedY = (fastRand() % 50) - 25;
-	shape->rotSpeedZ = (fastRand() % 30) - 15;
+	int rotX = fastRand() % 4096;
+	int rotY = fastRand() % 4096;
+	int rotZ = fastRand() % 4096;
+	quatFromEuler(&shape->orientation, rotY, rotX, rotZ);
+	quatToMatrix(&inst->rotation, &shape->orientation);
+	int rotSpeedX = (fastRand() % 40) - 20;
+	int rotSpeedY = (fastRand() % 50) - 25;
+	int rotSpeedZ = (fastRand() % 30) - 15;
+	quatFromEuler(&shape->spin, rotSpeedY, rotSpeedX, rotSpeedZ);
 	shape->moveSpeed = 2 + (fastRand() % 3);
-	shape->type = fastRand() % 3;
+	shape->type = fastRand() % NUM_SHAPE_TYPES;
+	inst->lod   = &shapeLODs[shape->type];
 	/* Vibrant colors */
 	int colorType = fastRand() % 6;
 	switch (colorType) {
-		case 0: shape->r = 255; shape->g = 80;  shape->b = 80;  break;  /* Red */
-		case 1: shape->r = 80;  shape->g = 255; shape->b = 80;  break;  /* Green */
-		case 2: shape->r = 80;  shape->g = 80;  shape->b = 255; break;  /* Blue */
-		case 3: shape->r = 255; shape->g = 255; shape->b = 80;  break;  /* Yellow */
-		case 4: shape->r = 255; shape->g = 80;  shape->b = 255; break;  /* Magenta */
-		default: shape->r = 80; shape->g = 255; shape->b = 255; break;  /* Cyan */
+		case 0: inst->r = 255; inst->g = 80;  inst->b = 80;  break;  /* Red */
+		case 1: inst->r = 80;  inst->g = 255; inst->b = 80;  break;  /* Green */
+		case 2: inst->r = 80;  inst->g = 80;  inst->b = 255; break;  /* Blue */
+		case 3: inst->r = 255; inst->g = 255; inst->b = 80;  break;  /* Yellow */
+		case 4: inst->r = 255; inst->g = 80;  inst->b = 255; break;  /* Magenta */
+		default: inst->r = 80; inst->g = 255; inst->b = 255; break;  /* Cyan */
 	}
 }
 
-/* Initialize starfield and shapes */
-static void initStarfield(void) {
-	for (int i = 0; i < NUM_STARS; i++) {
-		resetStar(&stars[i], true);
-	}
+/* Initialize starfield, exhaust and shapes */
+static void initScene(void) {
+	initStarfield(&starfield, NUM_STARS, SCREEN_WIDTH, SCREEN_HEIGHT, randSeed);
+	initParticles(&exhaust, randSeed);
+
 	for (int i = 0; i < NUM_SHAPES; i++) {
 		resetShape(&shapes[i], true);
 	}
 }
 
-/* Update starfield and shapes */
-static void updateStarfield(void) {
-	for (int i = 0; i < NUM_STARS; i++) {
-		stars[i].x -= stars[i].speed;
-		if (stars[i].x < -2) {
-			resetStar(&stars[i], false);
-		}
-	}
-	for (int i = 0; i < NUM_SHAPES; i++) {
-		shapes[i].x -= shapes[i].moveSpeed;
-		shapes[i].rotX += shapes[i].rotSpeedX;
-		shapes[i].rotY += shapes[i].rotSpeedY;
-		shapes[i].rotZ += shapes[i].rotSpeedZ;
+/* Update starfield, exhaust and shapes */
+static void updateScene(void) {
+	updateStarfield(&starfield);
+	updateParticles(&exhaust);
+
+	for (int i = 0; i < numActiveShapes; i++) {
+		MeshInstance *inst = &shapes[i].instance;
+
+		inst->x -= shapes[i].moveSpeed;
+		/* Tumble incrementally rather than rebuilding from Euler angles */
+		quatRotate(&shapes[i].orientation, &shapes[i].spin);
+		quatToMatrix(&inst->rotation, &shapes[i].orientation);
 		/* Check screen-space position - reset when fully off-screen left */
-		/* Shape size on screen is roughly (20 * 160) / z pixels */
-		int screenX = getScreenX(shapes[i].x, shapes[i].z);
-		int screenSize = (20 * (SCREEN_WIDTH / 2)) / shapes[i].z;
+		/* Shape size on screen is roughly (SHAPE_SIZE * 160) / z pixels */
+		int screenX = getScreenX(inst->x, inst->z);
+		int screenSize = (SHAPE_SIZE * (SCREEN_WIDTH / 2)) / inst->z;
 		if (screenX < -screenSize) {
 			resetShape(&shapes[i], false);
 		}
 	}
 }
 
-/* Draw a single flat-shaded triangle for background shapes */
-/* Uses depth index to sort: higher zIdx = drawn first (further back) */
-/* Background shapes should use indices from ORDERING_TABLE_SIZE/2 to ORDERING_TABLE_SIZE-3 */
-static void drawBgTriangle(DMAChain *chain, uint8_t r, uint8_t g, uint8_t b, int zIdx) {
-	/* Clamp zIdx to background range (behind main model, in front of stars) */
-	/* Main model uses indices 0 to ~ORDERING_TABLE_SIZE/2 */
-	/* Background shapes use ORDERING_TABLE_SIZE/2 to ORDERING_TABLE_SIZE-3 */
-	int minIdx = ORDERING_TABLE_SIZE / 2;
-	int maxIdx = ORDERING_TABLE_SIZE - 3;
-
-	if (zIdx < minIdx) zIdx = minIdx;
-	if (zIdx > maxIdx) zIdx = maxIdx;
-
-	uint32_t *ptr = allocatePacket(chain, zIdx, 4);
-	ptr[0] = gp0_rgb(r, g, b) | gp0_triangle(false, false);
-	gte_storeDataReg(GTE_SXY0, 1 * 4, ptr);
-	gte_storeDataReg(GTE_SXY1, 2 * 4, ptr);
-	gte_storeDataReg(GTE_SXY2, 3 * 4, ptr);
+/* Retained backdrop: drawing area and gradient, built once per framebuffer
+ * and relinked each frame with only changed fields patched */
+#define BACKDROP_BUFFER_SIZE 32
+
+typedef struct {
+	RetainedBlock block;
+	uint32_t      data[BACKDROP_BUFFER_SIZE];
+	uint32_t      *gradient[2];
+	int           flash;
+} Backdrop;
+
+static Backdrop backdrops[2];
+
+/* Patch the gradient triangle colors for the given flash state */
+static void setBackdropFlash(Backdrop *bd, int bgFlash) {
+	/* Top: deep purple, Bottom: dark blue/black */
+	/* Flash shifts toward yellow/orange */
+	int topR = 60 + ((255 - 60) * bgFlash) / 255;
+	int topG = 20 + ((220 - 20) * bgFlash) / 255;
+	int topB = 90 + ((80 - 90) * bgFlash) / 255;
+	int botR = 15 + ((180 - 15) * bgFlash) / 255;
+	int botG = 5 + ((100 - 5) * bgFlash) / 255;
+	int botB = 35 + ((40 - 35) * bgFlash) / 255;
+
+	uint32_t top = gp0_rgb(topR, topG, topB);
+	uint32_t bot = gp0_rgb(botR, botG, botB);
+
+	/* First triangle: top-left, top-right, bottom-right */
+	bd->gradient[0][0] = top | gp0_shadedTriangle(true, false, false);
+	bd->gradient[0][2] = top;
+	bd->gradient[0][4] = bot;
+
+	/* Second triangle: top-left, bottom-right, bottom-left */
+	bd->gradient[1][0] = top | gp0_shadedTriangle(true, false, false);
+	bd->gradient[1][2] = bot;
+	bd->gradient[1][4] = bot;
+
+	bd->flash = bgFlash;
+}
+
+/* Build the backdrop block for one framebuffer */
+static void initBackdrop(Backdrop *bd, int bufferX, int bufferY) {
+	uint32_t *ptr;
+
+	initRetainedBlock(&bd->block, bd->data, BACKDROP_BUFFER_SIZE);
+
+	/* Set drawing area attributes */
+	ptr    = allocateRetainedPacket(&bd->block, 4);
+	ptr[0] = gp0_texpage(0, true, false);
+	ptr[1] = gp0_fbOffset1(bufferX, bufferY);
+	ptr[2] = gp0_fbOffset2(
+		bufferX + SCREEN_WIDTH  - 1,
+		bufferY + SCREEN_HEIGHT - 2
+	);
+	ptr[3] = gp0_fbOrigin(bufferX, bufferY);
+
+	/* Gradient background as two Gouraud-shaded triangles (quad) */
+	/* This creates a smooth vertical gradient with PSX hardware dithering */
+	ptr    = allocateRetainedPacket(&bd->block, 6);
+	ptr[1] = gp0_xy(0, 0);                        /* Top-left */
+	ptr[3] = gp0_xy(SCREEN_WIDTH, 0);             /* Top-right */
+	ptr[5] = gp0_xy(SCREEN_WIDTH, SCREEN_HEIGHT); /* Bottom-right */
+	bd->gradient[0] = ptr;
+
+	ptr    = allocateRetainedPacket(&bd->block, 6);
+	ptr[1] = gp0_xy(0, 0);                        /* Top-left */
+	ptr[3] = gp0_xy(SCREEN_WIDTH, SCREEN_HEIGHT); /* Bottom-right */
+	ptr[5] = gp0_xy(0, SCREEN_HEIGHT);            /* Bottom-left */
+	bd->gradient[1] = ptr;
+
+	setBackdropFlash(bd, 0);
+}
+
+/* Patch the fields that changed since this backdrop was last drawn */
+static void updateBackdrop(Backdrop *bd, int bgFlash) {
+	if (bd->flash != bgFlash)
+		setBackdropFlash(bd, bgFlash);
 }
 
 /* Initialize the GTE for 3D rendering */
@@ -236,226 +463,29 @@ static void setupGTE(int width, int height) {
 	int focalLength = (width < height) ? width : height;
 	gte_setControlReg(GTE_H, focalLength / 2);
 
-	/* Set Z averaging scale factors for ordering table sorting */
-	gte_setControlReg(GTE_ZSF3, ORDERING_TABLE_SIZE / 3);
-	gte_setControlReg(GTE_ZSF4, ORDERING_TABLE_SIZE / 4);
-}
-
-/* Matrix multiplication helper */
-static void multiplyCurrentMatrixByVectors(GTEMatrix *output) {
-	gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_V0 | GTE_CV_NONE);
-	output->values[0][0] = gte_getDataReg(GTE_IR1);
-	output->values[1][0] = gte_getDataReg(GTE_IR2);
-	output->values[2][0] = gte_getDataReg(GTE_IR3);
-
-	gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_V1 | GTE_CV_NONE);
-	output->values[0][1] = gte_getDataReg(GTE_IR1);
-	output->values[1][1] = gte_getDataReg(GTE_IR2);
-	output->values[2][1] = gte_getDataReg(GTE_IR3);
-
-	gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_V2 | GTE_CV_NONE);
-	output->values[0][2] = gte_getDataReg(GTE_IR1);
-	output->values[1][2] = gte_getDataReg(GTE_IR2);
-	output->values[2][2] = gte_getDataReg(GTE_IR3);
-}
-
-/* Rotate the current GTE matrix */
-static void rotateCurrentMatrix(int yaw, int pitch, int roll) {
-	static GTEMatrix multiplied;
-	int s, c;
-
-	/* Yaw rotation (Y axis) */
-	if (yaw) {
-		s = isin(yaw);
-		c = icos(yaw);
-
-		gte_setColumnVectors(
-			c, -s,   0,
-			s,  c,   0,
-			0,  0, ONE
-		);
-		multiplyCurrentMatrixByVectors(&multiplied);
-		gte_loadRotationMatrix(&multiplied);
-	}
-
-	/* Pitch rotation (X axis) */
-	if (pitch) {
-		s = isin(pitch);
-		c = icos(pitch);
-
-		gte_setColumnVectors(
-			c,   0, s,
-			0, ONE, 0,
-			-s,   0, c
-		);
-		multiplyCurrentMatrixByVectors(&multiplied);
-		gte_loadRotationMatrix(&multiplied);
-	}
-
-	/* Roll rotation (Z axis) */
-	if (roll) {
-		s = isin(roll);
-		c = icos(roll);
-
-		gte_setColumnVectors(
-			ONE, 0,  0,
-			0, c, -s,
-			0, s,  c
-		);
-		multiplyCurrentMatrixByVectors(&multiplied);
-		gte_loadRotationMatrix(&multiplied);
-	}
-}
-
-/* Controller communication */
-static void delayMicroseconds(int time) {
-	time = ((time * 271) + 4) / 8;
-	__asm__ volatile(
-		".set push\n"
-		".set noreorder\n"
-		"bgtz  %0, .\n"
-		"addiu %0, -2\n"
-		".set pop\n"
-		: "+r"(time)
+	/* Cull objects against the same projection */
+	initViewFrustum(
+		&viewFrustum,
+		focalLength / 2,
+		width  / 2,
+		height / 2,
+		VIEW_Z_NEAR,
+		VIEW_Z_FAR
 	);
-}
-
-static void initControllerBus(void) {
-	SIO_CTRL(0) = SIO_CTRL_RESET;
-	SIO_MODE(0) = SIO_MODE_BAUD_DIV1 | SIO_MODE_DATA_8;
-	SIO_BAUD(0) = F_CPU / 250000;
-	SIO_CTRL(0) = SIO_CTRL_TX_ENABLE | SIO_CTRL_RX_ENABLE | SIO_CTRL_DSR_IRQ_ENABLE;
-}
-
-static bool waitForAcknowledge(int timeout) {
-	for (; timeout > 0; timeout -= 10) {
-		if (IRQ_STAT & (1 << IRQ_SIO0)) {
-			IRQ_STAT = ~(1 << IRQ_SIO0);
-			SIO_CTRL(0) |= SIO_CTRL_ACKNOWLEDGE;
-			return true;
-		}
-		delayMicroseconds(10);
-	}
-	return false;
-}
-
-static uint8_t exchangeByte(uint8_t value) {
-	while (!(SIO_STAT(0) & SIO_STAT_TX_NOT_FULL))
-		__asm__ volatile("");
-	SIO_DATA(0) = value;
-	while (!(SIO_STAT(0) & SIO_STAT_RX_NOT_EMPTY))
-		__asm__ volatile("");
-	return SIO_DATA(0);
-}
-
-static uint8_t exchangeByteWithTimeout(uint8_t value, int timeout) {
-	/* Wait for TX ready with timeout */
-	while (!(SIO_STAT(0) & SIO_STAT_TX_NOT_FULL)) {
-		if (--timeout <= 0) return 0xFF;
-		__asm__ volatile("");
-	}
-	SIO_DATA(0) = value;
-
-	/* Wait for RX ready with timeout */
-	timeout = 10000;
-	while (!(SIO_STAT(0) & SIO_STAT_RX_NOT_EMPTY)) {
-		if (--timeout <= 0) return 0xFF;
-		__asm__ volatile("");
-	}
-	return SIO_DATA(0);
-}
-
-/* Controller state structure with analog support */
-typedef struct {
-	uint16_t buttons;    /* Digital buttons (active high after inversion) */
-	uint8_t  leftX;      /* Left stick X (0x00=left, 0x80=center, 0xFF=right) */
-	uint8_t  leftY;      /* Left stick Y (0x00=up, 0x80=center, 0xFF=down) */
-	uint8_t  rightX;     /* Right stick X */
-	uint8_t  rightY;     /* Right stick Y */
-	bool     isAnalog;   /* True if analog controller detected */
-} ControllerState;
-
-static void pollController(int port, ControllerState *state) {
-	/* Initialize to defaults (no input, centered sticks) */
-	state->buttons = 0;
-	state->leftX = 0x80;
-	state->leftY = 0x80;
-	state->rightX = 0x80;
-	state->rightY = 0x80;
-	state->isAnalog = false;
-
-	/* Select port */
-	if (port)
-		SIO_CTRL(0) |= SIO_CTRL_CS_PORT_2;
-	else
-		SIO_CTRL(0) &= ~SIO_CTRL_CS_PORT_2;
-
-	/* Reset IRQ and assert DTR */
-	IRQ_STAT = ~(1 << IRQ_SIO0);
-	SIO_CTRL(0) |= SIO_CTRL_DTR | SIO_CTRL_ACKNOWLEDGE;
-	delayMicroseconds(60);
-
-	/* Send address byte (0x01 = controller) */
-	SIO_DATA(0) = 0x01;
-
-	if (!waitForAcknowledge(500)) {
-		SIO_CTRL(0) &= ~SIO_CTRL_DTR;
-		return;  /* No controller */
-	}
 
-	/* Clear receive buffer with timeout */
-	int clearTimeout = 2000;
-	while ((SIO_STAT(0) & SIO_STAT_RX_NOT_EMPTY) && clearTimeout-- > 0)
-		SIO_DATA(0);
-
-	/* Send poll command - request up to 8 bytes for analog data */
-	uint8_t response[8] = {0, 0, 0, 0, 0x80, 0x80, 0x80, 0x80};
-	uint8_t request[] = { 0x42, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-
-	/* First byte tells us the controller type and response length */
-	response[0] = exchangeByteWithTimeout(request[0], 20000);
-	if (!waitForAcknowledge(500)) goto done;
-
-	/* Get controller type from upper nibble, length from lower nibble */
-	int type = response[0] >> 4;
-	int halfwords = response[0] & 0x0F;  /* Response length in 16-bit units */
-	int responseLen = (halfwords + 1) * 2;  /* Convert to bytes */
-	if (responseLen > 8) responseLen = 8;
-
-	/* Read remaining bytes */
-	for (int i = 1; i < responseLen; i++) {
-		response[i] = exchangeByteWithTimeout(request[i], 20000);
-		if (i < responseLen - 1 && !waitForAcknowledge(500))
-			break;
-	}
-
-	/* Parse response */
-	state->buttons = (response[2] | (response[3] << 8)) ^ 0xFFFF;
-
-	/* Check if analog controller (type 0x7 = DualShock, 0x5 = Analog stick) */
-	if (type == 0x7 || type == 0x5) {
-		state->isAnalog = true;
-		state->rightX = response[4];
-		state->rightY = response[5];
-		state->leftX = response[6];
-		state->leftY = response[7];
-	}
-
-done:
-	/* Release DTR */
-	delayMicroseconds(60);
-	SIO_CTRL(0) &= ~SIO_CTRL_DTR;
+	/* Set Z averaging scale factors so OTZ is the average Z, each ordering
+	 * table layer maps it to its own slots */
+	gte_setControlReg(GTE_ZSF3, ONE / 3);
+	gte_setControlReg(GTE_ZSF4, ONE / 4);
 }
 
 int main(int argc, const char **argv) {
 	/* Initialize serial for debugging */
 	initSerialIO(115200);
 
-	/* Initialize controller bus */
-	initControllerBus();
-
 	/* Setup GPU based on region */
-	if ((GPU_GP1 & GP1_STAT_FB_MODE_BITMASK) == GP1_STAT_FB_MODE_PAL) {
+	bool isPAL = (GPU_GP1 & GP1_STAT_FB_MODE_BITMASK) == GP1_STAT_FB_MODE_PAL;
+	if (isPAL) {
 		puts("Using PAL mode");
 		setupGPU(GP1_MODE_PAL, SCREEN_WIDTH, SCREEN_HEIGHT);
 	} else {
@@ -463,8 +493,20 @@ int main(int argc, const char **argv) {
 		setupGPU(GP1_MODE_NTSC, SCREEN_WIDTH, SCREEN_HEIGHT);
 	}
 
-	/* Initialize GTE */
+	/* Start the vblank counter and DMA completion tracking */
+	initIRQ(isPAL);
+
+	/* Poll both controller ports from the SIO0 IRQ, a round per vblank */
+	initControllers();
+
+	/* Initialize GTE and the scene lights */
 	setupGTE(SCREEN_WIDTH, SCREEN_HEIGHT);
+	initLighting();
+
+#ifdef ENABLE_PROFILER
+	/* Timer 2 for the frame profiler, START cycles its overlay */
+	initProfiler();
+#endif
 
 	/* Enable DMA channels */
 	DMA_DPCR |= 0
@@ -474,41 +516,141 @@ int main(int argc, const char **argv) {
 	GPU_GP1 = gp1_dmaRequestMode(GP1_DREQ_GP0_WRITE);
 	GPU_GP1 = gp1_dispBlank(false);
 
-	/* Upload texture to VRAM (placed after framebuffers at 640,0) */
-	TextureInfo texture;
-	uploadTexture(
-		&texture,
-		textureData,
-		SCREEN_WIDTH * 2,  /* X position in VRAM */
-		0,                  /* Y position in VRAM */
-		TEXTURE_WIDTH,
-		TEXTURE_HEIGHT
+	/* Place the atlas and font palette next to the framebuffers. Both are
+	 * sent from the upload queue, which is simply drained here at boot. */
+	initVRAM(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+	VRAMRect atlasRect, fontPaletteRect;
+	if (
+		!allocateVRAMImage(&atlasRect, ATLAS_MAIN_WIDTH, ATLAS_MAIN_HEIGHT) ||
+		!allocateVRAMCLUT(&fontPaletteRect, 16)
+	) {
+		puts("Failed to allocate VRAM!");
+		return 1;
+	}
+
+	/* Time how long the embedded assets take to unpack and upload. The
+	 * compressed atlas gets decoded in bands, each one going out over DMA
+	 * while the next is decoded. */
+	uint16_t assetStartLine = getHblankCounter();
+
+#ifdef COMPRESS_ASSETS
+	size_t atlasArenaMark = assetArenaUsed;
+	void   *atlasStaging  = allocateAsset(ATLAS_STAGING_SIZE);
+
+	if (!atlasStaging) {
+		puts("Failed to allocate atlas staging buffer!");
+		return 1;
+	}
+
+	uploadCompressedVRAMImage(atlasData, &atlasRect, atlasStaging);
+	assetArenaUsed = atlasArenaMark;
+#else
+	queueVRAMUpload(atlasData, &atlasRect, NULL, NULL);
+#endif
+	queueVRAMUpload(fontPalette, &fontPaletteRect, NULL, NULL);
+
+	VRAMRect shipRect = {
+		.x      = atlasRect.x + ATLAS_MAIN_SHIP_X,
+		.y      = atlasRect.y + ATLAS_MAIN_SHIP_Y,
+		.width  = ATLAS_MAIN_SHIP_WIDTH,
+		.height = ATLAS_MAIN_SHIP_HEIGHT
+	};
+	VRAMRect fontRect = {
+		.x      = atlasRect.x + ATLAS_MAIN_FONT_X,
+		.y      = atlasRect.y + ATLAS_MAIN_FONT_Y,
+		.width  = ATLAS_MAIN_FONT_WIDTH / 4,
+		.height = ATLAS_MAIN_FONT_HEIGHT
+	};
+
+	TextureInfo texture, font;
+	setTextureInfo(
+		&texture, &shipRect, NULL,
+		ATLAS_MAIN_SHIP_WIDTH, ATLAS_MAIN_SHIP_HEIGHT, GP0_COLOR_16BPP
 	);
-	puts("Texture uploaded to VRAM");
-
-	/* Upload font to VRAM (placed after model texture) */
-	TextureInfo font;
-	uploadIndexedTexture(
-		&font,
-		fontTexture,
-		fontPalette,
-		SCREEN_WIDTH * 2,          /* Image X */
-		TEXTURE_HEIGHT,            /* Image Y (below model texture) */
-		SCREEN_WIDTH * 2,          /* Palette X */
-		TEXTURE_HEIGHT + FONT_HEIGHT, /* Palette Y */
-		FONT_WIDTH,
-		FONT_HEIGHT,
-		FONT_COLOR_DEPTH
+	setTextureInfo(
+		&font, &fontRect, &fontPaletteRect,
+		ATLAS_MAIN_FONT_WIDTH, ATLAS_MAIN_FONT_HEIGHT, FONT_COLOR_DEPTH
 	);
-	puts("Font uploaded to VRAM");
+
+	flushVRAMUploads();
+	puts("Texture atlas uploaded to VRAM");
 
 	/* Load 3D model from embedded data */
+	uint32_t modelSize     = modelData_size;
+	uint32_t triModelSize  = modelDataTris_size;
+	uint32_t lod1ModelSize = modelDataLod1_size;
+	uint32_t lod2ModelSize = modelDataLod2_size;
+
+	const void *modelFile     = unpackAsset(modelData, &modelSize);
+	const void *triModelFile  = unpackAsset(modelDataTris, &triModelSize);
+	const void *lod1ModelFile = unpackAsset(modelDataLod1, &lod1ModelSize);
+	const void *lod2ModelFile = unpackAsset(modelDataLod2, &lod2ModelSize);
+
+	if (!modelFile || !triModelFile || !lod1ModelFile || !lod2ModelFile) {
+		puts("Failed to unpack models!");
+		return 1;
+	}
+
+	printf("Assets unpacked in %d lines\n",
+		(uint16_t) (getHblankCounter() - assetStartLine));
+
 	Model model;
-	if (!loadModel(&model, modelData, modelData_size)) {
+	if (!loadModel(&model, modelFile, modelSize)) {
 		puts("Failed to load model!");
 		return 1;
 	}
-	printf("Model loaded: %d verts, %d faces\n", model.numVertices, model.numFaces);
+	printf("Model loaded: v%d, %d verts, %d faces, radius %d\n",
+		(model.version == MODEL_VERSION_1) ? 1 : model.version,
+		model.numVertices, model.numFaces, model.bounds.radius);
+
+	/* The world layer starts at OTZ 0, which the GTE never goes below, but
+	 * faces past its far end would be dropped */
+	int landerExtent = model.bounds.radius
+		+ ((model.bounds.z < 0) ? -model.bounds.z : model.bounds.z);
+
+	if ((LANDER_MAX_DISTANCE + landerExtent) >= OT_WORLD_Z_FAR)
+		puts("Warning: lander zoom range exceeds the world layer");
+
+	Model triModel;
+	if (!loadModel(&triModel, triModelFile, triModelSize)) {
+		puts("Failed to load triangle model!");
+		return 1;
+	}
+
+	Model lodModels[2];
+	if (
+		!loadModel(&lodModels[0], lod1ModelFile, lod1ModelSize) ||
+		!loadModel(&lodModels[1], lod2ModelFile, lod2ModelSize)
+	) {
+		puts("Failed to load model LODs!");
+		return 1;
+	}
+	printf("Model LODs: %d, %d faces\n",
+		lodModels[0].numFaces, lodModels[1].numFaces);
+
+	/* Both variants share the decimated levels, which have no quads */
+	const MeshLOD landerLOD = {
+		.levels    = { &model, &lodModels[0], &lodModels[1] },
+		.minRadius = { LANDER_LOD0_RADIUS, LANDER_LOD1_RADIUS, LANDER_LOD2_RADIUS },
+		.numLevels = 3,
+		.spriteR   = 96,
+		.spriteG   = 96,
+		.spriteB   = 96
+	};
+	const MeshLOD landerTriLOD = {
+		.levels    = { &triModel, &lodModels[0], &lodModels[1] },
+		.minRadius = { LANDER_LOD0_RADIUS, LANDER_LOD1_RADIUS, LANDER_LOD2_RADIUS },
+		.numLevels = 3,
+		.spriteR   = 96,
+		.spriteG   = 96,
+		.spriteB   = 96
+	};
+
+	/* SELECT switches between quads and split triangles, so the packet words
+	 * per frame of both paths can be compared on the MESH line of the HUD */
+	bool useQuads = true;
+	int  landerDistance = 300;
 
 	/* Initialize SPU FIRST (matches psyqo order - SPU::reset before BIOS events) */
 	setupSPU();
@@ -519,25 +661,52 @@ int main(int argc, const char **argv) {
 	biosInit();
 	puts("BIOS events initialized");
 
-	/* Upload SPU sound effect (guitar) - triggered by button press */
-	uint32_t spuSoundAddr = 0;
-	if (musicData_size > 0) {
-		spuSoundAddr = uploadVAG(musicData, musicData_size);
-		printf("SPU: Sound uploaded to 0x%05lX\n", (unsigned long)spuSoundAddr);
+	/* Reset the drive in the background. The asset reads below and then the
+	 * CD-DA commands queue up behind the INIT. */
+	initCDROM();
+	initCDRead();
+
+	/* Read the SPU sound effect (bite) from the disc and upload it, before
+	 * CD-DA starts as a read would stop the music. It stays resident in a
+	 * bank so retriggers cost no upload. */
+	SoundBank soundBank;
+	initSoundBank(&soundBank);
+
+	int      biteSound = -1;
+	uint32_t biteSize  = loadArchiveAsset(
+		"BITE", soundBuffer, SOUND_BUFFER_SECTORS
+	);
+
+	if (biteSize > 0) {
+		biteSound = loadSound(
+			&soundBank, soundBuffer, biteSize, 22050, SOUND_PRIORITY_NORMAL
+		);
+		printf("SPU: Sound %d loaded, %u bytes free\n",
+			biteSound, (unsigned)getSPURAMFree());
+	} else {
+		puts("SPU: Sound effect not found in " ARCHIVE_PATH);
 	}
 
-	/* Initialize CD-DA for background music */
+	/* Initialize CD-DA for background music, it starts a few frames into
+	 * the main loop */
 	/* NOTE: Do this BEFORE spuUnmute() since initCDDA() touches SPU_CTRL */
 	initCDDA();
-	puts("CD-DA initialized - music playing from disc");
+	puts("CD-DA queued - music will play from disc");
 
 	/* Unmute SPU AFTER CD-DA init (CD-DA init modifies SPU_CTRL) */
 	spuUnmute();
 	puts("SPU unmuted - press X for sound effect");
 
-	/* Double buffering */
-	DMAChain dmaChains[2];
-	bool     usingSecondFrame = false;
+	/* Double buffering: one chain is built while the other is being drawn */
+	static DMAChain dmaChains[2];
+	static uint32_t chainBuffers[2][CHAIN_BUFFER_SIZE];
+	bool            usingSecondFrame = false;
+
+	initChain(&dmaChains[0], chainBuffers[0], CHAIN_BUFFER_SIZE);
+	initChain(&dmaChains[1], chainBuffers[1], CHAIN_BUFFER_SIZE);
+
+	FramePresenter presenter;
+	initPresenter(&presenter);
 
 	/* Rotation angles controlled by player */
 	int rotationYaw   = 0;
@@ -548,164 +717,328 @@ int main(int argc, const char **argv) {
 	puts("Use D-pad or left stick to rotate");
 	puts("Use L1/R1 or right stick for roll");
 	puts("Press X button to play sound effect");
+	puts("Press O to start/stop the streamed guitar loop");
+	puts("Press SELECT to toggle quad/triangle rendering");
+#ifdef ENABLE_PROFILER
+	puts("Press START to cycle the profiler overlay and serial dump");
+#endif
 
 	/* Track previous button state for edge detection */
 	uint16_t prevButtons = 0;
 
 	/* Initialize starfield */
-	initStarfield();
+	initScene();
+	initBackdrop(&backdrops[0], 0, 0);
+	initBackdrop(&backdrops[1], SCREEN_WIDTH, 0);
 	puts("Starfield initialized");
 
 	/* Background flash effect (0 = purple, 255 = yellow) */
 	int bgFlash = 0;
 
+	/* Set up the cached HUD lines for both framebuffers */
+	for (int i = 0; i < NUM_HUD_LINES; i++) {
+		initTextLine(&hudLines[0][i], 8, hudLineY[i]);
+		initTextLine(&hudLines[1][i], 8, hudLineY[i]);
+	}
+
+	int hudRebuilds = 0;
+
+#ifdef ENABLE_PROFILER
+	/* 0 = hidden, 1 = overlay, 2 = overlay and serial dump */
+	int profilerMode = 0;
+#endif
+
+#ifdef LANDER_BENCH
+	/* Scenario being run and how far into it we are */
+	int                 benchIndex = 0, benchFrame = 0;
+	const BenchScenario *bench     = getBenchScenario(0);
+	BenchResults        benchResults;
+	uint32_t            benchVSync = getVSyncCount();
+
+	puts("Running benchmark scenarios");
+#endif
+
+	/* Simulation runs at TIMESTEP_HZ on both PAL and NTSC */
+	Timestep timestep;
+	initTimestep(&timestep, isPAL);
+
+	/* Ticks run since the last rendered frame, for the HUD */
+	int simTicks = 0;
+
 	/* Main loop */
 	for (;;) {
-		int bufferX = usingSecondFrame ? SCREEN_WIDTH : 0;
-		int bufferY = 0;
+#ifdef LANDER_BENCH
+		/* Every scenario starts from the same state and seed */
+		if (!benchFrame) {
+			randSeed        = BENCH_SEED;
+			numActiveShapes = bench->numShapes;
+			rotationYaw     = 0;
+			rotationPitch   = 0;
+			rotationRoll    = 0;
+			landerDistance  = 300;
+			bgFlash         = 0;
+			prevButtons     = 0;
+
+			initScene();
+			beginBenchScenario(&benchResults);
+		}
+
+		beginBenchFrame();
+#endif
+
+		/* Poll controller */
+		PROFILE_BEGIN(PROFILE_INPUT);
+		ControllerState pad;
+#ifdef LANDER_BENCH
+		const BenchInput *input = getBenchInput(bench, benchFrame);
+
+		pad.buttons   = input->buttons;
+		pad.leftX     = input->leftX;
+		pad.leftY     = input->leftY;
+		pad.rightX    = input->rightX;
+		pad.rightY    = input->rightY;
+		pad.isAnalog  = true;
+		pad.connected = true;
+#else
+		updateControllers();
+		pad = *getControllerState(0);
+#endif
+		PROFILE_END(PROFILE_INPUT);
+
+		PROFILE_BEGIN(PROFILE_SIMULATION);
+
+		/* Run the ticks due since the last frame. Benchmarks always run
+		 * exactly one so that every run draws the same frames. */
+#ifdef LANDER_BENCH
+		int ticks = 1;
+#else
+		int ticks = beginTimestepFrame(&timestep);
+#endif
+
+		for (int tick = 0; tick < ticks; tick++) {
+			/* Rotation speed (in fixed-point units per tick) */
+			const int ROTATION_SPEED = 32;
+			const int ANALOG_DEADZONE = 20;  /* Deadzone around center (0x80) */
+
+			/* Check for analog stick input first */
+			if (pad.isAnalog) {
+				/* Left stick controls yaw and pitch */
+				int stickX = (int)pad.leftX - 0x80;  /* -128 to +127 */
+				int stickY = (int)pad.leftY - 0x80;
+
+				/* Apply deadzone */
+				if (stickX > ANALOG_DEADZONE || stickX < -ANALOG_DEADZONE)
+					rotationYaw += stickX / 4;
+				if (stickY > ANALOG_DEADZONE || stickY < -ANALOG_DEADZONE)
+					rotationPitch += stickY / 4;
+
+				/* Right stick controls roll (X axis only) */
+				int rightX = (int)pad.rightX - 0x80;
+				if (rightX > ANALOG_DEADZONE || rightX < -ANALOG_DEADZONE)
+					rotationRoll += rightX / 4;
+			}
 
-		DMAChain *chain  = &dmaChains[usingSecondFrame];
-		usingSecondFrame = !usingSecondFrame;
+			/* D-pad controls yaw and pitch (works with both digital and analog) */
+			if (pad.buttons & PAD_LEFT)
+				rotationYaw -= ROTATION_SPEED;
+			if (pad.buttons & PAD_RIGHT)
+				rotationYaw += ROTATION_SPEED;
+			if (pad.buttons & PAD_UP)
+				rotationPitch -= ROTATION_SPEED;
+			if (pad.buttons & PAD_DOWN)
+				rotationPitch += ROTATION_SPEED;
+
+			/* L1/R1 control roll */
+			if (pad.buttons & PAD_L1)
+				rotationRoll -= ROTATION_SPEED;
+			if (pad.buttons & PAD_R1)
+				rotationRoll += ROTATION_SPEED;
+
+			/* L2/R2 move the lander away and back */
+			if ((pad.buttons & PAD_L2) && (landerDistance < LANDER_MAX_DISTANCE))
+				landerDistance += LANDER_ZOOM_SPEED;
+			if ((pad.buttons & PAD_R2) && (landerDistance > LANDER_MIN_DISTANCE))
+				landerDistance -= LANDER_ZOOM_SPEED;
+
+			/* Presses only register on the first tick, as prevButtons is
+			 * updated below. Frames running no ticks leave them for later. */
+
+			/* X button triggers SPU sound effect and flash (edge detection - only on press) */
+			if ((pad.buttons & PAD_X) && !(prevButtons & PAD_X)) {
+				/* Each press gets its own voice, so rapid presses overlap */
+				playSound(&soundBank, biteSound, 0x3FFF);
+				bgFlash = 255;  /* Trigger yellow flash */
+			}
 
-		uint32_t *ptr;
+			/* Circle toggles the streamed guitar loop */
+			if ((pad.buttons & PAD_CIRCLE) && !(prevButtons & PAD_CIRCLE)) {
+				if (isSPUStreamPlaying())
+					stopSPUStream();
+				else
+					startSPUStreamFromMemory(streamData, streamData_size, 22050, 0x2000, true);
+			}
 
-		GPU_GP1 = gp1_fbOffset(bufferX, bufferY);
+			if ((pad.buttons & PAD_SELECT) && !(prevButtons & PAD_SELECT))
+				useQuads = !useQuads;
 
-		clearOrderingTable(chain->orderingTable, ORDERING_TABLE_SIZE);
-		chain->nextPacket = chain->data;
+#ifdef ENABLE_PROFILER
+			if ((pad.buttons & PAD_START) && !(prevButtons & PAD_START))
+				profilerMode = (profilerMode + 1) % 3;
+#endif
 
-		/* Poll controller and update rotation */
-		ControllerState pad;
-		pollController(0, &pad);
-
-		/* Rotation speed (in fixed-point units per frame) */
-		const int ROTATION_SPEED = 32;
-		const int ANALOG_DEADZONE = 20;  /* Deadzone around center (0x80) */
-
-		/* Check for analog stick input first */
-		if (pad.isAnalog) {
-			/* Left stick controls yaw and pitch */
-			int stickX = (int)pad.leftX - 0x80;  /* -128 to +127 */
-			int stickY = (int)pad.leftY - 0x80;
-
-			/* Apply deadzone */
-			if (stickX > ANALOG_DEADZONE || stickX < -ANALOG_DEADZONE)
-				rotationYaw += stickX / 4;
-			if (stickY > ANALOG_DEADZONE || stickY < -ANALOG_DEADZONE)
-				rotationPitch += stickY / 4;
-
-			/* Right stick controls roll (X axis only) */
-			int rightX = (int)pad.rightX - 0x80;
-			if (rightX > ANALOG_DEADZONE || rightX < -ANALOG_DEADZONE)
-				rotationRoll += rightX / 4;
-		}
+			prevButtons = pad.buttons;
 
-		/* D-pad controls yaw and pitch (works with both digital and analog) */
-		if (pad.buttons & PAD_LEFT)
-			rotationYaw -= ROTATION_SPEED;
-		if (pad.buttons & PAD_RIGHT)
-			rotationYaw += ROTATION_SPEED;
-		if (pad.buttons & PAD_UP)
-			rotationPitch -= ROTATION_SPEED;
-		if (pad.buttons & PAD_DOWN)
-			rotationPitch += ROTATION_SPEED;
-
-		/* L1/R1 control roll */
-		if (pad.buttons & PAD_L1)
-			rotationRoll -= ROTATION_SPEED;
-		if (pad.buttons & PAD_R1)
-			rotationRoll += ROTATION_SPEED;
-
-		/* X button triggers SPU sound effect and flash (edge detection - only on press) */
-		if ((pad.buttons & PAD_X) && !(prevButtons & PAD_X)) {
-			if (spuSoundAddr != 0) {
-				playSample(0, spuSoundAddr, 22050, 0x3FFF);
+			/* Fade flash back to purple */
+			if (bgFlash > 0) {
+				bgFlash -= 12;
+				if (bgFlash < 0) bgFlash = 0;
 			}
-			bgFlash = 255;  /* Trigger yellow flash */
-		}
-		prevButtons = pad.buttons;
 
-		/* Fade flash back to purple */
-		if (bgFlash > 0) {
-			bgFlash -= 12;
-			if (bgFlash < 0) bgFlash = 0;
+			/* TRIANGLE fires the engine, exhaust leaves the nozzle below
+			 * the lander along its own down axis */
+			if (pad.buttons & PAD_TRIANGLE) {
+				const GTEMatrix *m = getCachedRotation(
+					&landerRotation, rotationYaw, rotationPitch, rotationRoll
+				);
+				const int16_t (*r)[3] = m->values;
+
+				int nozzle = model.bounds.radius / 2;
+				GTEVector16 origin = {
+					.x = (r[0][1] * nozzle) >> 12,
+					.y = (r[1][1] * nozzle) >> 12,
+					.z = ((r[2][1] * nozzle) >> 12) + landerDistance
+				};
+				GTEVector16 velocity = {
+					.x = (r[0][1] * EXHAUST_SPEED) >> 12,
+					.y = (r[1][1] * EXHAUST_SPEED) >> 12,
+					.z = (r[2][1] * EXHAUST_SPEED) >> 12
+				};
+
+				emitParticles(
+					&exhaust, &origin, &velocity, EXHAUST_SPREAD,
+					EXHAUST_PER_TICK, EXHAUST_LIFE
+				);
+			}
+
+			/* Update starfield, exhaust and shape animation */
+			updateScene();
 		}
 
-		/* Update starfield animation */
-		updateStarfield();
+		simTicks += ticks;
+
+		/* Send queued CD-ROM commands, drain sector reads and update CD-DA
+		 * looping */
+		updateCDROM();
+		updateCDRead();
 
-		/* Update CD-DA looping */
+		/* Return voices whose sample has finished to the allocator */
+		updateSPUVoices();
+		updateSPUStream();
 		updateCDDA();
+		PROFILE_END(PROFILE_SIMULATION);
 
-		/* Reset GTE translation vector and rotation matrix */
-		gte_setControlReg(GTE_TRX,    0);
-		gte_setControlReg(GTE_TRY,    0);
-		gte_setControlReg(GTE_TRZ, 300);  /* Distance from camera (closer = larger) */
-		gte_setRotationMatrix(
-			ONE,   0,   0,
-			0, ONE,   0,
-			0,   0, ONE
-		);
+#ifndef LANDER_BENCH
+		/* Behind schedule: run the next batch of ticks straight away rather
+		 * than drawing a frame that is already late */
+		if (!shouldRenderFrame(&timestep))
+			continue;
+#endif
 
-		/* Rotate the model based on player input */
-		rotateCurrentMatrix(rotationYaw, rotationPitch, rotationRoll);
+		int bufferX = usingSecondFrame ? SCREEN_WIDTH : 0;
+		int bufferY = 0;
 
-		/* Draw model faces */
-		for (int i = 0; i < model.numFaces; i++) {
-			const Face *face = &model.faces[i];
+		int      bufferIndex = usingSecondFrame;
+		DMAChain *chain      = &dmaChains[bufferIndex];
+		Backdrop *backdrop   = &backdrops[bufferIndex];
+		TextLine *hud        = hudLines[bufferIndex];
+		usingSecondFrame     = !usingSecondFrame;
 
-			/* Load vertices into GTE */
-			gte_loadV0(&model.vertices[face->v0]);
-			gte_loadV1(&model.vertices[face->v1]);
-			gte_loadV2(&model.vertices[face->v2]);
+		PROFILE_BEGIN(PROFILE_OT_CLEAR);
+		beginChain(chain);
+		PROFILE_END(PROFILE_OT_CLEAR);
 
-			/* Perspective transformation (3 vertices) */
-			gte_command(GTE_CMD_RTPT | GTE_SF);
+		/* Drop last frame's scratchpad temporaries */
+		scratchpadResetFrame();
 
-			/* Normal clipping for backface culling */
-			gte_command(GTE_CMD_NCLIP);
+		/* Interpolate constant motion by the part of a tick not simulated
+		 * yet, benchmarks draw exactly the simulated state */
+#ifdef LANDER_BENCH
+		int alpha = 0;
+#else
+		int alpha = getTimestepAlpha(&timestep);
+#endif
 
-			/* Get clipping result */
-			int nclip = gte_getDataReg(GTE_MAC0);
-			if (nclip <= 0)
-			continue;  /* Face is backfacing, skip it */
+		PROFILE_BEGIN(PROFILE_MODEL);
+		/* Reset GTE translation vector and rotation matrix */
+		gte_setControlReg(GTE_TRX,    0);
+		gte_setControlReg(GTE_TRY,    0);
+		gte_setControlReg(GTE_TRZ, landerDistance);  /* Distance from camera (closer = larger) */
 
-			/* Calculate average Z for depth sorting */
-			gte_command(GTE_CMD_AVSZ3 | GTE_SF);
-			int zIndex = gte_getDataReg(GTE_OTZ);
+		/* Rotate the model based on player input, the matrix is only rebuilt
+		 * on frames where the angles actually changed */
+		const GTEMatrix *landerMatrix = getCachedRotation(
+			&landerRotation, rotationYaw, rotationPitch, rotationRoll
+		);
 
-			if ((zIndex < 0) || (zIndex >= ORDERING_TABLE_SIZE))
-			continue;
+		gte_loadRotationMatrix(landerMatrix);
+		setLightRotation(landerMatrix);
+
+		/* Draw model faces, projecting each shared vertex only once */
+		MeshStats meshStats;
+		resetMeshStats(&meshStats);
+		int landerLevel = drawMeshLOD(
+			chain,
+			useQuads ? &landerLOD : &landerTriLOD,
+			&texture,
+			&viewFrustum,
+			OT_LAYER_WORLD,
+			&meshStats
+		);
+		PROFILE_END(PROFILE_MODEL);
 
-			/* Get UV coordinates for this face */
-			const UV *uv0 = &model.uvs[face->uv0];
-			const UV *uv1 = &model.uvs[face->uv1];
-			const UV *uv2 = &model.uvs[face->uv2];
-
-			/* Allocate packet for textured triangle (7 words) */
-			ptr    = allocatePacket(chain, zIndex, 7);
-			ptr[0] = gp0_rgb(128, 128, 128) | gp0_shadedTriangle(false, true, false);
-			gte_storeDataReg(GTE_SXY0, 1 * 4, ptr);  /* XY0 */
-			ptr[2] = gp0_uv(uv0->u, uv0->v, texture.clut);  /* UV0 + CLUT */
-			gte_storeDataReg(GTE_SXY1, 3 * 4, ptr);  /* XY1 */
-			ptr[4] = gp0_uv(uv1->u, uv1->v, texture.page);  /* UV1 + TPAGE */
-			gte_storeDataReg(GTE_SXY2, 5 * 4, ptr);  /* XY2 */
-			ptr[6] = gp0_uv(uv2->u, uv2->v, 0);            /* UV2 */
+		/* Draw 3D shapes in background */
+		/* Shapes should appear BEHIND the main model */
+		/* The far layer is drawn before the world layer, and sorts the shapes
+		 * among themselves by depth. Shapes still off-screen after spawning
+		 * are rejected by their bounding spheres. */
+		PROFILE_BEGIN(PROFILE_SHAPES);
+		for (int s = 0; s < numActiveShapes; s++) {
+			MeshInstance *inst = &shapeInstances[s];
+			*inst    = shapes[s].instance;
+			inst->x -= (shapes[s].moveSpeed * alpha) >> 12;
+
+			if (!useQuads)
+				inst->lod = &shapeTriLODs[shapes[s].type];
 		}
 
+		drawMeshInstances(
+			chain,
+			shapeInstances,
+			numActiveShapes,
+			&viewFrustum,
+			OT_LAYER_FAR,
+			&meshStats
+		);
+
+		/* Exhaust particles sort among the lander's faces */
+		drawParticles(&exhaust, chain, OT_LAYER_WORLD, alpha);
+		PROFILE_END(PROFILE_SHAPES);
+
 		/* ========================================
 		 * Controller HUD - Text display
 		 * Note: Don't add bufferX/bufferY - fbOrigin handles buffer offset
 		 * ======================================== */
+		PROFILE_BEGIN(PROFILE_HUD);
 		{
-			char hudText[128];
+			ScratchpadMark hudMark = scratchpadMark();
+			char           *hudText = scratchpadAlloc(HUD_TEXT_SIZE);
+			char           *p;
+			int            rebuilds = 0;
 
 			/* Mode indicator */
-			if (pad.isAnalog) {
-				printString(chain, &font, 8, 8, "ANALOG");
-			} else {
-				printString(chain, &font, 8, 8, "DIGITAL");
-			}
+			rebuilds += printTextLine(
+				chain, &hud[HUD_MODE], &font, pad.isAnalog ? "ANALOG" : "DIGITAL"
+			);
 
 			/* D-pad direction */
 			const char *dpadDir = "-";
@@ -714,254 +1047,163 @@ int main(int argc, const char **argv) {
 			else if (pad.buttons & PAD_LEFT)  dpadDir = "LEFT";
 			else if (pad.buttons & PAD_RIGHT) dpadDir = "RIGHT";
 
-			sprintf(hudText, "DPAD: %s", dpadDir);
-			printString(chain, &font, 8, 20, hudText);
+			p = appendString(hudText, "DPAD: ");
+			p = appendString(p, dpadDir);
+			rebuilds += printTextLine(chain, &hud[HUD_DPAD], &font, hudText);
 
 			/* Face buttons display */
-			sprintf(hudText, "BTN: %s%s%s%s",
-				(pad.buttons & PAD_X) ? "X " : "",
-				(pad.buttons & PAD_CIRCLE) ? "O " : "",
-				(pad.buttons & PAD_SQUARE) ? "[] " : "",
-				(pad.buttons & PAD_TRIANGLE) ? "/\\ " : "");
-			printString(chain, &font, 8, 32, hudText);
+			p = appendString(hudText, "BTN: ");
+			if (pad.buttons & PAD_X)        p = appendString(p, "X ");
+			if (pad.buttons & PAD_CIRCLE)   p = appendString(p, "O ");
+			if (pad.buttons & PAD_SQUARE)   p = appendString(p, "[] ");
+			if (pad.buttons & PAD_TRIANGLE) p = appendString(p, "/\\ ");
+			p = appendString(p, "VOX=");
+			p = appendInt(p, getActiveVoices(), 0);
+			rebuilds += printTextLine(chain, &hud[HUD_BUTTONS], &font, hudText);
 
 			/* Shoulder buttons */
-			sprintf(hudText, "SH: %s%s%s%s",
-				(pad.buttons & PAD_L1) ? "L1 " : "",
-				(pad.buttons & PAD_R1) ? "R1 " : "",
-				(pad.buttons & PAD_L2) ? "L2 " : "",
-				(pad.buttons & PAD_R2) ? "R2 " : "");
-			printString(chain, &font, 8, 44, hudText);
+			p = appendString(hudText, "SH: ");
+			if (pad.buttons & PAD_L1) p = appendString(p, "L1 ");
+			if (pad.buttons & PAD_R1) p = appendString(p, "R1 ");
+			if (pad.buttons & PAD_L2) p = appendString(p, "L2 ");
+			if (pad.buttons & PAD_R2) p = appendString(p, "R2 ");
+			rebuilds += printTextLine(chain, &hud[HUD_SHOULDERS], &font, hudText);
 
 			/* Left analog stick values */
-			sprintf(hudText, "L: X=%3d Y=%3d", pad.leftX, pad.leftY);
-			printString(chain, &font, 8, SCREEN_HEIGHT - 30, hudText);
+			p = appendString(hudText, "L: X=");
+			p = appendInt(p, pad.leftX, 3);
+			p = appendString(p, " Y=");
+			p = appendInt(p, pad.leftY, 3);
+			rebuilds += printTextLine(chain, &hud[HUD_LEFT_STICK], &font, hudText);
 
 			/* Right analog stick values */
-			sprintf(hudText, "R: X=%3d Y=%3d", pad.rightX, pad.rightY);
-			printString(chain, &font, 8, SCREEN_HEIGHT - 18, hudText);
+			p = appendString(hudText, "R: X=");
+			p = appendInt(p, pad.rightX, 3);
+			p = appendString(p, " Y=");
+			p = appendInt(p, pad.rightY, 3);
+			rebuilds += printTextLine(chain, &hud[HUD_RIGHT_STICK], &font, hudText);
+
+			/* Time the previous frame spent blocked in presentFrame() */
+			p = appendString(hudText, "WAIT: D=");
+			p = appendInt(p, presenter.timings.dmaWait, 0);
+			p = appendString(p, " G=");
+			p = appendInt(p, presenter.timings.drawWait, 0);
+			p = appendString(p, " V=");
+			p = appendInt(p, presenter.timings.vsyncWait, 0);
+			p = appendString(p, " T=");
+			p = appendInt(p, simTicks, 0);
+			rebuilds += printTextLine(chain, &hud[HUD_WAIT], &font, hudText);
+
+			/* Mesh renderer counters for this frame, Q(uads) or T(riangles) */
+			p = appendString(hudText, useQuads ? "MESH Q: V=" : "MESH T: V=");
+			p = appendInt(p, meshStats.verticesTransformed, 0);
+			p = appendString(p, " C=");
+			p = appendInt(p, meshStats.facesCulled, 0);
+			p = appendString(p, " E=");
+			p = appendInt(p, meshStats.facesEmitted, 0);
+			p = appendString(p, " W=");
+			p = appendInt(p, meshStats.packetWords, 0);
+			rebuilds += printTextLine(chain, &hud[HUD_MESH], &font, hudText);
+
+			/* Peak scratchpad usage so far (0 in release builds), and HUD
+			 * lines rebuilt last frame */
+			p = appendString(hudText, "SPAD: ");
+			p = appendInt(p, scratchpadGetHighWater(), 0);
+			p = appendString(p, "/");
+			p = appendInt(p, SCRATCHPAD_SIZE, 0);
+			p = appendString(p, " TXT=");
+			p = appendInt(p, hudRebuilds, 0);
+			rebuilds += printTextLine(chain, &hud[HUD_SCRATCHPAD], &font, hudText);
+
+			/* Packet arena usage of the last submitted frame */
+			p = appendString(hudText, "PKT: ");
+			p = appendInt(p, presenter.chainStats.wordsUsed, 0);
+			p = appendString(p, "/");
+			p = appendInt(p, presenter.chainStats.capacity, 0);
+			p = appendString(p, " HI=");
+			p = appendInt(p, presenter.chainStats.highWater, 0);
+			p = appendString(p, " DROP=");
+			p = appendInt(p, presenter.chainStats.packetsDropped, 0);
+			rebuilds += printTextLine(chain, &hud[HUD_PACKETS], &font, hudText);
+
+			/* Lander distance and level of detail (-1 = sprite), objects
+			 * culled by their bounding spheres and sprites drawn */
+			p = appendString(hudText, "LOD: Z=");
+			p = appendInt(p, landerDistance, 0);
+			p = appendString(p, " L=");
+			p = appendInt(p, landerLevel, 0);
+			p = appendString(p, " C=");
+			p = appendInt(p, meshStats.objectsCulled, 0);
+			p = appendString(p, " S=");
+			p = appendInt(p, meshStats.spritesDrawn, 0);
+			rebuilds += printTextLine(chain, &hud[HUD_LOD], &font, hudText);
+
+			hudRebuilds = rebuilds;
+			simTicks    = 0;
+			scratchpadRelease(hudMark);
 		}
 
-		/* Calculate gradient colors based on flash state */
-		/* Top: deep purple, Bottom: dark blue/black */
-		/* Flash shifts toward yellow/orange */
-		int topR = 60 + ((255 - 60) * bgFlash) / 255;
-		int topG = 20 + ((220 - 20) * bgFlash) / 255;
-		int topB = 90 + ((80 - 90) * bgFlash) / 255;
-		int botR = 15 + ((180 - 15) * bgFlash) / 255;
-		int botG = 5 + ((100 - 5) * bgFlash) / 255;
-		int botB = 35 + ((40 - 35) * bgFlash) / 255;
-
-		/* Draw gradient background as two Gouraud-shaded triangles (quad) */
-		/* This creates a smooth vertical gradient with PSX hardware dithering */
-		/* First triangle: top-left, top-right, bottom-right */
-		ptr = allocatePacket(chain, ORDERING_TABLE_SIZE - 1, 6);
-		ptr[0] = gp0_rgb(topR, topG, topB) | gp0_shadedTriangle(true, false, false);
-		ptr[1] = gp0_xy(0, 0);                    /* Top-left */
-		ptr[2] = gp0_rgb(topR, topG, topB);
-		ptr[3] = gp0_xy(SCREEN_WIDTH, 0);         /* Top-right */
-		ptr[4] = gp0_rgb(botR, botG, botB);
-		ptr[5] = gp0_xy(SCREEN_WIDTH, SCREEN_HEIGHT); /* Bottom-right */
-
-		/* Second triangle: top-left, bottom-right, bottom-left */
-		ptr = allocatePacket(chain, ORDERING_TABLE_SIZE - 1, 6);
-		ptr[0] = gp0_rgb(topR, topG, topB) | gp0_shadedTriangle(true, false, false);
-		ptr[1] = gp0_xy(0, 0);                    /* Top-left */
-		ptr[2] = gp0_rgb(botR, botG, botB);
-		ptr[3] = gp0_xy(SCREEN_WIDTH, SCREEN_HEIGHT); /* Bottom-right */
-		ptr[4] = gp0_rgb(botR, botG, botB);
-		ptr[5] = gp0_xy(0, SCREEN_HEIGHT);        /* Bottom-left */
-
-		/* Draw stars as flat shaded rectangles (right to left scrolling) */
-		for (int i = 0; i < NUM_STARS; i++) {
-			if (stars[i].x < 0 || stars[i].x >= SCREEN_WIDTH ||
-			    stars[i].y < 0 || stars[i].y >= SCREEN_HEIGHT)
-				continue;
-			ptr = allocatePacket(chain, ORDERING_TABLE_SIZE - 2, 3);
-			ptr[0] = gp0_rgb(stars[i].brightness, stars[i].brightness, stars[i].brightness) | gp0_rectangle(false, false, false);
-			ptr[1] = gp0_xy(stars[i].x, stars[i].y);
-			ptr[2] = gp0_xy(stars[i].size, stars[i].size);
-		}
+#ifdef ENABLE_PROFILER
+		/* Per-section timings of the last window, right of the HUD */
+		if (profilerMode)
+			drawProfiler(chain, &font, SCREEN_WIDTH - 112, 8);
+#endif
+		PROFILE_END(PROFILE_HUD);
+
+		/* Relink the starfield and the retained backdrop behind everything
+		 * else, the backdrop is linked last so it's drawn first */
+		drawStarfield(&starfield, chain, bufferIndex, OT_LAYER_BACKGROUND, alpha);
+		updateBackdrop(backdrop, bgFlash);
+		linkRetainedBlock(chain, &backdrop->block, OT_LAYER_BACKGROUND, 0);
+
+		/* Hand the list to the GPU and go straight back to building the next
+		 * frame; only the previous frame's DMA and the vblank flip block here */
+#ifdef LANDER_BENCH
+		endBenchFrame(&benchResults);
+#endif
+		presentFrame(&presenter, chain, bufferX, bufferY);
+
+#ifdef LANDER_BENCH
+		uint32_t vsync = getVSyncCount();
+
+		recordBenchFrame(
+			&benchResults,
+			presenter.chainStats.wordsUsed,
+			presenter.timings.dmaWait,
+			presenter.chainStats.packetsDropped,
+			vsync - benchVSync
+		);
+		benchVSync = vsync;
 
-		/* Draw 3D shapes in background */
-		/* Shapes should appear BEHIND the main model (which is at z=300) */
-		/* We use ordering table indices: higher = drawn first (further back) */
-		for (int s = 0; s < NUM_SHAPES; s++) {
-			Shape3D *sh = &shapes[s];
-
-			/* Only cull if completely behind camera */
-			if (sh->z < 50) continue;
-
-			/* Set up GTE for this shape */
-			gte_setControlReg(GTE_TRX, sh->x);
-			gte_setControlReg(GTE_TRY, sh->y);
-			gte_setControlReg(GTE_TRZ, sh->z);
-			gte_setRotationMatrix(ONE, 0, 0, 0, ONE, 0, 0, 0, ONE);
-			rotateCurrentMatrix(sh->rotY, sh->rotX, sh->rotZ);
-
-			int sz = 20;  /* Shape size */
-			GTEVector16 v[8];  /* Vertex buffer */
-
-			if (sh->type == SHAPE_CUBE) {
-				/* Cube vertices */
-				v[0] = (GTEVector16){-sz, -sz, -sz};  /* Back bottom left */
-				v[1] = (GTEVector16){ sz, -sz, -sz};  /* Back bottom right */
-				v[2] = (GTEVector16){ sz,  sz, -sz};  /* Back top right */
-				v[3] = (GTEVector16){-sz,  sz, -sz};  /* Back top left */
-				v[4] = (GTEVector16){-sz, -sz,  sz};  /* Front bottom left */
-				v[5] = (GTEVector16){ sz, -sz,  sz};  /* Front bottom right */
-				v[6] = (GTEVector16){ sz,  sz,  sz};  /* Front top right */
-				v[7] = (GTEVector16){-sz,  sz,  sz};  /* Front top left */
-
-				/* 6 faces, 2 triangles each - different brightness per face */
-				int faces[6][4] = {
-					{4, 5, 6, 7},  /* Front */
-					{1, 0, 3, 2},  /* Back */
-					{0, 4, 7, 3},  /* Left */
-					{5, 1, 2, 6},  /* Right */
-					{7, 6, 2, 3},  /* Top */
-					{0, 1, 5, 4},  /* Bottom */
-				};
-				int bright[6] = {100, 60, 80, 80, 100, 50};
-
-				for (int f = 0; f < 6; f++) {
-					int br = bright[f];
-					uint8_t fr = (sh->r * br) / 100;
-					uint8_t fg = (sh->g * br) / 100;
-					uint8_t fb = (sh->b * br) / 100;
-
-					/* First triangle of quad */
-					gte_loadV0(&v[faces[f][0]]);
-					gte_loadV1(&v[faces[f][1]]);
-					gte_loadV2(&v[faces[f][2]]);
-					gte_command(GTE_CMD_RTPT | GTE_SF);
-					gte_command(GTE_CMD_NCLIP);
-					if (gte_getDataReg(GTE_MAC0) > 0) {
-						gte_command(GTE_CMD_AVSZ3 | GTE_SF);
-						int zIdx = gte_getDataReg(GTE_OTZ);
-						drawBgTriangle(chain, fr, fg, fb, zIdx);
-					}
-
-					/* Second triangle of quad */
-					gte_loadV0(&v[faces[f][0]]);
-					gte_loadV1(&v[faces[f][2]]);
-					gte_loadV2(&v[faces[f][3]]);
-					gte_command(GTE_CMD_RTPT | GTE_SF);
-					gte_command(GTE_CMD_NCLIP);
-					if (gte_getDataReg(GTE_MAC0) > 0) {
-						gte_command(GTE_CMD_AVSZ3 | GTE_SF);
-						int zIdx = gte_getDataReg(GTE_OTZ);
-						drawBgTriangle(chain, fr, fg, fb, zIdx);
-					}
-				}
-			}
-			else if (sh->type == SHAPE_PYRAMID) {
-				/* Pyramid: apex at top, square base */
-				GTEVector16 apex = {0, -sz, 0};
-				v[0] = (GTEVector16){-sz, sz, -sz};  /* Base back left */
-				v[1] = (GTEVector16){ sz, sz, -sz};  /* Base back right */
-				v[2] = (GTEVector16){ sz, sz,  sz};  /* Base front right */
-				v[3] = (GTEVector16){-sz, sz,  sz};  /* Base front left */
-
-				/* 4 side faces */
-				int sideFaces[4][2] = {{3, 2}, {2, 1}, {1, 0}, {0, 3}};
-				int sideBright[4] = {100, 80, 60, 80};
-
-				for (int f = 0; f < 4; f++) {
-					int br = sideBright[f];
-					uint8_t fr = (sh->r * br) / 100;
-					uint8_t fg = (sh->g * br) / 100;
-					uint8_t fb = (sh->b * br) / 100;
-
-					gte_loadV0(&apex);
-					gte_loadV1(&v[sideFaces[f][0]]);
-					gte_loadV2(&v[sideFaces[f][1]]);
-					gte_command(GTE_CMD_RTPT | GTE_SF);
-					gte_command(GTE_CMD_NCLIP);
-					if (gte_getDataReg(GTE_MAC0) > 0) {
-						gte_command(GTE_CMD_AVSZ3 | GTE_SF);
-						int zIdx = gte_getDataReg(GTE_OTZ);
-						drawBgTriangle(chain, fr, fg, fb, zIdx);
-					}
-				}
-
-				/* Base (2 triangles) */
-				uint8_t baseBr = (sh->r * 40) / 100;
-				uint8_t baseBg = (sh->g * 40) / 100;
-				uint8_t baseBb = (sh->b * 40) / 100;
-
-				gte_loadV0(&v[0]);
-				gte_loadV1(&v[1]);
-				gte_loadV2(&v[2]);
-				gte_command(GTE_CMD_RTPT | GTE_SF);
-				gte_command(GTE_CMD_NCLIP);
-				if (gte_getDataReg(GTE_MAC0) > 0) {
-					gte_command(GTE_CMD_AVSZ3 | GTE_SF);
-					drawBgTriangle(chain, baseBr, baseBg, baseBb, gte_getDataReg(GTE_OTZ));
-				}
-
-				gte_loadV0(&v[0]);
-				gte_loadV1(&v[2]);
-				gte_loadV2(&v[3]);
-				gte_command(GTE_CMD_RTPT | GTE_SF);
-				gte_command(GTE_CMD_NCLIP);
-				if (gte_getDataReg(GTE_MAC0) > 0) {
-					gte_command(GTE_CMD_AVSZ3 | GTE_SF);
-					drawBgTriangle(chain, baseBr, baseBg, baseBb, gte_getDataReg(GTE_OTZ));
-				}
-			}
-			else { /* SHAPE_SPHERE - Octahedron (8 faces) */
-				/* 6 vertices: top, bottom, front, back, left, right */
-				GTEVector16 top   = {0, -sz, 0};
-				GTEVector16 bot   = {0,  sz, 0};
-				GTEVector16 front = {0, 0,  sz};
-				GTEVector16 back  = {0, 0, -sz};
-				GTEVector16 left  = {-sz, 0, 0};
-				GTEVector16 right = { sz, 0, 0};
-
-				/* 8 triangular faces */
-				GTEVector16 *octaFaces[8][3] = {
-					{&top, &front, &right}, {&top, &right, &back},
-					{&top, &back, &left},   {&top, &left, &front},
-					{&bot, &right, &front}, {&bot, &back, &right},
-					{&bot, &left, &back},   {&bot, &front, &left},
-				};
-				int octaBright[8] = {100, 80, 60, 80, 90, 70, 50, 70};
-
-				for (int f = 0; f < 8; f++) {
-					int br = octaBright[f];
-					uint8_t fr = (sh->r * br) / 100;
-					uint8_t fg = (sh->g * br) / 100;
-					uint8_t fb = (sh->b * br) / 100;
-
-					gte_loadV0(octaFaces[f][0]);
-					gte_loadV1(octaFaces[f][1]);
-					gte_loadV2(octaFaces[f][2]);
-					gte_command(GTE_CMD_RTPT | GTE_SF);
-					gte_command(GTE_CMD_NCLIP);
-					if (gte_getDataReg(GTE_MAC0) > 0) {
-						gte_command(GTE_CMD_AVSZ3 | GTE_SF);
-						int zIdx = gte_getDataReg(GTE_OTZ);
-						drawBgTriangle(chain, fr, fg, fb, zIdx);
-					}
-				}
+		if (++benchFrame >= bench->numFrames) {
+			printBenchResults(bench, &benchResults);
+
+			bench      = getBenchScenario(++benchIndex);
+			benchFrame = 0;
+
+			if (!bench) {
+				puts("BENCH END");
+#ifdef LANDER_HOST
+				return 0;
+#endif
+				for (;;)
+					__asm__ volatile("");
 			}
 		}
-
-		/* Set drawing area attributes */
-		ptr    = allocatePacket(chain, ORDERING_TABLE_SIZE - 1, 4);
-		ptr[0] = gp0_texpage(0, true, false);
-		ptr[1] = gp0_fbOffset1(bufferX, bufferY);
-		ptr[2] = gp0_fbOffset2(
-			bufferX + SCREEN_WIDTH  - 1,
-			bufferY + SCREEN_HEIGHT - 2
+#endif
+
+#ifdef ENABLE_PROFILER
+		/* Published with the timings for the web harness's graphs */
+		profileCount(PROFILE_COUNT_PACKET_WORDS, presenter.chainStats.wordsUsed);
+		profileCount(
+			PROFILE_COUNT_SPU_RAM_USED,
+			(SPU_RAM_END - SPU_RAM_START) - getSPURAMFree()
 		);
-		ptr[3] = gp0_fbOrigin(bufferX, bufferY);
+		profileCount(PROFILE_COUNT_CD_QUEUE, getCDROMQueueLength());
 
-		/* Wait for GPU and VSync, then draw */
-		waitForGP0Ready();
-		waitForVSync();
-		sendLinkedList(&(chain->orderingTable)[ORDERING_TABLE_SIZE - 1]);
+		if (profileEndFrame() && (profilerMode == 2))
+			dumpProfiler();
+#endif
 	}
 
 	return 0;
@@ -0,0 +1,169 @@
+/*
+ * Rotation matrix and quaternion helpers for the GTE
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "matrix.h"
+#include "ps1/gte.h"
+#include "scratchpad.h"
+#include "trig.h"
+
+/* GTE matrices use 4.12 fixed-point */
+#define ONE (1 << 12)
+
+SCRATCHPAD_STATIC_ASSERT(sizeof(GTEMatrix), "Rotation matrix temporary");
+
+/* Matrix multiplication helper */
+static void multiplyCurrentMatrixByVectors(GTEMatrix *output) {
+	gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_V0 | GTE_CV_NONE);
+	output->values[0][0] = gte_getDataReg(GTE_IR1);
+	output->values[1][0] = gte_getDataReg(GTE_IR2);
+	output->values[2][0] = gte_getDataReg(GTE_IR3);
+
+	gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_V1 | GTE_CV_NONE);
+	output->values[0][1] = gte_getDataReg(GTE_IR1);
+	output->values[1][1] = gte_getDataReg(GTE_IR2);
+	output->values[2][1] = gte_getDataReg(GTE_IR3);
+
+	gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_V2 | GTE_CV_NONE);
+	output->values[0][2] = gte_getDataReg(GTE_IR1);
+	output->values[1][2] = gte_getDataReg(GTE_IR2);
+	output->values[2][2] = gte_getDataReg(GTE_IR3);
+}
+
+void buildRotationMatrix(GTEMatrix *output, int yaw, int pitch, int roll) {
+	int sy = isin(yaw),   cy = icos(yaw);
+	int sp = isin(pitch), cp = icos(pitch);
+	int sr = isin(roll),  cr = icos(roll);
+
+	/* Shared products of the yaw and pitch terms */
+	int cysp = (cy * sp) >> 12;
+	int sysp = (sy * sp) >> 12;
+
+	output->values[0][0] = (cy * cp) >> 12;
+	output->values[1][0] = (sy * cp) >> 12;
+	output->values[2][0] = -sp;
+
+	output->values[0][1] = ((cysp * sr) - (sy * cr)) >> 12;
+	output->values[1][1] = ((sysp * sr) + (cy * cr)) >> 12;
+	output->values[2][1] = (cp * sr) >> 12;
+
+	output->values[0][2] = ((cysp * cr) + (sy * sr)) >> 12;
+	output->values[1][2] = ((sysp * cr) - (cy * sr)) >> 12;
+	output->values[2][2] = (cp * cr) >> 12;
+}
+
+/* Rotate the current GTE matrix */
+void rotateCurrentMatrix(int yaw, int pitch, int roll) {
+	ScratchpadMark mark     = scratchpadMark();
+	GTEMatrix      *rotated = scratchpadAlloc(sizeof(GTEMatrix));
+
+	/* Build the combined rotation on the CPU, then apply it with a single
+	 * matrix multiply instead of one per axis */
+	buildRotationMatrix(rotated, yaw, pitch, roll);
+
+	const int16_t (*m)[3] = rotated->values;
+
+	gte_setColumnVectors(
+		m[0][0], m[0][1], m[0][2],
+		m[1][0], m[1][1], m[1][2],
+		m[2][0], m[2][1], m[2][2]
+	);
+	multiplyCurrentMatrixByVectors(rotated);
+	gte_loadRotationMatrix(rotated);
+
+	scratchpadRelease(mark);
+}
+
+void resetRotationCache(RotationCache *cache) {
+	cache->valid = false;
+}
+
+const GTEMatrix *getCachedRotation(
+	RotationCache *cache,
+	int           yaw,
+	int           pitch,
+	int           roll
+) {
+	if (
+		!cache->valid ||
+		(cache->yaw != yaw) || (cache->pitch != pitch) || (cache->roll != roll)
+	) {
+		buildRotationMatrix(&cache->matrix, yaw, pitch, roll);
+
+		cache->yaw   = yaw;
+		cache->pitch = pitch;
+		cache->roll  = roll;
+		cache->valid = true;
+	}
+
+	return &cache->matrix;
+}
+
+/* The input is always close to unit length, so one Newton step of
+ * 1 / sqrt(n) ~= (3 - n) / 2 renormalizes it without a square root */
+static void normalizeQuat(Quaternion *output, int w, int x, int y, int z) {
+	int n     = ((w * w) + (x * x) + (y * y) + (z * z)) >> 12;
+	int scale = ((3 * ONE) - n) / 2;
+
+	output->w = (w * scale) >> 12;
+	output->x = (x * scale) >> 12;
+	output->y = (y * scale) >> 12;
+	output->z = (z * scale) >> 12;
+}
+
+void quatRotate(Quaternion *q, const Quaternion *step) {
+	int aw = q->w,    ax = q->x,    ay = q->y,    az = q->z;
+	int bw = step->w, bx = step->x, by = step->y, bz = step->z;
+
+	int w = ((aw * bw) - (ax * bx) - (ay * by) - (az * bz)) >> 12;
+	int x = ((aw * bx) + (ax * bw) + (ay * bz) - (az * by)) >> 12;
+	int y = ((aw * by) - (ax * bz) + (ay * bw) + (az * bx)) >> 12;
+	int z = ((aw * bz) + (ax * by) - (ay * bx) + (az * bw)) >> 12;
+
+	normalizeQuat(q, w, x, y, z);
+}
+
+void quatFromEuler(Quaternion *output, int yaw, int pitch, int roll) {
+	/* Quaternions are built from half angles */
+	int sy = isin(yaw   / 2), cy = icos(yaw   / 2);
+	int sp = isin(pitch / 2), cp = icos(pitch / 2);
+	int sr = isin(roll  / 2), cr = icos(roll  / 2);
+
+	int cycp = (cy * cp) >> 12;
+	int sysp = (sy * sp) >> 12;
+	int cysp = (cy * sp) >> 12;
+	int sycp = (sy * cp) >> 12;
+
+	// The table entries are rounded to 12 bits, so the product can still end
+	// up slightly off unit length.
+	normalizeQuat(
+		output,
+		((cycp * cr) + (sysp * sr)) >> 12,
+		((cycp * sr) - (sysp * cr)) >> 12,
+		((cysp * cr) + (sycp * sr)) >> 12,
+		((sycp * cr) - (cysp * sr)) >> 12
+	);
+}
+
+void quatToMatrix(GTEMatrix *output, const Quaternion *q) {
+	int w = q->w, x = q->x, y = q->y, z = q->z;
+
+	/* Doubled products, shifted by 11 rather than 12 */
+	int xx = (x * x) >> 11, yy = (y * y) >> 11, zz = (z * z) >> 11;
+	int xy = (x * y) >> 11, xz = (x * z) >> 11, yz = (y * z) >> 11;
+	int wx = (w * x) >> 11, wy = (w * y) >> 11, wz = (w * z) >> 11;
+
+	output->values[0][0] = ONE - (yy + zz);
+	output->values[0][1] = xy - wz;
+	output->values[0][2] = xz + wy;
+
+	output->values[1][0] = xy + wz;
+	output->values[1][1] = ONE - (xx + zz);
+	output->values[1][2] = yz - wx;
+
+	output->values[2][0] = xz - wy;
+	output->values[2][1] = yz + wx;
+	output->values[2][2] = ONE - (xx + yy);
+}
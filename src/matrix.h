@@ -0,0 +1,64 @@
+/*
+ * Rotation matrix and quaternion helpers for the GTE
+ *
+ * Builds rotation matrices on the CPU from isin()/icos() so objects don't need
+ * a chain of GTE multiplies each, caches matrices whose angles didn't change
+ * and steps free-tumbling objects with quaternions instead of Euler angles.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ps1/gte.h"
+
+/* Rotation matrix for the given Euler angles, reused while they stay the same */
+typedef struct {
+	GTEMatrix matrix;
+	int       yaw, pitch, roll;
+	bool      valid;
+} RotationCache;
+
+/* Unit quaternion in 4.12 fixed-point, for incrementally rotated objects */
+typedef struct {
+	int16_t w, x, y, z;
+} Quaternion;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Build yaw * pitch * roll directly from the six sines and cosines, without
+ * going through the GTE. Angles use the isin() range (4096 = full turn).
+ */
+void buildRotationMatrix(GTEMatrix *output, int yaw, int pitch, int roll);
+
+/* Multiply the GTE rotation matrix by yaw, pitch and roll rotations in turn */
+void rotateCurrentMatrix(int yaw, int pitch, int roll);
+
+/* Invalidate a cache so the next lookup rebuilds its matrix */
+void resetRotationCache(RotationCache *cache);
+
+/* Return the cached matrix, rebuilding it only if any angle changed */
+const GTEMatrix *getCachedRotation(
+	RotationCache *cache,
+	int           yaw,
+	int           pitch,
+	int           roll
+);
+
+/* Quaternion equivalent of buildRotationMatrix()'s yaw * pitch * roll */
+void quatFromEuler(Quaternion *output, int yaw, int pitch, int roll);
+
+/*
+ * Apply a per-frame rotation step to an orientation (q = q * step) and
+ * renormalize it, so fixed-point drift can't build up over time.
+ */
+void quatRotate(Quaternion *q, const Quaternion *step);
+
+void quatToMatrix(GTEMatrix *output, const Quaternion *q);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,649 @@
+/*
+ * Indexed mesh renderer for PS1 bare-metal
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "mesh.h"
+#include "gpu.h"
+#include "light.h"
+#include "lod.h"
+#include "model.h"
+#include "ps1/gpucmd.h"
+#include "ps1/gte.h"
+#include "scratchpad.h"
+
+/* Size of one projected vertex cache entry: packed screen XY and screen Z.
+ * Lit colors are kept separately, one word per normal rather than vertex. */
+#define MESH_CACHE_ENTRY_SIZE (sizeof(uint32_t) + sizeof(uint16_t))
+
+/* Lit vertices start out as the neutral texture color, so a fully lit face
+ * looks like it does unlit */
+#define MESH_BASE_COLOR gp0_rgb(128, 128, 128)
+
+/* Main RAM fallback for meshes whose cache doesn't fit in the scratchpad */
+static uint32_t meshSXYBuffer[MESH_MAX_VERTICES];
+static uint32_t meshRGBBuffer[MESH_MAX_NORMALS];
+static uint16_t meshSZBuffer [MESH_MAX_VERTICES];
+
+void resetMeshStats(MeshStats *stats) {
+	stats->verticesTransformed = 0;
+	stats->facesCulled         = 0;
+	stats->facesEmitted        = 0;
+	stats->packetWords         = 0;
+	stats->objectsCulled       = 0;
+	stats->spritesDrawn        = 0;
+}
+
+static void projectVertices(
+	const GTEVector16 *vertices,
+	int               numVertices,
+	uint32_t          *sxy,
+	uint16_t          *sz
+) {
+	int i = 0;
+
+	// Transform three vertices per RTPT. The results end up in SXY0-2 and
+	// SZ1-3 and are copied out to the cache.
+	for (; i <= (numVertices - 3); i += 3) {
+		gte_loadV0(&vertices[i + 0]);
+		gte_loadV1(&vertices[i + 1]);
+		gte_loadV2(&vertices[i + 2]);
+		gte_command(GTE_CMD_RTPT | GTE_SF);
+
+		gte_storeDataReg(GTE_SXY0, 0, &sxy[i + 0]);
+		gte_storeDataReg(GTE_SXY1, 0, &sxy[i + 1]);
+		gte_storeDataReg(GTE_SXY2, 0, &sxy[i + 2]);
+		sz[i + 0] = gte_getDataReg(GTE_SZ1);
+		sz[i + 1] = gte_getDataReg(GTE_SZ2);
+		sz[i + 2] = gte_getDataReg(GTE_SZ3);
+	}
+
+	// Any leftover vertices are transformed one by one, RTPS leaves each
+	// result at the end of the FIFO.
+	for (; i < numVertices; i++) {
+		gte_loadV0(&vertices[i]);
+		gte_command(GTE_CMD_RTPS | GTE_SF);
+
+		gte_storeDataReg(GTE_SXY2, 0, &sxy[i]);
+		sz[i] = gte_getDataReg(GTE_SZ3);
+	}
+}
+
+static void lightNormals(
+	const GTEVector16 *normals,
+	int               numNormals,
+	uint32_t          *rgb
+) {
+	int i = 0;
+
+	gte_setDataReg(GTE_RGBC, MESH_BASE_COLOR);
+
+	// NCCT lights three normals at once against the light matrix loaded by
+	// setLightRotation(), leaving the colors in RGB0-2.
+	for (; i <= (numNormals - 3); i += 3) {
+		gte_loadV0(&normals[i + 0]);
+		gte_loadV1(&normals[i + 1]);
+		gte_loadV2(&normals[i + 2]);
+		gte_command(GTE_CMD_NCCT | GTE_SF | GTE_LM);
+
+		gte_storeDataReg(GTE_RGB0, 0, &rgb[i + 0]);
+		gte_storeDataReg(GTE_RGB1, 0, &rgb[i + 1]);
+		gte_storeDataReg(GTE_RGB2, 0, &rgb[i + 2]);
+	}
+
+	for (; i < numNormals; i++) {
+		gte_loadV0(&normals[i]);
+		gte_command(GTE_CMD_NCCS | GTE_SF | GTE_LM);
+
+		gte_storeDataReg(GTE_RGB2, 0, &rgb[i]);
+	}
+}
+
+/* Projected vertex cache for the mesh currently being drawn */
+typedef struct {
+	ScratchpadMark mark;
+	uint32_t       *sxy;
+	uint16_t       *sz;
+	uint32_t       *rgb;     /* Lit color per normal, NULL if unlit */
+	const uint16_t *normals; /* Index into rgb for each v3 corner */
+} VertexCache;
+
+static void beginVertexCache(VertexCache *cache, const Model *model) {
+	int numVertices = model->numVertices;
+	int numNormals  = model->numNormals;
+
+	assert(numVertices <= MESH_MAX_VERTICES);
+	assert(numNormals  <= MESH_MAX_NORMALS);
+
+	// Put the cache in the scratchpad if there is room left, as it has no
+	// wait states; the SXY array is followed by the SZ array. The positions
+	// are read the most, so they get the first pick and the colors only
+	// go there if there is still space.
+	cache->mark = scratchpadMark();
+	cache->sxy  = scratchpadTryAlloc(numVertices * MESH_CACHE_ENTRY_SIZE);
+
+	if (cache->sxy) {
+		cache->sz = (uint16_t *) &(cache->sxy)[numVertices];
+	} else {
+		cache->sxy = meshSXYBuffer;
+		cache->sz  = meshSZBuffer;
+	}
+
+	projectVertices(model->vertices, numVertices, cache->sxy, cache->sz);
+
+	cache->rgb     = NULL;
+	cache->normals = model->cornerNormals;
+
+	if (!cache->normals)
+		return;
+
+	cache->rgb = scratchpadTryAlloc(numNormals * sizeof(uint32_t));
+	if (!cache->rgb)
+		cache->rgb = meshRGBBuffer;
+
+	lightNormals(model->normals, numNormals, cache->rgb);
+}
+
+static inline void endVertexCache(VertexCache *cache) {
+	scratchpadRelease(cache->mark);
+}
+
+/* Run NCLIP and AVSZ3 on a cached triangle, returns its OTZ or -1 if culled */
+static inline int sortCachedTriangle(
+	const VertexCache *cache,
+	int               v0,
+	int               v1,
+	int               v2
+) {
+	// Reload the cached screen coordinates for NCLIP backface culling.
+	gte_loadDataReg(GTE_SXY0, 0, &(cache->sxy)[v0]);
+	gte_loadDataReg(GTE_SXY1, 0, &(cache->sxy)[v1]);
+	gte_loadDataReg(GTE_SXY2, 0, &(cache->sxy)[v2]);
+	gte_command(GTE_CMD_NCLIP);
+
+	if ((int) gte_getDataReg(GTE_MAC0) <= 0)
+		return -1;
+
+	// Calculate average Z for depth sorting from the cached depths.
+	gte_setDataReg(GTE_SZ1, cache->sz[v0]);
+	gte_setDataReg(GTE_SZ2, cache->sz[v1]);
+	gte_setDataReg(GTE_SZ3, cache->sz[v2]);
+	gte_command(GTE_CMD_AVSZ3 | GTE_SF);
+
+	return gte_getDataReg(GTE_OTZ);
+}
+
+/* Same as sortCachedTriangle() for a quad in GP0 corner order */
+static inline int sortCachedQuad(
+	const VertexCache *cache,
+	int               v0,
+	int               v1,
+	int               v2,
+	int               v3
+) {
+	// The first three corners form one of the quad's two triangles, which is
+	// enough to cull it as the converter only keeps (nearly) planar quads.
+	gte_loadDataReg(GTE_SXY0, 0, &(cache->sxy)[v0]);
+	gte_loadDataReg(GTE_SXY1, 0, &(cache->sxy)[v1]);
+	gte_loadDataReg(GTE_SXY2, 0, &(cache->sxy)[v2]);
+	gte_command(GTE_CMD_NCLIP);
+
+	if ((int) gte_getDataReg(GTE_MAC0) <= 0)
+		return -1;
+
+	gte_setDataReg(GTE_SZ0, cache->sz[v0]);
+	gte_setDataReg(GTE_SZ1, cache->sz[v1]);
+	gte_setDataReg(GTE_SZ2, cache->sz[v2]);
+	gte_setDataReg(GTE_SZ3, cache->sz[v3]);
+	gte_command(GTE_CMD_AVSZ4 | GTE_SF);
+
+	return gte_getDataReg(GTE_OTZ);
+}
+
+/*
+ * Emit one textured triangle from three packed v2 corners. n0-n2 are the
+ * corners' positions in the model's corner list, which pick their lit colors
+ * in v3 models.
+ */
+static inline void drawPackedTriangle(
+	DMAChain          *chain,
+	OTLayer           layer,
+	const VertexCache *cache,
+	uint32_t          c0,
+	uint32_t          c1,
+	uint32_t          c2,
+	int               n0,
+	int               n1,
+	int               n2,
+	uint32_t          clut,
+	uint32_t          page,
+	uint32_t          base,
+	MeshStats         *stats
+) {
+	int v0 = MODEL_CORNER_VERTEX(c0);
+	int v1 = MODEL_CORNER_VERTEX(c1);
+	int v2 = MODEL_CORNER_VERTEX(c2);
+
+	int otz    = sortCachedTriangle(cache, v0, v1, v2);
+	int zIndex = (otz < 0) ? -1 : getLayerSlot(layer, otz);
+
+	if (zIndex < 0) {
+		stats->facesCulled++;
+		return;
+	}
+
+	// The corners already hold the U/V bytes of each GP0 UV word, only the
+	// texture's offset within its page and the CLUT and texpage attributes
+	// have to be added in.
+	if (cache->rgb) {
+		const uint32_t *rgb     = cache->rgb;
+		const uint16_t *normals = cache->normals;
+
+		uint32_t *ptr = allocatePacket(chain, layer, zIndex, 9);
+		ptr[0] = rgb[normals[n0]] | gp0_shadedTriangle(true, true, false);
+		ptr[1] = cache->sxy[v0];
+		ptr[2] = MODEL_CORNER_UV(c0) + clut;
+		ptr[3] = rgb[normals[n1]];
+		ptr[4] = cache->sxy[v1];
+		ptr[5] = MODEL_CORNER_UV(c1) + page;
+		ptr[6] = rgb[normals[n2]];
+		ptr[7] = cache->sxy[v2];
+		ptr[8] = MODEL_CORNER_UV(c2) + base;
+
+		stats->facesEmitted++;
+		stats->packetWords += 10;
+		return;
+	}
+
+	uint32_t *ptr = allocatePacket(chain, layer, zIndex, 7);
+	ptr[0] = gp0_rgb(128, 128, 128) | gp0_shadedTriangle(false, true, false);
+	ptr[1] = cache->sxy[v0];
+	ptr[2] = MODEL_CORNER_UV(c0) + clut;
+	ptr[3] = cache->sxy[v1];
+	ptr[4] = MODEL_CORNER_UV(c1) + page;
+	ptr[5] = cache->sxy[v2];
+	ptr[6] = MODEL_CORNER_UV(c2) + base;
+
+	stats->facesEmitted++;
+	stats->packetWords += 8;
+}
+
+/* Emit one textured quad from four packed v2 corners in GP0 order, the first
+ * of them at position n in the model's corner list */
+static inline void drawPackedQuad(
+	DMAChain          *chain,
+	OTLayer           layer,
+	const VertexCache *cache,
+	const uint32_t    *corners,
+	int               n,
+	uint32_t          clut,
+	uint32_t          page,
+	uint32_t          base,
+	MeshStats         *stats
+) {
+	int v0 = MODEL_CORNER_VERTEX(corners[0]);
+	int v1 = MODEL_CORNER_VERTEX(corners[1]);
+	int v2 = MODEL_CORNER_VERTEX(corners[2]);
+	int v3 = MODEL_CORNER_VERTEX(corners[3]);
+
+	int otz    = sortCachedQuad(cache, v0, v1, v2, v3);
+	int zIndex = (otz < 0) ? -1 : getLayerSlot(layer, otz);
+
+	if (zIndex < 0) {
+		stats->facesCulled++;
+		return;
+	}
+
+	if (cache->rgb) {
+		const uint32_t *rgb     = cache->rgb;
+		const uint16_t *normals = &(cache->normals)[n];
+
+		uint32_t *ptr = allocatePacket(chain, layer, zIndex, 12);
+		ptr[0]  = rgb[normals[0]] | gp0_shadedQuad(true, true, false);
+		ptr[1]  = cache->sxy[v0];
+		ptr[2]  = MODEL_CORNER_UV(corners[0]) + clut;
+		ptr[3]  = rgb[normals[1]];
+		ptr[4]  = cache->sxy[v1];
+		ptr[5]  = MODEL_CORNER_UV(corners[1]) + page;
+		ptr[6]  = rgb[normals[2]];
+		ptr[7]  = cache->sxy[v2];
+		ptr[8]  = MODEL_CORNER_UV(corners[2]) + base;
+		ptr[9]  = rgb[normals[3]];
+		ptr[10] = cache->sxy[v3];
+		ptr[11] = MODEL_CORNER_UV(corners[3]) + base;
+
+		stats->facesEmitted++;
+		stats->packetWords += 13;
+		return;
+	}
+
+	uint32_t *ptr = allocatePacket(chain, layer, zIndex, 9);
+	ptr[0] = gp0_rgb(128, 128, 128) | gp0_shadedQuad(false, true, false);
+	ptr[1] = cache->sxy[v0];
+	ptr[2] = MODEL_CORNER_UV(corners[0]) + clut;
+	ptr[3] = cache->sxy[v1];
+	ptr[4] = MODEL_CORNER_UV(corners[1]) + page;
+	ptr[5] = cache->sxy[v2];
+	ptr[6] = MODEL_CORNER_UV(corners[2]) + base;
+	ptr[7] = cache->sxy[v3];
+	ptr[8] = MODEL_CORNER_UV(corners[3]) + base;
+
+	stats->facesEmitted++;
+	stats->packetWords += 10;
+}
+
+static void drawPackedGroups(
+	DMAChain          *chain,
+	const Model       *model,
+	const TextureInfo *texture,
+	OTLayer           layer,
+	const VertexCache *cache,
+	MeshStats         *stats
+) {
+	uint32_t base = gp0_uv(texture->u, texture->v, 0);
+	uint32_t clut = gp0_uv(texture->u, texture->v, texture->clut);
+	uint32_t page = gp0_uv(texture->u, texture->v, texture->page);
+
+	const uint32_t *data = model->groups;
+	int            n     = 0; /* Corners walked so far */
+
+	for (int i = model->numGroups; i > 0; i--) {
+		uint32_t header = *(data++);
+		int      count  = MODEL_GROUP_COUNT(header);
+
+		switch (MODEL_GROUP_TYPE(header)) {
+			case MODEL_GROUP_STRIP:
+				// Every other triangle in a strip has its first two corners
+				// swapped to keep the winding consistent.
+				for (int j = 0; j < count; j++, data++, n++) {
+					if (j & 1)
+						drawPackedTriangle(
+							chain, layer, cache, data[1], data[0], data[2],
+							n + 1, n, n + 2, clut, page, base, stats
+						);
+					else
+						drawPackedTriangle(
+							chain, layer, cache, data[0], data[1], data[2],
+							n, n + 1, n + 2, clut, page, base, stats
+						);
+				}
+
+				data += 2;
+				n    += 2;
+				break;
+
+			case MODEL_GROUP_FAN:
+				for (int j = 1; j <= count; j++)
+					drawPackedTriangle(
+						chain, layer, cache, data[0], data[j], data[j + 1],
+						n, n + j, n + j + 1, clut, page, base, stats
+					);
+
+				data += count + 2;
+				n    += count + 2;
+				break;
+
+			case MODEL_GROUP_QUADS:
+				for (int j = count; j > 0; j--, data += 4, n += 4)
+					drawPackedQuad(
+						chain, layer, cache, data, n, clut, page, base, stats
+					);
+				break;
+
+			default:
+				for (int j = count; j > 0; j--, data += 3, n += 3)
+					drawPackedTriangle(
+						chain, layer, cache, data[0], data[1], data[2],
+						n, n + 1, n + 2, clut, page, base, stats
+					);
+				break;
+		}
+	}
+}
+
+void drawMesh(
+	DMAChain          *chain,
+	const Model       *model,
+	const TextureInfo *texture,
+	OTLayer           layer,
+	MeshStats         *stats
+) {
+	VertexCache cache;
+
+	beginVertexCache(&cache, model);
+	stats->verticesTransformed += model->numVertices;
+
+	if (model->version >= MODEL_VERSION_2) {
+		drawPackedGroups(chain, model, texture, layer, &cache, stats);
+		endVertexCache(&cache);
+		return;
+	}
+
+	const uint32_t *sxy  = cache.sxy;
+	const Face     *face = model->faces;
+
+	for (int i = model->numFaces; i > 0; i--, face++) {
+		bool isQuad = face->v3 >= 0;
+
+		int otz = isQuad
+			? sortCachedQuad(&cache, face->v0, face->v1, face->v2, face->v3)
+			: sortCachedTriangle(&cache, face->v0, face->v1, face->v2);
+		int zIndex = (otz < 0) ? -1 : getLayerSlot(layer, otz);
+
+		if (zIndex < 0) {
+			stats->facesCulled++;
+			continue;
+		}
+
+		const UV *uv0 = &model->uvs[face->uv0];
+		const UV *uv1 = &model->uvs[face->uv1];
+		const UV *uv2 = &model->uvs[face->uv2];
+
+		// Textured triangle (7 words) or quad (9 words), XY values come
+		// straight from the cache.
+		int      length = isQuad ? 9 : 7;
+		uint32_t *ptr   = allocatePacket(chain, layer, zIndex, length);
+		ptr[0] = gp0_rgb(128, 128, 128) | (isQuad
+			? gp0_shadedQuad(false, true, false)
+			: gp0_shadedTriangle(false, true, false));
+		ptr[1] = sxy[face->v0];
+		ptr[2] = gp0_uv(texture->u + uv0->u, texture->v + uv0->v, texture->clut);
+		ptr[3] = sxy[face->v1];
+		ptr[4] = gp0_uv(texture->u + uv1->u, texture->v + uv1->v, texture->page);
+		ptr[5] = sxy[face->v2];
+		ptr[6] = gp0_uv(texture->u + uv2->u, texture->v + uv2->v, 0);
+
+		if (isQuad) {
+			const UV *uv3 = &model->uvs[face->uv3];
+
+			ptr[7] = sxy[face->v3];
+			ptr[8] = gp0_uv(texture->u + uv3->u, texture->v + uv3->v, 0);
+		}
+
+		stats->facesEmitted++;
+		stats->packetWords += length + 1;
+	}
+
+	endVertexCache(&cache);
+}
+
+void drawFlatMesh(
+	DMAChain    *chain,
+	const Model *model,
+	uint8_t     r,
+	uint8_t     g,
+	uint8_t     b,
+	OTLayer     layer,
+	MeshStats   *stats
+) {
+	VertexCache cache;
+
+	// Flat meshes only come from shapes.c, which uses v1 face records.
+	assert(model->version == MODEL_VERSION_1);
+
+	beginVertexCache(&cache, model);
+	stats->verticesTransformed += model->numVertices;
+
+	const uint32_t    *sxy     = cache.sxy;
+	const Face        *face    = model->faces;
+	const GTEVector16 *normals = model->normals;
+	uint32_t          color    = gp0_rgb(r, g, b);
+
+	// Each face is lit by NCCS from its normal, which also multiplies the
+	// light by the base color
+	gte_setDataReg(GTE_RGBC, color);
+
+	for (int i = 0; i < model->numFaces; i++, face++) {
+		bool isQuad = face->v3 >= 0;
+
+		int otz = isQuad
+			? sortCachedQuad(&cache, face->v0, face->v1, face->v2, face->v3)
+			: sortCachedTriangle(&cache, face->v0, face->v1, face->v2);
+		int zIndex = (otz < 0) ? -1 : getLayerSlot(layer, otz);
+
+		if (zIndex < 0) {
+			stats->facesCulled++;
+			continue;
+		}
+
+		if (normals) {
+			gte_loadV0(&normals[face->n]);
+			gte_command(GTE_CMD_NCCS | GTE_SF | GTE_LM);
+			color = gte_getDataReg(GTE_RGB2);
+		}
+
+		int      length = isQuad ? 5 : 4;
+		uint32_t *ptr   = allocatePacket(chain, layer, zIndex, length);
+		ptr[0] = color
+			| (isQuad ? gp0_quad(false, false) : gp0_triangle(false, false));
+		ptr[1] = sxy[face->v0];
+		ptr[2] = sxy[face->v1];
+		ptr[3] = sxy[face->v2];
+
+		if (isQuad)
+			ptr[4] = sxy[face->v3];
+
+		stats->facesEmitted++;
+		stats->packetWords += length + 1;
+	}
+
+	endVertexCache(&cache);
+}
+
+/* Draw a square covering roughly the projected sphere's area */
+static void drawLODSprite(
+	DMAChain               *chain,
+	const SphereProjection *projection,
+	uint8_t                r,
+	uint8_t                g,
+	uint8_t                b,
+	OTLayer                layer,
+	MeshStats              *stats
+) {
+	int zIndex = getLayerSlot(layer, projection->z);
+
+	if (zIndex < 0) {
+		stats->objectsCulled++;
+		return;
+	}
+
+	int size = (projection->radius * 3 + 1) >> 1;
+	if (size < 1)
+		size = 1;
+
+	uint32_t *ptr = allocatePacket(chain, layer, zIndex, 3);
+	ptr[0] = gp0_rgb(r, g, b) | gp0_rectangle(false, false, false);
+	ptr[1] = gp0_xy(projection->sx - (size >> 1), projection->sy - (size >> 1));
+	ptr[2] = gp0_xy(size, size);
+
+	stats->spritesDrawn++;
+	stats->packetWords += 4;
+}
+
+int drawMeshLOD(
+	DMAChain          *chain,
+	const MeshLOD     *lod,
+	const TextureInfo *texture,
+	const ViewFrustum *frustum,
+	OTLayer           layer,
+	MeshStats         *stats
+) {
+	SphereProjection projection;
+
+	if (!projectBoundingSphere(frustum, &(lod->levels[0]->bounds), &projection)) {
+		stats->objectsCulled++;
+		return LOD_CULLED;
+	}
+
+	int level = selectLOD(lod, projection.radius);
+
+	if (level == LOD_SPRITE)
+		drawLODSprite(
+			chain,
+			&projection,
+			lod->spriteR,
+			lod->spriteG,
+			lod->spriteB,
+			layer,
+			stats
+		);
+	else
+		drawMesh(chain, lod->levels[level], texture, layer, stats);
+
+	return level;
+}
+
+void drawMeshInstances(
+	DMAChain           *chain,
+	const MeshInstance *instances,
+	int                count,
+	const ViewFrustum  *frustum,
+	OTLayer            layer,
+	MeshStats          *stats
+) {
+	for (; count > 0; count--, instances++) {
+		const MeshLOD *lod = instances->lod;
+
+		gte_setControlReg(GTE_TRX, instances->x);
+		gte_setControlReg(GTE_TRY, instances->y);
+		gte_setControlReg(GTE_TRZ, instances->z);
+		gte_loadRotationMatrix(&instances->rotation);
+
+		SphereProjection projection;
+
+		if (!projectBoundingSphere(frustum, &(lod->levels[0]->bounds), &projection)) {
+			stats->objectsCulled++;
+			continue;
+		}
+
+		int level = selectLOD(lod, projection.radius);
+
+		if (level != LOD_SPRITE)
+			setLightRotation(&instances->rotation);
+
+		// Sprites stand in for a whole mesh, so darken the tint to about the
+		// average of its lit faces
+		if (level == LOD_SPRITE)
+			drawLODSprite(
+				chain,
+				&projection,
+				(instances->r * 3) >> 2,
+				(instances->g * 3) >> 2,
+				(instances->b * 3) >> 2,
+				layer,
+				stats
+			);
+		else
+			drawFlatMesh(
+				chain,
+				lod->levels[level],
+				instances->r,
+				instances->g,
+				instances->b,
+				layer,
+				stats
+			);
+	}
+}
@@ -0,0 +1,110 @@
+/*
+ * Indexed mesh renderer for PS1 bare-metal
+ *
+ * Projects every vertex of a Model exactly once per draw (three at a time with
+ * RTPT) into a screen-space cache, then assembles faces from the cached SXY/SZ
+ * values instead of re-transforming shared vertices for each adjacent face.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "gpu.h"
+#include "lod.h"
+#include "model.h"
+#include "ps1/gte.h"
+
+/* The cache lives in the scratchpad when it fits (about 170 vertices at 6
+ * bytes each) and falls back to a main RAM buffer of this size otherwise */
+#define MESH_MAX_VERTICES 1024
+
+/* Lit colors of v3 models take another 4 bytes per normal, in the scratchpad
+ * if there's still room after the vertices */
+#define MESH_MAX_NORMALS 1024
+
+/* Per-frame renderer counters, accumulated over every drawMesh() call */
+typedef struct {
+	uint16_t verticesTransformed;
+	uint16_t facesCulled;
+	uint16_t facesEmitted;
+	uint16_t packetWords;   /* Including tags */
+	uint16_t objectsCulled; /* Rejected by their bounding sphere */
+	uint16_t spritesDrawn;  /* Objects collapsed to a sprite */
+} MeshStats;
+
+/* One placed, rotated and tinted copy of a flat-shaded mesh */
+typedef struct {
+	const MeshLOD *lod;
+	GTEMatrix   rotation;
+	int16_t     x, y, z;
+	uint8_t     r, g, b;
+} MeshInstance;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void resetMeshStats(MeshStats *stats);
+
+/*
+ * Draw a textured model using the GTE's current rotation matrix and
+ * translation vector. Faces are sorted into the given ordering table layer by
+ * their average Z, faces beyond the layer's depth range are culled. Both v1
+ * face records and v2/v3 packed primitive groups are supported. v3 models are
+ * Gouraud shaded by the GTE from their corner normals, each lit once per draw
+ * with the lights set up by setLightRotation() for the current rotation.
+ */
+void drawMesh(
+	DMAChain          *chain,
+	const Model       *model,
+	const TextureInfo *texture,
+	OTLayer           layer,
+	MeshStats         *stats
+);
+
+/*
+ * Draw an untextured model with flat-shaded faces in the given color, using
+ * the GTE's current transform, sorted into the given layer like drawMesh().
+ * Meshes with face normals are lit like drawMesh() does.
+ */
+void drawFlatMesh(
+	DMAChain    *chain,
+	const Model *model,
+	uint8_t     r,
+	uint8_t     g,
+	uint8_t     b,
+	OTLayer     layer,
+	MeshStats   *stats
+);
+
+/*
+ * Cull a textured model by its bounding sphere, then draw the level of detail
+ * matching its on-screen size with drawMesh() or as a sprite. Returns the
+ * level drawn, LOD_SPRITE or LOD_CULLED.
+ */
+int drawMeshLOD(
+	DMAChain          *chain,
+	const MeshLOD     *lod,
+	const TextureInfo *texture,
+	const ViewFrustum *frustum,
+	OTLayer           layer,
+	MeshStats         *stats
+);
+
+/*
+ * Load each instance's transform and lights and draw it with drawFlatMesh(),
+ * culling and picking levels of detail like drawMeshLOD(). Sprites use the
+ * instance's tint.
+ */
+void drawMeshInstances(
+	DMAChain           *chain,
+	const MeshInstance *instances,
+	int                count,
+	const ViewFrustum  *frustum,
+	OTLayer            layer,
+	MeshStats          *stats
+);
+
+#ifdef __cplusplus
+}
+#endif
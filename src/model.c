@@ -6,18 +6,19 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include "model.h"
+#include "trig.h"
 
 /*
- * Binary model format:
+ * Binary model format, version 1:
  *
  * Header (8 bytes):
  *   uint16_t num_vertices
  *   uint16_t num_uvs
  *   uint16_t num_faces
- *   uint16_t reserved
+ *   uint16_t version (0)
  *
- * Vertices (num_vertices * 6 bytes):
- *   int16_t x, y, z
+ * Vertices (num_vertices * 8 bytes, matching GTEVector16):
+ *   int16_t x, y, z, padding
  *
  * UVs (num_uvs * 2 bytes, padded to 4-byte alignment):
  *   uint8_t u, v
@@ -26,22 +27,83 @@
  *   int16_t v0, v1, v2, v3
  *   int16_t uv0, uv1, uv2, uv3
  *   int16_t normal_index
+ *
+ * Version 2:
+ *
+ * Header (16 bytes):
+ *   uint16_t num_vertices
+ *   uint16_t num_groups
+ *   uint16_t num_faces (triangles)
+ *   uint16_t version (2)
+ *   int16_t  sphere_x, sphere_y, sphere_z
+ *   uint16_t sphere_radius
+ *
+ * Vertices (num_vertices * 8 bytes, in first use order)
+ *
+ * Groups (num_groups, see MODEL_GROUP_*):
+ *   uint32_t type << 16 | num_triangles
+ *   uint32_t corners[], each vertex | (u | v << 8) << 16
+ *
+ * Version 3 is version 2 with a normal table between the vertices and the
+ * groups, and a normal index for each corner after them:
+ *   uint16_t num_normals, padding
+ *   Normals (num_normals * 8 bytes, 4.12 fixed-point)
+ *   Groups
+ *   uint16_t normal index per corner, in group order, padded to 4 bytes
  */
 
-bool loadModel(Model *model, const uint8_t *data, size_t size) {
-	if (!model || !data || size < 8) {
-		return false;
+#define V1_HEADER_SIZE 8
+#define V2_HEADER_SIZE 16
+
+/* v1 files have no bounding sphere, so fit one around the bounding box */
+static void computeBounds(Model *model) {
+	const GTEVector16 *v = model->vertices;
+	BoundingSphere    *bounds = &model->bounds;
+
+	if (!model->numVertices) {
+		bounds->x = bounds->y = bounds->z = bounds->radius = 0;
+		return;
 	}
 
-	/* Read header */
-	const uint16_t *header = (const uint16_t *)data;
-	model->numVertices = header[0];
-	model->numUVs = header[1];
-	model->numFaces = header[2];
-	model->reserved = header[3];
+	int minX = v->x, minY = v->y, minZ = v->z;
+	int maxX = v->x, maxY = v->y, maxZ = v->z;
+
+	for (int i = 1; i < model->numVertices; i++) {
+		if (v[i].x < minX) minX = v[i].x;
+		if (v[i].y < minY) minY = v[i].y;
+		if (v[i].z < minZ) minZ = v[i].z;
+		if (v[i].x > maxX) maxX = v[i].x;
+		if (v[i].y > maxY) maxY = v[i].y;
+		if (v[i].z > maxZ) maxZ = v[i].z;
+	}
+
+	bounds->x = (minX + maxX) / 2;
+	bounds->y = (minY + maxY) / 2;
+	bounds->z = (minZ + maxZ) / 2;
+
+	uint32_t maxDist = 0;
+
+	for (int i = 0; i < model->numVertices; i++) {
+		int dx = v[i].x - bounds->x;
+		int dy = v[i].y - bounds->y;
+		int dz = v[i].z - bounds->z;
+
+		uint32_t dist = (dx * dx) + (dy * dy) + (dz * dz);
+		if (dist > maxDist)
+			maxDist = dist;
+	}
 
+	// Round up so that the sphere always contains the furthest vertex.
+	uint32_t radius = isqrt(maxDist);
+	if ((radius * radius) < maxDist)
+		radius++;
+
+	bounds->radius = radius;
+}
+
+static bool loadModelV1(Model *model, const uint8_t *data, size_t size) {
 	/* Calculate offsets */
-	size_t vertexOffset = 8;
+	size_t vertexOffset = V1_HEADER_SIZE;
 	size_t vertexSize = model->numVertices * sizeof(GTEVector16);
 
 	/* Align to 4 bytes */
@@ -54,10 +116,173 @@ bool loadModel(Model *model, const uint8_t *data, size_t size) {
 	size_t faceOffset = uvOffset + uvSize;
 	faceOffset = (faceOffset + 3) & ~3;
 
+	if ((faceOffset + model->numFaces * sizeof(Face)) > size) {
+		return false;
+	}
+
 	/* Set pointers into the data */
+	model->numGroups = 0;
 	model->vertices = (const GTEVector16 *)(data + vertexOffset);
 	model->uvs = (const UV *)(data + uvOffset);
 	model->faces = (const Face *)(data + faceOffset);
+	model->groups = NULL;
+
+	computeBounds(model);
+	return true;
+}
+
+/* Walk the primitive groups once, checking that every group and its corners
+ * fit in the data and only reference existing vertices. Returns the number
+ * of corners in numCorners. */
+static bool validateGroups(
+	const Model    *model,
+	const uint32_t *groups,
+	size_t         words,
+	size_t         *numCorners
+) {
+	size_t offset = 0;
+
+	for (int i = model->numGroups; i > 0; i--) {
+		if (offset >= words) {
+			return false;
+		}
+
+		uint32_t header = groups[offset++];
+		size_t   count  = MODEL_GROUP_COUNT(header);
+		size_t   corners;
+
+		switch (MODEL_GROUP_TYPE(header)) {
+			case MODEL_GROUP_LIST:
+				corners = count * 3;
+				break;
+
+			case MODEL_GROUP_STRIP:
+			case MODEL_GROUP_FAN:
+				corners = count + 2;
+				break;
+
+			case MODEL_GROUP_QUADS:
+				corners = count * 4;
+				break;
+
+			default:
+				return false;
+		}
+
+		if (corners > (words - offset)) {
+			return false;
+		}
+
+		for (; corners > 0; corners--, offset++) {
+			if (MODEL_CORNER_VERTEX(groups[offset]) >= model->numVertices) {
+				return false;
+			}
+		}
+	}
+
+	*numCorners = offset - model->numGroups;
+	return true;
+}
+
+static bool loadModelV2(Model *model, const uint8_t *data, size_t size) {
+	if (size < V2_HEADER_SIZE) {
+		return false;
+	}
+
+	const uint16_t *header = (const uint16_t *)data;
+	model->numGroups = header[1];
+	model->numUVs = 0;
+	model->bounds.x = (int16_t) header[4];
+	model->bounds.y = (int16_t) header[5];
+	model->bounds.z = (int16_t) header[6];
+	model->bounds.radius = header[7];
+
+	size_t vertexOffset = V2_HEADER_SIZE;
+	size_t normalOffset = vertexOffset + model->numVertices * sizeof(GTEVector16);
+	size_t groupOffset = normalOffset;
+
+	model->numNormals = 0;
+
+	if (model->version == MODEL_VERSION_3) {
+		if ((normalOffset + 4) > size) {
+			return false;
+		}
+
+		model->numNormals = *(const uint16_t *)(data + normalOffset);
+		normalOffset += 4;
+		groupOffset = normalOffset + model->numNormals * sizeof(GTEVector16);
+	}
+
+	if (groupOffset > size) {
+		return false;
+	}
+
+	const uint32_t *groups = (const uint32_t *)(data + groupOffset);
+	size_t         groupWords = (size - groupOffset) / sizeof(uint32_t);
+	size_t         numCorners;
+
+	if (!validateGroups(model, groups, groupWords, &numCorners)) {
+		return false;
+	}
+
+	model->vertices = (const GTEVector16 *)(data + vertexOffset);
+	model->uvs = NULL;
+	model->faces = NULL;
+	model->groups = groups;
+	model->normals = NULL;
+	model->cornerNormals = NULL;
+
+	if (model->version != MODEL_VERSION_3) {
+		return true;
+	}
+
+	// The corner normals follow the last group, check they're all there and
+	// in range too
+	size_t cornerOffset = groupOffset
+		+ (model->numGroups + numCorners) * sizeof(uint32_t);
+
+	if ((cornerOffset + numCorners * sizeof(uint16_t)) > size) {
+		return false;
+	}
+
+	const uint16_t *cornerNormals = (const uint16_t *)(data + cornerOffset);
+
+	for (size_t i = 0; i < numCorners; i++) {
+		if (cornerNormals[i] >= model->numNormals) {
+			return false;
+		}
+	}
+
+	model->normals = (const GTEVector16 *)(data + normalOffset);
+	model->cornerNormals = cornerNormals;
 
 	return true;
 }
+
+bool loadModel(Model *model, const uint8_t *data, size_t size) {
+	if (!model || !data || size < V1_HEADER_SIZE) {
+		return false;
+	}
+
+	/* Read header */
+	const uint16_t *header = (const uint16_t *)data;
+	model->numVertices = header[0];
+	model->numUVs = header[1];
+	model->numFaces = header[2];
+	model->version = header[3];
+	model->normals = NULL;
+	model->cornerNormals = NULL;
+	model->numNormals = 0;
+
+	switch (model->version) {
+		case MODEL_VERSION_1:
+			return loadModelV1(model, data, size);
+
+		case MODEL_VERSION_2:
+		case MODEL_VERSION_3:
+			return loadModelV2(model, data, size);
+
+		default:
+			return false;
+	}
+}
@@ -4,32 +4,76 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "ps1/gte.h"
 
+/* Format version, stored in the last header field (always 0 in v1 files) */
+#define MODEL_VERSION_1 0
+#define MODEL_VERSION_2 2
+#define MODEL_VERSION_3 3  /* v2 with corner normals */
+
+/*
+ * v2 primitive group types. Each group is a header word (type in the upper
+ * half, primitive count in the lower half) followed by its corners: three per
+ * triangle for lists, four per quad, or count + 2 shared corners for strips
+ * and fans.
+ */
+#define MODEL_GROUP_LIST  0
+#define MODEL_GROUP_STRIP 1
+#define MODEL_GROUP_FAN   2
+#define MODEL_GROUP_QUADS 3  /* Four corners per quad, in GP0 order */
+
+#define MODEL_GROUP_TYPE(header)  ((header) >> 16)
+#define MODEL_GROUP_COUNT(header) ((header) & 0xffff)
+
+/* A v2 corner packs the vertex index in the lower half and the U/V bytes of
+ * the GP0 UV word in the upper half, so one load covers both */
+#define MODEL_CORNER_VERTEX(corner) ((corner) & 0xffff)
+#define MODEL_CORNER_UV(corner)     ((corner) >> 16)
+
 /* Texture coordinates */
 typedef struct {
 	uint8_t u, v;
 } UV;
 
-/* Face structure */
+/*
+ * Face structure. Quads store their corners in GP0 order, where the GPU draws
+ * (v0, v1, v2) and (v1, v2, v3), so the first three give the face's winding.
+ */
 typedef struct {
 	int16_t v0, v1, v2, v3;     /* Vertex indices (v3 = -1 for triangles) */
 	int16_t uv0, uv1, uv2, uv3; /* UV indices */
-	int16_t n;                   /* Normal index (unused) */
+	int16_t n;                   /* Face normal index, for flat meshes */
 } Face;
 
+/* Sphere enclosing every vertex, in model space */
+typedef struct {
+	int16_t  x, y, z;
+	uint16_t radius;
+} BoundingSphere;
+
 /* Model structure */
 typedef struct {
 	uint16_t numVertices;
 	uint16_t numUVs;
-	uint16_t numFaces;
-	uint16_t reserved;
+	uint16_t numFaces;   /* Triangles and quads, for both versions */
+	uint16_t version;
+	uint16_t numGroups;  /* v2 only */
+	uint16_t numNormals; /* v3 only */
+
+	BoundingSphere bounds;
 
 	const GTEVector16 *vertices;
-	const UV *uvs;
-	const Face *faces;
+	const UV *uvs;              /* v1 only */
+	const Face *faces;          /* v1 only */
+	const uint32_t *groups;     /* v2 and v3 */
+
+	/* 4.12 unit normals for GTE lighting, or NULL if unlit: indexed by
+	 * cornerNormals in v3 models, by Face.n in flat v1 meshes */
+	const GTEVector16 *normals;
+	const uint16_t *cornerNormals; /* v3 only, one per corner in group order */
 } Model;
 
 #ifdef __cplusplus
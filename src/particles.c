@@ -0,0 +1,311 @@
+/*
+ * Structure-of-arrays particle engines for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gpu.h"
+#include "particles.h"
+#include "ps1/gpucmd.h"
+#include "ps1/gte.h"
+
+/* Stars spawn up to this many pixels past the right edge */
+#define STAR_SPAWN_MARGIN 20
+
+static const GTEMatrix identityMatrix = {
+	.values = {
+		{ 4096,    0,    0 },
+		{    0, 4096,    0 },
+		{    0,    0, 4096 }
+	}
+};
+
+static inline uint32_t nextRandom(uint32_t *seed) {
+	uint32_t x = *seed;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	*seed = x;
+	return x;
+}
+
+/* Random value in 0..range-1, scaled with a multiply rather than a modulo */
+static inline int randomRange(uint32_t *seed, int range) {
+	return ((nextRandom(seed) >> 16) * range) >> 16;
+}
+
+/* Pick a new row, parallax layer and color for a star */
+static void spawnStar(Starfield *sf, int i) {
+	int layer = randomRange(&sf->seed, 3);
+	int brightness, speed;
+
+	// Farther layers are dimmer and slower, the 12.4 speeds give each star a
+	// little variation within its layer
+	if (layer == 0) {
+		brightness = 60 + randomRange(&sf->seed, 40);
+		speed      = 16 + randomRange(&sf->seed, 4);
+	} else if (layer == 1) {
+		brightness = 120 + randomRange(&sf->seed, 60);
+		speed      = 32 + randomRange(&sf->seed, 8);
+	} else {
+		brightness = 200 + randomRange(&sf->seed, 55);
+		speed      = 48 + randomRange(&sf->seed, 16);
+	}
+
+	sf->y[i]     = randomRange(&sf->seed, sf->height);
+	sf->speed[i] = speed;
+	sf->color[i] = gp0_rgb(brightness, brightness, brightness)
+		| gp0_rectangle1x1(false, false, false);
+}
+
+static void respawnStar(Starfield *sf, int i) {
+	sf->x[i] = (sf->width << STARFIELD_SUBPIXEL_BITS)
+		+ randomRange(&sf->seed, STAR_SPAWN_MARGIN << STARFIELD_SUBPIXEL_BITS);
+
+	spawnStar(sf, i);
+}
+
+void initStarfield(Starfield *sf, int numStars, int width, int height, uint32_t seed) {
+	if (numStars > STARFIELD_MAX_STARS)
+		numStars = STARFIELD_MAX_STARS;
+
+	sf->numStars = numStars;
+	sf->width    = width;
+	sf->height   = height;
+	sf->seed     = seed ? seed : 1;
+
+	for (int i = 0; i < numStars; i++) {
+		sf->x[i] = randomRange(&sf->seed, width << STARFIELD_SUBPIXEL_BITS);
+		spawnStar(sf, i);
+	}
+
+	// The packets laid out here are back to back, drawStarfield() only ever
+	// rewrites the dots between their tags
+	for (int i = 0; i < 2; i++) {
+		initRetainedBlock(&sf->blocks[i], sf->data[i], STARFIELD_BLOCK_SIZE);
+
+		for (int j = 0; j < numStars; j += PARTICLE_DOTS_PER_PACKET) {
+			int dots = numStars - j;
+
+			if (dots > PARTICLE_DOTS_PER_PACKET)
+				dots = PARTICLE_DOTS_PER_PACKET;
+
+			allocateRetainedPacket(&sf->blocks[i], dots * 2);
+		}
+	}
+}
+
+void updateStarfield(Starfield *sf) {
+	int16_t       *x     = sf->x;
+	const int16_t *speed = sf->speed;
+	int           n      = sf->numStars;
+	int           i      = 0;
+
+	// Stars wrap as soon as they go negative, so one sign test covers four of
+	// them on the fast path
+	for (; i <= (n - 4); i += 4) {
+		int x0 = x[i + 0] - speed[i + 0];
+		int x1 = x[i + 1] - speed[i + 1];
+		int x2 = x[i + 2] - speed[i + 2];
+		int x3 = x[i + 3] - speed[i + 3];
+
+		x[i + 0] = x0;
+		x[i + 1] = x1;
+		x[i + 2] = x2;
+		x[i + 3] = x3;
+
+		if ((x0 | x1 | x2 | x3) < 0) {
+			if (x0 < 0) respawnStar(sf, i + 0);
+			if (x1 < 0) respawnStar(sf, i + 1);
+			if (x2 < 0) respawnStar(sf, i + 2);
+			if (x3 < 0) respawnStar(sf, i + 3);
+		}
+	}
+
+	for (; i < n; i++) {
+		x[i] -= speed[i];
+
+		if (x[i] < 0)
+			respawnStar(sf, i);
+	}
+}
+
+void drawStarfield(
+	Starfield *sf,
+	DMAChain  *chain,
+	int       buffer,
+	OTLayer   layer,
+	int       alpha
+) {
+	const int16_t  *x     = sf->x;
+	const int16_t  *y     = sf->y;
+	const int16_t  *speed = sf->speed;
+	const uint32_t *color = sf->color;
+
+	// Skip the first tag, then write color and XY pairs and step over the tag
+	// ending each packet. Stars past the right edge are clipped by the
+	// drawing area.
+	uint32_t *ptr = &sf->data[buffer][1];
+	int      i    = 0;
+
+	for (int left = sf->numStars; left > 0; left -= PARTICLE_DOTS_PER_PACKET) {
+		int dots = (left > PARTICLE_DOTS_PER_PACKET) ? PARTICLE_DOTS_PER_PACKET : left;
+
+		for (; dots > 0; dots--, i++, ptr += 2) {
+			int sx = (x[i] - ((speed[i] * alpha) >> 12)) >> STARFIELD_SUBPIXEL_BITS;
+
+			ptr[0] = color[i];
+			ptr[1] = gp0_xy(sx, y[i]);
+		}
+
+		ptr++;
+	}
+
+	linkRetainedBlock(chain, &sf->blocks[buffer], layer, 0);
+}
+
+void initParticles(ParticleSystem *ps, uint32_t seed) {
+	ps->numParticles = 0;
+	ps->seed         = seed ? seed : 1;
+}
+
+void emitParticles(
+	ParticleSystem    *ps,
+	const GTEVector16 *origin,
+	const GTEVector16 *velocity,
+	int               spread,
+	int               count,
+	int               life
+) {
+	int range = spread * 2 + 1;
+
+	for (; (count > 0) && (ps->numParticles < PARTICLE_MAX_PARTICLES); count--) {
+		int i = ps->numParticles++;
+
+		ps->x[i]    = origin->x;
+		ps->y[i]    = origin->y;
+		ps->z[i]    = origin->z;
+		ps->vx[i]   = velocity->x + randomRange(&ps->seed, range) - spread;
+		ps->vy[i]   = velocity->y + randomRange(&ps->seed, range) - spread;
+		ps->vz[i]   = velocity->z + randomRange(&ps->seed, range) - spread;
+		ps->life[i] = life - randomRange(&ps->seed, (life >> 2) + 1);
+	}
+}
+
+/* Move the last particle into slot i */
+static void removeParticle(ParticleSystem *ps, int i) {
+	int last = --(ps->numParticles);
+
+	ps->x[i]    = ps->x[last];
+	ps->y[i]    = ps->y[last];
+	ps->z[i]    = ps->z[last];
+	ps->vx[i]   = ps->vx[last];
+	ps->vy[i]   = ps->vy[last];
+	ps->vz[i]   = ps->vz[last];
+	ps->life[i] = ps->life[last];
+}
+
+/* Integrate one coordinate array, four particles per iteration */
+static void integrate(int16_t *pos, const int16_t *vel, int n) {
+	int i = 0;
+
+	for (; i <= (n - 4); i += 4) {
+		pos[i + 0] += vel[i + 0];
+		pos[i + 1] += vel[i + 1];
+		pos[i + 2] += vel[i + 2];
+		pos[i + 3] += vel[i + 3];
+	}
+
+	for (; i < n; i++)
+		pos[i] += vel[i];
+}
+
+void updateParticles(ParticleSystem *ps) {
+	integrate(ps->x, ps->vx, ps->numParticles);
+	integrate(ps->y, ps->vy, ps->numParticles);
+	integrate(ps->z, ps->vz, ps->numParticles);
+
+	// Walk backwards so the particle swapped into a freed slot has already
+	// been aged
+	for (int i = ps->numParticles - 1; i >= 0; i--) {
+		if (--(ps->life[i]) == 0)
+			removeParticle(ps, i);
+	}
+}
+
+/* Fade from yellow through orange to dark red as a particle burns out */
+static inline uint32_t getParticleColor(int life) {
+	int c = life << 3;
+
+	if (c > 255)
+		c = 255;
+
+	return gp0_rgb(c, (c * 3) >> 2, c >> 2) | gp0_rectangle1x1(false, false, false);
+}
+
+void drawParticles(
+	const ParticleSystem *ps,
+	DMAChain             *chain,
+	OTLayer              layer,
+	int                  alpha
+) {
+	int n = ps->numParticles;
+
+	if (!n)
+		return;
+
+	gte_loadRotationMatrix(&identityMatrix);
+	gte_setControlReg(GTE_TRX, 0);
+	gte_setControlReg(GTE_TRY, 0);
+	gte_setControlReg(GTE_TRZ, 0);
+
+	for (int i = 0; i < n; i += 3) {
+		// The last triple is padded by repeating its first particle, only the
+		// dots that exist are emitted
+		int count = n - i;
+		int j1    = (count > 1) ? (i + 1) : i;
+		int j2    = (count > 2) ? (i + 2) : i;
+
+		if (count > 3)
+			count = 3;
+
+		gte_setV0(
+			ps->x[i] + ((ps->vx[i] * alpha) >> 12),
+			ps->y[i] + ((ps->vy[i] * alpha) >> 12),
+			ps->z[i] + ((ps->vz[i] * alpha) >> 12)
+		);
+		gte_setV1(
+			ps->x[j1] + ((ps->vx[j1] * alpha) >> 12),
+			ps->y[j1] + ((ps->vy[j1] * alpha) >> 12),
+			ps->z[j1] + ((ps->vz[j1] * alpha) >> 12)
+		);
+		gte_setV2(
+			ps->x[j2] + ((ps->vx[j2] * alpha) >> 12),
+			ps->y[j2] + ((ps->vy[j2] * alpha) >> 12),
+			ps->z[j2] + ((ps->vz[j2] * alpha) >> 12)
+		);
+		gte_command(GTE_CMD_RTPT | GTE_SF);
+		gte_command(GTE_CMD_AVSZ3 | GTE_SF);
+
+		int zIndex = getLayerSlot(layer, gte_getDataReg(GTE_OTZ));
+
+		if (zIndex < 0)
+			continue;
+
+		uint32_t *ptr = allocatePacket(chain, layer, zIndex, count * 2);
+
+		ptr[0] = getParticleColor(ps->life[i]);
+		gte_storeDataReg(GTE_SXY0, 0, &ptr[1]);
+
+		if (count > 1) {
+			ptr[2] = getParticleColor(ps->life[j1]);
+			gte_storeDataReg(GTE_SXY1, 0, &ptr[3]);
+		}
+		if (count > 2) {
+			ptr[4] = getParticleColor(ps->life[j2]);
+			gte_storeDataReg(GTE_SXY2, 0, &ptr[5]);
+		}
+	}
+}
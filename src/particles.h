@@ -0,0 +1,121 @@
+/*
+ * Structure-of-arrays particle engines for PS1 bare-metal
+ *
+ * Every particle field lives in its own array so update loops touch only the
+ * fields they change, in sequential order, four particles per iteration.
+ * Random values are brought into range with a multiply and shift instead of
+ * a division.
+ *
+ * The starfield is 2D and never dies out: stars scroll left and wrap back in
+ * on the right. Each is drawn as a 2-word 1x1 rectangle (GP0 0x68), batched
+ * PARTICLE_DOTS_PER_PACKET to a tag in a retained block per framebuffer, so
+ * thousands of stars cost about two words each and no arena space.
+ *
+ * Particle systems hold short lived 3D particles (engine exhaust) in view
+ * space. They're projected three at a time with RTPT and each triple is
+ * emitted as one 6-word packet sorted by its average Z.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gpu.h"
+#include "ps1/gte.h"
+
+#define PARTICLE_DOTS_PER_PACKET 32
+
+#define STARFIELD_MAX_STARS 2048
+#define STARFIELD_NUM_PACKETS \
+	((STARFIELD_MAX_STARS + PARTICLE_DOTS_PER_PACKET - 1) / PARTICLE_DOTS_PER_PACKET)
+#define STARFIELD_BLOCK_SIZE \
+	(STARFIELD_NUM_PACKETS * (PARTICLE_DOTS_PER_PACKET * 2 + 1))
+
+/* Fractional bits of star positions and speeds */
+#define STARFIELD_SUBPIXEL_BITS 4
+
+#define PARTICLE_MAX_PARTICLES 512
+
+typedef struct {
+	int16_t  x[STARFIELD_MAX_STARS];      /* 12.4 fixed-point pixels */
+	int16_t  y[STARFIELD_MAX_STARS];      /* Whole pixels */
+	int16_t  speed[STARFIELD_MAX_STARS];  /* 12.4 pixels per tick, leftwards */
+	uint32_t color[STARFIELD_MAX_STARS];  /* Dot command and color, GP0 word 0 */
+
+	int      numStars, width, height;
+	uint32_t seed;
+
+	/* One block per framebuffer, see RetainedBlock */
+	RetainedBlock blocks[2];
+	uint32_t      data[2][STARFIELD_BLOCK_SIZE];
+} Starfield;
+
+typedef struct {
+	int16_t x[PARTICLE_MAX_PARTICLES];   /* View space position */
+	int16_t y[PARTICLE_MAX_PARTICLES];
+	int16_t z[PARTICLE_MAX_PARTICLES];
+	int16_t vx[PARTICLE_MAX_PARTICLES];  /* Velocity per tick */
+	int16_t vy[PARTICLE_MAX_PARTICLES];
+	int16_t vz[PARTICLE_MAX_PARTICLES];
+	uint8_t life[PARTICLE_MAX_PARTICLES];  /* Ticks left to live */
+
+	int      numParticles;
+	uint32_t seed;
+} ParticleSystem;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Scatter numStars stars over a width x height area and build both blocks */
+void initStarfield(Starfield *sf, int numStars, int width, int height, uint32_t seed);
+
+/* Advance every star by one tick */
+void updateStarfield(Starfield *sf);
+
+/*
+ * Patch the block for the given framebuffer (0 or 1) and link it into a
+ * layer. Stars are drawn alpha / 4096 of a tick further along. The block must
+ * be linked after anything meant to be drawn on top of it in the same slot.
+ */
+void drawStarfield(
+	Starfield *sf,
+	DMAChain  *chain,
+	int       buffer,
+	OTLayer   layer,
+	int       alpha
+);
+
+void initParticles(ParticleSystem *ps, uint32_t seed);
+
+/*
+ * Spawn up to count particles at origin, moving along velocity with up to
+ * spread units of random deviation on each axis. Particles that don't fit
+ * are dropped.
+ */
+void emitParticles(
+	ParticleSystem    *ps,
+	const GTEVector16 *origin,
+	const GTEVector16 *velocity,
+	int               spread,
+	int               count,
+	int               life
+);
+
+/* Advance every particle by one tick and remove the expired ones */
+void updateParticles(ParticleSystem *ps);
+
+/*
+ * Project and draw all particles, alpha / 4096 of a tick further along.
+ * Overwrites the GTE rotation matrix and translation vector.
+ */
+void drawParticles(
+	const ParticleSystem *ps,
+	DMAChain             *chain,
+	OTLayer              layer,
+	int                  alpha
+);
+
+#ifdef __cplusplus
+}
+#endif
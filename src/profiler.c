@@ -0,0 +1,194 @@
+/*
+ * Frame profiler for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "font.h"
+#include "format.h"
+#include "irq.h"
+#include "profiler.h"
+#include "ps1/registers.h"
+
+#ifdef ENABLE_PROFILER
+
+/* Timer 2 ticks to microseconds, 8 / 33.8688 in 10-bit fixed point */
+#define TICKS_TO_US(ticks) (((ticks) * 242) >> 10)
+
+/* Each bar character stands for this many microseconds, so a full bar is
+ * one NTSC frame */
+#define PROFILER_BAR_LENGTH 16
+#define PROFILER_BAR_SCALE  1042
+
+static const char *const sectionNames[NUM_PROFILE_SECTIONS] = {
+	"INP", "SIM", "MDL", "SHP", "HUD", "OTC", "GPU", "VSY"
+};
+
+static uint16_t startTimer[NUM_PROFILE_SECTIONS];
+static uint16_t startLine[NUM_PROFILE_SECTIONS];
+static uint32_t frameTicks[NUM_PROFILE_SECTIONS];
+
+/* End of the previous frame, for the whole frame's time */
+static uint16_t frameStartTimer, frameStartLine;
+static uint32_t frameStartVSync;
+
+/* The web harness relies on this layout, see profiler.h */
+_Static_assert(
+	offsetof(ProfileTelemetry, counters) == 20,
+	"ProfileTelemetry header layout changed"
+);
+
+static ProfileTelemetry telemetry;
+
+/* Running totals of the window being collected, in microseconds */
+static uint32_t     windowSum[NUM_PROFILE_SECTIONS];
+static uint16_t     windowMin[NUM_PROFILE_SECTIONS];
+static uint16_t     windowMax[NUM_PROFILE_SECTIONS];
+static int          windowFrames = 0;
+static ProfileStats stats[NUM_PROFILE_SECTIONS];
+
+static void resetWindow(void) {
+	for (int i = 0; i < NUM_PROFILE_SECTIONS; i++) {
+		windowSum[i] = 0;
+		windowMin[i] = UINT16_MAX;
+		windowMax[i] = 0;
+	}
+
+	windowFrames = 0;
+}
+
+static inline uint16_t clampTime(uint32_t time) {
+	return (time > UINT16_MAX) ? UINT16_MAX : time;
+}
+
+void initProfiler(void) {
+	for (int i = 0; i < NUM_PROFILE_SECTIONS; i++) {
+		frameTicks[i] = 0;
+		stats[i].min  = 0;
+		stats[i].avg  = 0;
+		stats[i].max  = 0;
+
+		for (int j = 0; j < 4; j++)
+			telemetry.sectionNames[i][j] = sectionNames[i][j];
+	}
+
+	resetWindow();
+
+	frameStartTimer = TIMER_VALUE(2);
+	frameStartLine  = getHblankCounter();
+	frameStartVSync = getVSyncCount();
+
+	telemetry.version     = PROFILER_TELEMETRY_VERSION;
+	telemetry.numSections = NUM_PROFILE_SECTIONS;
+	telemetry.numCounters = NUM_PROFILE_COUNTERS;
+	telemetry.magic       = PROFILER_TELEMETRY_MAGIC;
+
+	printf("Profiler telemetry at %p\n", (void *) &telemetry);
+}
+
+void profileBegin(ProfileSection section) {
+	startLine[section]  = getHblankCounter();
+	startTimer[section] = TIMER_VALUE(2);
+}
+
+void profileEnd(ProfileSection section) {
+	frameTicks[section] += getElapsedTimer2Ticks(startTimer[section], startLine[section]);
+}
+
+void profileCount(ProfileCounter counter, uint32_t value) {
+	telemetry.counters[counter] = value;
+}
+
+bool profileEndFrame(void) {
+	uint32_t frameTime = getElapsedTimer2Ticks(frameStartTimer, frameStartLine);
+	uint32_t vsync     = getVSyncCount();
+	uint32_t vblanks   = vsync - frameStartVSync;
+
+	frameStartTimer = TIMER_VALUE(2);
+	frameStartLine  = getHblankCounter();
+	frameStartVSync = vsync;
+
+	telemetry.frameTime     = clampTime(TICKS_TO_US(frameTime));
+	telemetry.droppedFrames = (vblanks > 1) ? (vblanks - 1) : 0;
+	telemetry.totalDropped += telemetry.droppedFrames;
+
+	for (int i = 0; i < NUM_PROFILE_SECTIONS; i++) {
+		uint16_t time = clampTime(TICKS_TO_US(frameTicks[i]));
+
+		telemetry.sectionTimes[i] = time;
+
+		windowSum[i] += time;
+		if (time < windowMin[i])
+			windowMin[i] = time;
+		if (time > windowMax[i])
+			windowMax[i] = time;
+
+		frameTicks[i] = 0;
+	}
+
+	// Bumped once everything else is written, so that a reader seeing it
+	// change knows the rest of the block belongs to the new frame
+	telemetry.sequence++;
+
+	if (++windowFrames < PROFILER_WINDOW)
+		return false;
+
+	for (int i = 0; i < NUM_PROFILE_SECTIONS; i++) {
+		stats[i].min = windowMin[i];
+		stats[i].avg = windowSum[i] / PROFILER_WINDOW;
+		stats[i].max = windowMax[i];
+	}
+
+	resetWindow();
+	return true;
+}
+
+const ProfileStats *getProfileStats(ProfileSection section) {
+	return &stats[section];
+}
+
+const ProfileTelemetry *getProfileTelemetry(void) {
+	return &telemetry;
+}
+
+void drawProfiler(DMAChain *chain, const TextureInfo *font, int x, int y) {
+	char line[16 + PROFILER_BAR_LENGTH];
+
+	for (int i = 0; i < NUM_PROFILE_SECTIONS; i++) {
+		const ProfileStats *entry = &stats[i];
+
+		int avgLength = (entry->avg + PROFILER_BAR_SCALE / 2) / PROFILER_BAR_SCALE;
+		int maxLength = (entry->max + PROFILER_BAR_SCALE / 2) / PROFILER_BAR_SCALE;
+
+		if (maxLength > PROFILER_BAR_LENGTH)
+			maxLength = PROFILER_BAR_LENGTH;
+		if (avgLength > maxLength)
+			avgLength = maxLength;
+
+		// "MDL  1234 ====--", average drawn solid and the rest up to the max
+		// dashed
+		char *p = appendString(line, sectionNames[i]);
+		p       = appendInt(p, entry->avg, 6);
+		*(p++)  = ' ';
+
+		for (int j = 0; j < maxLength; j++)
+			*(p++) = (j < avgLength) ? '=' : '-';
+
+		*p = 0;
+		printString(chain, font, x, y + i * FONT_LINE_HEIGHT, line);
+	}
+}
+
+void dumpProfiler(void) {
+	printf("Profile over %d frames (us min/avg/max):\n", PROFILER_WINDOW);
+
+	for (int i = 0; i < NUM_PROFILE_SECTIONS; i++)
+		printf(
+			"  %s %5u %5u %5u\n", sectionNames[i],
+			stats[i].min, stats[i].avg, stats[i].max
+		);
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Frame profiler for PS1 bare-metal
+ *
+ * Sections of the frame are bracketed with PROFILE_BEGIN()/PROFILE_END() and
+ * timed with root counter 2 running at the system clock / 8 (about 0.24 us
+ * per tick). Timer 2 wraps every 15.5 ms, less than a frame, so the hblank
+ * counter is read alongside it to recover whole wraps. Time spent in each
+ * section is summed per frame, and min/avg/max over PROFILER_WINDOW frames
+ * are shown as bars by drawProfiler() or dumped over serial.
+ *
+ * Every frame the profiler also publishes the frame's own timings, along
+ * with a few counters set by the game, in a ProfileTelemetry block kept in
+ * main RAM. Its address is printed at boot, and it starts with a magic value
+ * so that the web harness (web/index.html) can find it in the emulator's
+ * copy of RAM and graph it without a serial console.
+ *
+ * Everything compiles away unless ENABLE_PROFILER is defined (by the CMake
+ * option of the same name), and always does in NDEBUG builds.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gpu.h"
+
+/* Frames aggregated into each set of statistics */
+#define PROFILER_WINDOW 32
+
+typedef enum {
+	PROFILE_INPUT,
+	PROFILE_SIMULATION,
+	PROFILE_MODEL,
+	PROFILE_SHAPES,
+	PROFILE_HUD,
+	PROFILE_OT_CLEAR,
+	PROFILE_GPU_WAIT,
+	PROFILE_VSYNC_WAIT,
+	NUM_PROFILE_SECTIONS
+} ProfileSection;
+
+/* Per-frame time of a section over the last window, in microseconds */
+typedef struct {
+	uint16_t min, avg, max;
+} ProfileStats;
+
+/* Values sampled once a frame, set with profileCount() */
+typedef enum {
+	PROFILE_COUNT_PACKET_WORDS,
+	PROFILE_COUNT_SPU_RAM_USED,
+	PROFILE_COUNT_CD_QUEUE,
+	NUM_PROFILE_COUNTERS
+} ProfileCounter;
+
+#define PROFILER_TELEMETRY_MAGIC   0x4d4c544c /* "LTLM" */
+#define PROFILER_TELEMETRY_VERSION 1
+
+/*
+ * Last frame's figures, rewritten by profileEndFrame(). The layout is read
+ * as is by web/index.html, so fields only ever get added at the end along
+ * with a version bump. All times are in microseconds.
+ */
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint8_t  numSections, numCounters;
+	uint32_t sequence;      /* Frames published, incremented last */
+	uint16_t frameTime;     /* Since the previous profileEndFrame() */
+	uint16_t droppedFrames; /* Vblanks the frame ran over by */
+	uint32_t totalDropped;
+	uint32_t counters[NUM_PROFILE_COUNTERS];
+	uint16_t sectionTimes[NUM_PROFILE_SECTIONS];
+	char     sectionNames[NUM_PROFILE_SECTIONS][4];
+} ProfileTelemetry;
+
+#if defined(ENABLE_PROFILER) && defined(NDEBUG)
+#undef ENABLE_PROFILER
+#endif
+
+#ifdef ENABLE_PROFILER
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start timer 2. Needs initIRQ() to have started the hblank counter. */
+void initProfiler(void);
+
+void profileBegin(ProfileSection section);
+void profileEnd(ProfileSection section);
+
+/* Close the frame's totals and publish its telemetry, updating the
+ * statistics every PROFILER_WINDOW frames. Returns true when new statistics
+ * are available. */
+bool profileEndFrame(void);
+
+const ProfileStats *getProfileStats(ProfileSection section);
+
+/* Set a counter to publish with the frame's timings */
+void profileCount(ProfileCounter counter, uint32_t value);
+
+const ProfileTelemetry *getProfileTelemetry(void);
+
+/* Draw a line per section: name, average and an avg/max bar */
+void drawProfiler(DMAChain *chain, const TextureInfo *font, int x, int y);
+
+/* Print the last window's statistics to the serial port */
+void dumpProfiler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define PROFILE_BEGIN(section) profileBegin(section)
+#define PROFILE_END(section)   profileEnd(section)
+
+#else
+
+#define PROFILE_BEGIN(section)
+#define PROFILE_END(section)
+
+#endif
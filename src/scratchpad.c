@@ -0,0 +1,89 @@
+/*
+ * Scratchpad arena allocator for PS1 bare-metal
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "scratchpad.h"
+
+static size_t staticTop = 0;
+static size_t frameTop  = 0;
+
+#ifndef NDEBUG
+static size_t highWater = 0;
+#endif
+
+static inline size_t alignSize(size_t size) {
+	return (size + SCRATCHPAD_ALIGN - 1) & ~(SCRATCHPAD_ALIGN - 1);
+}
+
+void *scratchpadAllocStatic(size_t size) {
+	// Static blocks go below the frame region, so they can only be carved out
+	// while no frame allocations are live.
+	assert(frameTop == staticTop);
+
+	void *ptr = scratchpadAlloc(size);
+	staticTop = frameTop;
+
+	return ptr;
+}
+
+void *scratchpadTryAlloc(size_t size) {
+	size = alignSize(size);
+
+	if ((frameTop + size) > SCRATCHPAD_SIZE)
+		return 0;
+
+	void *ptr = (void *) (SCRATCHPAD_BASE + frameTop);
+	frameTop += size;
+
+#ifndef NDEBUG
+	if (frameTop > highWater)
+		highWater = frameTop;
+#endif
+
+	return ptr;
+}
+
+void *scratchpadAlloc(size_t size) {
+	void *ptr = scratchpadTryAlloc(size);
+
+	// Callers don't check the result, so this has to stop release builds too
+	// rather than hand out NULL
+	if (!ptr) {
+		printf("Scratchpad exhausted allocating %u bytes!\n", (unsigned) size);
+
+		for (;;)
+			__asm__ volatile("");
+	}
+
+	return ptr;
+}
+
+void scratchpadResetFrame(void) {
+	frameTop = staticTop;
+}
+
+ScratchpadMark scratchpadMark(void) {
+	return frameTop;
+}
+
+void scratchpadRelease(ScratchpadMark mark) {
+	assert((mark >= staticTop) && (mark <= frameTop));
+
+	frameTop = mark;
+}
+
+size_t scratchpadGetFree(void) {
+	return SCRATCHPAD_SIZE - frameTop;
+}
+
+size_t scratchpadGetHighWater(void) {
+#ifndef NDEBUG
+	return highWater;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,63 @@
+/*
+ * Scratchpad arena allocator for PS1 bare-metal
+ *
+ * The R3000's 1 KB data cache is mapped as zero wait state RAM at 0x1f800000.
+ * This is a bump allocator over it: static allocations made at startup sit at
+ * the bottom, frame allocations above them are dropped by
+ * scratchpadResetFrame(), and scratchpadMark()/scratchpadRelease() give
+ * function-scoped temporaries.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef LANDER_HOST
+/* The host build (see host/) backs the scratchpad with an ordinary array */
+extern uint8_t hostScratchpad[];
+#define SCRATCHPAD_BASE ((uintptr_t) hostScratchpad)
+#else
+#define SCRATCHPAD_BASE 0x1f800000
+#endif
+#define SCRATCHPAD_SIZE 1024
+
+/* Allocation granularity, keeps every block word aligned for lwc2/swc2 */
+#define SCRATCHPAD_ALIGN 4
+
+/* Fail the build if a fixed-size block can't fit in the scratchpad */
+#define SCRATCHPAD_STATIC_ASSERT(size, what) \
+	_Static_assert((size) <= SCRATCHPAD_SIZE, what " does not fit in the scratchpad")
+
+typedef size_t ScratchpadMark;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Allocate memory that lives for the whole program, before any frame use */
+void *scratchpadAllocStatic(size_t size);
+
+/* Allocate frame-scoped memory. Never returns NULL: running out of scratchpad
+ * halts, in release builds too. */
+void *scratchpadAlloc(size_t size);
+
+/* Same as scratchpadAlloc() but returns NULL instead of halting */
+void *scratchpadTryAlloc(size_t size);
+
+/* Free everything allocated since the last reset, keeping static blocks */
+void scratchpadResetFrame(void);
+
+/* Save and restore the allocation pointer around temporaries */
+ScratchpadMark scratchpadMark(void);
+void scratchpadRelease(ScratchpadMark mark);
+
+/* Bytes still available for frame allocations */
+size_t scratchpadGetFree(void);
+
+/* Highest number of bytes ever in use (always 0 in NDEBUG builds) */
+size_t scratchpadGetHighWater(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,171 @@
+/*
+ * Shared geometry library for background shapes
+ */
+
+#include <stdint.h>
+#include "shapes.h"
+#include "lod.h"
+#include "model.h"
+
+#define S SHAPE_SIZE
+
+/* Components of 4.12 unit normals: 1, 1 / sqrt(3), and 1 / sqrt(5),
+ * 2 / sqrt(5) for the pyramid's sides */
+#define N1 4096
+#define N3 2365
+#define N5 1832
+#define N5_2 3664
+
+/* Faces carry the index of their outward normal */
+#define TRI(a, b, c, n) { (a), (b), (c), -1, 0, 0, 0, -1, (n) }
+
+/* Quad given in perimeter order, stored in GP0 order. (b, c, a) has the same
+ * winding as the (a, b, c) triangle of the equivalent TRI() pair and the GPU
+ * fills in (c, a, d) as the second half. */
+#define QUAD(a, b, c, d, n) { (b), (c), (a), (d), 0, 0, 0, 0, (n) }
+
+/* Cube: 6 faces, one quad each */
+static const GTEVector16 cubeVertices[] = {
+	{ -S, -S, -S, 0 },  /* Back bottom left */
+	{  S, -S, -S, 0 },  /* Back bottom right */
+	{  S,  S, -S, 0 },  /* Back top right */
+	{ -S,  S, -S, 0 },  /* Back top left */
+	{ -S, -S,  S, 0 },  /* Front bottom left */
+	{  S, -S,  S, 0 },  /* Front bottom right */
+	{  S,  S,  S, 0 },  /* Front top right */
+	{ -S,  S,  S, 0 }   /* Front top left */
+};
+
+static const GTEVector16 cubeNormals[] = {
+	{   0,   0,  N1, 0 },  /* Front */
+	{   0,   0, -N1, 0 },  /* Back */
+	{ -N1,   0,   0, 0 },  /* Left */
+	{  N1,   0,   0, 0 },  /* Right */
+	{   0,  N1,   0, 0 },  /* Top */
+	{   0, -N1,   0, 0 }   /* Bottom */
+};
+
+static const Face cubeFaces[] = {
+	QUAD(4, 5, 6, 7, 0),  /* Front */
+	QUAD(1, 0, 3, 2, 1),  /* Back */
+	QUAD(0, 4, 7, 3, 2),  /* Left */
+	QUAD(5, 1, 2, 6, 3),  /* Right */
+	QUAD(7, 6, 2, 3, 4),  /* Top */
+	QUAD(0, 1, 5, 4, 5)   /* Bottom */
+};
+
+/* Same cube split into triangles, kept for the quad benchmark */
+static const Face cubeTriFaces[] = {
+	TRI(4, 5, 6, 0), TRI(4, 6, 7, 0),  /* Front */
+	TRI(1, 0, 3, 1), TRI(1, 3, 2, 1),  /* Back */
+	TRI(0, 4, 7, 2), TRI(0, 7, 3, 2),  /* Left */
+	TRI(5, 1, 2, 3), TRI(5, 2, 6, 3),  /* Right */
+	TRI(7, 6, 2, 4), TRI(7, 2, 3, 4),  /* Top */
+	TRI(0, 1, 5, 5), TRI(0, 5, 4, 5)   /* Bottom */
+};
+
+/* Pyramid: apex at top, square base */
+static const GTEVector16 pyramidVertices[] = {
+	{ -S,  S, -S, 0 },  /* Base back left */
+	{  S,  S, -S, 0 },  /* Base back right */
+	{  S,  S,  S, 0 },  /* Base front right */
+	{ -S,  S,  S, 0 },  /* Base front left */
+	{  0, -S,  0, 0 }   /* Apex */
+};
+
+static const GTEVector16 pyramidNormals[] = {
+	{     0, -N5,  N5_2, 0 },  /* Front */
+	{  N5_2, -N5,     0, 0 },  /* Right */
+	{     0, -N5, -N5_2, 0 },  /* Back */
+	{ -N5_2, -N5,     0, 0 },  /* Left */
+	{     0,  N1,     0, 0 }   /* Base */
+};
+
+static const Face pyramidFaces[] = {
+	TRI(4, 3, 2, 0), TRI(4, 2, 1, 1), TRI(4, 1, 0, 2), TRI(4, 0, 3, 3),  /* Sides */
+	QUAD(0, 1, 2, 3, 4)                                                  /* Base */
+};
+
+static const Face pyramidTriFaces[] = {
+	TRI(4, 3, 2, 0), TRI(4, 2, 1, 1), TRI(4, 1, 0, 2), TRI(4, 0, 3, 3),  /* Sides */
+	TRI(0, 1, 2, 4), TRI(0, 2, 3, 4)                                     /* Base */
+};
+
+/* Octahedron: top, bottom, front, back, left, right */
+static const GTEVector16 octahedronVertices[] = {
+	{  0, -S,  0, 0 },  /* Top */
+	{  0,  S,  0, 0 },  /* Bottom */
+	{  0,  0,  S, 0 },  /* Front */
+	{  0,  0, -S, 0 },  /* Back */
+	{ -S,  0,  0, 0 },  /* Left */
+	{  S,  0,  0, 0 }   /* Right */
+};
+
+static const GTEVector16 octahedronNormals[] = {
+	{  N3, -N3,  N3, 0 }, {  N3, -N3, -N3, 0 },  /* Top half */
+	{ -N3, -N3, -N3, 0 }, { -N3, -N3,  N3, 0 },
+	{  N3,  N3,  N3, 0 }, {  N3,  N3, -N3, 0 },  /* Bottom half */
+	{ -N3,  N3, -N3, 0 }, { -N3,  N3,  N3, 0 }
+};
+
+static const Face octahedronFaces[] = {
+	TRI(0, 2, 5, 0), TRI(0, 5, 3, 1), TRI(0, 3, 4, 2), TRI(0, 4, 2, 3),
+	TRI(1, 5, 2, 4), TRI(1, 3, 5, 5), TRI(1, 4, 3, 6), TRI(1, 2, 4, 7)
+};
+
+#define ARRAY_LENGTH(x) (sizeof(x) / sizeof((x)[0]))
+
+#define FLAT_MESH(name, faceSet, boundsRadius) { \
+	.numVertices = ARRAY_LENGTH(name ## Vertices), \
+	.numUVs      = 0, \
+	.numFaces    = ARRAY_LENGTH(faceSet ## Faces), \
+	.version     = MODEL_VERSION_1, \
+	.numGroups   = 0, \
+	.bounds      = { 0, 0, 0, (boundsRadius) }, \
+	.vertices    = name ## Vertices, \
+	.uvs         = 0, \
+	.faces       = faceSet ## Faces, \
+	.groups      = 0, \
+	.normals     = name ## Normals \
+}
+
+/* Bounding radii: corners of the cube and pyramid base are S * sqrt(3) away
+ * from the origin, rounded up */
+const Model cubeMesh       = FLAT_MESH(cube,       cube,       35);
+const Model pyramidMesh    = FLAT_MESH(pyramid,    pyramid,    35);
+const Model octahedronMesh = FLAT_MESH(octahedron, octahedron, S);
+
+const Model cubeTriMesh    = FLAT_MESH(cube,       cubeTri,    35);
+const Model pyramidTriMesh = FLAT_MESH(pyramid,    pyramidTri, 35);
+
+const Model *const shapeMeshes[NUM_SHAPE_TYPES] = {
+	&cubeMesh,
+	&pyramidMesh,
+	&octahedronMesh
+};
+
+const Model *const shapeTriMeshes[NUM_SHAPE_TYPES] = {
+	&cubeTriMesh,
+	&pyramidTriMesh,
+	&octahedronMesh
+};
+
+/* The shapes are about as simple as meshes get, so their only lower level of
+ * detail is a sprite */
+#define SHAPE_LOD(mesh) { \
+	.levels    = { &(mesh) }, \
+	.minRadius = { SHAPE_SPRITE_RADIUS }, \
+	.numLevels = 1 \
+}
+
+const MeshLOD shapeLODs[NUM_SHAPE_TYPES] = {
+	SHAPE_LOD(cubeMesh),
+	SHAPE_LOD(pyramidMesh),
+	SHAPE_LOD(octahedronMesh)
+};
+
+const MeshLOD shapeTriLODs[NUM_SHAPE_TYPES] = {
+	SHAPE_LOD(cubeTriMesh),
+	SHAPE_LOD(pyramidTriMesh),
+	SHAPE_LOD(octahedronMesh)
+};
@@ -0,0 +1,49 @@
+/*
+ * Shared geometry library for background shapes
+ *
+ * Flat-shaded primitives, using quads where faces are planar, stored as
+ * static Model-compatible meshes with face normals for GTE lighting, so every
+ * debris instance can be drawn through the mesh renderer without building
+ * vertex or face tables at runtime.
+ */
+
+#pragma once
+
+#include "lod.h"
+#include "model.h"
+
+/* Shape types, used as indices into shapeMeshes[] */
+#define SHAPE_CUBE     0
+#define SHAPE_PYRAMID  1
+#define SHAPE_SPHERE   2  /* Low-poly octahedron */
+#define NUM_SHAPE_TYPES 3
+
+/* Half-extent of every shape in model units */
+#define SHAPE_SIZE 20
+
+/* On-screen radius in pixels below which shapes are drawn as sprites */
+#define SHAPE_SPRITE_RADIUS 4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const Model cubeMesh;
+extern const Model pyramidMesh;
+extern const Model octahedronMesh;
+
+/* Same shapes with every quad split into two triangles, for comparing the
+ * quad and triangle paths */
+extern const Model cubeTriMesh;
+extern const Model pyramidTriMesh;
+
+extern const Model *const shapeMeshes[NUM_SHAPE_TYPES];
+extern const Model *const shapeTriMeshes[NUM_SHAPE_TYPES];
+
+/* Levels of detail for each shape type, for drawMeshInstances() */
+extern const MeshLOD shapeLODs[NUM_SHAPE_TYPES];
+extern const MeshLOD shapeTriLODs[NUM_SHAPE_TYPES];
+
+#ifdef __cplusplus
+}
+#endif
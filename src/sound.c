@@ -0,0 +1,62 @@
+/*
+ * Sound effect bank for PS1 bare-metal
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sound.h"
+#include "spu.h"
+
+void initSoundBank(SoundBank *bank) {
+	for (int i = 0; i < SOUND_BANK_SIZE; i++)
+		bank->sounds[i].block = -1;
+
+	bank->numSounds = 0;
+}
+
+int loadSound(
+	SoundBank  *bank,
+	const void *data,
+	size_t     size,
+	int        sampleRate,
+	int        priority
+) {
+	if (bank->numSounds >= SOUND_BANK_SIZE)
+		return -1;
+
+	int block = allocateSPURAM(size);
+
+	if (block < 0)
+		return -1;
+
+	uploadSPURAM(block, data, size);
+
+	int   index = bank->numSounds++;
+	Sound *sound = &bank->sounds[index];
+
+	sound->block    = block;
+	sound->priority = priority;
+	sound->pitch    = getSPUPitch(sampleRate);
+
+	return index;
+}
+
+void freeSoundBank(SoundBank *bank) {
+	for (int i = 0; i < bank->numSounds; i++) {
+		freeSPURAM(bank->sounds[i].block);
+		bank->sounds[i].block = -1;
+	}
+
+	bank->numSounds = 0;
+}
+
+int playSound(const SoundBank *bank, int sound, int volume) {
+	if ((sound < 0) || (sound >= bank->numSounds))
+		return -1;
+
+	const Sound *entry = &bank->sounds[sound];
+
+	return playVoice(
+		getSPURAMAddress(entry->block), entry->pitch, volume, entry->priority
+	);
+}
@@ -0,0 +1,59 @@
+/*
+ * Sound effect bank for PS1 bare-metal
+ *
+ * A bank keeps a set of SPU-ADPCM samples resident in SPU RAM, each with its
+ * pitch worked out once at load time and a priority for the voice allocator,
+ * so triggering one is just a few register writes. Overlapping triggers of
+ * the same sound get a voice each instead of restarting each other.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SOUND_BANK_SIZE 16
+
+/* Priorities passed to the voice allocator, higher cuts off lower */
+#define SOUND_PRIORITY_LOW    0
+#define SOUND_PRIORITY_NORMAL 64
+#define SOUND_PRIORITY_HIGH   128
+
+typedef struct {
+	int8_t   block;    /* SPU RAM handle, -1 if the slot is empty */
+	uint8_t  priority;
+	uint16_t pitch;
+} Sound;
+
+typedef struct {
+	Sound   sounds[SOUND_BANK_SIZE];
+	uint8_t numSounds;
+} SoundBank;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void initSoundBank(SoundBank *bank);
+
+/*
+ * Upload a raw SPU-ADPCM sample into the bank. Returns its index, or -1 if
+ * the bank or SPU RAM is full.
+ */
+int loadSound(
+	SoundBank  *bank,
+	const void *data,
+	size_t     size,
+	int        sampleRate,
+	int        priority
+);
+
+/* Free every sample of the bank from SPU RAM */
+void freeSoundBank(SoundBank *bank);
+
+/* Play a sound on a free or stolen voice, returns the voice or -1 */
+int playSound(const SoundBank *bank, int sound, int volume);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,16 +3,52 @@
  * Source: psyqo/modplayer/modplayer.c
  */
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <stdio.h>
 #include "spu.h"
+#include "irq.h"
 #include "ps1/registers.h"
 
-/* SPU RAM layout - matching psyqo */
-#define SPU_RAM_START 0x1010
-
-static uint32_t spuRamPos = SPU_RAM_START;
+/* Blocks moved at a time by compactSPURAM() */
+#define SPU_COMPACT_CHUNK 1024
+
+typedef struct {
+	uint32_t addr;
+	uint32_t size; /* 0 if the handle is free */
+} SPUBlock;
+
+/* Blocks handed out, and their handles sorted by address */
+static SPUBlock blocks[SPU_MAX_BLOCKS];
+static int8_t   blockOrder[SPU_MAX_BLOCKS];
+static int      numBlocks = 0;
+
+/* Queued asynchronous uploads, the one at the head is in flight */
+typedef struct {
+	const void          *data;
+	uint32_t            addr;
+	uint32_t            size;
+	SPUTransferCallback callback;
+	void                *arg;
+} SPUUpload;
+
+static SPUUpload     uploadQueue[SPU_UPLOAD_QUEUE_SIZE];
+static uint8_t       uploadHead = 0, uploadLength = 0;
+static volatile bool uploadActive = false;
+
+static IRQCallback spuIRQCallback = NULL;
+
+static void onUploadDone(DMAChannel channel);
+
+/* Voice allocator state */
+static uint32_t voicesHeld    = 0; /* Reserved, never released or stolen */
+static uint32_t voicesBusy    = 0;
+static uint32_t voicesKeyedOn = 0; /* Keyed on since the last update */
+static uint32_t nextSerial    = 0;
+static uint8_t  voicePriority[SPU_NUM_VOICES];
+static uint32_t voiceSerial[SPU_NUM_VOICES];
+static uint32_t voiceAddr[SPU_NUM_VOICES];  /* Sample each voice last started */
 
 /* psyqo register definitions (from common/hardware/spu.h) */
 #define SPU_VOICES ((volatile struct SPUVoice *)0x1f801c00)
@@ -28,6 +64,9 @@ static uint32_t spuRamPos = SPU_RAM_START;
 #define SPU_NOISE_EN_HIGH   (*(volatile uint16_t *)0x1f801d96)
 #define SPU_REVERB_EN_LOW   (*(volatile uint16_t *)0x1f801d98)
 #define SPU_REVERB_EN_HIGH  (*(volatile uint16_t *)0x1f801d9a)
+#define SPU_ENDX_LOW        (*(volatile uint16_t *)0x1f801d9c)
+#define SPU_ENDX_HIGH       (*(volatile uint16_t *)0x1f801d9e)
+#define SPU_IRQ_ADDR        (*(volatile uint16_t *)0x1f801da4)
 #define SPU_RAM_DTA         (*(volatile uint16_t *)0x1f801da6)
 #define SPU_CTRL_REG        (*(volatile uint16_t *)0x1f801daa)
 #define SPU_RAM_DTC         (*(volatile uint16_t *)0x1f801dac)
@@ -60,16 +99,6 @@ struct DMARegisters {
 #define DMA_CTRL ((volatile struct DMARegisters *)0x1f801080)
 #define DMA_SPU 4
 
-/*
- * SPUWaitIdle - matching psyqo with timeout for safety
- */
-static void SPUWaitIdle(void) {
-	int timeout = 10000;
-	while ((SPU_STATUS_REG & 0x07ff) != 0 && --timeout > 0) {
-		for (volatile int c = 0; c < 100; c++);
-	}
-}
-
 /*
  * SPUResetVoice - matching psyqo exactly
  */
@@ -114,10 +143,24 @@ void setupSPU(void) {
 	SPU_CTRL_REG = 0x8000;
 
 	/* Reset all 24 voices */
-	for (int i = 0; i < 24; i++) {
+	for (int i = 0; i < SPU_NUM_VOICES; i++) {
 		SPUResetVoice(i);
+		voiceAddr[i] = 0;
 	}
 
+	numBlocks     = 0;
+	voicesHeld    = 0;
+	voicesBusy    = 0;
+	voicesKeyedOn = 0;
+
+	uploadHead   = 0;
+	uploadLength = 0;
+	uploadActive = false;
+	setDMACallback(DMA_SPU, onUploadDone);
+
+	for (int i = 0; i < SPU_MAX_BLOCKS; i++)
+		blocks[i].size = 0;
+
 	printf("SPU: Ready, CTRL=0x%04X STAT=0x%04X\n", SPU_CTRL_REG, SPU_STATUS_REG);
 }
 
@@ -134,63 +177,291 @@ void spuUnmute(void) {
 }
 
 /*
- * Upload SPU-ADPCM data to SPU RAM
- * Note: Our data is raw SPU-ADPCM (no VAG header) from psxavenc -t spu
+ * Start moving data between main RAM and SPU RAM with DMA, size rounded up to
+ * 64 bytes - matching psyqo's upload sequence
  */
-uint32_t uploadVAG(const void *data, size_t size) {
-	const uint8_t *spuData = (const uint8_t *)data;
-	size_t spuSize = size;
-
-	uint32_t addr = spuRamPos;
-
-	printf("SPU: Upload %u bytes to 0x%05lX\n", (unsigned)spuSize, (unsigned long)addr);
-
+static void SPUStartDMA(const void *data, uint32_t addr, size_t size, bool write) {
 	/* Calculate BCR - matching psyqo exactly */
-	uint32_t bcr = spuSize >> 6;
-	if (spuSize & 0x3f) bcr++;
+	uint32_t bcr = size >> 6;
+	if (size & 0x3f) bcr++;
 	bcr <<= 16;
 	bcr |= 0x10;
 
 	/* Set transfer address */
 	SPU_RAM_DTA = addr >> 3;
 
-	/* Set DMA write mode - matching psyqo exactly */
-	SPU_CTRL_REG = (SPU_CTRL_REG & ~0x0030) | 0x0020;
+	/* Set DMA write (2) or read (3) mode */
+	uint16_t mode = write ? 0x0020 : 0x0030;
+
+	SPU_CTRL_REG = (SPU_CTRL_REG & ~0x0030) | mode;
 	{
 		int timeout = 10000;
-		while ((SPU_CTRL_REG & 0x0030) != 0x0020 && --timeout > 0);
+		while ((SPU_CTRL_REG & 0x0030) != mode && --timeout > 0);
 	}
 
 	/* Note: psyqo does SBUS_DEV4_CTRL &= ~0x0f000000 here but that may
 	 * cause issues with HLE BIOS, so we skip it */
 
 	/* DMA transfer - matching psyqo exactly */
-	DMA_CTRL[DMA_SPU].MADR = (uint32_t)spuData;
+	DMA_CTRL[DMA_SPU].MADR = (uint32_t)data;
 	DMA_CTRL[DMA_SPU].BCR = bcr;
-	DMA_CTRL[DMA_SPU].CHCR = 0x01000201;
+	DMA_CTRL[DMA_SPU].CHCR = write ? 0x01000201 : 0x01000200;
+}
 
-	/* Wait for DMA completion */
-	{
-		int timeout = 100000;
-		while ((DMA_CTRL[DMA_SPU].CHCR & 0x01000000) != 0 && --timeout > 0);
+/*
+ * Blocking transfer, only for compactSPURAM() which has to finish before
+ * anything else touches SPU RAM. Spins rather than servicing interrupts so
+ * the upload queue's completion handler doesn't see it.
+ */
+static void SPUTransfer(void *data, uint32_t addr, size_t size, bool write) {
+	SPUStartDMA(data, addr, size, write);
+
+	while ((DMA_CTRL[DMA_SPU].CHCR & 0x01000000) != 0)
+		__asm__ volatile("");
+}
+
+/*
+ * Claim the next queued upload for the DMA, called with interrupts masked.
+ * The caller starts it once they're enabled again, as SPUStartDMA() may spin
+ * a while waiting for the SPU to change transfer mode.
+ */
+static const SPUUpload *claimNextUpload(void) {
+	if (uploadActive || !uploadLength)
+		return NULL;
+
+	uploadActive = true;
+	return &uploadQueue[uploadHead];
+}
+
+static void startUpload(const SPUUpload *upload) {
+	if (upload)
+		SPUStartDMA(upload->data, upload->addr, upload->size, true);
+}
+
+/* DMA completion callback, from the BIOS DMA event or serviceIRQs() */
+static void onUploadDone(DMAChannel channel) {
+	uint32_t status = enterCriticalSection();
+
+	if (!uploadActive) {
+		exitCriticalSection(status);
+		return;
 	}
 
-	/* Update allocation pointer */
-	spuRamPos = addr + ((spuSize + 63) & ~63);
+	// The callback may queue another upload into the slot being freed
+	SPUTransferCallback callback = uploadQueue[uploadHead].callback;
+	void                *arg     = uploadQueue[uploadHead].arg;
 
-	printf("SPU: Done\n");
-	return addr;
+	uploadHead = (uploadHead + 1) % SPU_UPLOAD_QUEUE_SIZE;
+	uploadLength--;
+	uploadActive = false;
+
+	const SPUUpload *next = claimNextUpload();
+	exitCriticalSection(status);
+
+	/* Keep the DMA busy while the callback runs */
+	startUpload(next);
+
+	if (callback)
+		callback(arg);
+}
+
+bool queueSPUUpload(
+	uint32_t            addr,
+	const void          *data,
+	size_t              size,
+	SPUTransferCallback callback,
+	void                *arg
+) {
+	// With BIOS events enabled onUploadDone() runs from the DMA interrupt, so
+	// keep it from popping the queue halfway through an insertion
+	uint32_t status = enterCriticalSection();
+
+	if (uploadLength >= SPU_UPLOAD_QUEUE_SIZE) {
+		exitCriticalSection(status);
+		return false;
+	}
+
+	SPUUpload *upload = &uploadQueue[(uploadHead + uploadLength) % SPU_UPLOAD_QUEUE_SIZE];
+
+	upload->data     = data;
+	upload->addr     = addr;
+	upload->size     = size;
+	upload->callback = callback;
+	upload->arg      = arg;
+
+	uploadLength++;
+
+	const SPUUpload *next = claimNextUpload();
+	exitCriticalSection(status);
+
+	startUpload(next);
+	return true;
+}
+
+bool isSPUUploadBusy(void) {
+	return uploadLength != 0;
+}
+
+void waitForSPUUploads(void) {
+	while (uploadLength) {
+		waitForDMA(DMA_SPU);
+		serviceIRQs();
+	}
+}
+
+int allocateSPURAM(size_t size) {
+	if (!size)
+		return -1;
+
+	size = (size + SPU_RAM_ALIGN - 1) & ~(SPU_RAM_ALIGN - 1);
+
+	int handle = -1;
+	for (int i = 0; i < SPU_MAX_BLOCKS; i++) {
+		if (!blocks[i].size) {
+			handle = i;
+			break;
+		}
+	}
+	if (handle < 0)
+		return -1;
+
+	/* First fit: take the first gap between blocks large enough */
+	uint32_t addr = SPU_RAM_START;
+	int      slot = 0;
+
+	for (; slot < numBlocks; slot++) {
+		const SPUBlock *block = &blocks[blockOrder[slot]];
+
+		if ((block->addr - addr) >= size)
+			break;
+
+		addr = block->addr + block->size;
+	}
+
+	if ((slot == numBlocks) && ((SPU_RAM_END - addr) < size))
+		return -1;
+
+	for (int i = numBlocks; i > slot; i--)
+		blockOrder[i] = blockOrder[i - 1];
+
+	blockOrder[slot]    = handle;
+	blocks[handle].addr = addr;
+	blocks[handle].size = size;
+	numBlocks++;
+
+	return handle;
+}
+
+void freeSPURAM(int handle) {
+	if ((handle < 0) || (handle >= SPU_MAX_BLOCKS) || !blocks[handle].size)
+		return;
+
+	/* Don't leave voices playing whatever gets uploaded here next */
+	uint32_t start = blocks[handle].addr;
+	uint32_t end   = start + blocks[handle].size;
+
+	for (int i = 0; i < SPU_NUM_VOICES; i++) {
+		if ((voiceAddr[i] >= start) && (voiceAddr[i] < end)) {
+			stopChannel(i);
+			voiceAddr[i] = 0;
+		}
+	}
+
+	int slot = 0;
+	while (blockOrder[slot] != handle)
+		slot++;
+
+	numBlocks--;
+	for (int i = slot; i < numBlocks; i++)
+		blockOrder[i] = blockOrder[i + 1];
+
+	blocks[handle].size = 0;
+}
+
+uint32_t getSPURAMAddress(int handle) {
+	return blocks[handle].addr;
+}
+
+size_t getSPURAMFree(void) {
+	size_t used = 0;
+
+	for (int i = 0; i < numBlocks; i++)
+		used += blocks[blockOrder[i]].size;
+
+	return (SPU_RAM_END - SPU_RAM_START) - used;
+}
+
+bool compactSPURAM(void) {
+	static uint32_t buffer[SPU_COMPACT_CHUNK / 4];
+
+	/* A held voice (a stream, ...) keeps playing from its block, which can't
+	 * move under it */
+	if (voicesHeld)
+		return false;
+
+	waitForSPUUploads();
+
+	/* Voices may be playing from the blocks about to move */
+	SPU_KEY_OFF_LOW  = 0xffff;
+	SPU_KEY_OFF_HIGH = 0x00ff;
+	voicesBusy       = 0;
+
+	uint32_t addr = SPU_RAM_START;
+
+	for (int i = 0; i < numBlocks; i++) {
+		SPUBlock *block = &blocks[blockOrder[i]];
+
+		/* Blocks only ever move down, so copying in ascending chunks never
+		 * overwrites data that hasn't been moved yet */
+		if (block->addr != addr) {
+			for (uint32_t offset = 0; offset < block->size; offset += SPU_COMPACT_CHUNK) {
+				size_t chunk = block->size - offset;
+				if (chunk > SPU_COMPACT_CHUNK) chunk = SPU_COMPACT_CHUNK;
+
+				SPUTransfer(buffer, block->addr + offset, chunk, false);
+				SPUTransfer(buffer, addr + offset, chunk, true);
+			}
+
+			block->addr = addr;
+		}
+
+		addr += block->size;
+	}
+
+	SPU_CTRL_REG &= ~0x0030;
+	return true;
+}
+
+void uploadSPURAM(int handle, const void *data, size_t size) {
+	while (!queueSPUUpload(blocks[handle].addr, data, size, NULL, NULL))
+		waitForSPUUploads();
+
+	waitForSPUUploads();
 }
 
 /*
- * Play sample - fast version without debug output
+ * Upload SPU-ADPCM data to SPU RAM
+ * Note: Our data is raw SPU-ADPCM (no VAG header) from psxavenc -t spu
  */
-void playSample(int channel, uint32_t spuAddr, int sampleRate, int volume) {
-	/* Calculate pitch - matching psyqo formula */
-	int pitch = (sampleRate << 12) / 44100;
-	if (pitch > 0x3FFF) pitch = 0x3FFF;
-	if (pitch < 1) pitch = 1;
+uint32_t uploadVAG(const void *data, size_t size) {
+	int handle = allocateSPURAM(size);
+
+	if (handle < 0) {
+		printf("SPU: No room for %u bytes\n", (unsigned)size);
+		return 0;
+	}
+
+	uint32_t addr = blocks[handle].addr;
+
+	printf("SPU: Upload %u bytes to 0x%05lX\n", (unsigned)size, (unsigned long)addr);
+	uploadSPURAM(handle, data, size);
+	printf("SPU: Done\n");
+
+	return addr;
+}
 
+/* Point a voice at a sample and key it on */
+static void startVoice(int channel, uint32_t spuAddr, int pitch, int volume) {
 	/* Volume scaling */
 	if (volume > 0x3FFF) volume = 0x3FFF;
 
@@ -198,6 +469,7 @@ void playSample(int channel, uint32_t spuAddr, int sampleRate, int volume) {
 	SPU_VOICES[channel].volumeLeft = volume;
 	SPU_VOICES[channel].volumeRight = volume;
 	SPU_VOICES[channel].sampleStartAddr = spuAddr >> 3;
+	voiceAddr[channel] = spuAddr;
 
 	/* Key on immediately - no wait needed for sound effects */
 	if (channel < 16) {
@@ -210,10 +482,157 @@ void playSample(int channel, uint32_t spuAddr, int sampleRate, int volume) {
 	SPU_VOICES[channel].sampleRate = pitch;
 }
 
+int getSPUPitch(int sampleRate) {
+	/* Calculate pitch - matching psyqo formula */
+	int pitch = (sampleRate << 12) / 44100;
+	if (pitch > 0x3FFF) pitch = 0x3FFF;
+	if (pitch < 1) pitch = 1;
+
+	return pitch;
+}
+
+/*
+ * Play sample - fast version without debug output
+ */
+void playSample(int channel, uint32_t spuAddr, int sampleRate, int volume) {
+	startVoice(channel, spuAddr, getSPUPitch(sampleRate), volume);
+}
+
 void stopChannel(int channel) {
 	if (channel < 16) {
 		SPU_KEY_OFF_LOW = (1 << channel);
 	} else {
 		SPU_KEY_OFF_HIGH = (1 << (channel - 16));
 	}
+
+	voicesBusy &= ~(1 << channel);
+	voicesHeld &= ~(1 << channel);
+}
+
+int allocateVoice(int priority) {
+	uint32_t freeVoices = ~voicesBusy & ((1 << SPU_NUM_VOICES) - 1);
+	int      voice      = -1;
+
+	if (freeVoices) {
+		voice = 0;
+		while (!(freeVoices & (1 << voice)))
+			voice++;
+	} else {
+		/* Steal from the lowest priority playing, preferring the quietest
+		 * envelope and then the oldest among equals. Voices of a higher
+		 * priority than the new sound are never cut off. */
+		int bestPriority = priority + 1, bestVolume = 0;
+
+		for (int i = 0; i < SPU_NUM_VOICES; i++) {
+			int voicePrio = voicePriority[i];
+			int volume    = SPU_VOICES[i].currentVolume & 0x7fff;
+
+			if ((voicePrio > priority) || (voicesHeld & (1 << i)))
+				continue;
+			if (
+				(voicePrio < bestPriority) ||
+				((voicePrio == bestPriority) && (volume < bestVolume)) ||
+				(
+					(voicePrio == bestPriority) && (volume == bestVolume) &&
+					((int32_t) (voiceSerial[i] - voiceSerial[voice]) < 0)
+				)
+			) {
+				voice        = i;
+				bestPriority = voicePrio;
+				bestVolume   = volume;
+			}
+		}
+
+		if (voice < 0)
+			return -1;
+	}
+
+	voicesBusy          |= 1 << voice;
+	voicesKeyedOn       |= 1 << voice;
+	voicePriority[voice] = priority;
+	voiceSerial[voice]   = nextSerial++;
+
+	return voice;
+}
+
+int reserveVoice(void) {
+	int voice = allocateVoice(SPU_PRIORITY_RESERVED);
+
+	if (voice >= 0)
+		voicesHeld |= 1 << voice;
+
+	return voice;
+}
+
+void startVoiceLoop(
+	int      voice,
+	uint32_t spuAddr,
+	uint32_t repeatAddr,
+	int      pitch,
+	int      volume
+) {
+	startVoice(voice, spuAddr, pitch, volume);
+
+	/* Written after key on, which may reload it */
+	SPU_VOICES[voice].sampleRepeatAddr = repeatAddr >> 3;
+}
+
+void setVoiceRepeatAddress(int voice, uint32_t repeatAddr) {
+	SPU_VOICES[voice].sampleRepeatAddr = repeatAddr >> 3;
+}
+
+int getVoiceEnvelope(int voice) {
+	return SPU_VOICES[voice].currentVolume & 0x7fff;
+}
+
+int playVoice(uint32_t spuAddr, int pitch, int volume, int priority) {
+	int voice = allocateVoice(priority);
+
+	if (voice >= 0)
+		startVoice(voice, spuAddr, pitch, volume);
+
+	return voice;
+}
+
+void updateSPUVoices(void) {
+	/* ENDX is set once a voice has played its last block. Voices keyed on
+	 * since the last update may still show the flag of their previous
+	 * sample, so they're left alone until the next one. */
+	uint32_t ended = SPU_ENDX_LOW | (SPU_ENDX_HIGH << 16);
+
+	voicesBusy   &= ~(ended & ~voicesKeyedOn & ~voicesHeld);
+	voicesKeyedOn = 0;
+}
+
+int getActiveVoices(void) {
+	int count = 0;
+
+	for (uint32_t mask = voicesBusy; mask; mask &= mask - 1)
+		count++;
+
+	return count;
+}
+
+/* The SPU IRQ is acknowledged by clearing its enable bit, setSPUIRQ() arms it
+ * again */
+static void spuIRQHandler(void) {
+	SPU_CTRL_REG &= ~0x0040;
+
+	if (spuIRQCallback)
+		spuIRQCallback();
+}
+
+void setSPUIRQ(uint32_t addr, IRQCallback callback) {
+	SPU_CTRL_REG  &= ~0x0040;
+	spuIRQCallback = callback;
+
+	if (!callback) {
+		setIRQCallback(IRQ_SPU, NULL);
+		return;
+	}
+
+	SPU_IRQ_ADDR = addr >> 3;
+	IRQ_STAT     = ~(1 << IRQ_SPU);
+	setIRQCallback(IRQ_SPU, spuIRQHandler);
+	SPU_CTRL_REG |= 0x0040;
 }
@@ -1,11 +1,40 @@
 /*
  * SPU helper functions for PS1 bare-metal
+ *
+ * SPU RAM is handed out in 64-byte aligned blocks identified by a handle,
+ * since compactSPURAM() may move them to merge free space. Voices for one-shot
+ * sounds come from a 24-voice allocator: free voices are used first, and once
+ * all are busy the lowest priority voice is stolen, quietest and then oldest
+ * first. updateSPUVoices() returns voices whose sample has ended.
+ *
+ * Uploads are queued and run in the background, each finishing with a
+ * callback from the DMA completion event, so loading samples mid-game doesn't
+ * stall the frame it happens in.
  */
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include "irq.h"
+
+#define SPU_NUM_VOICES 24
+
+/* SPU RAM usable for samples. The first 4 KB hold the capture buffers and
+ * psyqo's silent block, reverb is disabled so its work area is free. */
+#define SPU_RAM_START  0x1010
+#define SPU_RAM_END    0x80000
+#define SPU_RAM_ALIGN  64
+
+#define SPU_MAX_BLOCKS 32
+
+#define SPU_UPLOAD_QUEUE_SIZE 8
+
+/* Priority of voices taken with reserveVoice() */
+#define SPU_PRIORITY_RESERVED 255
+
+typedef void (*SPUTransferCallback)(void *arg);
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,15 +46,94 @@ void setupSPU(void);
 /* Unmute SPU - call after upload is complete */
 void spuUnmute(void);
 
-/* Upload VAG audio data to SPU RAM and return the SPU address */
+/* Allocate a block of SPU RAM, returns a handle or -1 if there's no room */
+int allocateSPURAM(size_t size);
+
+/* Release a block, its handle may be reused afterwards. Voices started from
+ * it are keyed off first. */
+void freeSPURAM(int handle);
+
+/* Current address of a block, which changes when compactSPURAM() moves it */
+uint32_t getSPURAMAddress(int handle);
+
+/* Bytes not allocated, possibly split over several gaps */
+size_t getSPURAMFree(void);
+
+/* Move every block down to close the gaps between them. Stops all voices,
+ * as they may be playing from blocks that move. Returns false without moving
+ * anything while a voice taken with reserveVoice() is held. */
+bool compactSPURAM(void);
+
+/*
+ * Queue a DMA upload to an SPU RAM address. The data must stay valid until
+ * the callback runs. Returns false if the queue is full.
+ */
+bool queueSPUUpload(
+	uint32_t            addr,
+	const void          *data,
+	size_t              size,
+	SPUTransferCallback callback,
+	void                *arg
+);
+
+/* Returns whether any queued upload hasn't completed yet */
+bool isSPUUploadBusy(void);
+
+/* Block until every queued upload has completed, servicing interrupts */
+void waitForSPUUploads(void);
+
+/* Copy data into an allocated block and wait for it to land */
+void uploadSPURAM(int handle, const void *data, size_t size);
+
+/* Upload VAG audio data to a new block of SPU RAM and return its address,
+ * or 0 if SPU RAM is full */
 uint32_t uploadVAG(const void *data, size_t size);
 
+/* Convert a sample rate in Hz to the SPU's 4.12 pitch */
+int getSPUPitch(int sampleRate);
+
 /* Play a sample on a specific channel (0-23) */
 void playSample(int channel, uint32_t spuAddr, int sampleRate, int volume);
 
 /* Stop playback on a channel */
 void stopChannel(int channel);
 
+/* Reserve a voice for a sound of the given priority, stealing one of equal
+ * or lower priority if all are busy. Returns -1 if none can be taken. */
+int allocateVoice(int priority);
+
+/* Take a voice for exclusive use (streams, music). It's never stolen or
+ * released by updateSPUVoices(), only by stopChannel(). */
+int reserveVoice(void);
+
+/* Start a voice with its repeat address set, for looping and ring buffers */
+void startVoiceLoop(
+	int      voice,
+	uint32_t spuAddr,
+	uint32_t repeatAddr,
+	int      pitch,
+	int      volume
+);
+
+/* Address a voice jumps to at its next loop end block */
+void setVoiceRepeatAddress(int voice, uint32_t repeatAddr);
+
+/* Current ADSR envelope level of a voice, 0 once it's silent */
+int getVoiceEnvelope(int voice);
+
+/* Allocate a voice and start a sample on it, returns the voice or -1 */
+int playVoice(uint32_t spuAddr, int pitch, int volume, int priority);
+
+/* Release voices that have finished playing. Call once per frame. */
+void updateSPUVoices(void);
+
+/* Number of voices currently allocated */
+int getActiveVoices(void);
+
+/* Call back once a voice reads from addr, or disable the SPU IRQ with NULL.
+ * The IRQ fires once per call, so the callback must set it up again. */
+void setSPUIRQ(uint32_t addr, IRQCallback callback);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,235 @@
+/*
+ * Streamed SPU-ADPCM playback for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "spu.h"
+#include "spustream.h"
+
+#define ADPCM_BLOCK_SIZE 16
+
+/* Flags in the second byte of each ADPCM block */
+#define ADPCM_FLAG_LOOP_END    0x01
+#define ADPCM_FLAG_LOOP_REPEAT 0x02
+
+typedef enum {
+	STREAM_STOPPED,
+	STREAM_PLAYING,
+	STREAM_ENDING   /* Last chunk playing, voice mutes at its end */
+} StreamState;
+
+static StreamState state = STREAM_STOPPED;
+
+static SPUStreamSource source;
+static void            *sourceArg;
+static bool            sourceEnded;
+
+static int      ringBlock = -1, voice = -1;
+static uint32_t ringAddr;
+static int      pitch, volume;
+
+/* Half the SPU IRQ is armed at, and the one holding the last chunk */
+static int armedHalf, finalHalf;
+
+/* Chunks waiting to be uploaded, one per ring half */
+static uint32_t staging[2][SPU_STREAM_CHUNK_SIZE / 4];
+
+/* startSPUStreamFromMemory() source state */
+static const uint8_t *memoryData;
+static size_t        memorySize, memoryPosition;
+static bool          memoryLoop;
+
+static void onHalfEntered(void);
+
+static inline uint32_t getHalfAddress(int half) {
+	return ringAddr + half * SPU_STREAM_CHUNK_SIZE;
+}
+
+/* Pull the next chunk from the source and patch its loop flags */
+static void prepareChunk(int half) {
+	uint8_t *chunk  = (uint8_t *) staging[half];
+	size_t  length  = 0;
+
+	if (!sourceEnded)
+		length = source(chunk, SPU_STREAM_CHUNK_SIZE, sourceArg) & ~(ADPCM_BLOCK_SIZE - 1);
+
+	bool isLast = length < SPU_STREAM_CHUNK_SIZE;
+
+	// Pad short chunks with silent blocks
+	if (isLast)
+		memset(&chunk[length], 0, SPU_STREAM_CHUNK_SIZE - length);
+
+	// Drop any loop flags the encoder set (a loop start would also move the
+	// repeat address), then end the chunk with a jump to the other half, or
+	// with a mute on the last one.
+	for (int i = 1; i < SPU_STREAM_CHUNK_SIZE; i += ADPCM_BLOCK_SIZE)
+		chunk[i] = 0;
+
+	chunk[SPU_STREAM_CHUNK_SIZE - ADPCM_BLOCK_SIZE + 1] = isLast
+		? ADPCM_FLAG_LOOP_END
+		: (ADPCM_FLAG_LOOP_END | ADPCM_FLAG_LOOP_REPEAT);
+
+	if (isLast && !sourceEnded) {
+		sourceEnded = true;
+		finalHalf   = half;
+	}
+}
+
+/* A refilled half has landed in SPU RAM, make it the voice's next stop */
+static void onHalfUploaded(void *arg) {
+	int half = (int) (intptr_t) arg;
+
+	if (state != STREAM_PLAYING)
+		return;
+
+	setVoiceRepeatAddress(voice, getHalfAddress(half));
+
+	// Upload first, arm after: DMA writes to the IRQ address trigger it too
+	armedHalf = half;
+	setSPUIRQ(getHalfAddress(half), onHalfEntered);
+}
+
+/* The voice has just jumped into the half the IRQ was armed at, so the
+ * other one is done playing */
+static void onHalfEntered(void) {
+	if (state != STREAM_PLAYING)
+		return;
+
+	if (armedHalf == finalHalf) {
+		state = STREAM_ENDING;
+		return;
+	}
+
+	int freeHalf = armedHalf ^ 1;
+
+	prepareChunk(freeHalf);
+	queueSPUUpload(
+		getHalfAddress(freeHalf), staging[freeHalf], SPU_STREAM_CHUNK_SIZE,
+		onHalfUploaded, (void *) (intptr_t) freeHalf
+	);
+}
+
+/* Both halves are in SPU RAM, start the voice on the first */
+static void onPrefilled(void *arg) {
+	if (state != STREAM_PLAYING)
+		return;
+
+	startVoiceLoop(voice, getHalfAddress(0), getHalfAddress(1), pitch, volume);
+
+	if (finalHalf == 0) {
+		state = STREAM_ENDING;
+		return;
+	}
+
+	armedHalf = 1;
+	setSPUIRQ(getHalfAddress(1), onHalfEntered);
+}
+
+static size_t readMemory(void *buffer, size_t size, void *arg) {
+	uint8_t *output = (uint8_t *) buffer;
+	size_t  written = 0;
+
+	while (written < size) {
+		size_t length = memorySize - memoryPosition;
+
+		if (!length) {
+			if (!memoryLoop)
+				break;
+
+			memoryPosition = 0;
+			continue;
+		}
+		if (length > (size - written))
+			length = size - written;
+
+		memcpy(&output[written], &memoryData[memoryPosition], length);
+		written        += length;
+		memoryPosition += length;
+	}
+
+	return written;
+}
+
+bool startSPUStream(
+	SPUStreamSource streamSource,
+	void            *arg,
+	int             sampleRate,
+	int             streamVolume
+) {
+	stopSPUStream();
+
+	ringBlock = allocateSPURAM(SPU_STREAM_CHUNK_SIZE * 2);
+	if (ringBlock < 0)
+		return false;
+
+	voice = reserveVoice();
+	if (voice < 0) {
+		freeSPURAM(ringBlock);
+		ringBlock = -1;
+		return false;
+	}
+
+	source      = streamSource;
+	sourceArg   = arg;
+	sourceEnded = false;
+	finalHalf   = -1;
+	armedHalf   = -1;
+	ringAddr    = getSPURAMAddress(ringBlock);
+	pitch       = getSPUPitch(sampleRate);
+	volume      = streamVolume;
+	state       = STREAM_PLAYING;
+
+	prepareChunk(0);
+	prepareChunk(1);
+
+	queueSPUUpload(getHalfAddress(0), staging[0], SPU_STREAM_CHUNK_SIZE, NULL, NULL);
+	queueSPUUpload(
+		getHalfAddress(1), staging[1], SPU_STREAM_CHUNK_SIZE, onPrefilled, NULL
+	);
+
+	return true;
+}
+
+bool startSPUStreamFromMemory(
+	const void *data,
+	size_t     size,
+	int        sampleRate,
+	int        streamVolume,
+	bool       loop
+) {
+	memoryData     = (const uint8_t *) data;
+	memorySize     = size;
+	memoryPosition = 0;
+	memoryLoop     = loop && size;
+
+	return startSPUStream(readMemory, NULL, sampleRate, streamVolume);
+}
+
+void stopSPUStream(void) {
+	if (state == STREAM_STOPPED)
+		return;
+
+	state = STREAM_STOPPED;
+	setSPUIRQ(0, NULL);
+
+	// Uploads still queued point at the ring and the staging buffers
+	waitForSPUUploads();
+
+	stopChannel(voice);
+	freeSPURAM(ringBlock);
+
+	voice     = -1;
+	ringBlock = -1;
+}
+
+bool isSPUStreamPlaying(void) {
+	return state != STREAM_STOPPED;
+}
+
+void updateSPUStream(void) {
+	if ((state == STREAM_ENDING) && !getVoiceEnvelope(voice))
+		stopSPUStream();
+}
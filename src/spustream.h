@@ -0,0 +1,60 @@
+/*
+ * Streamed SPU-ADPCM playback for PS1 bare-metal
+ *
+ * Plays a sample of any length on a single reserved voice through a ring of
+ * two chunks in SPU RAM. Every chunk ends with a loop end block and the
+ * voice's repeat address points at the other half, so the voice plays
+ * seamlessly from one half into the next. The SPU IRQ address sits at the
+ * start of the half being played: when the voice reaches it the other half
+ * is free, and is refilled from the source with a background DMA upload.
+ * Only one stream can play at a time, as the SPU has a single IRQ address.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bytes per ring half, a multiple of both the 16-byte ADPCM block and the
+ * 64-byte DMA block. 4 KB lasts about a third of a second at 22050 Hz. */
+#define SPU_STREAM_CHUNK_SIZE 4096
+
+/*
+ * Fill buffer with up to size bytes of SPU-ADPCM data, returning how many
+ * were written. Returning less than size ends the stream.
+ */
+typedef size_t (*SPUStreamSource)(void *buffer, size_t size, void *arg);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Stream from a callback. Returns false if SPU RAM or voices are exhausted. */
+bool startSPUStream(
+	SPUStreamSource source,
+	void            *arg,
+	int             sampleRate,
+	int             volume
+);
+
+/* Stream a sample held in main RAM, optionally looping it forever */
+bool startSPUStreamFromMemory(
+	const void *data,
+	size_t     size,
+	int        sampleRate,
+	int        volume,
+	bool       loop
+);
+
+/* Stop the stream and free its voice and ring buffer */
+void stopSPUStream(void);
+
+bool isSPUStreamPlaying(void);
+
+/* Notice the end of a finished stream and release it. Call once per frame. */
+void updateSPUStream(void);
+
+#ifdef __cplusplus
+}
+#endif
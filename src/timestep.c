@@ -0,0 +1,65 @@
+/*
+ * Fixed timestep scheduler for PS1 bare-metal
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "irq.h"
+#include "timestep.h"
+
+void initTimestep(Timestep *ts, bool isPAL) {
+	ts->lastVSync   = getVSyncCount();
+	ts->refreshRate = isPAL ? 50 : 60;
+	ts->accumulator = 0;
+	ts->pending     = 0;
+	ts->skipped     = 0;
+
+	ts->ticks         = 0;
+	ts->framesSkipped = 0;
+	ts->ticksDropped  = 0;
+}
+
+int beginTimestepFrame(Timestep *ts) {
+	uint32_t now     = getVSyncCount();
+	uint32_t elapsed = now - ts->lastVSync;
+
+	ts->lastVSync = now;
+
+	// Anything past a second is a stall (loading, a debugger) rather than a
+	// slow frame, there's no point simulating through it
+	if (elapsed > (uint32_t) ts->refreshRate)
+		elapsed = ts->refreshRate;
+
+	ts->accumulator += elapsed * TIMESTEP_HZ;
+
+	int due   = ts->accumulator / ts->refreshRate;
+	int ticks = (due > TIMESTEP_MAX_TICKS) ? TIMESTEP_MAX_TICKS : due;
+
+	ts->accumulator -= ticks * ts->refreshRate;
+	ts->pending      = due - ticks;
+	ts->ticks       += ticks;
+
+	return ticks;
+}
+
+bool shouldRenderFrame(Timestep *ts) {
+	if (!ts->pending) {
+		ts->skipped = 0;
+		return true;
+	}
+
+	// Still behind after a full batch, drawing this frame would only make the
+	// next one owe even more
+	if (ts->skipped < TIMESTEP_MAX_SKIP) {
+		ts->skipped++;
+		ts->framesSkipped++;
+		return false;
+	}
+
+	// Skipped as many frames as allowed, let the game slow down instead
+	ts->accumulator  -= ts->pending * ts->refreshRate;
+	ts->ticksDropped += ts->pending;
+	ts->pending       = 0;
+	ts->skipped       = 0;
+	return true;
+}
@@ -0,0 +1,63 @@
+/*
+ * Fixed timestep scheduler for PS1 bare-metal
+ *
+ * The simulation advances in ticks of 1 / TIMESTEP_HZ seconds regardless of
+ * the video mode or of how long frames take to draw. Every vblank counted by
+ * irq.c adds TIMESTEP_HZ to an accumulator and every tick takes the refresh
+ * rate back out of it, so PAL (50 Hz) runs 6 ticks every 5 vblanks and NTSC
+ * one per vblank, both at the same game speed.
+ *
+ * Each iteration of the main loop runs the ticks due since the previous one,
+ * at most TIMESTEP_MAX_TICKS at a time. When that still leaves some owed, up
+ * to TIMESTEP_MAX_SKIP frames in a row are not rendered so the simulation can
+ * catch up. Past that the backlog is dropped and the game slows down, which
+ * is only meant to happen on loading spikes. The part of a tick left in the
+ * accumulator can be used to interpolate positions when rendering.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMESTEP_HZ        60
+#define TIMESTEP_MAX_TICKS  4
+#define TIMESTEP_MAX_SKIP   2
+
+/* getTimestepAlpha() scale, 1.0 in 20.12 fixed-point */
+#define TIMESTEP_ALPHA_ONE 4096
+
+typedef struct {
+	uint32_t lastVSync;
+	int      refreshRate;  /* Vblanks per second */
+	int      accumulator;  /* In 1 / (TIMESTEP_HZ * refreshRate) seconds */
+	int      pending;      /* Ticks still owed after the last batch */
+	int      skipped;      /* Frames in a row not rendered */
+
+	/* Totals since initTimestep(), for the HUD */
+	uint32_t ticks, framesSkipped, ticksDropped;
+} Timestep;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start counting from the current vblank */
+void initTimestep(Timestep *ts, bool isPAL);
+
+/* Number of ticks the simulation should run now */
+int beginTimestepFrame(Timestep *ts);
+
+/* Whether to render after this iteration's ticks, or skip ahead to catch up */
+bool shouldRenderFrame(Timestep *ts);
+
+/* How far the simulation is into the next tick, 0 to TIMESTEP_ALPHA_ONE - 1.
+ * Something moving by v per tick is drawn v * alpha / TIMESTEP_ALPHA_ONE
+ * further along. */
+static inline int getTimestepAlpha(const Timestep *ts) {
+	return (ts->accumulator * TIMESTEP_ALPHA_ONE) / ts->refreshRate;
+}
+
+#ifdef __cplusplus
+}
+#endif
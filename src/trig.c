@@ -3,13 +3,61 @@
  * Based on ps1-bare-metal by spicyjpeg
  */
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "trig.h"
+#include "sineTable.h"
+
+#if (SINE_TABLE_BITS < 2) || (SINE_TABLE_BITS > ISIN_SHIFT)
+#error "SINE_TABLE_BITS must be between 2 and ISIN_SHIFT"
+#endif
 
 #define A (1 << 12)
 #define B 19900
 #define	C  3516
 
+/* Fold an angle into the first quadrant and look it up, interpolating over
+ * the low bits below the table's resolution */
+static inline int lookupSine(int x, int shift, bool interpolate) {
+	int fracBits = shift - SINE_TABLE_BITS;
+	int quadrant = x >> shift;
+	int offset   = x & ((1 << shift) - 1);
+
+	// Odd quadrants run the table backwards. Mirroring a zero offset lands on
+	// the extra entry at the end of the table.
+	if (quadrant & 1)
+		offset = (1 << shift) - offset;
+
+	int y;
+
+	if (interpolate) {
+		int index = offset >> fracBits;
+		int frac  = offset & ((1 << fracBits) - 1);
+
+		y = sineTable[index];
+		if (frac)
+			y += (((sineTable[index + 1] - y) * frac) + (1 << (fracBits - 1)))
+				>> fracBits;
+	} else {
+		y = sineTable[(offset + ((1 << fracBits) >> 1)) >> fracBits];
+	}
+
+	return (quadrant & 2) ? (-y) : y;
+}
+
 int isin(int x) {
+	return lookupSine(x, ISIN_SHIFT, SINE_TABLE_BITS < ISIN_SHIFT);
+}
+
+int isin2(int x) {
+	return lookupSine(x, ISIN2_SHIFT, true);
+}
+
+int isinFast(int x) {
+	return lookupSine(x, ISIN_SHIFT, false);
+}
+
+int isinPoly(int x) {
 	int c = x << (30 - ISIN_SHIFT);
 	x    -= 1 << ISIN_SHIFT;
 
@@ -24,7 +72,7 @@ int isin(int x) {
 	return (c >= 0) ? y : (-y);
 }
 
-int isin2(int x) {
+int isin2Poly(int x) {
 	int c = x << (30 - ISIN2_SHIFT);
 	x    -= 1 << ISIN2_SHIFT;
 
@@ -38,3 +86,22 @@ int isin2(int x) {
 
 	return (c >= 0) ? y : (-y);
 }
+
+uint32_t isqrt(uint32_t value) {
+	uint32_t root = 0;
+	uint32_t bit  = 1 << 30;
+
+	while (bit > value)
+		bit >>= 2;
+
+	for (; bit; bit >>= 2) {
+		if (value >= (root + bit)) {
+			value -= root + bit;
+			root   = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+	}
+
+	return root;
+}
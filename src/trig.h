@@ -1,10 +1,23 @@
 /*
  * Fixed-point trigonometry functions
  * Based on ps1-bare-metal by spicyjpeg
+ *
+ * Sines come from a quarter-wave table generated at build time by
+ * tools/generateSineTable.py (SINE_TABLE_BITS sets its size). Each call site
+ * can pick a variant:
+ * - isinFast(): nearest table entry, one load and no multiplies. It trades
+ *               accuracy for cycles: at 8 bits it's slightly worse than the
+ *               polynomial (13 vs 12.5 LSB max error, see host/trigbench.c)
+ * - isin():     linearly interpolated between entries where the table is
+ *               coarser than the 10-bit angle
+ * - isin2():    interpolated, for 15-bit angles
+ * - isinPoly(): the original polynomial approximation, kept for comparison
  */
 
 #pragma once
 
+#include <stdint.h>
+
 #define ISIN_SHIFT  10
 #define ISIN2_SHIFT 15
 #define ISIN_PI     (1 << (ISIN_SHIFT  + 1))
@@ -16,6 +29,13 @@ extern "C" {
 
 int isin(int x);
 int isin2(int x);
+int isinFast(int x);
+
+int isinPoly(int x);
+int isin2Poly(int x);
+
+/* Integer square root, rounded down. Bit by bit, so keep it off hot paths */
+uint32_t isqrt(uint32_t value);
 
 static inline int icos(int x) {
 	return isin(x + (1 << ISIN_SHIFT));
@@ -23,6 +43,9 @@ static inline int icos(int x) {
 static inline int icos2(int x) {
 	return isin2(x + (1 << ISIN2_SHIFT));
 }
+static inline int icosFast(int x) {
+	return isinFast(x + (1 << ISIN_SHIFT));
+}
 
 #ifdef __cplusplus
 }
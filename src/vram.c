@@ -0,0 +1,340 @@
+/*
+ * VRAM manager for PS1 bare-metal
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "gpu.h"
+#include "lz4.h"
+#include "vram.h"
+#include "ps1/gpucmd.h"
+
+#define NUM_PAGES (VRAM_PAGES_X * VRAM_PAGES_Y)
+
+typedef enum {
+	PAGE_FREE,
+	PAGE_SHELVES,  /* Shared by images packed into shelves */
+	PAGE_USED      /* Allocated whole, or under the framebuffers */
+} PageState;
+
+/*
+ * Shelf packing state of a page. Images go left to right along the current
+ * shelf, and a new shelf is opened below it when one doesn't fit. Earlier
+ * shelves aren't revisited, which keeps allocation cheap at the cost of some
+ * wasted space.
+ */
+typedef struct {
+	uint8_t  state;
+	uint8_t  shelfX;
+	uint16_t shelfY, shelfHeight;
+} VRAMPage;
+
+static VRAMPage pages[NUM_PAGES];
+
+/* CLUT area below the framebuffers, filled row by row */
+static int clutWidth, clutX, clutY;
+
+typedef struct {
+	const uint8_t      *data;
+	VRAMRect           rect;
+	int                rowsDone;
+	VRAMUploadCallback callback;
+	void               *arg;
+} VRAMUpload;
+
+static VRAMUpload uploadQueue[VRAM_UPLOAD_QUEUE_SIZE];
+static int        uploadHead = 0, uploadCount = 0;
+
+static inline int getPageX(int index) {
+	return (index % VRAM_PAGES_X) * VRAM_PAGE_WIDTH;
+}
+
+static inline int getPageY(int index) {
+	return (index / VRAM_PAGES_X) * VRAM_PAGE_HEIGHT;
+}
+
+void initVRAM(int fbWidth, int fbHeight) {
+	int fbRight = fbWidth * 2;
+
+	for (int i = 0; i < NUM_PAGES; i++) {
+		VRAMPage *page = &pages[i];
+
+		bool underFB = (getPageX(i) < fbRight) && (getPageY(i) < fbHeight);
+
+		page->state       = underFB ? PAGE_USED : PAGE_FREE;
+		page->shelfX      = 0;
+		page->shelfY      = 0;
+		page->shelfHeight = 0;
+	}
+
+	// The framebuffer pages are unusable for textures anyway, so whatever is
+	// left of them below the framebuffers becomes the CLUT area
+	clutWidth = fbRight & ~(VRAM_CLUT_ALIGN - 1);
+	clutX     = 0;
+	clutY     = fbHeight;
+}
+
+bool allocateVRAMPage(VRAMRect *rect) {
+	for (int i = 0; i < NUM_PAGES; i++) {
+		if (pages[i].state != PAGE_FREE)
+			continue;
+
+		pages[i].state = PAGE_USED;
+
+		rect->x      = getPageX(i);
+		rect->y      = getPageY(i);
+		rect->width  = VRAM_PAGE_WIDTH;
+		rect->height = VRAM_PAGE_HEIGHT;
+		return true;
+	}
+
+	return false;
+}
+
+/* Try to fit an image into a page's shelves */
+static bool allocateFromPage(int index, VRAMRect *rect, int width, int height) {
+	VRAMPage *page = &pages[index];
+
+	if ((page->shelfX + width) > VRAM_PAGE_WIDTH || height > page->shelfHeight) {
+		// Open a new shelf under the current one
+		int nextY = page->shelfY + page->shelfHeight;
+
+		if ((nextY + height) > VRAM_PAGE_HEIGHT)
+			return false;
+
+		page->shelfX      = 0;
+		page->shelfY      = nextY;
+		page->shelfHeight = height;
+	}
+
+	rect->x      = getPageX(index) + page->shelfX;
+	rect->y      = getPageY(index) + page->shelfY;
+	rect->width  = width;
+	rect->height = height;
+
+	page->shelfX += width;
+	page->state   = PAGE_SHELVES;
+	return true;
+}
+
+bool allocateVRAMImage(VRAMRect *rect, int width, int height) {
+	if (
+		(width <= 0) || (width > VRAM_PAGE_WIDTH) ||
+		(height <= 0) || (height > VRAM_PAGE_HEIGHT)
+	)
+		return false;
+
+	// Pages that are already shared come first, so free pages stay free for
+	// whole page allocations for as long as possible
+	for (int i = 0; i < NUM_PAGES; i++) {
+		if ((pages[i].state == PAGE_SHELVES) && allocateFromPage(i, rect, width, height))
+			return true;
+	}
+	for (int i = 0; i < NUM_PAGES; i++) {
+		if ((pages[i].state == PAGE_FREE) && allocateFromPage(i, rect, width, height))
+			return true;
+	}
+
+	return false;
+}
+
+bool allocateVRAMCLUT(VRAMRect *rect, int numColors) {
+	if (numColors > clutWidth)
+		return false;
+
+	if ((clutX + numColors) > clutWidth) {
+		clutX = 0;
+		clutY++;
+	}
+	if (clutY >= VRAM_PAGE_HEIGHT)
+		return false;
+
+	rect->x      = clutX;
+	rect->y      = clutY;
+	rect->width  = numColors;
+	rect->height = 1;
+
+	clutX += (numColors + VRAM_CLUT_ALIGN - 1) & ~(VRAM_CLUT_ALIGN - 1);
+	return true;
+}
+
+void setTextureInfo(
+	TextureInfo      *info,
+	const VRAMRect   *image,
+	const VRAMRect   *palette,
+	int              width,
+	int              height,
+	GP0ColorDepth    colorDepth
+) {
+	int texelsPerHalfword = 1;
+
+	if (colorDepth == GP0_COLOR_4BPP)
+		texelsPerHalfword = 4;
+	else if (colorDepth == GP0_COLOR_8BPP)
+		texelsPerHalfword = 2;
+
+	info->page   = gp0_page(
+		image->x / VRAM_PAGE_WIDTH,
+		image->y / VRAM_PAGE_HEIGHT,
+		GP0_BLEND_SEMITRANS,
+		colorDepth
+	);
+	info->clut   = palette ? gp0_clut(palette->x / VRAM_CLUT_ALIGN, palette->y) : 0;
+	info->u      = (uint8_t)  ((image->x % VRAM_PAGE_WIDTH) * texelsPerHalfword);
+	info->v      = (uint8_t)   (image->y % VRAM_PAGE_HEIGHT);
+	info->width  = (uint16_t) width;
+	info->height = (uint16_t) height;
+}
+
+bool allocateTexture(
+	TextureInfo   *info,
+	VRAMRect      *image,
+	VRAMRect      *palette,
+	int           width,
+	int           height,
+	GP0ColorDepth colorDepth
+) {
+	int widthDivider = 1, numColors = 0;
+
+	if (colorDepth == GP0_COLOR_4BPP) {
+		widthDivider = 4;
+		numColors    = 16;
+	} else if (colorDepth == GP0_COLOR_8BPP) {
+		widthDivider = 2;
+		numColors    = 256;
+	}
+
+	assert(!numColors || palette);
+
+	if (!allocateVRAMImage(image, (width + widthDivider - 1) / widthDivider, height))
+		return false;
+	if (numColors && !allocateVRAMCLUT(palette, numColors))
+		return false;
+
+	setTextureInfo(info, image, numColors ? palette : NULL, width, height, colorDepth);
+	return true;
+}
+
+bool queueVRAMUpload(
+	const void         *data,
+	const VRAMRect     *rect,
+	VRAMUploadCallback callback,
+	void               *arg
+) {
+	if (uploadCount >= VRAM_UPLOAD_QUEUE_SIZE)
+		return false;
+
+	VRAMUpload *upload = &uploadQueue[(uploadHead + uploadCount) % VRAM_UPLOAD_QUEUE_SIZE];
+
+	upload->data     = (const uint8_t *) data;
+	upload->rect     = *rect;
+	upload->rowsDone = 0;
+	upload->callback = callback;
+	upload->arg      = arg;
+
+	uploadCount++;
+	return true;
+}
+
+bool isVRAMUploadBusy(void) {
+	return uploadCount > 0;
+}
+
+void serviceVRAMUploads(void) {
+	int budget   = VRAM_UPLOAD_BUDGET;
+	int finished = 0;
+
+	// Large images are sent in bands of whole rows, the rest of them goes out
+	// over the next frames. Bands must start on a word boundary for the DMA,
+	// so images with an odd width always go out in one piece.
+	while ((uploadCount - finished) && (budget > 0)) {
+		VRAMUpload *upload = &uploadQueue[(uploadHead + finished) % VRAM_UPLOAD_QUEUE_SIZE];
+		VRAMRect   *rect   = &upload->rect;
+
+		int remaining = rect->height - upload->rowsDone;
+		int rows      = budget / rect->width;
+
+		if ((rect->width & 1) || (rows > remaining))
+			rows = remaining;
+		if (!rows)
+			break;
+
+		sendVRAMData(
+			&upload->data[upload->rowsDone * rect->width * 2],
+			rect->x,
+			rect->y + upload->rowsDone,
+			rect->width,
+			rows
+		);
+
+		upload->rowsDone += rows;
+		budget           -= rows * rect->width;
+
+		if (upload->rowsDone >= rect->height)
+			finished++;
+	}
+
+	if (!finished)
+		return;
+
+	// The next list going out waits for the last transfer anyway, so waiting
+	// here before reporting completion costs nothing extra
+	waitForDMADone();
+
+	for (; finished > 0; finished--) {
+		VRAMUpload *upload = &uploadQueue[uploadHead];
+
+		uploadHead = (uploadHead + 1) % VRAM_UPLOAD_QUEUE_SIZE;
+		uploadCount--;
+
+		if (upload->callback)
+			upload->callback(upload->arg);
+	}
+}
+
+void flushVRAMUploads(void) {
+	while (isVRAMUploadBusy())
+		serviceVRAMUploads();
+}
+
+void uploadCompressedVRAMImage(
+	const void     *data,
+	const VRAMRect *rect,
+	void           *staging
+) {
+	assert(getLZ4Size(data) == (size_t) (rect->width * rect->height * 2));
+
+	LZ4Stream stream;
+	initLZ4Stream(&stream, staging, data);
+
+	// Odd widths can't be split on word boundaries, see serviceVRAMUploads()
+	int pitch    = rect->width * 2;
+	int bandRows = (rect->width & 1) ? rect->height : (VRAM_DECODE_BAND / rect->width);
+	int rowsSent = 0;
+
+	if (bandRows < 1)
+		bandRows = 1;
+
+	// sendVRAMData() only waits for the previous band to finish transferring
+	// once the next one has been decoded, so both run side by side
+	while (rowsSent < rect->height) {
+		int rowsDone = decodeLZ4Stream(&stream, (rowsSent + bandRows) * pitch) / pitch;
+
+		if (rowsDone > rect->height)
+			rowsDone = rect->height;
+
+		sendVRAMData(
+			(const uint8_t *) staging + rowsSent * pitch,
+			rect->x,
+			rect->y + rowsSent,
+			rect->width,
+			rowsDone - rowsSent
+		);
+
+		rowsSent = rowsDone;
+	}
+
+	waitForDMADone();
+}
@@ -0,0 +1,126 @@
+/*
+ * VRAM manager for PS1 bare-metal
+ *
+ * VRAM is split into 32 texture pages of 64x256 halfwords (16 across, 2
+ * down). Pages overlapping the two side-by-side framebuffers are reserved,
+ * and the rows left below the framebuffers within those pages hold CLUTs.
+ * Every other page can be taken whole (for an atlas) or shared by smaller
+ * images packed into shelves, which never cross a page boundary.
+ *
+ * Uploads can also be queued instead of sent right away. The queue is
+ * serviced by presentFrame() once the previous frame has been drawn and the
+ * vblank has started, sending up to VRAM_UPLOAD_BUDGET halfwords a frame, so
+ * streaming textures in only ever delays the next list by a bounded amount.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gpu.h"
+#include "ps1/gpucmd.h"
+
+#define VRAM_WIDTH  1024
+#define VRAM_HEIGHT  512
+
+#define VRAM_PAGE_WIDTH   64
+#define VRAM_PAGE_HEIGHT 256
+#define VRAM_PAGES_X     (VRAM_WIDTH  / VRAM_PAGE_WIDTH)
+#define VRAM_PAGES_Y     (VRAM_HEIGHT / VRAM_PAGE_HEIGHT)
+
+/* CLUTs start on 16 halfword boundaries */
+#define VRAM_CLUT_ALIGN 16
+
+#define VRAM_UPLOAD_QUEUE_SIZE 16
+
+/* Most halfwords sent from the queue per frame, about 16 KB */
+#define VRAM_UPLOAD_BUDGET 8192
+
+/* Halfwords decoded per band by uploadCompressedVRAMImage() */
+#define VRAM_DECODE_BAND 2048
+
+/* An area of VRAM, in halfwords */
+typedef struct {
+	int16_t x, y, width, height;
+} VRAMRect;
+
+typedef void (*VRAMUploadCallback)(void *arg);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Mark everything free except two fbWidth x fbHeight framebuffers placed
+ * side by side at the top left corner */
+void initVRAM(int fbWidth, int fbHeight);
+
+/* Reserve a whole texture page */
+bool allocateVRAMPage(VRAMRect *rect);
+
+/* Reserve room for an image of the given size within a single page, in
+ * halfwords (a 4bpp image is width / 4 halfwords wide) */
+bool allocateVRAMImage(VRAMRect *rect, int width, int height);
+
+/* Reserve a 16 or 256 color CLUT */
+bool allocateVRAMCLUT(VRAMRect *rect, int numColors);
+
+/*
+ * Reserve an image of width x height texels (and a CLUT if indexed) and fill
+ * in the texture's attributes. palette may be NULL for 16bpp textures.
+ */
+bool allocateTexture(
+	TextureInfo   *info,
+	VRAMRect      *image,
+	VRAMRect      *palette,
+	int           width,
+	int           height,
+	GP0ColorDepth colorDepth
+);
+
+/* Fill in a texture's attributes for an image already placed in VRAM, such
+ * as one entry of an atlas. palette may be NULL for 16bpp textures. */
+void setTextureInfo(
+	TextureInfo      *info,
+	const VRAMRect   *image,
+	const VRAMRect   *palette,
+	int              width,
+	int              height,
+	GP0ColorDepth    colorDepth
+);
+
+/*
+ * Queue data to be copied into the given area. The data must stay valid
+ * until the callback (which may be NULL) runs. Returns false if the queue is
+ * full.
+ */
+bool queueVRAMUpload(
+	const void         *data,
+	const VRAMRect     *rect,
+	VRAMUploadCallback callback,
+	void               *arg
+);
+
+bool isVRAMUploadBusy(void);
+
+/* Send queued uploads within this frame's budget. Called by presentFrame()
+ * while the GPU is idle. */
+void serviceVRAMUploads(void);
+
+/* Send everything still queued, blocking until done */
+void flushVRAMUploads(void);
+
+/*
+ * Decompress an LZ4 packed image (see lz4.h) into a word aligned staging
+ * buffer of width * height halfwords and send it, blocking until done. The
+ * image goes out in bands of whole rows as soon as each is decoded, so most
+ * of the transfer overlaps decoding. Bypasses the upload queue.
+ */
+void uploadCompressedVRAMImage(
+	const void     *data,
+	const VRAMRect *rect,
+	void           *staging
+);
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,125 +6,103 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
-#include <string.h>
 #include "xa.h"
+#include "cdrom.h"
+#include "irq.h"
+#include "iso9660.h"
 #include "ps1/registers.h"
 
-/* CD-ROM commands */
-#define CD_CMD_GETSTAT   0x01
-#define CD_CMD_SETLOC    0x02
-#define CD_CMD_PLAY      0x03
-#define CD_CMD_STOP      0x08
-#define CD_CMD_PAUSE     0x09
-#define CD_CMD_INIT      0x0A
-#define CD_CMD_DEMUTE    0x0C
-#define CD_CMD_SETFILTER 0x0D
-#define CD_CMD_SETMODE   0x0E
-#define CD_CMD_GETLOCP   0x11
-#define CD_CMD_READ_S    0x1B  /* Real-time streaming read */
-
-/* Mode flags for XA playback */
-#define CD_MODE_SPEED_2X   0x80  /* Double speed (required for 37800 Hz XA) */
-#define CD_MODE_XA_ADPCM   0x40  /* Enable XA-ADPCM decoding */
-#define CD_MODE_XA_FILTER  0x08  /* Enable file/channel filtering */
+/* XA-ADPCM playback at double speed with file/channel filtering */
+#define XA_MODE (CDROM_MODE_SPEED_2X | CDROM_MODE_XA_ADPCM | CDROM_MODE_XA_FILTER)
+
+/* 2x speed reads 150 sectors per second */
+#define XA_SECTORS_PER_SECOND 150
 
 /* XA state */
 static bool xa_playing = false;
 static bool xa_looping = false;
 static uint32_t xa_start_lba = 0;
+static uint32_t xa_end_lba = 0;
 static int xa_channel = 0;
+static int xa_filter_channel = -1;  /* Channel the drive is filtering on */
+
+/* GETLOCP polling state */
+static bool xa_poll_pending = false;
+static uint32_t xa_last_poll = 0;
+static bool xa_end_pending = false;  /* End of stream predicted */
+static uint32_t xa_end_frame = 0;
+
+static void onStreamStarted(const CDROMResponse *response, void *arg) {
+	if (response->irq != CDROM_IRQ_ACKNOWLEDGE) {
+		printf("XA: Streaming failed to start\n");
+		return;
+	}
 
-/* Small delay for CD-ROM operations */
-static void cdDelay(void) {
-	for (volatile int i = 0; i < 10000; i++)
-		__asm__ volatile("");
-}
-
-/* Wait for CD-ROM controller to be ready */
-static void waitCDReady(void) {
-	while (CDROM_HSTS & CDROM_HSTS_BUSYSTS)
-		__asm__ volatile("");
+	xa_playing = true;
+	xa_end_pending = false;
+	xa_last_poll = getVSyncCount();
 }
 
-/* Wait for CD-ROM response */
-static int waitForResponse(void) {
-	int timeout = 100000;
+/* Seek back to the start and keep streaming. Mode and filter are already
+ * set, so it's just SETLOC and READ_S. */
+static void restartStream(void) {
+	uint8_t msf[3];
 
-	CDROM_ADDRESS = 1;
-	while (!(CDROM_HINTSTS & CDROM_HINT_INT_BITMASK) && timeout > 0) {
-		timeout--;
-		__asm__ volatile("");
-	}
-
-	int intType = CDROM_HINTSTS & CDROM_HINT_INT_BITMASK;
-
-	/* Discard response bytes */
-	CDROM_ADDRESS = 1;
-	while (CDROM_HSTS & CDROM_HSTS_RSLRRDY) {
-		volatile uint8_t dummy = CDROM_RESULT;
-		(void)dummy;
-	}
+	lbaToMSF(xa_start_lba, msf);
+	issueCDROMCommand(CDROM_CMD_SETLOC, msf, 3, NULL, NULL);
+	issueCDROMCommand(CDROM_CMD_READ_S, NULL, 0, onStreamStarted, NULL);
+}
 
-	/* Acknowledge interrupt */
-	CDROM_ADDRESS = 1;
-	CDROM_HCLRCTL = CDROM_HCLRCTL_CLRINT_BITMASK;
-	cdDelay();
+/* GETLOCP response: track, index, relative M:S:F, absolute M:S:F of the
+ * sector being read */
+static void onLocation(const CDROMResponse *response, void *arg) {
+	xa_poll_pending = false;
 
-	return intType;
-}
+	if (!xa_playing || (response->irq != CDROM_IRQ_ACKNOWLEDGE) || (response->length < 8))
+		return;
 
-/* Send command with no parameters */
-static void sendCommand(uint8_t cmd) {
-	waitCDReady();
-	CDROM_ADDRESS = 0;
-	CDROM_COMMAND = cmd;
-	cdDelay();
-}
+	uint32_t lba = msfToLBA(&response->data[5]);
+	uint32_t remaining = (lba < xa_end_lba) ? (xa_end_lba - lba) : 0;
 
-/* Send command with one parameter */
-static void sendCommand1(uint8_t cmd, uint8_t p1) {
-	waitCDReady();
-	CDROM_ADDRESS = 0;
-	CDROM_PARAMETER = p1;
-	CDROM_COMMAND = cmd;
-	cdDelay();
-}
+	/* Close to the end, work out the frame the last sector is read in
+	 * rather than waiting for the next poll, which could overshoot into
+	 * whatever follows the file on disc */
+	uint32_t rate = getVSyncRate();
 
-/* Send command with two parameters */
-static void sendCommand2(uint8_t cmd, uint8_t p1, uint8_t p2) {
-	waitCDReady();
-	CDROM_ADDRESS = 0;
-	CDROM_PARAMETER = p1;
-	CDROM_PARAMETER = p2;
-	CDROM_COMMAND = cmd;
-	cdDelay();
+	if (remaining < (XA_SECTORS_PER_SECOND * XA_POLL_FRAMES * 2) / rate) {
+		xa_end_pending = true;
+		xa_end_frame = getVSyncCount() + (remaining * rate) / XA_SECTORS_PER_SECOND;
+	}
 }
 
-/* Send command with three parameters */
-static void sendCommand3(uint8_t cmd, uint8_t p1, uint8_t p2, uint8_t p3) {
-	waitCDReady();
-	CDROM_ADDRESS = 0;
-	CDROM_PARAMETER = p1;
-	CDROM_PARAMETER = p2;
-	CDROM_PARAMETER = p3;
-	CDROM_COMMAND = cmd;
-	cdDelay();
+/* The stream has reached its last sector */
+static void onStreamEnd(void) {
+	xa_end_pending = false;
+
+	if (xa_looping) {
+		/* Not playing until READ_S is acknowledged, so no poll sees the old
+		 * position in the meantime */
+		xa_playing = false;
+		restartStream();
+	} else {
+		issueCDROMCommand(CDROM_CMD_PAUSE, NULL, 0, NULL, NULL);
+		xa_playing = false;
+		printf("XA: Stream ended\n");
+	}
 }
 
-/* Convert LBA to BCD MSF format */
-static void lba_to_msf(uint32_t lba, uint8_t *min, uint8_t *sec, uint8_t *frame) {
-	/* Add 150 sectors (2 seconds) for lead-in */
-	lba += 150;
+static void onXAFileFound(const CDFile *file, void *arg) {
+	if (!file) {
+		printf("XA: File not found\n");
+		return;
+	}
 
-	uint32_t m = lba / (75 * 60);
-	uint32_t s = (lba / 75) % 60;
-	uint32_t f = lba % 75;
+	printf("XA: Found at LBA %lu, %lu bytes\n",
+	       (unsigned long)file->lba, (unsigned long)file->size);
 
-	/* Convert to BCD */
-	*min = ((m / 10) << 4) | (m % 10);
-	*sec = ((s / 10) << 4) | (s % 10);
-	*frame = ((f / 10) << 4) | (f % 10);
+	xa_play_lba(file->lba, file->size / 2048, xa_channel, xa_looping);
 }
 
 void xa_init(void) {
@@ -132,7 +110,6 @@ void xa_init(void) {
 
 	/* Enable SPU with CD audio input */
 	SPU_CTRL = SPU_CTRL_ENABLE | SPU_CTRL_DAC_ENABLE | SPU_CTRL_I2SA_ENABLE;
-	cdDelay();
 
 	/* Set master volume */
 	SPU_MVOLL = 0x3FFF;
@@ -144,87 +121,79 @@ void xa_init(void) {
 
 	printf("XA: SPU configured\n");
 
-	/* Clear any pending interrupts */
-	CDROM_ADDRESS = 1;
-	CDROM_HCLRCTL = CDROM_HCLRCTL_CLRINT_BITMASK | CDROM_HCLRCTL_CLRPRM;
-	cdDelay();
-
-	/* Initialize CD-ROM */
-	sendCommand(CD_CMD_INIT);
-	waitForResponse();
-	for (volatile int i = 0; i < 100000; i++) __asm__ volatile("");
-	waitForResponse();  /* Init sends two responses */
-	printf("XA: CD-ROM initialized\n");
-
-	/* Demute CD audio */
-	sendCommand(CD_CMD_DEMUTE);
-	waitForResponse();
-	printf("XA: Demuted\n");
+	/* The drive was reset by initCDROM(), demute once its INIT is done */
+	issueCDROMCommand(CDROM_CMD_DEMUTE, NULL, 0, NULL, NULL);
 }
 
 void xa_play(const char *filename, int channel, bool loop) {
-	/* For now, use hardcoded LBA - finding files on ISO9660 is complex
-	 * The XA file will be placed at a known location by mkpsxiso
-	 * We'll need to determine the LBA from the disc layout
-	 */
 	printf("XA: Play requested: %s channel=%d loop=%d\n", filename, channel, loop);
 
-	/* Hardcode LBA for MUSIC.XA - adjust based on disc layout
-	 * After data track + padding, typically around sector 23+ */
-	uint32_t lba = 23;  /* Will be updated based on actual disc layout */
+	/* Playback starts once the file has been found in the ISO9660 directory */
+	xa_channel = channel;
+	xa_looping = loop;
 
-	xa_play_lba(lba, channel, loop);
+	if (!findCDFile(filename, onXAFileFound, NULL))
+		printf("XA: CD reader busy\n");
 }
 
-void xa_play_lba(uint32_t startLBA, int channel, bool loop) {
-	printf("XA: Starting from LBA %lu, channel=%d, loop=%d\n",
-	       (unsigned long)startLBA, channel, loop);
+void xa_play_lba(uint32_t startLBA, uint32_t numSectors, int channel, bool loop) {
+	printf("XA: Starting from LBA %lu (%lu sectors), channel=%d, loop=%d\n",
+	       (unsigned long)startLBA, (unsigned long)numSectors, channel, loop);
 
 	xa_start_lba = startLBA;
-	xa_channel = channel;
+	xa_end_lba = startLBA + numSectors;
 	xa_looping = loop;
-
-	/* Stop any current playback */
-	sendCommand(CD_CMD_PAUSE);
-	waitForResponse();
+	xa_playing = false;
+	xa_poll_pending = false;
+	xa_end_pending = false;
 
 	/* Set mode for XA-ADPCM playback:
-	 * - CD_MODE_SPEED_2X: Double speed for 37800 Hz
-	 * - CD_MODE_XA_ADPCM: Enable XA audio decoding
-	 * - CD_MODE_XA_FILTER: Enable file/channel filtering
+	 * - CDROM_MODE_SPEED_2X: Double speed for 37800 Hz
+	 * - CDROM_MODE_XA_ADPCM: Enable XA audio decoding
+	 * - CDROM_MODE_XA_FILTER: Enable file/channel filtering
+	 * Skipped if still set from the previous stream.
 	 */
-	uint8_t mode = CD_MODE_SPEED_2X | CD_MODE_XA_ADPCM | CD_MODE_XA_FILTER;
-	sendCommand1(CD_CMD_SETMODE, mode);
-	waitForResponse();
-	printf("XA: Mode=0x%02X\n", mode);
+	if (getCDROMMode() != XA_MODE) {
+		uint8_t mode = XA_MODE;
+		issueCDROMCommand(CDROM_CMD_SETMODE, &mode, 1, NULL, NULL);
+		xa_filter_channel = -1;
+	}
+
+	xa_set_channel(channel);
+
+	/* Seek and start real-time streaming. READ_S moves straight to the new
+	 * location, so whatever was being read doesn't need pausing first. */
+	restartStream();
+}
+
+void xa_set_channel(int channel) {
+	xa_channel = channel;
+
+	if (channel == xa_filter_channel)
+		return;
 
 	/* Set XA filter: file=0, channel as specified
 	 * File number 0 matches psxavenc -F 0 parameter (default)
+	 * The drive keeps reading, so switching between interleaved channels
+	 * takes effect on the next sector without a seek.
 	 */
-	sendCommand2(CD_CMD_SETFILTER, 0, channel);
-	waitForResponse();
-	printf("XA: Filter file=0 channel=%d\n", channel);
-
-	/* Set location (MSF in BCD) */
-	uint8_t min, sec, frame;
-	lba_to_msf(startLBA, &min, &sec, &frame);
-	sendCommand3(CD_CMD_SETLOC, min, sec, frame);
-	waitForResponse();
-	printf("XA: SetLoc %02X:%02X:%02X\n", min, sec, frame);
+	uint8_t params[2];
+	params[0] = 0;
+	params[1] = channel;
+	issueCDROMCommand(CDROM_CMD_SETFILTER, params, 2, NULL, NULL);
 
-	/* Start real-time streaming read */
-	sendCommand(CD_CMD_READ_S);
-	waitForResponse();
+	xa_filter_channel = channel;
+}
 
-	xa_playing = true;
-	printf("XA: Streaming started!\n");
+int xa_get_channel(void) {
+	return xa_channel;
 }
 
 void xa_stop(void) {
 	printf("XA: Stopping\n");
-	sendCommand(CD_CMD_PAUSE);
-	waitForResponse();
+	issueCDROMCommand(CDROM_CMD_PAUSE, NULL, 0, NULL, NULL);
 	xa_playing = false;
+	xa_end_pending = false;
 }
 
 void xa_set_volume(int vol) {
@@ -239,11 +208,21 @@ bool xa_is_playing(void) {
 }
 
 void xa_update(void) {
-	/* Check for end of stream and loop if needed */
-	/* This would require monitoring CD-ROM interrupts/status
-	 * For now, this is a placeholder - looping needs proper
-	 * end-of-file detection via CD-ROM callbacks */
-	if (xa_playing && xa_looping) {
-		/* TODO: Detect end of XA stream and restart */
+	/* XA sectors go straight to the ADPCM decoder, so the end of the stream
+	 * is found by asking the drive where it is every few frames. The poll
+	 * goes through the command queue and never blocks. */
+	if (!xa_playing)
+		return;
+
+	if (xa_end_pending) {
+		if ((int32_t) (getVSyncCount() - xa_end_frame) >= 0)
+			onStreamEnd();
+		return;
 	}
+
+	if (xa_poll_pending || ((getVSyncCount() - xa_last_poll) < XA_POLL_FRAMES))
+		return;
+
+	xa_last_poll = getVSyncCount();
+	xa_poll_pending = issueCDROMCommand(CDROM_CMD_GETLOCP, NULL, 0, onLocation, NULL);
 }
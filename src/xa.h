@@ -9,6 +9,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Frames between GETLOCP polls for the end of the stream */
+#define XA_POLL_FRAMES 8
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -23,8 +26,16 @@ void xa_init(void);
  */
 void xa_play(const char *filename, int channel, bool loop);
 
-/* Start playing XA audio from LBA position directly */
-void xa_play_lba(uint32_t startLBA, int channel, bool loop);
+/* Start playing XA audio from LBA position directly, the stream ends or
+ * loops after numSectors sectors */
+void xa_play_lba(uint32_t startLBA, uint32_t numSectors, int channel, bool loop);
+
+/* Switch to another of the interleaved channels (0-7) of the stream playing.
+ * Only changes the drive's filter, so there is no seek and no gap. */
+void xa_set_channel(int channel);
+
+/* Channel currently selected */
+int xa_get_channel(void);
 
 /* Stop XA playback */
 void xa_stop(void);
@@ -35,7 +46,7 @@ void xa_set_volume(int vol);
 /* Check if XA is currently playing */
 bool xa_is_playing(void);
 
-/* Update XA state - call periodically for looping support */
+/* Detect the end of the stream and loop or stop it - call once per frame */
 void xa_update(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""
+Write a C header giving the size of each asset once it's unpacked, so buffers
+holding them can be sized at build time rather than guessed.
+
+Each NAME=path argument becomes a define holding the file's size rounded up
+to 4 bytes, the granularity the arena in src/main.c hands out. LZ4 assets
+made by compressAsset.py are measured by their stored uncompressed size.
+"""
+
+import argparse
+import struct
+import sys
+from pathlib import Path
+
+LZ4_MAGIC = b"LZ4B"
+
+
+def unpacked_size(path):
+    data = Path(path).read_bytes()
+
+    if data[:4] == LZ4_MAGIC:
+        return struct.unpack("<I", data[4:8])[0]
+
+    return len(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Write unpacked asset sizes to a C header")
+    parser.add_argument("-o", "--output", required=True, help="C header output")
+    parser.add_argument("assets", nargs="+", help="NAME=path pairs")
+    args = parser.parse_args()
+
+    lines = [
+        "/* Generated by tools/assetSizes.py, do not edit */",
+        "",
+        "#pragma once",
+        "",
+    ]
+
+    for asset in args.assets:
+        name, sep, path = asset.partition("=")
+
+        if not sep:
+            print(f"error: expected NAME=path, got {asset}", file=sys.stderr)
+            sys.exit(1)
+
+        try:
+            size = unpacked_size(path)
+        except OSError as e:
+            print(f"error: {e}", file=sys.stderr)
+            sys.exit(1)
+
+        lines.append(f"#define {name} {(size + 3) & ~3}")
+
+    lines.append("")
+    Path(args.output).write_text("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,7 +1,8 @@
 #!/usr/bin/env python3
 """
 Build a PSX disc image (.bin/.cue) from the compiled executable.
-Includes CD-DA audio track for music and SPU for sound effects.
+Includes CD-DA audio track for music and SPU for sound effects, and packs the
+assets listed in assets/archive.json into ASSETS.PAK (see packArchive.py).
 Requires: mkpsxiso
 """
 
@@ -16,8 +17,8 @@ OUTPUT_DIR = PROJECT_ROOT / "web" / "rom"
 TOOLS_DIR = PROJECT_ROOT / "tools"
 ASSETS_DIR = PROJECT_ROOT / "assets"
 
-def create_iso_xml(has_audio=False):
-    """Create XML for disc with optional CD-DA audio track."""
+def create_iso_xml(has_audio=False, has_archive=False):
+    """Create XML for disc with optional asset archive and CD-DA audio track."""
     xml = '''<?xml version="1.0" encoding="UTF-8"?>
 
 <iso_project image_name="lander.bin" cue_sheet="lander.cue">
@@ -25,7 +26,11 @@ def create_iso_xml(has_audio=False):
 \t\t<directory_tree>
 \t\t\t<file name="SYSTEM.CNF" source="system.cnf"/>
 \t\t\t<file name="LANDER.EXE" source="lander.psexe"/>
-\t\t</directory_tree>
+'''
+    if has_archive:
+        xml += '''\t\t\t<file name="ASSETS.PAK" source="assets.pak"/>
+'''
+    xml += '''\t\t</directory_tree>
 \t</track>
 '''
     if has_audio:
@@ -86,12 +91,29 @@ def main():
     else:
         print("No CD-DA music (sefchol_take_it_slow.wav not found)")
 
+    # Pack assets into a single archive, grouped so assets loaded together are
+    # contiguous on disc
+    manifest = ASSETS_DIR / "archive.json"
+    has_archive = manifest.exists()
+    if has_archive:
+        result = subprocess.run([
+            sys.executable, str(TOOLS_DIR / "packArchive.py"),
+            str(manifest), str(work_dir / "assets.pak"),
+            "-I", str(BUILD_DIR), "-I", str(ASSETS_DIR),
+            "--order", "group"
+        ])
+        if result.returncode != 0:
+            print("ERROR: packArchive.py failed!")
+            sys.exit(1)
+    else:
+        print("No asset archive (archive.json not found)")
+
     # Create SYSTEM.CNF
     (work_dir / "system.cnf").write_text(create_system_cnf())
 
     # Create ISO XML config
     xml_path = work_dir / "iso.xml"
-    xml_path.write_text(create_iso_xml(has_audio))
+    xml_path.write_text(create_iso_xml(has_audio, has_archive))
 
     # Run mkpsxiso
     print("Building disc image...")
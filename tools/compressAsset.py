@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Compress an asset into an LZ4 block for embedding, see src/lz4.h.
+
+Output format:
+  uint32_t magic ("LZ4B")
+  uint32_t uncompressed size in bytes
+  LZ4 block (standard LZ4 block format, no frame), padded to 4 bytes
+
+The compressor is a plain greedy matcher with a hash table of 4-byte
+sequences, it's meant to run at build time so it favours simplicity over
+speed. --level searches a hash chain of that many candidates per position
+for a longer match.
+"""
+
+import argparse
+import struct
+import sys
+from pathlib import Path
+
+MAGIC = b"LZ4B"
+
+MIN_MATCH     = 4
+MAX_OFFSET    = 65535
+HASH_BITS     = 14
+# The last match must start at least 12 bytes before the end and the last 5
+# bytes are always literals, as the LZ4 block format requires
+MF_LIMIT      = 12
+LAST_LITERALS = 5
+
+
+def hash4(data, i):
+    value = int.from_bytes(data[i:i + 4], "little")
+    return ((value * 2654435761) & 0xffffffff) >> (32 - HASH_BITS)
+
+
+def write_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def write_sequence(out, literals, match_length, offset):
+    lit_len   = len(literals)
+    token_lit = min(lit_len, 15)
+    token_mat = 0 if match_length is None else min(match_length - MIN_MATCH, 15)
+
+    out.append((token_lit << 4) | token_mat)
+    if lit_len >= 15:
+        write_length(out, lit_len - 15)
+    out += literals
+
+    if match_length is not None:
+        out += struct.pack("<H", offset)
+        if match_length - MIN_MATCH >= 15:
+            write_length(out, match_length - MIN_MATCH - 15)
+
+
+def compress(data, level):
+    out    = bytearray()
+    heads  = {}
+    chain  = {}
+    anchor = 0
+    i      = 0
+    end    = len(data)
+    limit  = end - MF_LIMIT
+
+    while i < limit:
+        h         = hash4(data, i)
+        candidate = heads.get(h)
+        chain[i]  = candidate
+        heads[h]  = i
+
+        best_length, best_offset = 0, 0
+        tries = level
+
+        while (candidate is not None) and (tries > 0) and (i - candidate <= MAX_OFFSET):
+            if data[candidate:candidate + MIN_MATCH] == data[i:i + MIN_MATCH]:
+                length   = MIN_MATCH
+                max_len  = end - LAST_LITERALS - i
+                while (length < max_len) and (data[candidate + length] == data[i + length]):
+                    length += 1
+                if length > best_length:
+                    best_length, best_offset = length, i - candidate
+
+            candidate  = chain.get(candidate)
+            tries     -= 1
+
+        if best_length < MIN_MATCH:
+            i += 1
+            continue
+
+        write_sequence(out, data[anchor:i], best_length, best_offset)
+
+        # Index the positions the match skips over so later matches can find
+        # them too
+        for j in range(i + 1, min(i + best_length, limit)):
+            h        = hash4(data, j)
+            chain[j] = heads.get(h)
+            heads[h] = j
+
+        i      += best_length
+        anchor  = i
+
+    write_sequence(out, data[anchor:], None, 0)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description="LZ4 compress an asset for embedding")
+    parser.add_argument("input", help="Raw asset")
+    parser.add_argument("output", help="Compressed asset")
+    parser.add_argument("-l", "--level", type=int, default=16, help="Hash chain candidates per position")
+    args = parser.parse_args()
+
+    try:
+        data = Path(args.input).read_bytes()
+    except OSError as e:
+        print(f"error: {e}", file=sys.stderr)
+        sys.exit(1)
+
+    block  = compress(data, max(args.level, 1))
+    output = MAGIC + struct.pack("<I", len(data)) + block
+    output += bytes(-len(output) % 4)
+
+    Path(args.output).write_bytes(output)
+
+    ratio = (len(output) * 100 // len(data)) if data else 100
+    print(f"{Path(args.input).name}: {len(data)} -> {len(output)} bytes ({ratio}%)")
+
+
+if __name__ == "__main__":
+    main()
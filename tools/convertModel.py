@@ -2,12 +2,12 @@
 """
 Convert OBJ model files to PS1 binary format.
 
-Output format:
+Version 1 format (--format 1):
   Header (8 bytes):
     uint16_t num_vertices
     uint16_t num_uvs
     uint16_t num_faces
-    uint16_t reserved
+    uint16_t version (0)
 
   Vertices (num_vertices * 8 bytes each, matching GTEVector16):
     int16_t x, y, z, padding
@@ -16,22 +16,88 @@ Output format:
     uint8_t u, v
 
   Faces (num_faces * 18 bytes each):
-    int16_t v0, v1, v2, v3  (v3 = -1 for triangles)
+    int16_t v0, v1, v2, v3  (v3 = -1 for triangles, quads in GP0 order)
     int16_t uv0, uv1, uv2, uv3
     int16_t normal_index
+
+Version 2 format (--format 2, default):
+  Header (16 bytes):
+    uint16_t num_vertices
+    uint16_t num_groups
+    uint16_t num_faces (triangles and quads)
+    uint16_t version (2)
+    int16_t  sphere_x, sphere_y, sphere_z
+    uint16_t sphere_radius
+
+  Vertices (num_vertices * 8 bytes, renumbered in first use order)
+
+  Groups (num_groups):
+    uint32_t type << 16 | count  (0 = list, 1 = strip, 2 = fan, 3 = quads)
+    uint32_t corners[]  (3 per triangle for lists, 4 per quad, count + 2
+                         for strips and fans)
+
+  Each corner is vertex | (u | v << 8) << 16, so the U/V half is already the
+  low half of a GP0 UV word. Triangles are reordered for vertex locality,
+  which also helps find longer strips.
+
+Version 3 format (--normals):
+  Same as version 2 with version = 3, plus a normal table and a normal index
+  for every corner:
+    uint16_t num_normals, uint16_t padding (0), after the vertices
+    Normals (num_normals * 8 bytes, 4.12 fixed-point GTEVector16)
+    Groups, as in version 2
+    uint16_t normal index for each corner, in group order, padded to 4 bytes
+
+  Corner normals average the faces around their vertex that meet the face at
+  less than the crease angle. Corners on either side of a sharper edge share
+  the vertex but not the normal, so hard edges stay hard under Gouraud
+  shading without duplicating vertices.
+
+With --decimate, the mesh is simplified by vertex clustering to roughly the
+given fraction of its triangles before conversion, for lower levels of detail.
+
+With --quads, planar OBJ quads are kept as single faces in GP0 corner order
+(the GPU draws v0-v1-v2 and v1-v2-v3) rather than split into two triangles.
 """
 
 import argparse
+import math
 import struct
 import sys
+from collections import defaultdict
 from pathlib import Path
 
+MODEL_VERSION_2 = 2
+MODEL_VERSION_3 = 3
+
+GROUP_LIST = 0
+GROUP_STRIP = 1
+GROUP_FAN = 2
+GROUP_QUADS = 3
+
+# Minimum cosine between the two halves' normals for a quad to be kept whole.
+# The renderer only culls quads by their first triangle.
+QUAD_PLANAR_THRESHOLD = 0.98
+
+# Finest clustering grid tried by --decimate, in cells along the longest axis
+DECIMATE_MAX_CELLS = 128
+
+# Simulated FIFO size used when reordering triangles
+ORDER_CACHE_SIZE = 16
+
+# Default angle in degrees above which --normals treats an edge as hard
+CREASE_ANGLE = 50
+
+# 1.0 in the GTE's 4.12 fixed-point format
+GTE_ONE = 4096
+
 
 def parse_obj(filepath):
     """Parse OBJ file and return vertices, uvs, and faces."""
     vertices = []
     uvs = []
     faces = []
+    polygons = []
 
     # OBJ indices are 1-based, we need to track the base index for each object
     vertex_offset = 0
@@ -76,6 +142,12 @@ def parse_obj(filepath):
                     face_verts.append(v_idx)
                     face_uvs.append(uv_idx)
 
+                # Remember which triangles came from the same polygon, so the
+                # v2 writer can turn it back into a fan
+                poly = len(polygons)
+                polygons.append((face_verts, face_uvs))
+                first_face = len(faces)
+
                 # Handle triangles and quads
                 # Reverse winding order (swap v1/v2) for correct backface culling on PS1
                 if len(face_verts) == 3:
@@ -101,7 +173,233 @@ def parse_obj(filepath):
                             'uvs': (face_uvs[0], face_uvs[i+1], face_uvs[i], -1)
                         })
 
-    return vertices, uvs, faces
+                for face in faces[first_face:]:
+                    face['poly'] = poly
+
+    return vertices, uvs, faces, polygons
+
+
+def cluster_vertices(vertices, cells):
+    """Snap vertices to a grid with the given number of cells on the longest
+    axis, returning the vertex kept for each original one."""
+    lo = [min(v[i] for v in vertices) for i in range(3)]
+    hi = [max(v[i] for v in vertices) for i in range(3)]
+    size = max(hi[i] - lo[i] for i in range(3)) / cells or 1.0
+
+    clusters = defaultdict(list)
+    for index, v in enumerate(vertices):
+        key = tuple(int((v[i] - lo[i]) / size) for i in range(3))
+        clusters[key].append(index)
+
+    # Each cluster is represented by its member closest to the centroid, so
+    # the simplified mesh only uses existing vertices (and their UVs)
+    remap = [0] * len(vertices)
+    for members in clusters.values():
+        centroid = [sum(vertices[m][i] for m in members) / len(members) for i in range(3)]
+        keep = min(members, key=lambda m: sum((vertices[m][i] - centroid[i]) ** 2 for i in range(3)))
+
+        for m in members:
+            remap[m] = keep
+
+    return remap
+
+
+def decimate(vertices, faces, ratio):
+    """
+    Simplify the triangle list to about ratio times its size. Triangle counts
+    don't grow monotonically with the grid resolution, so every resolution is
+    tried and the one closest to the target without exceeding it is kept.
+    Triangles that collapse or become duplicates are dropped.
+    """
+    target = max(1, int(len(faces) * ratio))
+
+    def collapse(cells):
+        remap = cluster_vertices(vertices, cells)
+        seen = set()
+        result = []
+
+        for face in faces:
+            verts = tuple(remap[v] for v in face['verts'][:3])
+            if len(set(verts)) < 3:
+                continue
+
+            # Rotate to a canonical corner so the same triangle isn't kept
+            # twice, whatever corner it starts from
+            key = verts[verts.index(min(verts)):] + verts[:verts.index(min(verts))]
+            if key in seen:
+                continue
+
+            seen.add(key)
+            result.append({
+                'verts': verts + (-1,),
+                'uvs': face['uvs'],
+                'poly': len(result)
+            })
+
+        return result
+
+    best = None
+    for cells in range(1, DECIMATE_MAX_CELLS + 1):
+        result = collapse(cells)
+
+        if not result or len(result) > target:
+            continue
+        if best is None or len(result) > len(best):
+            best = result
+
+    if best is None:
+        best = [dict(face, poly=i) for i, face in enumerate(faces)]
+
+    # Every simplified triangle is its own polygon, which keeps --fans and
+    # --quads from regrouping corners that no longer belong together
+    polygons = [
+        (list(face['verts'][:3]), list(face['uvs'][:3])) for face in best
+    ]
+    return best, polygons
+
+
+def triangle_normal(vertices, a, b, c):
+    """Unit normal of a triangle, or None if it is degenerate."""
+    p, q, r = vertices[a], vertices[b], vertices[c]
+    u = [q[i] - p[i] for i in range(3)]
+    v = [r[i] - p[i] for i in range(3)]
+    n = (u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0])
+    length = math.sqrt(sum(x * x for x in n))
+
+    return tuple(x / length for x in n) if length else None
+
+
+def face_normal(vertices, face):
+    """Outward unit normal of a face, or None if it is degenerate. Faces are
+    stored with reversed winding, so their cross product points inwards."""
+    n = triangle_normal(vertices, *face['verts'][:3])
+
+    return tuple(-x for x in n) if n else None
+
+
+def corner_normals(vertices, faces, crease_angle):
+    """
+    Give every face corner a normal averaged from the faces around its vertex
+    that are within the crease angle of the face itself. Returns the distinct
+    normals and, for each face, the index of each corner's normal.
+    """
+    threshold = math.cos(math.radians(crease_angle))
+    normals_of = [face_normal(vertices, face) for face in faces]
+
+    vertex_faces = defaultdict(list)
+    for i, face in enumerate(faces):
+        for v in face['verts']:
+            if v >= 0:
+                vertex_faces[v].append(i)
+
+    normals = []
+    index_of = {}
+    face_normals = []
+
+    for i, face in enumerate(faces):
+        own = normals_of[i]
+        indices = []
+
+        for v in face['verts']:
+            if v < 0:
+                indices.append(-1)
+                continue
+
+            total = [0.0, 0.0, 0.0]
+            for j in vertex_faces[v]:
+                other = normals_of[j]
+                if other is None:
+                    continue
+                if own is not None and sum(a * b for a, b in zip(own, other)) < threshold:
+                    continue
+
+                total = [total[c] + other[c] for c in range(3)]
+
+            length = math.sqrt(sum(x * x for x in total))
+            normal = tuple(x / length for x in total) if length else (own or (0.0, 0.0, 1.0))
+
+            # Flat faces and smooth vertices end up with the same normal on
+            # several corners, which only has to be stored and lit once
+            key = convert_normal(*normal)
+            if key not in index_of:
+                index_of[key] = len(normals)
+                normals.append(key)
+
+            indices.append(index_of[key])
+
+        face_normals.append(tuple(indices))
+
+    return normals, face_normals
+
+
+def merge_quads(vertices, faces, polygons):
+    """Fold the two triangles of each planar OBJ quad back into one face."""
+    merged = []
+    i = 0
+
+    while i < len(faces):
+        face = faces[i]
+        verts, poly_uvs = polygons[face['poly']]
+
+        if len(verts) != 4:
+            merged.append(face)
+            i += 1
+            continue
+
+        n0 = triangle_normal(vertices, verts[0], verts[2], verts[1])
+        n1 = triangle_normal(vertices, verts[0], verts[3], verts[2])
+
+        if n0 is None or n1 is None or sum(a * b for a, b in zip(n0, n1)) < QUAD_PLANAR_THRESHOLD:
+            merged.extend(faces[i:i + 2])
+            i += 2
+            continue
+
+        # The reversed quad runs p0-p3-p2-p1. Starting the GP0 order at p3
+        # keeps the split along p0-p2, so the GPU covers exactly the same two
+        # triangles the quad would have been split into.
+        order = (3, 2, 0, 1)
+        merged.append({
+            'verts': tuple(verts[k] for k in order),
+            'uvs': tuple(poly_uvs[k] for k in order),
+            'poly': face['poly']
+        })
+        i += 2
+
+    return merged
+
+
+def convert_vertex(x, y, z, scale):
+    """Scale an OBJ vertex and convert it to the PS1 coordinate system."""
+    # Swap Y and Z for PS1 coordinate system, negate Y
+    vx = int(x * scale)
+    vy = int(-z * scale)  # PS1 Y is up
+    vz = int(y * scale)   # PS1 Z is depth
+
+    # Clamp to int16 range
+    vx = max(-32768, min(32767, vx))
+    vy = max(-32768, min(32767, vy))
+    vz = max(-32768, min(32767, vz))
+
+    return vx, vy, vz
+
+
+def convert_normal(x, y, z):
+    """Convert a unit OBJ normal to a 4.12 vector in PS1 coordinates."""
+    # Same axis swap as convert_vertex(), which is a rotation, so outward
+    # normals stay outward
+    return tuple(
+        max(-32768, min(32767, int(round(c * GTE_ONE)))) for c in (x, -z, y)
+    )
+
+
+def convert_uv(u, v, tex_size):
+    """Convert an OBJ UV to texel coordinates."""
+    # OBJ UVs are 0-1, convert to pixel coordinates
+    # V is flipped in OBJ (0 = bottom, 1 = top)
+    pu = int(u * tex_size) % 256
+    pv = int((1.0 - v) * tex_size) % 256
+
+    return pu, pv
 
 
 def convert_to_binary(vertices, uvs, faces, scale=28.0, tex_size=64):
@@ -119,26 +417,14 @@ def convert_to_binary(vertices, uvs, faces, scale=28.0, tex_size=64):
     # Vertices (scaled and converted to int16)
     # GTEVector16 is 8 bytes: x, y, z, padding (each int16)
     for x, y, z in vertices:
-        # Scale and convert to 16-bit integers
-        # Swap Y and Z for PS1 coordinate system, negate Y
-        vx = int(x * scale)
-        vy = int(-z * scale)  # PS1 Y is up
-        vz = int(y * scale)   # PS1 Z is depth
-
-        # Clamp to int16 range
-        vx = max(-32768, min(32767, vx))
-        vy = max(-32768, min(32767, vy))
-        vz = max(-32768, min(32767, vz))
+        vx, vy, vz = convert_vertex(x, y, z, scale)
 
         # Pack as 8 bytes: x, y, z, padding (matching GTEVector16 structure)
         data.extend(struct.pack('<hhhh', vx, vy, vz, 0))
 
     # UVs (converted to 0-255 range based on texture size)
     for u, v in uvs:
-        # OBJ UVs are 0-1, convert to pixel coordinates
-        # V is flipped in OBJ (0 = bottom, 1 = top)
-        pu = int(u * tex_size) % 256
-        pv = int((1.0 - v) * tex_size) % 256
+        pu, pv = convert_uv(u, v, tex_size)
 
         data.extend(struct.pack('<BB', pu, pv))
 
@@ -162,6 +448,299 @@ def convert_to_binary(vertices, uvs, faces, scale=28.0, tex_size=64):
     return bytes(data)
 
 
+def optimize_triangle_order(triangles):
+    """
+    Greedily reorder triangles (or quads) so each one reuses recently used
+    vertices, scoring candidates against a small simulated FIFO.
+    """
+    vertex_tris = defaultdict(list)
+    for i, tri in enumerate(triangles):
+        for v in set(tri):
+            vertex_tris[v].append(i)
+
+    emitted = [False] * len(triangles)
+    order = []
+    fifo = []
+    fallback = 0
+
+    while len(order) < len(triangles):
+        best = None
+        best_score = 0
+
+        candidates = sorted({t for v in fifo for t in vertex_tris[v] if not emitted[t]})
+        for t in candidates:
+            score = sum(ORDER_CACHE_SIZE - fifo.index(v)
+                        for v in triangles[t] if v in fifo)
+            if score > best_score:
+                best, best_score = t, score
+
+        if best is None:
+            while emitted[fallback]:
+                fallback += 1
+            best = fallback
+
+        emitted[best] = True
+        order.append(best)
+
+        for v in triangles[best]:
+            if v in fifo:
+                fifo.remove(v)
+            fifo.insert(0, v)
+        del fifo[ORDER_CACHE_SIZE:]
+
+    return order
+
+
+def build_strip(start, corners, edge_map, used):
+    """Grow the longest strip starting from the given triangle."""
+    best = None
+
+    for rotation in range(3):
+        tri = corners[start]
+        strip = [tri[rotation], tri[(rotation + 1) % 3], tri[(rotation + 2) % 3]]
+        members = [start]
+        taken = {start}
+
+        while True:
+            k = len(strip) - 2
+            # Even triangles keep the edge direction, odd ones are decoded
+            # with their first two corners swapped
+            edge = (strip[k], strip[k + 1]) if (k % 2 == 0) else (strip[k + 1], strip[k])
+
+            next_tri = None
+            for t, third in edge_map.get(edge, []):
+                if not used[t] and t not in taken:
+                    next_tri = (t, third)
+                    break
+
+            if next_tri is None:
+                break
+
+            strip.append(next_tri[1])
+            members.append(next_tri[0])
+            taken.add(next_tri[0])
+
+        if best is None or len(members) > len(best[1]):
+            best = (strip, members)
+
+    return best
+
+
+def build_groups(faces, polygons, uvs, tex_size, use_strips, use_fans,
+                 face_normals=None):
+    """Split faces into list, strip, fan and quad groups in locality order.
+    Corners are (vertex, uv, normal) tuples, normal 0 without face_normals,
+    so strips only join triangles across edges shaded smoothly."""
+    def corner(v, uv, n=0):
+        pu, pv = convert_uv(*uvs[uv], tex_size) if uvs else (0, 0)
+        return (v, pu | (pv << 8), n)
+
+    corners = []
+    poly_normal = {}
+    for i, face in enumerate(faces):
+        count = 4 if face['verts'][3] >= 0 else 3
+        normals = face_normals[i] if face_normals else (0,) * count
+        corners.append(tuple(
+            corner(v, uv, n) for v, uv, n in
+            zip(face['verts'][:count], face['uvs'][:count], normals[:count])
+        ))
+
+        for v, n in zip(face['verts'][:count], normals[:count]):
+            poly_normal.setdefault((face['poly'], v), n)
+
+    order = optimize_triangle_order([tuple(c[0] for c in tri) for tri in corners])
+
+    used = [False] * len(faces)
+    group_of = [None] * len(faces)
+    groups = []
+
+    if use_fans:
+        poly_faces = defaultdict(list)
+        for i, face in enumerate(faces):
+            poly_faces[face['poly']].append(i)
+
+        for poly, members in poly_faces.items():
+            # Merged quads are a single face and stay quads
+            if len(members) < 2:
+                continue
+
+            # Fan corners run backwards around the polygon, matching the
+            # reversed winding used for single triangles
+            verts, poly_uvs = polygons[poly]
+            def fan_corner(i):
+                return corner(verts[i], poly_uvs[i], poly_normal[(poly, verts[i])])
+
+            fan = [fan_corner(0)]
+            fan += [fan_corner(i) for i in range(len(verts) - 1, 0, -1)]
+
+            for t in members:
+                used[t] = True
+                group_of[t] = len(groups)
+            groups.append((GROUP_FAN, len(members), fan))
+
+    if use_strips:
+        edge_map = defaultdict(list)
+        for t, tri in enumerate(corners):
+            if len(tri) != 3:
+                continue
+
+            a, b, c = tri
+            edge_map[(a, b)].append((t, c))
+            edge_map[(b, c)].append((t, a))
+            edge_map[(c, a)].append((t, b))
+
+        for t in order:
+            if used[t] or len(corners[t]) != 3:
+                continue
+
+            strip, members = build_strip(t, corners, edge_map, used)
+            if len(members) < 2:
+                continue
+
+            for m in members:
+                used[m] = True
+                group_of[m] = len(groups)
+            groups.append((GROUP_STRIP, len(members), strip))
+
+    # Emit groups in the order their first face appears, gathering runs of
+    # loose triangles into lists and loose quads into quad groups
+    output = []
+    emitted = set()
+    loose = []
+    loose_size = 3
+
+    def flush():
+        if loose:
+            group_type = GROUP_QUADS if loose_size == 4 else GROUP_LIST
+            output.append((group_type, len(loose) // loose_size, loose[:]))
+            loose.clear()
+
+    for t in order:
+        g = group_of[t]
+
+        if g is None:
+            if len(corners[t]) != loose_size:
+                flush()
+                loose_size = len(corners[t])
+
+            loose.extend(corners[t])
+            continue
+        if g in emitted:
+            continue
+
+        flush()
+        emitted.add(g)
+        output.append(groups[g])
+
+    flush()
+    return output
+
+
+def compute_bounding_sphere(points):
+    """Ritter's bounding sphere, grown until it contains every point."""
+    def dist(a, b):
+        return math.sqrt(sum((a[i] - b[i]) ** 2 for i in range(3)))
+
+    if not points:
+        return (0, 0, 0), 0
+
+    p = points[0]
+    q = max(points, key=lambda x: dist(p, x))
+    r = max(points, key=lambda x: dist(q, x))
+
+    center = [(q[i] + r[i]) / 2 for i in range(3)]
+    radius = dist(q, r) / 2
+
+    for point in points:
+        d = dist(center, point)
+        if d > radius:
+            radius = (radius + d) / 2
+            k = (d - radius) / d
+            center = [center[i] + (point[i] - center[i]) * k for i in range(3)]
+
+    # Round the center, then make sure the integer sphere still contains
+    # every point
+    center = tuple(int(round(c)) for c in center)
+    radius = max(dist(center, point) for point in points)
+
+    return center, int(math.ceil(radius))
+
+
+def convert_to_binary_v2(vertices, uvs, faces, polygons, scale=28.0, tex_size=64,
+                         use_strips=False, use_fans=False, normals=None,
+                         face_normals=None):
+    """Convert parsed OBJ data to the packed v2 format, or v3 if corner
+    normals are given."""
+    groups = build_groups(
+        faces, polygons, uvs, tex_size, use_strips, use_fans, face_normals
+    )
+
+    # Renumber vertices and normals in first use order, dropping unreferenced
+    # ones
+    remap = {}
+    normal_remap = {}
+    for _, _, group_corners in groups:
+        for v, _, n in group_corners:
+            if v not in remap:
+                remap[v] = len(remap)
+            if n not in normal_remap:
+                normal_remap[n] = len(normal_remap)
+
+    points = [None] * len(remap)
+    for v, new_index in remap.items():
+        points[new_index] = convert_vertex(*vertices[v], scale)
+
+    center, radius = compute_bounding_sphere(points)
+    num_faces = sum(count for _, count, _ in groups)
+
+    version = MODEL_VERSION_3 if normals else MODEL_VERSION_2
+
+    data = bytearray()
+    data.extend(struct.pack('<HHHH', len(points), len(groups), num_faces, version))
+    data.extend(struct.pack('<hhhH', *center, min(radius, 65535)))
+
+    for vx, vy, vz in points:
+        data.extend(struct.pack('<hhhh', vx, vy, vz, 0))
+
+    if normals:
+        ordered = [None] * len(normal_remap)
+        for n, new_index in normal_remap.items():
+            ordered[new_index] = normals[n]
+
+        data.extend(struct.pack('<HH', len(ordered), 0))
+        for nx, ny, nz in ordered:
+            data.extend(struct.pack('<hhhh', nx, ny, nz, 0))
+
+    for group_type, count, group_corners in groups:
+        data.extend(struct.pack('<I', (group_type << 16) | count))
+
+        for v, uv, _ in group_corners:
+            data.extend(struct.pack('<I', remap[v] | (uv << 16)))
+
+    if normals:
+        for _, _, group_corners in groups:
+            for _, _, n in group_corners:
+                data.extend(struct.pack('<H', normal_remap[n]))
+
+        while len(data) % 4 != 0:
+            data.append(0)
+
+    stats = defaultdict(int)
+    for group_type, count, _ in groups:
+        stats[group_type] += count
+
+    return bytes(data), {
+        'vertices': len(points),
+        'normals': len(normal_remap) if normals else 0,
+        'groups': len(groups),
+        'list': stats[GROUP_LIST],
+        'strip': stats[GROUP_STRIP],
+        'fan': stats[GROUP_FAN],
+        'quad': stats[GROUP_QUADS],
+        'radius': radius
+    }
+
+
 def main():
     parser = argparse.ArgumentParser(description='Convert OBJ to PS1 binary format')
     parser.add_argument('input', help='Input OBJ file')
@@ -170,17 +749,55 @@ def main():
                         help='Scale factor for vertices (default: 28.0)')
     parser.add_argument('-t', '--texsize', type=int, default=64,
                         help='Texture size in pixels (default: 64)')
+    parser.add_argument('-f', '--format', type=int, choices=(1, 2), default=2,
+                        help='Output format version (default: 2)')
+    parser.add_argument('--strips', action='store_true',
+                        help='Stitch triangles into strips (v2 only)')
+    parser.add_argument('--fans', action='store_true',
+                        help='Keep OBJ polygons as triangle fans (v2 only)')
+    parser.add_argument('-d', '--decimate', type=float, default=1.0,
+                        help='Fraction of triangles to keep (default: 1.0)')
+    parser.add_argument('--quads', action='store_true',
+                        help='Keep planar OBJ quads as GP0 quads')
+    parser.add_argument('-n', '--normals', action='store_true',
+                        help='Add vertex normals for GTE lighting (v3, v2 only)')
+    parser.add_argument('--crease', type=float, default=CREASE_ANGLE,
+                        help=f'Angle in degrees above which edges stay hard '
+                             f'(default: {CREASE_ANGLE})')
 
     args = parser.parse_args()
 
     print(f"Converting {args.input} to {args.output}")
 
-    vertices, uvs, faces = parse_obj(args.input)
+    vertices, uvs, faces, polygons = parse_obj(args.input)
+    if args.decimate < 1.0:
+        faces, polygons = decimate(vertices, faces, args.decimate)
+    if args.quads:
+        faces = merge_quads(vertices, faces, polygons)
+
+    normals = None
+    face_normals = None
+    if args.normals and args.format == 2:
+        normals, face_normals = corner_normals(vertices, faces, args.crease)
+
     print(f"  Vertices: {len(vertices)}")
     print(f"  UVs: {len(uvs)}")
     print(f"  Faces: {len(faces)}")
 
-    binary_data = convert_to_binary(vertices, uvs, faces, args.scale, args.texsize)
+    if args.format == 1:
+        binary_data = convert_to_binary(vertices, uvs, faces, args.scale, args.texsize)
+    else:
+        binary_data, info = convert_to_binary_v2(
+            vertices, uvs, faces, polygons, args.scale, args.texsize,
+            args.strips, args.fans, normals, face_normals
+        )
+        print(f"  Used vertices: {info['vertices']}")
+        if normals:
+            print(f"  Normals: {info['normals']}")
+        print(f"  Groups: {info['groups']} "
+              f"(list {info['list']}, strip {info['strip']}, fan {info['fan']} triangles, "
+              f"{info['quad']} quads)")
+        print(f"  Bounding radius: {info['radius']}")
     print(f"  Output size: {len(binary_data)} bytes")
 
     # Ensure output directory exists
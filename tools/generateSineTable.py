@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""
+Generate the quarter-wave sine lookup table used by src/trig.c.
+
+Output is a C header defining SINE_TABLE_BITS and sineTable[], which holds
+(1 << bits) + 1 entries of sin(0..pi/2) in 4.12 fixed-point. The extra entry
+at the end lets the lookup mirror and interpolate without bounds checks.
+"""
+
+import argparse
+import math
+from pathlib import Path
+
+
+def generate_table(bits, one):
+    steps = 1 << bits
+
+    return [round(math.sin((i / steps) * (math.pi / 2)) * one) for i in range(steps + 1)]
+
+
+def format_header(bits, table, per_line=12):
+    lines = [
+        '/* Generated by tools/generateSineTable.py, do not edit */',
+        '',
+        '#pragma once',
+        '',
+        '#include <stdint.h>',
+        '',
+        f'#define SINE_TABLE_BITS {bits}',
+        '',
+        f'static const int16_t sineTable[{len(table)}] = {{',
+    ]
+
+    for i in range(0, len(table), per_line):
+        row = ', '.join(f'{value:4d}' for value in table[i:i + per_line])
+        lines.append(f'\t{row},')
+
+    lines.append('};')
+    lines.append('')
+
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate the sine lookup table header')
+    parser.add_argument('output', help='Output header file')
+    parser.add_argument('-b', '--bits', type=int, default=8,
+                        help='log2 of the number of steps per quadrant (default: 8)')
+    parser.add_argument('-o', '--one', type=int, default=4096,
+                        help='Fixed-point value of 1.0 (default: 4096)')
+
+    args = parser.parse_args()
+
+    table = generate_table(args.bits, args.one)
+
+    Path(args.output).parent.mkdir(parents=True, exist_ok=True)
+
+    with open(args.output, 'w') as f:
+        f.write(format_header(args.bits, table))
+
+    print(f"Generated {args.output}: {len(table)} entries ({len(table) * 2} bytes)")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""
+Pack assets listed in a JSON manifest into a single sector-aligned archive.
+
+Manifest format:
+  {
+    "assets": [
+      { "name": "MODEL", "source": "lander/modelData.bin",
+        "type": "model", "group": "boot" },
+      ...
+    ]
+  }
+
+  Names are looked up at runtime by their FNV-1a hash, so they must be unique
+  (case-insensitive). Sources are searched for in each --search directory in
+  turn. Assets sharing a group are loaded together and are placed next to
+  each other on disc with --order group (the default), groups following each
+  other in the order they first appear; --order manifest keeps the manifest
+  order as is.
+
+Archive format:
+  TOC sector (2048 bytes):
+    uint32_t magic ("LPAK")
+    uint16_t version (1)
+    uint16_t num_entries
+    Entries (num_entries * 12 bytes, at most 170):
+      uint32_t name_hash  (FNV-1a of the upper case name)
+      uint32_t type << 24 | sector offset from the start of the archive
+      uint32_t size in bytes
+
+  Asset data, each blob starting on a sector boundary and padded with zeroes.
+"""
+
+import argparse
+import json
+import struct
+import sys
+from pathlib import Path
+
+SECTOR_SIZE = 2048
+ARCHIVE_MAGIC = b'LPAK'
+ARCHIVE_VERSION = 1
+TOC_HEADER_SIZE = 8
+TOC_ENTRY_SIZE = 12
+MAX_ENTRIES = (SECTOR_SIZE - TOC_HEADER_SIZE) // TOC_ENTRY_SIZE
+MAX_OFFSET = (1 << 24) - 1
+
+# Must match ArchiveAssetType in src/archive.h
+ASSET_TYPES = {
+    'raw': 0,
+    'model': 1,
+    'texture': 2,
+    'palette': 3,
+    'sound': 4,
+}
+
+
+def fnv1a(name):
+    """32-bit FNV-1a hash of the upper case name, as computed by archive.c."""
+    h = 0x811c9dc5
+    for c in name.upper().encode('ascii'):
+        h = ((h ^ c) * 0x01000193) & 0xffffffff
+    return h
+
+
+def find_source(source, search_dirs):
+    for directory in search_dirs:
+        path = Path(directory) / source
+        if path.exists():
+            return path
+    return None
+
+
+def order_assets(assets, order):
+    """Return the assets in disc order."""
+    if order == 'manifest':
+        return list(assets)
+
+    groups = {}
+    for asset in assets:
+        groups.setdefault(asset.get('group', asset['name']), []).append(asset)
+    return [asset for group in groups.values() for asset in group]
+
+
+def pack_archive(assets, search_dirs, order):
+    """Build the archive, returns its data and the resulting layout."""
+    if len(assets) > MAX_ENTRIES:
+        raise ValueError(f"too many assets ({len(assets)}, max {MAX_ENTRIES})")
+
+    hashes = {}
+    for asset in assets:
+        h = fnv1a(asset['name'])
+        if h in hashes:
+            raise ValueError(f"{asset['name']} collides with {hashes[h]}")
+        hashes[h] = asset['name']
+
+    toc = bytearray(struct.pack('<4sHH', ARCHIVE_MAGIC, ARCHIVE_VERSION, len(assets)))
+    blobs = bytearray()
+    layout = []
+
+    for asset in order_assets(assets, order):
+        path = find_source(asset['source'], search_dirs)
+        if path is None:
+            raise FileNotFoundError(f"{asset['source']} not found")
+
+        type_name = asset.get('type', 'raw')
+        if type_name not in ASSET_TYPES:
+            raise ValueError(f"{asset['name']}: unknown type {type_name}")
+
+        data = path.read_bytes()
+        offset = 1 + len(blobs) // SECTOR_SIZE
+        if offset > MAX_OFFSET:
+            raise ValueError("archive too large")
+
+        toc.extend(struct.pack('<III',
+            fnv1a(asset['name']),
+            (ASSET_TYPES[type_name] << 24) | offset,
+            len(data)
+        ))
+
+        blobs.extend(data)
+        blobs.extend(bytes(-len(blobs) % SECTOR_SIZE))
+        layout.append((asset['name'], asset.get('group', ''), offset, len(data)))
+
+    toc.extend(bytes(SECTOR_SIZE - len(toc)))
+    return bytes(toc + blobs), layout
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Pack assets into a PS1 disc archive')
+    parser.add_argument('manifest', help='Input JSON manifest')
+    parser.add_argument('output', help='Output archive file')
+    parser.add_argument('-I', '--search', action='append', default=[],
+                        help='Directory to look for asset sources in (repeatable, '
+                             'defaults to the manifest directory)')
+    parser.add_argument('--order', choices=('group', 'manifest'), default='group',
+                        help='Keep assets of a group contiguous, or keep the '
+                             'manifest order')
+
+    args = parser.parse_args()
+
+    manifest = json.loads(Path(args.manifest).read_text())
+    search_dirs = args.search or [Path(args.manifest).parent]
+
+    print(f"Packing {args.manifest} to {args.output}")
+
+    try:
+        data, layout = pack_archive(manifest['assets'], search_dirs, args.order)
+    except (ValueError, FileNotFoundError) as e:
+        print(f"ERROR: {e}")
+        sys.exit(1)
+
+    for name, group, offset, size in layout:
+        print(f"  {name:<16} {group:<8} sector {offset:>5}, {size} bytes")
+    print(f"  Output size: {len(data)} bytes ({len(data) // SECTOR_SIZE} sectors)")
+
+    Path(args.output).parent.mkdir(parents=True, exist_ok=True)
+
+    with open(args.output, 'wb') as f:
+        f.write(data)
+
+    print("Done!")
+
+
+if __name__ == '__main__':
+    main()
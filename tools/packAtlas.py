@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""
+Pack raw images (as output by convertImage) into a single VRAM atlas.
+
+Images are given as NAME=path:WIDTHxHEIGHT:BPP, width and height in texels
+and BPP being 4, 8 or 16. Images of any depth can share an atlas since the
+packing is done in VRAM halfwords, a 4bpp image taking width / 4 of them per
+row. They're shelf packed tallest first into an area no wider than a texture
+page (64 halfwords) nor taller than 256 rows, so the whole atlas is sent to
+VRAM with one upload and every entry is reachable through the same texpage.
+
+An empty path (NAME=:WIDTHxHEIGHT:BPP) reserves a blank image instead, for
+builds that can't run the image converter.
+
+Atlas data format:
+  Rows of uint16_t, ATLAS_<ATLAS>_WIDTH halfwords each, unused areas zeroed.
+
+Header format:
+  #define ATLAS_<ATLAS>_WIDTH  <width in halfwords>
+  #define ATLAS_<ATLAS>_HEIGHT <height in rows>
+
+  And for each entry:
+  #define ATLAS_<ATLAS>_<NAME>_X      <offset in halfwords>
+  #define ATLAS_<ATLAS>_<NAME>_Y      <offset in rows>
+  #define ATLAS_<ATLAS>_<NAME>_WIDTH  <width in texels>
+  #define ATLAS_<ATLAS>_<NAME>_HEIGHT <height in texels>
+"""
+
+import argparse
+import re
+import sys
+from pathlib import Path
+
+PAGE_WIDTH  = 64
+PAGE_HEIGHT = 256
+
+TEXELS_PER_HALFWORD = { 4: 4, 8: 2, 16: 1 }
+
+
+class Image:
+    def __init__(self, spec):
+        match = re.fullmatch(r"(\w+)=(.*):(\d+)x(\d+):(\d+)", spec)
+        if not match:
+            raise ValueError(f"invalid image '{spec}', expected NAME=path:WxH:BPP")
+
+        self.name   = match.group(1).upper()
+        self.path   = Path(match.group(2)) if match.group(2) else None
+        self.width  = int(match.group(3))
+        self.height = int(match.group(4))
+        self.bpp    = int(match.group(5))
+
+        if self.bpp not in TEXELS_PER_HALFWORD:
+            raise ValueError(f"{self.name}: unsupported depth {self.bpp}")
+
+        divider = TEXELS_PER_HALFWORD[self.bpp]
+
+        if self.width % divider:
+            raise ValueError(f"{self.name}: width must be a multiple of {divider}")
+
+        self.row_width = self.width // divider
+        self.data      = (
+            self.path.read_bytes() if self.path
+            else bytes(self.row_width * self.height * 2)
+        )
+        self.x         = 0
+        self.y         = 0
+
+        if len(self.data) != self.row_width * self.height * 2:
+            raise ValueError(
+                f"{self.name}: {self.path} is {len(self.data)} bytes, expected "
+                f"{self.row_width * self.height * 2}"
+            )
+        if (self.row_width > PAGE_WIDTH) or (self.height > PAGE_HEIGHT):
+            raise ValueError(f"{self.name}: larger than a texture page")
+
+
+def pack(images):
+    """Shelf pack images tallest first, returning the atlas size"""
+    shelf_x, shelf_y, shelf_height = 0, 0, 0
+    width = 0
+
+    for image in sorted(images, key=lambda i: (-i.height, -i.row_width)):
+        if (shelf_x + image.row_width) > PAGE_WIDTH:
+            shelf_x       = 0
+            shelf_y      += shelf_height
+            shelf_height  = 0
+
+        if (shelf_y + image.height) > PAGE_HEIGHT:
+            raise ValueError(f"{image.name}: atlas doesn't fit in a texture page")
+
+        image.x       = shelf_x
+        image.y       = shelf_y
+        shelf_x      += image.row_width
+        shelf_height  = max(shelf_height, image.height)
+        width         = max(width, shelf_x)
+
+    # Keep rows a whole number of words so the atlas can be sent in bands
+    width += width % 2
+
+    return width, shelf_y + shelf_height
+
+
+def write_atlas(path, images, width, height):
+    atlas = bytearray(width * height * 2)
+    pitch = width * 2
+
+    for image in images:
+        row = image.row_width * 2
+
+        for y in range(image.height):
+            src = y * row
+            dst = (image.y + y) * pitch + image.x * 2
+
+            atlas[dst:dst + row] = image.data[src:src + row]
+
+    Path(path).write_bytes(atlas)
+
+
+def write_header(path, name, images, width, height):
+    prefix = f"ATLAS_{name.upper()}"
+    lines  = [
+        "/* Generated by packAtlas.py, do not edit */",
+        "",
+        "#pragma once",
+        "",
+        f"#define {prefix}_WIDTH  {width}",
+        f"#define {prefix}_HEIGHT {height}",
+    ]
+
+    for image in images:
+        lines += [
+            "",
+            f"#define {prefix}_{image.name}_X      {image.x}",
+            f"#define {prefix}_{image.name}_Y      {image.y}",
+            f"#define {prefix}_{image.name}_WIDTH  {image.width}",
+            f"#define {prefix}_{image.name}_HEIGHT {image.height}",
+        ]
+
+    Path(path).write_text("\n".join(lines) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Pack raw images into a single texture page sized VRAM atlas"
+    )
+    parser.add_argument("images", nargs="+", help="NAME=path:WIDTHxHEIGHT:BPP")
+    parser.add_argument("-n", "--name", default="main", help="Atlas name used in the header")
+    parser.add_argument("-o", "--output", required=True, help="Raw atlas data output")
+    parser.add_argument("--header", required=True, help="C header output")
+    args = parser.parse_args()
+
+    try:
+        images = [Image(spec) for spec in args.images]
+
+        if len({ image.name for image in images }) != len(images):
+            raise ValueError("image names must be unique")
+
+        width, height = pack(images)
+    except (ValueError, OSError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        sys.exit(1)
+
+    write_atlas(args.output, images, width, height)
+    write_header(args.header, args.name, images, width, height)
+
+    print(
+        f"Packed {len(images)} images into a {width}x{height} atlas "
+        f"({width * height * 2} bytes)"
+    )
+
+
+if __name__ == "__main__":
+    main()